@@ -249,35 +249,6 @@ def _format_posix_json(path, acl, uid, gid, fh_hex, numeric, synthesized=False):
     return d
 
 
-def _fs_source_from_proc_mounts(mountpoint):
-    """Read /proc/mounts to find the filesystem source for a mountpoint."""
-    with open('/proc/mounts') as f:
-        for line in f:
-            parts = line.split()
-            if len(parts) >= 2 and parts[1] == mountpoint:
-                return parts[0]
-    return mountpoint
-
-
-def _get_mount_info(path):
-    stx = t.statx(path, mask=t.STATX_MNT_ID_UNIQUE)
-    if hasattr(t, 'STATMOUNT_SB_SOURCE'):
-        sm = t.statmount(stx.stx_mnt_id,
-                         mask=t.STATMOUNT_MNT_POINT | t.STATMOUNT_SB_SOURCE)
-        mountpoint = sm.mnt_point
-        fs_name = sm.sb_source
-    else:
-        # This is is compatiblity for github runner where kernel doesn't
-        # return source in statmount output.
-        sm = t.statmount(stx.stx_mnt_id, mask=t.STATMOUNT_MNT_POINT)
-        mountpoint = sm.mnt_point
-        fs_name = _fs_source_from_proc_mounts(mountpoint)
-    abs_path = os.path.realpath(path)
-    rel = os.path.relpath(abs_path, mountpoint)
-    rel_path = None if rel == '.' else rel
-    return mountpoint, fs_name, rel_path
-
-
 def _output_acl(path, fd, acl, uid, gid, numeric, quiet, use_json, skip_base,
                 synthesized=False):
     if skip_base and acl.trivial:
@@ -366,14 +337,18 @@ def main():
             continue
 
         try:
-            mountpoint, fs_name, rel_path = _get_mount_info(path)
+            dir_fd = t.openat2(path, flags=os.O_RDONLY | os.O_DIRECTORY,
+                               resolve=t.RESOLVE_NO_SYMLINKS)
+            try:
+                it = t.iter_filesystem_contents_fd(dir_fd, path=path)
+            finally:
+                os.close(dir_fd)
         except OSError as e:
             print(f'truenas_getfacl: {path}: {e}', file=sys.stderr)
             rc = 1
             continue
 
-        with t.iter_filesystem_contents(mountpoint, fs_name,
-                                        relative_path=rel_path) as it:
+        with it:
             for item in it:
                 full_path = os.path.join(item.parent, item.name)
                 if item.islnk:
@@ -14,16 +14,20 @@ truenas_os_ext = Extension(
         'src/cext/os/move_mount.c',
         'src/cext/os/mount_setattr.c',
         'src/cext/os/fsmount.c',
+        'src/cext/os/mount_tree.c',
         'src/cext/os/umount2.c',
         'src/cext/os/userns.c',
         'src/cext/os/acl_check.c',
         'src/cext/os/renameat2.c',
         'src/cext/os/fsiter.c',
         'src/cext/os/acl.c',
+        'src/cext/os/acl_diff.c',
         'src/cext/os/util_enum.c',
         'src/cext/os/nfs4acl.c',
         'src/cext/os/posixacl.c',
         'src/cext/os/xattr.c',
+        'src/cext/os/checksum.c',
+        'src/cext/os/fcopy.c',
     ],
     include_dirs=['src/cext/os']
 )
@@ -34,6 +38,11 @@ truenas_pyfilter_ext = Extension(
         'src/cext/filter_utils/truenas_pyfilter.c',
         'src/cext/filter_utils/filter_list.c',
         'src/cext/filter_utils/filter_options.c',
+        'src/cext/filter_utils/filter_set.c',
+        'src/cext/filter_utils/live_query.c',
+        'src/cext/filter_utils/filter_explain.c',
+        'src/cext/filter_utils/filter_page.c',
+        'src/cext/filter_utils/filter_lookup.c',
     ],
     include_dirs=['src/cext/filter_utils'],
     extra_compile_args=['-O2', '-Wall', '-Wextra', '-Wno-unused-parameter'],
@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+/*
+ * explain(): a profiled tnfilter() run.
+ *
+ * The query runs exactly as tnfilter() runs it, with a prof_node_t tree
+ * (prof_tree_new()) threaded through filter_list_run() and phase timers
+ * through apply_options().  The counters come back as ProfileNode /
+ * QueryProfile struct sequences plus a plain-text tree dump, so a filter
+ * author can see which term is slow or unselective and reorder it.
+ */
+
+#include <string.h>
+#include "filter_list.h"
+
+static PyStructSequence_Field profile_node_fields[] = {
+    {"term", "[path, op, value] for a leaf, or \"OR\" / \"AND\""},
+    {"evaluations", "Times the node was evaluated"},
+    {"matches", "Evaluations that matched"},
+    {"path_misses", "Leaf evaluations that found no value at the path"},
+    {"time_ns", "Time spent in the node, children and operator calls "
+                "included"},
+    {"children", "ProfileNode of each branch (OR / AND only)"},
+    {NULL}
+};
+
+static PyStructSequence_Desc profile_node_desc = {
+    .name = "truenas_pyfilter.ProfileNode",
+    .doc = "Counters for one node of a compiled filter tree, from explain().",
+    .fields = profile_node_fields,
+    .n_in_sequence = 6,
+};
+
+static PyStructSequence_Field query_profile_fields[] = {
+    {"result", "What tnfilter() returns for the same arguments"},
+    {"items", "Items examined (fewer than len(data) when get=True "
+              "short-circuits)"},
+    {"matched", "Items that passed every filter"},
+    {"filter_ns", "Time spent iterating and filtering (and grouping)"},
+    {"select_ns", "Time spent in select projection"},
+    {"order_ns", "Time spent in order_by"},
+    {"slice_ns", "Time spent applying offset/limit"},
+    {"total_ns", "Wall time of the whole run"},
+    {"filters", "ProfileNode of each top-level filter (implicitly AND'd)"},
+    {"tree", "Human-readable dump of the above"},
+    {NULL}
+};
+
+static PyStructSequence_Desc query_profile_desc = {
+    .name = "truenas_pyfilter.QueryProfile",
+    .doc = "Profiled tnfilter() run, from explain().",
+    .fields = query_profile_fields,
+    .n_in_sequence = 10,
+};
+
+int
+init_explain_types(PyObject *module, fl_state_t *state)
+{
+    state->ProfileNodeType =
+        (PyObject *)PyStructSequence_NewType(&profile_node_desc);
+    if (!state->ProfileNodeType)
+        return -1;
+    if (PyModule_AddObjectRef(module, "ProfileNode", state->ProfileNodeType) < 0)
+        return -1;
+
+    state->QueryProfileType =
+        (PyObject *)PyStructSequence_NewType(&query_profile_desc);
+    if (!state->QueryProfileType)
+        return -1;
+    return PyModule_AddObjectRef(module, "QueryProfile",
+                                 state->QueryProfileType);
+}
+
+/* ===========================================================================
+ * Conversion
+ * =========================================================================== */
+
+static PyObject *nodes_to_tuple(prof_node_t *nodes, Py_ssize_t n,
+                                fl_state_t *state);
+
+static PyObject *
+node_to_py(prof_node_t *pn, fl_state_t *state)
+{
+    PyObject *children = NULL;
+    PyObject *node = NULL;
+
+    children = nodes_to_tuple(pn->ch, pn->nch, state);
+    if (!children)
+        return NULL;
+
+    node = PyStructSequence_New((PyTypeObject *)state->ProfileNodeType);
+    if (!node) {
+        Py_DECREF(children);
+        return NULL;
+    }
+    PyStructSequence_SET_ITEM(node, 0, Py_NewRef(pn->term));
+    PyStructSequence_SET_ITEM(node, 1, PyLong_FromSsize_t(pn->evaluations));
+    PyStructSequence_SET_ITEM(node, 2, PyLong_FromSsize_t(pn->matches));
+    PyStructSequence_SET_ITEM(node, 3, PyLong_FromSsize_t(pn->path_misses));
+    PyStructSequence_SET_ITEM(node, 4,
+                              PyLong_FromUnsignedLongLong(pn->time_ns));
+    PyStructSequence_SET_ITEM(node, 5, children);
+    if (!PyStructSequence_GET_ITEM(node, 1) ||
+        !PyStructSequence_GET_ITEM(node, 2) ||
+        !PyStructSequence_GET_ITEM(node, 3) ||
+        !PyStructSequence_GET_ITEM(node, 4))
+        Py_CLEAR(node);
+    return node;
+}
+
+static PyObject *
+nodes_to_tuple(prof_node_t *nodes, Py_ssize_t n, fl_state_t *state)
+{
+    PyObject *tuple = NULL;
+    PyObject *node = NULL;
+    Py_ssize_t i;
+
+    tuple = PyTuple_New(n);
+    if (!tuple)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        node = node_to_py(&nodes[i], state);
+        if (!node) {
+            Py_DECREF(tuple);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(tuple, i, node);
+    }
+    return tuple;
+}
+
+/* ===========================================================================
+ * Tree dump
+ * =========================================================================== */
+
+/* "1.234 ms" (microsecond resolution) */
+static PyObject *
+fmt_ms(uint64_t ns)
+{
+    return PyUnicode_FromFormat("%llu.%03llu ms",
+                                (unsigned long long)(ns / 1000000),
+                                (unsigned long long)(ns / 1000 % 1000));
+}
+
+static int
+append_line(PyObject *lines, PyObject *line)
+{
+    int r;
+
+    if (!line)
+        return -1;
+    r = PyList_Append(lines, line);
+    Py_DECREF(line);
+    return r;
+}
+
+static int
+dump_nodes(PyObject *lines, prof_node_t *nodes, Py_ssize_t n, int depth)
+{
+    prof_node_t *pn = NULL;
+    PyObject *ms = NULL;
+    PyObject *line = NULL;
+    char indent[64];
+    Py_ssize_t pct;
+    Py_ssize_t i;
+    int w;
+
+    w = depth * 2 < (int)sizeof(indent) ? depth * 2 : (int)sizeof(indent) - 1;
+    memset(indent, ' ', (size_t)w);
+    indent[w] = '\0';
+
+    for (i = 0; i < n; i++) {
+        pn = &nodes[i];
+        pct = pn->evaluations ? pn->matches * 1000 / pn->evaluations : 0;
+        ms = fmt_ms(pn->time_ns);
+        if (!ms)
+            return -1;
+        if (pn->nch == 0) {
+            line = PyUnicode_FromFormat(
+                "%s%R  evals=%zd matches=%zd (%zd.%zd%%) misses=%zd %U",
+                indent, pn->term, pn->evaluations, pn->matches,
+                pct / 10, pct % 10, pn->path_misses, ms);
+        } else {
+            line = PyUnicode_FromFormat(
+                "%s%U  evals=%zd matches=%zd (%zd.%zd%%) %U",
+                indent, pn->term, pn->evaluations, pn->matches,
+                pct / 10, pct % 10, ms);
+        }
+        Py_DECREF(ms);
+        if (append_line(lines, line) < 0)
+            return -1;
+        if (dump_nodes(lines, pn->ch, pn->nch, depth + 1) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static PyObject *
+dump_tree(prof_node_t *nodes, Py_ssize_t n, Py_ssize_t nitems,
+          Py_ssize_t matched, uint64_t filter_ns,
+          const options_timing_t *timing, uint64_t total_ns)
+{
+    PyObject *lines = NULL;
+    PyObject *sep = NULL;
+    PyObject *tree = NULL;
+    PyObject *ms[5] = { NULL, NULL, NULL, NULL, NULL };
+    int i;
+
+    ms[0] = fmt_ms(total_ns);
+    ms[1] = fmt_ms(filter_ns);
+    ms[2] = fmt_ms(timing->select_ns);
+    ms[3] = fmt_ms(timing->order_ns);
+    ms[4] = fmt_ms(timing->slice_ns);
+    lines = PyList_New(0);
+    for (i = 0; i < 5; i++) {
+        if (!ms[i])
+            goto out;
+    }
+    if (!lines)
+        goto out;
+
+    if (append_line(lines, PyUnicode_FromFormat(
+            "tnfilter: %zd items, %zd matched, %U", nitems, matched,
+            ms[0])) < 0 ||
+        append_line(lines, PyUnicode_FromFormat(
+            "  filter %U | select %U | order %U | slice %U",
+            ms[1], ms[2], ms[3], ms[4])) < 0 ||
+        dump_nodes(lines, nodes, n, 1) < 0)
+        goto out;
+
+    sep = PyUnicode_FromString("\n");
+    if (sep)
+        tree = PyUnicode_Join(sep, lines);
+
+out:
+    for (i = 0; i < 5; i++)
+        Py_XDECREF(ms[i]);
+    Py_XDECREF(lines);
+    Py_XDECREF(sep);
+    return tree;
+}
+
+/* ===========================================================================
+ * explain()
+ * =========================================================================== */
+
+PyObject *
+filter_explain(PyObject *data, CompiledFiltersObject *cf,
+               CompiledOptionsObject *co, fl_state_t *state)
+{
+    options_timing_t timing = { 0, 0, 0 };
+    group_acc_t *groups = NULL;
+    prof_node_t *prof = NULL;
+    PyObject *filtered = NULL;
+    PyObject *result = NULL;
+    PyObject *nodes = NULL;
+    PyObject *tree = NULL;
+    PyObject *profile = NULL;
+    Py_ssize_t nitems = 0;
+    Py_ssize_t matched;
+    uint64_t t0, t1, t2;
+
+    prof = prof_tree_new(cf->filters, cf->nfilters);
+    if (!prof)
+        return NULL;
+    if (co->grouped && !(groups = group_acc_new(co)))
+        goto out;
+
+    t0 = fl_now_ns();
+    filtered = filter_list_run(data, cf->filters, cf->nfilters,
+                               co->shortcircuit, cf->model, state,
+                               groups, prof, &nitems);
+    if (filtered && groups)
+        Py_SETREF(filtered, group_acc_finish(groups));
+    if (!filtered)
+        goto out;
+    t1 = fl_now_ns();
+    result = apply_options(filtered, co, state, &timing);
+    if (!result)
+        goto out;
+    t2 = fl_now_ns();
+    matched = groups ? group_acc_nitems(groups) : PyList_GET_SIZE(filtered);
+
+    nodes = nodes_to_tuple(prof, cf->nfilters, state);
+    if (!nodes)
+        goto out;
+    tree = dump_tree(prof, cf->nfilters, nitems, matched, t1 - t0,
+                     &timing, t2 - t0);
+    if (!tree)
+        goto out;
+
+    profile = PyStructSequence_New((PyTypeObject *)state->QueryProfileType);
+    if (!profile)
+        goto out;
+    PyStructSequence_SET_ITEM(profile, 0, Py_NewRef(result));
+    PyStructSequence_SET_ITEM(profile, 1, PyLong_FromSsize_t(nitems));
+    PyStructSequence_SET_ITEM(profile, 2, PyLong_FromSsize_t(matched));
+    PyStructSequence_SET_ITEM(profile, 3, PyLong_FromUnsignedLongLong(t1 - t0));
+    PyStructSequence_SET_ITEM(profile, 4,
+                              PyLong_FromUnsignedLongLong(timing.select_ns));
+    PyStructSequence_SET_ITEM(profile, 5,
+                              PyLong_FromUnsignedLongLong(timing.order_ns));
+    PyStructSequence_SET_ITEM(profile, 6,
+                              PyLong_FromUnsignedLongLong(timing.slice_ns));
+    PyStructSequence_SET_ITEM(profile, 7, PyLong_FromUnsignedLongLong(t2 - t0));
+    PyStructSequence_SET_ITEM(profile, 8, Py_NewRef(nodes));
+    PyStructSequence_SET_ITEM(profile, 9, Py_NewRef(tree));
+    for (int i = 1; i < 8; i++) {
+        if (!PyStructSequence_GET_ITEM(profile, i)) {
+            Py_CLEAR(profile);
+            break;
+        }
+    }
+
+out:
+    prof_tree_free(prof, cf->nfilters);
+    group_acc_free(groups);
+    Py_XDECREF(filtered);
+    Py_XDECREF(result);
+    Py_XDECREF(nodes);
+    Py_XDECREF(tree);
+    return profile;
+}
@@ -26,6 +26,7 @@
  */
 
 #include "filter_list.h"
+#include <structmember.h> /* T_OBJECT */
 
 /* -- operator codes ----------------------------------------------------------- */
 
@@ -55,6 +56,9 @@ typedef struct {
     bool is_wildcard;     /* key == "*"        */
     bool is_digit;        /* key is all-digits */
     long digit_val;       /* value when is_digit */
+    /* struct-sequence field cache, see structseq_field_index() */
+    PyTypeObject *ss_type; /* owned: last tuple subclass seen, or NULL */
+    Py_ssize_t ss_index;   /* key's slot in ss_type, or -1 if not a field */
 } path_part_t;
 
 /* -- compiled simple filter --------------------------------------------------- */
@@ -67,6 +71,7 @@ typedef struct {
     PyObject *value;     /* owned: comparison value                */
     PyObject *value_ci;  /* owned: casefolded value (when ci)      */
     PyObject *re_match;  /* owned: bound pattern.match  (OP_RE)    */
+    bool lookup;         /* parts[0] is LOOKUP_KEY (lookup_record()) */
 } simple_filter_t;
 
 /* -- compiled filter tree node ------------------------------------------------ */
@@ -301,8 +306,10 @@ free_simple(simple_filter_t *sf)
     Py_ssize_t i;
 
     if (sf->parts) {
-        for (i = 0; i < sf->nparts; i++)
+        for (i = 0; i < sf->nparts; i++) {
             Py_XDECREF(sf->parts[i].key);
+            Py_XDECREF(sf->parts[i].ss_type);
+        }
         PyMem_RawFree(sf->parts);
     }
     Py_XDECREF(sf->value);
@@ -692,6 +699,55 @@ done:
     return rc;
 }
 
+/*
+ * Return 1 if a path starting with `key` is a lookup.<path> join leaf, 0 if
+ * it is an ordinary path, -1 on error.  A model with a field (or alias)
+ * named LOOKUP_KEY claims the name, so such paths keep resolving against it.
+ */
+int
+path_is_lookup(PyObject *key, PyObject *model, fl_state_t *state)
+{
+    PyObject *fields = NULL;
+    PyObject *name = NULL;
+    PyObject *fi = NULL;
+    int found;
+
+    if (PyUnicode_CompareWithASCIIString(key, LOOKUP_KEY) != 0)
+        return 0;
+    if (model == NULL || model == Py_None)
+        return 1;
+
+    fields = PyObject_GetAttr(model, state->model_fields_str);
+    if (!fields)
+        return -1;
+    found = PyDict_Check(fields)
+          ? find_field_by_alias(fields, key, state, &name, &fi)
+          : 0;
+    Py_DECREF(fields);
+    if (found < 0)
+        return -1;
+    return !found;
+}
+
+/*
+ * Compile sf->value with re.compile() and cache the bound .match method.
+ * compile_simple() does this up front; a leaf rebuilt from a pickle
+ * (cf_load()) leaves it to the first evaluation (see apply_op()).
+ * Returns 0 on success, -1 on error (exception set).
+ */
+static int
+sf_compile_regex(simple_filter_t *sf, fl_state_t *state)
+{
+    PyObject *pattern = NULL;
+
+    pattern = PyObject_CallOneArg(state->re_compile, sf->value);
+    if (!pattern)
+        return -1;
+    sf->re_match = PyObject_GetAttrString(pattern, "match");
+    Py_DECREF(pattern);
+    return sf->re_match ? 0 : -1;
+}
+
 /*
  * Compile a simple [name, op, value] filter into a simple_filter_t.
  * `f` may be a list or tuple of length 3.  When `model` is non-NULL it is a
@@ -709,7 +765,7 @@ compile_simple(PyObject *f, fl_state_t *state, PyObject *model)
     bool ci;
     compiled_filter_t *cf = NULL;
     simple_filter_t *sf = NULL;
-    PyObject *pattern = NULL;
+    int r;
 
     name_obj = PySequence_GetItem(f, 0);
     if (!name_obj)
@@ -761,9 +817,18 @@ compile_simple(PyObject *f, fl_state_t *state, PyObject *model)
         return NULL;
     }
 
+    /* A lookup.<path> leaf reads the joined record under tnfilter(lookup=...),
+     * which the model does not describe. */
+    r = path_is_lookup(sf->parts[0].key, model, state);
+    if (r < 0) {
+        free_cf(cf);
+        return NULL;
+    }
+    sf->lookup = r;
+
     /* Resolve pydantic field aliases -> attribute names once, here, so the
      * per-item loop only ever traverses attribute names. */
-    if (model != NULL && model != Py_None) {
+    if (model != NULL && model != Py_None && !sf->lookup) {
         if (resolve_alias_path(sf->parts, sf->nparts, model, state) < 0) {
             free_cf(cf);
             return NULL;
@@ -780,18 +845,9 @@ compile_simple(PyObject *f, fl_state_t *state, PyObject *model)
     }
 
     /* Pre-compile regex and cache the bound .match method */
-    if (op == OP_RE) {
-        pattern = PyObject_CallOneArg(state->re_compile, sf->value);
-        if (!pattern) {
-            free_cf(cf);
-            return NULL;
-        }
-        sf->re_match = PyObject_GetAttrString(pattern, "match");
-        Py_DECREF(pattern);
-        if (!sf->re_match) {
-            free_cf(cf);
-            return NULL;
-        }
+    if (op == OP_RE && sf_compile_regex(sf, state) < 0) {
+        free_cf(cf);
+        return NULL;
     }
 
     return cf;
@@ -1031,6 +1087,11 @@ apply_op(const simple_filter_t *sf, PyObject *val, fl_state_t *state)
     case OP_RE:
         /* Regex: match on source (or "" if None).  CI would have folded both. */
         arg = (source == Py_None) ? state->empty_str : source;
+        if (!sf->re_match &&
+            sf_compile_regex((simple_filter_t *)sf, state) < 0) {
+            result = -1;
+            break;
+        }
         res = PyObject_CallOneArg(sf->re_match, arg);
         if (!res) {
             result = -1;
@@ -1152,6 +1213,149 @@ fl_type_is_pydantic(PyTypeObject *tp, fl_state_t *state)
     return state->pyd_cache_verdict;
 }
 
+/*
+ * Return the ob_item[] slot holding field `pp->key` of tuple subclass `tp`,
+ * or -1 if `pp->key` is not such a field.
+ *
+ * PyStructSequence types (StatxResult, IterInstance, StatmountResult, ...)
+ * expose every field, visible or not, as a T_OBJECT member descriptor whose
+ * offset lies inside ob_item[], so once the slot is known a field read is a
+ * plain PyTuple_GET_ITEM instead of a getattr.  The (type -> slot) result is
+ * memoised on the path part.  The type is held as a strong ref so that a
+ * freed and reallocated type can never alias a stale entry.  Types with a
+ * custom tp_getattro are never resolved this way.
+ */
+static Py_ssize_t
+structseq_field_index(path_part_t *pp, PyTypeObject *tp)
+{
+    PyObject *descr;
+    PyMemberDef *m;
+    Py_ssize_t off;
+
+    if (tp == pp->ss_type)
+        return pp->ss_index;
+
+    pp->ss_index = -1;
+    if (tp->tp_getattro == PyObject_GenericGetAttr) {
+        descr = _PyType_Lookup(tp, pp->key);
+        if (descr && Py_IS_TYPE(descr, &PyMemberDescr_Type)) {
+            m = ((PyMemberDescrObject *)descr)->d_member;
+            off = m->offset - (Py_ssize_t)offsetof(PyTupleObject, ob_item);
+            if (m->type == T_OBJECT && off >= 0 &&
+                off % (Py_ssize_t)sizeof(PyObject *) == 0)
+                pp->ss_index = off / (Py_ssize_t)sizeof(PyObject *);
+        }
+    }
+    Py_XSETREF(pp->ss_type, (PyTypeObject *)Py_NewRef(tp));
+    return pp->ss_index;
+}
+
+/* Outcome of descending one path component, see path_step(). */
+typedef enum {
+    STEP_ERROR = -1,
+    STEP_MISSING = 0,  /* component absent: the term does not match */
+    STEP_BORROWED,     /* *out is the child, borrowed from cur */
+    STEP_NEW,          /* *out is the child, a new reference */
+    STEP_LEAF,         /* attribute absent on a plain object: cur is the leaf */
+} path_step_t;
+
+/*
+ * Descend from `cur` through the single non-wildcard component `pp`.
+ * Shared by eval_simple_from() and cf_fetch_value() so that the two can
+ * never disagree about which value a path resolves to.
+ */
+static inline path_step_t
+path_step(PyObject *cur, path_part_t *pp, fl_state_t *state, PyObject **out)
+{
+    PyObject *v = NULL;
+    PyObject **dictptr = NULL;
+    Py_ssize_t j;
+
+    if (PyDict_CheckExact(cur)) {
+        v = PyDict_GetItemWithError(cur, pp->key);
+        if (!v)
+            return PyErr_Occurred() ? STEP_ERROR : STEP_MISSING;
+        *out = v;
+        return STEP_BORROWED;
+    }
+
+    if (PyList_Check(cur) || PyTuple_Check(cur)) {
+        if (pp->is_digit) {
+            *out = (pp->digit_val < PySequence_Fast_GET_SIZE(cur))
+                 ? PySequence_Fast_GET_ITEM(cur, pp->digit_val)
+                 : Py_None;
+            return STEP_BORROWED;
+        }
+        if (PyTuple_Check(cur) && !PyTuple_CheckExact(cur) &&
+            (j = structseq_field_index(pp, Py_TYPE(cur))) >= 0) {
+            /*
+             * Struct-sequence field: read the slot directly.  A NULL
+             * slot reads as None, as the member descriptor would.
+             */
+            v = PyTuple_GET_ITEM(cur, j);
+            *out = v ? v : Py_None;
+            return STEP_BORROWED;
+        }
+        /*
+         * Non-numeric, non-wildcard component on a sequence.  Try getattr
+         * to support NamedTuple and other tuple subclasses that expose
+         * named fields as attributes.  A missing named field mirrors the
+         * dict missing-key case: no match.
+         */
+        v = PyObject_GetAttr(cur, pp->key);
+        if (!v) {
+            if (!PyErr_ExceptionMatches(PyExc_AttributeError))
+                return STEP_ERROR;
+            PyErr_Clear();
+            return STEP_MISSING;
+        }
+        *out = v;
+        return STEP_NEW;
+    }
+
+    /*
+     * Non-dict, non-list object.
+     *
+     * Pydantic fast path: pydantic v2 stores field values in the instance
+     * __dict__ under the attribute name, does not override
+     * __getattribute__, and does not expose stored fields as data
+     * descriptors -- so a present __dict__ entry is identical to the
+     * getattr result.  Reading it directly avoids the per-access
+     * __getattr__-hook wrapper pydantic installs as tp_getattro (measured
+     * ~2.4x cheaper than getattr).  A miss (computed_field, model_extra,
+     * private or unset field) falls through to the getattr path below,
+     * which stays fully correct for any object.
+     */
+    if (fl_type_is_pydantic(Py_TYPE(cur), state)) {
+        dictptr = _PyObject_GetDictPtr(cur);
+        if (dictptr && *dictptr) {
+            v = PyDict_GetItemWithError(*dictptr, pp->key);
+            if (v) {
+                *out = v;
+                return STEP_BORROWED;
+            }
+            if (PyErr_Occurred())
+                return STEP_ERROR;
+        }
+    }
+
+    /*
+     * General fallback: try getattr for custom objects (NamedTuple,
+     * dataclass, etc.).  If the attribute does not exist, mirror Python
+     * get_impl semantics: the current value is the leaf and the remaining
+     * path parts are ignored.
+     */
+    v = PyObject_GetAttr(cur, pp->key);
+    if (!v) {
+        if (!PyErr_ExceptionMatches(PyExc_AttributeError))
+            return STEP_ERROR;
+        PyErr_Clear();
+        return STEP_LEAF;
+    }
+    *out = v;
+    return STEP_NEW;
+}
+
 /*
  * Evaluate a simple filter against `item`, starting path traversal at
  * parts[start].
@@ -1176,20 +1380,36 @@ eval_simple_from(PyObject *item, const simple_filter_t *sf,
     PyObject *cur = item;
     PyObject *cur_owned = NULL; /* non-NULL: we own cur and must release it */
     Py_ssize_t i;
-    const path_part_t *pp = NULL;
+    path_part_t *pp = NULL;
     Py_ssize_t n;
     Py_ssize_t j;
     PyObject *entry = NULL;
     int result;
-    Py_ssize_t slen;
     PyObject *v = NULL;
-    PyObject **dictptr = NULL;
+    PyObject *rec = NULL;
+
+    /* -- lookup.<path>: evaluate <path> against the joined record ------------- */
+    if (start == 0 && sf->lookup && state->lookup) {
+        if (lookup_record(item, state, &rec) < 0)
+            return -1;
+        if (!rec) {
+            if (state->prof_misses)
+                (*state->prof_misses)++;
+            return 0; /* no joined record -> no match */
+        }
+        return eval_simple_from(rec, sf, 1, state);
+    }
 
     /* -- ultra-fast path: single-level exact-dict lookup ---------------------- */
     if (start == 0 && nparts == 1 && PyDict_CheckExact(item)) {
         val = PyDict_GetItemWithError(item, sf->parts[0].key);
-        if (!val)
-            return PyErr_Occurred() ? -1 : 0; /* missing key -> no match */
+        if (!val) {
+            if (PyErr_Occurred())
+                return -1;
+            if (state->prof_misses)
+                (*state->prof_misses)++;
+            return 0; /* missing key -> no match */
+        }
         return apply_op(sf, val, state); /* val borrowed from item */
     }
 
@@ -1197,12 +1417,25 @@ eval_simple_from(PyObject *item, const simple_filter_t *sf,
     for (i = start; i < nparts; i++) {
         pp = &sf->parts[i];
 
-        if (PyDict_CheckExact(cur)) {
-            v = PyDict_GetItemWithError(cur, pp->key);
-            if (!v) {
-                Py_XDECREF(cur_owned);
-                return PyErr_Occurred() ? -1 : 0;
+        if (pp->is_wildcard && (PyList_Check(cur) || PyTuple_Check(cur))) {
+            /* Wildcard: recurse over each element with remaining path.
+             * Incref each entry before recursing: eval_simple_from may
+             * call Python code (getattr, casefold, regex) that mutates
+             * cur, invalidating the borrowed ob_item[] pointer. */
+            n = PySequence_Fast_GET_SIZE(cur);
+            result = 0;
+            for (j = 0; j < n && result == 0; j++) {
+                entry = PySequence_Fast_GET_ITEM(cur, j);
+                Py_INCREF(entry);
+                result = eval_simple_from(entry, sf, i + 1, state);
+                Py_DECREF(entry);
             }
+            Py_XDECREF(cur_owned);
+            return result;
+        }
+
+        switch (path_step(cur, pp, state, &v)) {
+        case STEP_BORROWED:
             /*
              * v is borrowed from cur.  If we own cur, incref v so it stays
              * alive when we release cur below.
@@ -1210,110 +1443,23 @@ eval_simple_from(PyObject *item, const simple_filter_t *sf,
             if (cur_owned)
                 Py_SETREF(cur_owned, Py_NewRef(v));
             cur = v;
-
-        } else if (PyList_Check(cur) || PyTuple_Check(cur)) {
-
-            if (pp->is_wildcard) {
-                /* Wildcard: recurse over each element with remaining path.
-                 * Incref each entry before recursing: eval_simple_from may
-                 * call Python code (getattr, casefold, regex) that mutates
-                 * cur, invalidating the borrowed ob_item[] pointer. */
-                n = PySequence_Fast_GET_SIZE(cur);
-                result = 0;
-                for (j = 0; j < n && result == 0; j++) {
-                    entry = PySequence_Fast_GET_ITEM(cur, j);
-                    Py_INCREF(entry);
-                    result = eval_simple_from(entry, sf, i + 1, state);
-                    Py_DECREF(entry);
-                }
-                Py_XDECREF(cur_owned);
-                return result;
-            }
-
-            if (pp->is_digit) {
-                slen = PySequence_Fast_GET_SIZE(cur);
-                v = (pp->digit_val < slen)
-                    ? PySequence_Fast_GET_ITEM(cur, pp->digit_val)
-                    : Py_None;
-                /* v borrowed from cur; same ownership dance as dict case */
-                if (cur_owned)
-                    Py_SETREF(cur_owned, Py_NewRef(v));
-                cur = v;
-            } else {
-                /*
-                 * Non-numeric, non-wildcard component on a sequence.
-                 * Try getattr to support NamedTuple and other tuple
-                 * subclasses that expose named fields as attributes.
-                 * Fall through to a descriptive ValueError only when
-                 * the attribute genuinely does not exist.
-                 */
-                v = PyObject_GetAttr(cur, pp->key);
-                if (!v) {
-                    if (!PyErr_ExceptionMatches(PyExc_AttributeError)) {
-                        Py_XDECREF(cur_owned);
-                        return -1;
-                    }
-                    /* Missing named field: mirror dict missing-key → no match */
-                    PyErr_Clear();
-                    Py_XDECREF(cur_owned);
-                    return 0;
-                }
-                Py_XSETREF(cur_owned, v);
-                cur = v;
-            }
-
-        } else {
-            /*
-             * Non-dict, non-list object.
-             *
-             * Pydantic fast path: pydantic v2 stores field values in the
-             * instance __dict__ under the attribute name, does not override
-             * __getattribute__, and does not expose stored fields as data
-             * descriptors -- so a present __dict__ entry is identical to the
-             * getattr result.  Reading it directly avoids the per-access
-             * __getattr__-hook wrapper pydantic installs as tp_getattro
-             * (measured ~2.4x cheaper than getattr).  A miss (computed_field,
-             * model_extra, private or unset field) falls through to the
-             * getattr path below, which stays fully correct for any object.
-             */
-            if (fl_type_is_pydantic(Py_TYPE(cur), state)) {
-                dictptr = _PyObject_GetDictPtr(cur);
-                if (dictptr && *dictptr) {
-                    v = PyDict_GetItemWithError(*dictptr, pp->key);
-                    if (v) {
-                        /* v borrowed from cur's __dict__; same ownership
-                         * dance as the exact-dict branch above. */
-                        if (cur_owned)
-                            Py_SETREF(cur_owned, Py_NewRef(v));
-                        cur = v;
-                        continue;
-                    }
-                    if (PyErr_Occurred()) {
-                        Py_XDECREF(cur_owned);
-                        return -1;
-                    }
-                }
-            }
-
-            /*
-             * General fallback: try getattr for custom objects (NamedTuple,
-             * dataclass, etc.).  If the attribute does not exist, mirror
-             * Python get_impl semantics: treat the current value as the leaf
-             * and apply the operator directly, ignoring remaining path parts.
-             */
-            v = PyObject_GetAttr(cur, pp->key);
-            if (!v) {
-                if (!PyErr_ExceptionMatches(PyExc_AttributeError)) {
-                    Py_XDECREF(cur_owned);
-                    return -1;
-                }
-                PyErr_Clear();
-                result = apply_op(sf, cur, state);
-                Py_XDECREF(cur_owned);
-                return result;
-            }
+            break;
+        case STEP_NEW:
             Py_XSETREF(cur_owned, v);
             cur = v;
+            break;
+        case STEP_LEAF:
+            result = apply_op(sf, cur, state);
+            Py_XDECREF(cur_owned);
+            return result;
+        case STEP_MISSING:
+            if (state->prof_misses)
+                (*state->prof_misses)++;
+            Py_XDECREF(cur_owned);
+            return 0;
+        default:
+            Py_XDECREF(cur_owned);
+            return -1;
         }
     }
 
@@ -1365,12 +1511,183 @@ eval_filter(PyObject *item, const compiled_filter_t *cf, fl_state_t *state,
     return -1;
 }
 
+/*
+ * eval_filter() with per-node counters (explain()).  `pn` mirrors `cf`; see
+ * prof_tree_new().  Kept separate so the unprofiled path pays nothing.
+ */
+static int
+eval_filter_prof(PyObject *item, const compiled_filter_t *cf,
+                 prof_node_t *pn, fl_state_t *state, int depth)
+{
+    uint64_t start = fl_now_ns();
+    Py_ssize_t i;
+    int r;
+
+    if (depth > FILTER_MAX_DEPTH) {
+        PyErr_SetString(PyExc_RecursionError,
+                        "filter_list: maximum filter nesting depth exceeded");
+        return -1;
+    }
+
+    switch (cf->type) {
+    case CF_SIMPLE:
+        state->prof_misses = &pn->path_misses;
+        r = eval_simple_from(item, &cf->s, 0, state);
+        state->prof_misses = NULL;
+        break;
+    case CF_OR:
+        r = 0;
+        for (i = 0; i < cf->compound.nch && r == 0; i++)
+            r = eval_filter_prof(item, cf->compound.ch[i], &pn->ch[i],
+                                 state, depth + 1);
+        break;
+    default: /* CF_AND */
+        r = 1;
+        for (i = 0; i < cf->compound.nch && r == 1; i++)
+            r = eval_filter_prof(item, cf->compound.ch[i], &pn->ch[i],
+                                 state, depth + 1);
+        break;
+    }
+
+    pn->evaluations++;
+    if (r == 1)
+        pn->matches++;
+    pn->time_ns += fl_now_ns() - start;
+    return r;
+}
+
+/* ===============================================================================
+ * Profile trees (explain())
+ * =============================================================================== */
+
+/* Operator spellings, indexed by op_code_t (inverse of parse_op()). */
+static const char *op_names[] = {
+    [OP_EQ] = "=", [OP_NE] = "!=", [OP_GT] = ">", [OP_GE] = ">=",
+    [OP_LT] = "<", [OP_LE] = "<=", [OP_RE] = "~", [OP_IN] = "in",
+    [OP_NIN] = "nin", [OP_RIN] = "rin", [OP_RNIN] = "rnin", [OP_SW] = "^",
+    [OP_NSW] = "!^", [OP_EW] = "$", [OP_NEW] = "!$",
+};
+
+/*
+ * [path, op, value] label of a leaf.  The path is rebuilt from the compiled
+ * (alias-resolved) parts, re-escaping literal dots.
+ */
+static PyObject *
+simple_label(const simple_filter_t *sf)
+{
+    PyObject *dot = NULL;
+    PyObject *esc = NULL;
+    PyObject *parts = NULL;
+    PyObject *path = NULL;
+    PyObject *key = NULL;
+    PyObject *op = NULL;
+    Py_ssize_t i;
+
+    dot = PyUnicode_FromString(".");
+    esc = PyUnicode_FromString("\\.");
+    parts = PyList_New(sf->nparts);
+    if (!dot || !esc || !parts)
+        goto out;
+    for (i = 0; i < sf->nparts; i++) {
+        key = PyUnicode_Replace(sf->parts[i].key, dot, esc, -1);
+        if (!key)
+            goto out;
+        PyList_SET_ITEM(parts, i, key);
+    }
+    path = PyUnicode_Join(dot, parts);
+
+out:
+    Py_XDECREF(dot);
+    Py_XDECREF(esc);
+    Py_XDECREF(parts);
+    if (!path)
+        return NULL;
+    op = PyUnicode_FromFormat("%s%s", sf->ci ? "C" : "", op_names[sf->op]);
+    if (!op) {
+        Py_DECREF(path);
+        return NULL;
+    }
+    return Py_BuildValue("[NNO]", path, op, sf->value);
+}
+
+static void
+prof_node_clear(prof_node_t *pn)
+{
+    Py_CLEAR(pn->term);
+    prof_tree_free(pn->ch, pn->nch);
+    pn->ch = NULL;
+    pn->nch = 0;
+}
+
+static int
+prof_node_init(prof_node_t *pn, const compiled_filter_t *cf)
+{
+    Py_ssize_t i;
+
+    if (cf->type == CF_SIMPLE) {
+        pn->term = simple_label(&cf->s);
+        return pn->term ? 0 : -1;
+    }
+
+    pn->term = PyUnicode_FromString(cf->type == CF_OR ? "OR" : "AND");
+    if (!pn->term)
+        return -1;
+    pn->ch = PyMem_RawCalloc((size_t)cf->compound.nch + 1, sizeof(*pn->ch));
+    if (!pn->ch) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    pn->nch = cf->compound.nch;
+    for (i = 0; i < pn->nch; i++) {
+        if (prof_node_init(&pn->ch[i], cf->compound.ch[i]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Allocate zeroed profile nodes shaped like the `n` top-level filters in
+ * `compiled`.  Returns NULL on error.
+ */
+prof_node_t *
+prof_tree_new(compiled_filter_t * const *compiled, Py_ssize_t n)
+{
+    prof_node_t *nodes = NULL;
+    Py_ssize_t i;
+
+    nodes = PyMem_RawCalloc((size_t)n + 1, sizeof(*nodes));
+    if (!nodes) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (prof_node_init(&nodes[i], compiled[i]) < 0) {
+            prof_tree_free(nodes, n);
+            return NULL;
+        }
+    }
+    return nodes;
+}
+
+void
+prof_tree_free(prof_node_t *nodes, Py_ssize_t n)
+{
+    Py_ssize_t i;
+
+    if (!nodes)
+        return;
+    for (i = 0; i < n; i++)
+        prof_node_clear(&nodes[i]);
+    PyMem_RawFree(nodes);
+}
+
 /* ===============================================================================
  * Internal filter_list implementation
  * =============================================================================== */
 
 /*
- * Per-item model guard, shared by filter_list_run() and match_item().
+ * Per-item model guard, shared by filter_list_run(), match_item() and
+ * filter_set_match().
  *
  * A filter's field paths are alias-resolved against the model= passed at
  * compile time, so:
@@ -1384,7 +1701,7 @@ eval_filter(PyObject *item, const compiled_filter_t *cf, fl_state_t *state,
  * error message.  Returns 1 if the item may be filtered, 0 with an exception
  * set otherwise.
  */
-static int
+int
 check_item_model(PyObject *item, PyObject *model, Py_ssize_t nfilters,
                  fl_state_t *state, const char *fn)
 {
@@ -1427,11 +1744,20 @@ check_item_model(PyObject *item, PyObject *model, Py_ssize_t nfilters,
 /*
  * Pure evaluation loop: iterate `data`, append items matching all `compiled`
  * filters to a new list, and return it.  Does not own or free `compiled`.
+ *
+ * With a `groups` accumulator (group_by/aggregate options) matching items are
+ * folded into it instead and the returned list stays empty; the caller then
+ * takes the rows from group_acc_finish().
+ *
+ * explain() passes `prof` (see prof_tree_new()) to collect per-node counters
+ * and `nitemsp` to learn how many items were examined; both are NULL
+ * otherwise.
  */
 PyObject *
 filter_list_run(PyObject *data, compiled_filter_t * const *compiled,
                 Py_ssize_t nfilters, bool shortcircuit, PyObject *model,
-                fl_state_t *state)
+                fl_state_t *state, group_acc_t *groups, prof_node_t *prof,
+                Py_ssize_t *nitemsp)
 {
     PyObject *result = NULL;
     PyObject *iter = NULL;
@@ -1463,9 +1789,12 @@ filter_list_run(PyObject *data, compiled_filter_t * const *compiled,
         }
 
         match = 1;
+        if (nitemsp)
+            (*nitemsp)++;
 
         for (i = 0; i < nfilters; i++) {
-            r = eval_filter(item, compiled[i], state, 0);
+            r = prof ? eval_filter_prof(item, compiled[i], &prof[i], state, 0)
+                     : eval_filter(item, compiled[i], state, 0);
             if (r < 0) {
                 Py_DECREF(item);
                 Py_DECREF(iter);
@@ -1479,7 +1808,9 @@ filter_list_run(PyObject *data, compiled_filter_t * const *compiled,
         }
 
         if (match) {
-            if (PyList_Append(result, item) < 0) {
+            r = groups ? group_acc_add(groups, item)
+                       : PyList_Append(result, item);
+            if (r < 0) {
                 Py_DECREF(item);
                 Py_DECREF(iter);
                 Py_DECREF(result);
@@ -1513,7 +1844,6 @@ match_item(PyObject *item, compiled_filter_t * const *compiled,
            Py_ssize_t nfilters, PyObject *model, fl_state_t *state,
            bool *matchp)
 {
-    Py_ssize_t i;
     int r;
 
     /* Reset the pydantic inline cache (see fl_state_t). */
@@ -1524,17 +1854,366 @@ match_item(PyObject *item, compiled_filter_t * const *compiled,
     if (!check_item_model(item, model, nfilters, state, "match"))
         return false;
 
+    r = eval_filters(item, compiled, nfilters, state);
+    if (r < 0)
+        return false;  /* exception already set */
+    *matchp = r;
+    return true;
+}
+
+/*
+ * Evaluate the implicit AND of `compiled` against `item` with no model
+ * check; callers run check_item_model() first.
+ * Returns 1 (match), 0 (no match), -1 (error).
+ */
+int
+eval_filters(PyObject *item, compiled_filter_t * const *compiled,
+             Py_ssize_t nfilters, fl_state_t *state)
+{
+    Py_ssize_t i;
+    int r;
+
     for (i = 0; i < nfilters; i++) {
         r = eval_filter(item, compiled[i], state, 0);
-        if (r < 0)
-            return false;  /* exception already set */
-        if (!r) {
-            *matchp = false;
-            return true;
+        if (r != 1)
+            return r;
+    }
+    return 1;
+}
+
+/* ===============================================================================
+ * Index support for CompiledFilterSet (filter_set.c)
+ * =============================================================================== */
+
+/*
+ * Decide whether top-level term `cf` can key a hash index: a case-sensitive
+ * [path, "=", value] leaf with no wildcard component and a hashable value.
+ * Such a term can only match an item whose value at `path` hashes and
+ * compares equal to `value`, so a dict lookup finds every candidate.
+ *
+ * Returns 1 and sets *pathp to a new tuple of the (alias-resolved) path keys
+ * and *valuep to a borrowed ref to the value; 0 if the term is not
+ * indexable; -1 on error.
+ */
+int
+cf_index_term(const compiled_filter_t *cf, PyObject **pathp,
+              PyObject **valuep)
+{
+    const simple_filter_t *sf = &cf->s;
+    PyObject *path = NULL;
+    Py_ssize_t i;
+
+    if (cf->type != CF_SIMPLE || sf->op != OP_EQ || sf->ci)
+        return 0;
+    for (i = 0; i < sf->nparts; i++) {
+        if (sf->parts[i].is_wildcard)
+            return 0;
+    }
+    if (PyObject_Hash(sf->value) == -1) {
+        if (!PyErr_ExceptionMatches(PyExc_TypeError))
+            return -1;
+        PyErr_Clear();
+        return 0;
+    }
+
+    path = PyTuple_New(sf->nparts);
+    if (!path)
+        return -1;
+    for (i = 0; i < sf->nparts; i++)
+        PyTuple_SET_ITEM(path, i, Py_NewRef(sf->parts[i].key));
+
+    *pathp = path;
+    *valuep = sf->value;
+    return 1;
+}
+
+/*
+ * Resolve the path of an indexable term (see cf_index_term()) against
+ * `item`, yielding the value its operator would be applied to.
+ *
+ * Returns 1 and sets *out to a new reference, 0 if the path is absent (the
+ * term cannot match), -1 on error.
+ */
+int
+cf_fetch_value(PyObject *item, const compiled_filter_t *cf,
+               fl_state_t *state, PyObject **out)
+{
+    const simple_filter_t *sf = &cf->s;
+    PyObject *cur = Py_NewRef(item);
+    PyObject *v = NULL;
+    Py_ssize_t i;
+
+    for (i = 0; i < sf->nparts; i++) {
+        switch (path_step(cur, &sf->parts[i], state, &v)) {
+        case STEP_BORROWED:
+            Py_SETREF(cur, Py_NewRef(v));
+            break;
+        case STEP_NEW:
+            Py_SETREF(cur, v);
+            break;
+        case STEP_LEAF:
+            *out = cur;
+            return 1;
+        case STEP_MISSING:
+            Py_DECREF(cur);
+            return 0;
+        default:
+            Py_DECREF(cur);
+            return -1;
         }
     }
-    *matchp = true;
-    return true;
+    *out = cur;
+    return 1;
+}
+
+/* ===============================================================================
+ * Pickle support
+ *
+ * A compiled tree is serialised node by node, after compilation: a leaf as
+ * (CF_SIMPLE, path keys, op code, ci, value, lookup) with the keys already
+ * split and alias-resolved, an OR / AND node as (type, children).  cf_load() rebuilds
+ * the tree without re-parsing paths or operators and without touching the
+ * model; only the casefolded value is recomputed, and regex leaves compile
+ * their pattern on first use (sf_compile_regex()).
+ * =============================================================================== */
+
+static PyObject *
+cf_dump(const compiled_filter_t *cf)
+{
+    const simple_filter_t *sf = NULL;
+    PyObject *items = NULL;
+    PyObject *child = NULL;
+    Py_ssize_t n;
+    Py_ssize_t i;
+
+    n = cf->type == CF_SIMPLE ? cf->s.nparts : cf->compound.nch;
+    items = PyTuple_New(n);
+    if (!items)
+        return NULL;
+
+    if (cf->type != CF_SIMPLE) {
+        for (i = 0; i < n; i++) {
+            child = cf_dump(cf->compound.ch[i]);
+            if (!child) {
+                Py_DECREF(items);
+                return NULL;
+            }
+            PyTuple_SET_ITEM(items, i, child);
+        }
+        return Py_BuildValue("(iN)", (int)cf->type, items);
+    }
+
+    sf = &cf->s;
+    for (i = 0; i < n; i++)
+        PyTuple_SET_ITEM(items, i, Py_NewRef(sf->parts[i].key));
+    return Py_BuildValue("(iNiOOO)", CF_SIMPLE, items, (int)sf->op,
+                         sf->ci ? Py_True : Py_False, sf->value,
+                         sf->lookup ? Py_True : Py_False);
+}
+
+static compiled_filter_t *
+cf_load(PyObject *node, fl_state_t *state, int depth)
+{
+    compiled_filter_t *cf = NULL;
+    compiled_filter_t *child = NULL;
+    simple_filter_t *sf = NULL;
+    PyObject *items = NULL;
+    PyObject *key = NULL;
+    Py_ssize_t n;
+    Py_ssize_t i;
+    int type, op, ci, lookup;
+
+    if (depth > FILTER_MAX_DEPTH) {
+        PyErr_SetString(PyExc_RecursionError,
+                        "filter_list: maximum filter nesting depth exceeded");
+        return NULL;
+    }
+    if (!PyTuple_Check(node) || PyTuple_GET_SIZE(node) < 2 ||
+        !PyTuple_Check(PyTuple_GET_ITEM(node, 1)))
+        goto bad;
+    type = PyLong_AsInt(PyTuple_GET_ITEM(node, 0));
+    if (type == -1 && PyErr_Occurred())
+        return NULL;
+    items = PyTuple_GET_ITEM(node, 1);
+    n = PyTuple_GET_SIZE(items);
+
+    cf = PyMem_RawCalloc(1, sizeof(*cf));
+    if (!cf) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    if ((type == CF_OR || type == CF_AND) && PyTuple_GET_SIZE(node) == 2) {
+        cf->type = type;
+        cf->compound.ch = PyMem_RawCalloc((size_t)n + 1, sizeof(*cf->compound.ch));
+        if (!cf->compound.ch) {
+            PyErr_NoMemory();
+            goto fail;
+        }
+        for (i = 0; i < n; i++) {
+            child = cf_load(PyTuple_GET_ITEM(items, i), state, depth + 1);
+            if (!child)
+                goto fail;
+            cf->compound.ch[cf->compound.nch++] = child;
+        }
+        return cf;
+    }
+
+    if (type != CF_SIMPLE || PyTuple_GET_SIZE(node) != 6 || n == 0)
+        goto bad;
+    op = PyLong_AsInt(PyTuple_GET_ITEM(node, 2));
+    if (op == -1 && PyErr_Occurred())
+        goto fail;
+    if (op < OP_EQ || op > OP_NEW)
+        goto bad;
+    ci = PyObject_IsTrue(PyTuple_GET_ITEM(node, 3));
+    if (ci < 0)
+        goto fail;
+
+    sf = &cf->s;
+    sf->op = op;
+    sf->ci = ci;
+    sf->value = Py_NewRef(PyTuple_GET_ITEM(node, 4));
+    sf->parts = PyMem_RawCalloc((size_t)n, sizeof(*sf->parts));
+    if (!sf->parts) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+    for (i = 0; i < n; i++) {
+        key = PyTuple_GET_ITEM(items, i);
+        if (!PyUnicode_Check(key))
+            goto bad;
+        if (init_path_part(&sf->parts[i], Py_NewRef(key)) < 0) {
+            Py_DECREF(key);
+            goto fail;
+        }
+        sf->nparts++;
+    }
+    lookup = PyObject_IsTrue(PyTuple_GET_ITEM(node, 5));
+    if (lookup < 0)
+        goto fail;
+    sf->lookup = lookup;
+    if (ci) {
+        sf->value_ci = c_casefold(sf->value, state->casefold_str);
+        if (!sf->value_ci)
+            goto fail;
+    }
+    return cf;
+
+bad:
+    PyErr_SetString(PyExc_ValueError,
+                    "filter_list: invalid pickled CompiledFilters");
+fail:
+    free_cf(cf);
+    return NULL;
+}
+
+/*
+ * Look up the module-level function that unpickles a compiled object.  The
+ * types are static, so __reduce__ cannot reach the module state directly.
+ */
+static PyObject *
+plan_loader(const char *name)
+{
+    PyObject *mod = NULL;
+    PyObject *fn = NULL;
+
+    mod = PyImport_ImportModule("truenas_pyfilter");
+    if (!mod)
+        return NULL;
+    fn = PyObject_GetAttrString(mod, name);
+    Py_DECREF(mod);
+    return fn;
+}
+
+/*
+ * Unpickle a CompiledFilters: `args` is the tuple compiled_filters_reduce()
+ * hands to truenas_pyfilter._load_filters(), which has checked its version.
+ */
+PyObject *
+filters_load(PyObject *args, fl_state_t *state)
+{
+    CompiledFiltersObject *obj = NULL;
+    compiled_filter_t **compiled = NULL;
+    PyObject *tree = NULL;
+    PyObject *model = NULL;
+    PyObject *repr_str = NULL;
+    Py_ssize_t n;
+    Py_ssize_t i;
+    int version;
+
+    if (!PyArg_ParseTuple(args, "iO!OU", &version, &PyTuple_Type, &tree,
+                          &model, &repr_str))
+        return NULL;
+
+    n = PyTuple_GET_SIZE(tree);
+    compiled = PyMem_RawCalloc((size_t)n + 1, sizeof(*compiled));
+    if (!compiled)
+        return PyErr_NoMemory();
+    for (i = 0; i < n; i++) {
+        compiled[i] = cf_load(PyTuple_GET_ITEM(tree, i), state, 0);
+        if (!compiled[i]) {
+            free_cf_array(compiled, i);
+            return NULL;
+        }
+    }
+
+    obj = PyObject_New(CompiledFiltersObject, &CompiledFilters_Type);
+    if (!obj) {
+        free_cf_array(compiled, n);
+        return NULL;
+    }
+    obj->filters = compiled;
+    obj->nfilters = n;
+    obj->model = Py_NewRef(model);
+    obj->repr_str = Py_NewRef(repr_str);
+    return (PyObject *)obj;
+}
+
+static PyObject *
+compiled_filters_reduce(CompiledFiltersObject *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *loader = NULL;
+    PyObject *tree = NULL;
+    PyObject *node = NULL;
+    Py_ssize_t i;
+
+    tree = PyTuple_New(self->nfilters);
+    if (!tree)
+        return NULL;
+    for (i = 0; i < self->nfilters; i++) {
+        node = cf_dump(self->filters[i]);
+        if (!node) {
+            Py_DECREF(tree);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(tree, i, node);
+    }
+
+    loader = plan_loader("_load_filters");
+    if (!loader) {
+        Py_DECREF(tree);
+        return NULL;
+    }
+    return Py_BuildValue("(N(iNOO))", loader, PLAN_FORMAT_VERSION, tree,
+                         self->model, self->repr_str);
+}
+
+static PyObject *
+compiled_options_reduce(CompiledOptionsObject *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *loader = NULL;
+    PyObject *state = NULL;
+
+    state = options_dump(self);
+    if (!state)
+        return NULL;
+    loader = plan_loader("_load_options");
+    if (!loader) {
+        Py_DECREF(state);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", loader, state);
 }
 
 /* ===============================================================================
@@ -1556,6 +2235,11 @@ compiled_filters_repr(CompiledFiltersObject *self)
     return PyUnicode_FromFormat("CompiledFilters(%U)", self->repr_str);
 }
 
+static PyMethodDef compiled_filters_methods[] = {
+    {"__reduce__", (PyCFunction)compiled_filters_reduce, METH_NOARGS, NULL},
+    {NULL}
+};
+
 PyTypeObject CompiledFilters_Type = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "truenas_pyfilter.CompiledFilters",
@@ -1564,6 +2248,7 @@ PyTypeObject CompiledFilters_Type = {
     .tp_repr = (reprfunc)compiled_filters_repr,
     .tp_flags = Py_TPFLAGS_DEFAULT,
     .tp_doc = PyDoc_STR("Pre-compiled filter tree for use with tnfilter()."),
+    .tp_methods = compiled_filters_methods,
 };
 
 /* ===============================================================================
@@ -1575,10 +2260,14 @@ compiled_options_dealloc(CompiledOptionsObject *self)
 {
     free_select_specs(self->select_specs, self->nselect);
     free_order_specs(self->order_specs, self->norder);
+    free_agg_specs(self->group_specs, self->ngroup);
+    free_agg_specs(self->agg_specs, self->nagg);
     Py_CLEAR(self->repr_str);
     Py_CLEAR(self->arg_select);
     Py_CLEAR(self->arg_order_by);
     Py_CLEAR(self->model);
+    Py_CLEAR(self->arg_group_by);
+    Py_CLEAR(self->arg_aggregate);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
@@ -1597,6 +2286,14 @@ static PyMemberDef compiled_options_members[] = {
     {"offset", Py_T_PYSSIZET, offsetof(CompiledOptionsObject, offset), Py_READONLY},
     {"limit", Py_T_PYSSIZET, offsetof(CompiledOptionsObject, limit), Py_READONLY},
     {"model", Py_T_OBJECT_EX, offsetof(CompiledOptionsObject, model), Py_READONLY},
+    {"group_by", Py_T_OBJECT_EX, offsetof(CompiledOptionsObject, arg_group_by), Py_READONLY},
+    {"aggregate", Py_T_OBJECT_EX, offsetof(CompiledOptionsObject, arg_aggregate), Py_READONLY},
+    {"distinct", Py_T_BOOL, offsetof(CompiledOptionsObject, distinct), Py_READONLY},
+    {NULL}
+};
+
+static PyMethodDef compiled_options_methods[] = {
+    {"__reduce__", (PyCFunction)compiled_options_reduce, METH_NOARGS, NULL},
     {NULL}
 };
 
@@ -1608,5 +2305,6 @@ PyTypeObject CompiledOptions_Type = {
     .tp_repr = (reprfunc)compiled_options_repr,
     .tp_flags = Py_TPFLAGS_DEFAULT,
     .tp_doc = PyDoc_STR("Pre-compiled options for use with tnfilter()."),
+    .tp_methods = compiled_options_methods,
     .tp_members = compiled_options_members,
 };
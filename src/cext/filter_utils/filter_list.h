@@ -4,6 +4,8 @@
 #define FILTER_LIST_H
 
 #include <Python.h>
+#include <stdint.h>
+#include <time.h>
 #include "common/includes.h"
 
 /*
@@ -37,6 +39,17 @@ typedef struct {
      */
     PyTypeObject *pyd_cache_type; /* last type checked (borrowed)  */
     int pyd_cache_verdict;        /* 1 = pydantic model, 0 = not   */
+    PyObject *LiveQueryDeltaType; /* struct sequence, live_query.c */
+    PyObject *QueryProfileType;   /* struct sequence, filter_explain.c */
+    PyObject *ProfileNodeType;    /* struct sequence, filter_explain.c */
+    PyObject *PageType;           /* struct sequence, filter_page.c */
+    /* explain(): when non-NULL, eval_simple_from() counts path-resolution
+     * misses of the leaf being profiled here. */
+    Py_ssize_t *prof_misses;
+    /* tnfilter(lookup=...): when non-NULL, "lookup.<path>" filter leaves and
+     * select entries read the item's joined record (see lookup_record()).
+     * Set for the duration of one run and restored afterwards. */
+    struct lookup_ctx *lookup;
 } fl_state_t;
 
 /*
@@ -59,6 +72,10 @@ typedef struct compiled_filter compiled_filter_t;
  * tested for numeric list-index syntax; the results are cached in
  * key_indices so the per-item traversal loop needs no string parsing.
  *
+ * A path whose first segment is LOOKUP_KEY reads the item's joined record
+ * instead when tnfilter() runs with a lookup (lookup is then set), unless
+ * the model has a field of that name (see path_is_lookup()).
+ *
  * Memory: keys and key_indices are PyMem_RawMalloc'd parallel arrays of
  * length nkeys, owned by this struct.  rename is an owned PyObject ref,
  * or NULL for plain paths.  free_select_specs() releases everything.
@@ -68,6 +85,7 @@ typedef struct {
     Py_ssize_t *key_indices; /* parallel: >= 0 = list index, -1 = attr name */
     Py_ssize_t nkeys;
     PyObject *rename;        /* non-NULL: flat output key for [target, rename] specs */
+    bool lookup;             /* keys[0] is LOOKUP_KEY (see lookup_record()) */
 } compiled_select_spec_t;
 
 /*
@@ -95,6 +113,96 @@ typedef struct {
     int nulls_mode;          /* 0 = none, 1 = nulls_first, 2 = nulls_last */
 } compiled_order_spec_t;
 
+/*
+ * order_key_t — one order_by key of a row, as sort_by_spec() sees it (see
+ * order_keys_get()).  null is set when the spec has a nulls_ mode and the
+ * row lands in the nulls bucket; val is then NULL.  Rows are compared with
+ * order_keys_cmp(), which reproduces apply_order()'s ordering apart from
+ * its final tie-break on list position.
+ */
+typedef struct {
+    PyObject *val;  /* owned, NULL when null */
+    bool null;
+} order_key_t;
+
+#define ORDER_CMP_ERROR (-2)
+
+/*
+ * compiled_agg_spec_t — one group_by field or aggregate compiled from
+ * compile_options(group_by=..., aggregate=...).
+ *
+ * The path is pre-split the same way as compiled_order_spec_t and read with
+ * the same traversal, so group keys and aggregated values resolve exactly
+ * like order_by keys.  name is the output dict key: the group_by path as
+ * passed, or the aggregate's key in the aggregate mapping.  nkeys == 0 only
+ * for a path-less AGG_COUNT (count rows).
+ *
+ * Memory: same ownership rules as compiled_order_spec_t; name is an owned
+ * ref.  free_agg_specs() releases everything.
+ */
+enum {
+    AGG_KEY,            /* group_by field */
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_DISTINCT_COUNT,
+};
+
+typedef struct {
+    PyObject **keys;         /* owned array of PyUnicode path components */
+    Py_ssize_t *key_indices; /* parallel: >= 0 = list index, -1 = attr name */
+    Py_ssize_t nkeys;
+    PyObject *name;          /* output dict key (owned) */
+    int func;                /* AGG_* */
+} compiled_agg_spec_t;
+
+/*
+ * group_acc_t — running per-group aggregate state for one grouped query.
+ *
+ * Opaque here; defined in filter_options.c.  Created by group_acc_new(),
+ * fed each matching item by filter_list_run() and turned into the list of
+ * group dicts by group_acc_finish().
+ */
+typedef struct group_acc group_acc_t;
+
+/*
+ * prof_node_t — per-node counters for explain(), mirroring one node of a
+ * compiled filter tree.
+ *
+ * Built by prof_tree_new() with the same shape as the compiled tree and
+ * filled by filter_list_run() when it is handed a profile.  time_ns is
+ * inclusive of children and of everything the node's operator calls
+ * (casefold, regex match, rich comparison).  path_misses counts leaf
+ * evaluations that found no value at the filter path.  term is the node's
+ * label: the [path, op, value] list of a leaf, or "OR" / "AND".
+ */
+typedef struct prof_node {
+    PyObject *term;               /* owned label */
+    Py_ssize_t evaluations;
+    Py_ssize_t matches;
+    Py_ssize_t path_misses;
+    uint64_t time_ns;
+    struct prof_node *ch;         /* owned array of nch children */
+    Py_ssize_t nch;
+} prof_node_t;
+
+/* Phase timings filled by apply_options() when handed a non-NULL pointer. */
+typedef struct {
+    uint64_t select_ns;
+    uint64_t order_ns;
+    uint64_t slice_ns;
+} options_timing_t;
+
+static inline uint64_t
+fl_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 /*
  * CompiledFiltersObject — Python-visible object wrapping a compiled filter tree.
  *
@@ -115,6 +223,29 @@ typedef struct {
     PyObject *repr_str;
 } CompiledFiltersObject;
 
+/*
+ * CompiledFilterSetObject — many subscribers' CompiledFilters behind a single
+ * match call.
+ *
+ * Created by compile_filter_set() and passed to match_any().  ids/filters are
+ * parallel tuples in subscription order.  Each subscriber with a top-level
+ * [path, "=", value] term is filed under one such term in a per-path hash
+ * index (filter_index_t, see filter_set.c); the rest are listed in scan[] and
+ * evaluated for every item.  All members share one model (or None).
+ */
+typedef struct filter_index filter_index_t;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *ids;            /* tuple of subscriber ids                */
+    PyObject *filters;        /* tuple of CompiledFilters, parallel     */
+    PyObject *model;          /* shared model= class, or None           */
+    filter_index_t *indexes;  /* owned array, one per indexed path      */
+    Py_ssize_t nindexes;
+    Py_ssize_t *scan;         /* owned: subscribers with no index term  */
+    Py_ssize_t nscan;
+} CompiledFilterSetObject;
+
 /*
  * CompiledOptionsObject — Python-visible object wrapping compiled post-filter
  * options (select, order_by, count, offset, limit).
@@ -126,9 +257,14 @@ typedef struct {
  *   shortcircuit — stop after the first match (get=True with no order_by).
  *   count_flag   — return item count instead of the list.
  *   select_specs — field projection specs; NULL / nselect==0 means no projection.
+ *   distinct     — keep only the first row of each distinct projection
+ *                  (requires select_specs).
  *   order_specs  — ordering directives applied in reverse spec order (so
  *                  specs[0] is the primary key); NULL / norder==0 means no sort.
  *   offset/limit — applied after ordering; limit==0 means no cap.
+ *   group_specs/agg_specs — group_by fields and aggregates (see
+ *                  compiled_agg_spec_t); `grouped` is set when either
+ *                  was given.
  *   repr_str     — lazily cached __repr__.
  */
 typedef struct {
@@ -138,6 +274,7 @@ typedef struct {
     bool count_flag;
     compiled_select_spec_t *select_specs;
     Py_ssize_t nselect;
+    bool distinct;
     compiled_order_spec_t *order_specs;
     Py_ssize_t norder;
     Py_ssize_t offset;
@@ -146,12 +283,65 @@ typedef struct {
     PyObject *arg_select;
     PyObject *arg_order_by;
     PyObject *model;
+    /* group_by / aggregate: when grouped, the filter pass folds matching
+     * items into one dict per group and select/order_by/offset/limit/count
+     * apply to those dicts instead of the items. */
+    bool grouped;
+    compiled_agg_spec_t *group_specs;
+    Py_ssize_t ngroup;
+    compiled_agg_spec_t *agg_specs;
+    Py_ssize_t nagg;
+    PyObject *arg_group_by;
+    PyObject *arg_aggregate;
 } CompiledOptionsObject;
 
+/*
+ * CompiledLookupObject — a hash-join table for tnfilter(lookup=...).
+ *
+ * Created by compile_lookup() from a second collection: every record is
+ * filed in `table` under its value at the foreign path.  At query time an
+ * item's value at the local path (local_keys, pre-split like an order_by
+ * path) is looked up in `table`, and "lookup.<path>" filter leaves and select
+ * entries read the record found.  local/foreign hold the paths as passed.
+ */
+#define LOOKUP_KEY "lookup"
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *table;         /* dict: foreign key value -> record */
+    PyObject **local_keys;   /* owned array of PyUnicode path components */
+    Py_ssize_t *local_key_indices;
+    Py_ssize_t nlocal;
+    PyObject *local;
+    PyObject *foreign;
+} CompiledLookupObject;
+
+/*
+ * lookup_ctx_t — per-run join state behind fl_state_t.lookup.  Caches the
+ * record of the last item resolved, since several leaves and select entries
+ * usually ask for the same item in a row.
+ */
+typedef struct lookup_ctx {
+    CompiledLookupObject *lk; /* borrowed for the run */
+    PyObject *item;           /* owned: item `rec` was resolved for */
+    PyObject *rec;            /* borrowed from lk->table; NULL = no match */
+} lookup_ctx_t;
+
+/*
+ * Version of the tuples CompiledFilters / CompiledOptions pickle to (see
+ * cf_dump(), options_dump()).  Bump it whenever their layout, or the meaning
+ * of an op / func / nulls code in them, changes: loading a different version
+ * raises ValueError rather than misreading the plan.
+ */
+#define PLAN_FORMAT_VERSION 1
+
 /* -- pre-compiled type objects ----------------------------------------------- */
 
 extern PyTypeObject CompiledFilters_Type;
 extern PyTypeObject CompiledOptions_Type;
+extern PyTypeObject CompiledFilterSet_Type;
+extern PyTypeObject LiveQuery_Type;
+extern PyTypeObject CompiledLookup_Type;
 
 /* -- internal functions used by truenas_pyfilter.c ----------------------- */
 
@@ -159,16 +349,66 @@ compiled_filter_t *compile_filter(PyObject *f, fl_state_t *state, int depth,
                                   PyObject *model);
 int resolve_alias_keys(PyObject **keys, Py_ssize_t *key_indices,
                        Py_ssize_t nkeys, PyObject *model, fl_state_t *state);
+int path_is_lookup(PyObject *key, PyObject *model, fl_state_t *state);
 void free_cf_array(compiled_filter_t **arr, Py_ssize_t n);
 PyObject *filter_list_run(PyObject *data,
                           compiled_filter_t * const *compiled,
                           Py_ssize_t nfilters, bool shortcircuit,
-                          PyObject *model, fl_state_t *state);
+                          PyObject *model, fl_state_t *state,
+                          group_acc_t *groups, prof_node_t *prof,
+                          Py_ssize_t *nitemsp);
+prof_node_t *prof_tree_new(compiled_filter_t * const *compiled,
+                           Py_ssize_t n);
+void prof_tree_free(prof_node_t *nodes, Py_ssize_t n);
 bool match_item(PyObject *item, compiled_filter_t * const *compiled,
                 Py_ssize_t nfilters, PyObject *model, fl_state_t *state,
                 bool *matchp);
+int check_item_model(PyObject *item, PyObject *model, Py_ssize_t nfilters,
+                     fl_state_t *state, const char *fn);
+int eval_filters(PyObject *item, compiled_filter_t * const *compiled,
+                 Py_ssize_t nfilters, fl_state_t *state);
+int cf_index_term(const compiled_filter_t *cf, PyObject **pathp,
+                  PyObject **valuep);
+int cf_fetch_value(PyObject *item, const compiled_filter_t *cf,
+                   fl_state_t *state, PyObject **out);
+PyObject *filters_load(PyObject *args, fl_state_t *state);
+
+/* filter_set.c */
+PyObject *filter_set_new(PyObject *subscribers);
+PyObject *filter_set_match(PyObject *item, CompiledFilterSetObject *fs,
+                           fl_state_t *state);
+
+/* filter_explain.c */
+PyObject *filter_explain(PyObject *data, CompiledFiltersObject *cf,
+                         CompiledOptionsObject *co, fl_state_t *state);
+int init_explain_types(PyObject *module, fl_state_t *state);
+
+/* filter_page.c */
+PyObject *filter_page(PyObject *data, CompiledFiltersObject *cf,
+                      CompiledOptionsObject *co, PyObject *after,
+                      fl_state_t *state);
+int init_page_types(PyObject *module, fl_state_t *state);
+
+/* filter_lookup.c */
+PyObject *lookup_new(PyObject *data, PyObject *local, PyObject *foreign);
+int lookup_record(PyObject *item, fl_state_t *state, PyObject **recp);
+void lookup_ctx_enter(fl_state_t *state, lookup_ctx_t *ctx,
+                      CompiledLookupObject *lk, lookup_ctx_t **savep);
+void lookup_ctx_exit(fl_state_t *state, lookup_ctx_t *ctx,
+                     lookup_ctx_t *saved);
+
+/* live_query.c */
+PyObject *live_query_new(PyObject *module, PyObject *data,
+                         CompiledFiltersObject *filters,
+                         CompiledOptionsObject *options, PyObject *key);
+int init_live_query_types(PyObject *module, fl_state_t *state);
 
 /* filter_options.c */
+int opt_split_keys(PyObject *path_obj, PyObject ***out_keys,
+                   Py_ssize_t **out_indices, Py_ssize_t *out_nkeys);
+PyObject *opt_traverse_keys(PyObject *item, PyObject **keys,
+                            Py_ssize_t *key_indices, Py_ssize_t nkeys,
+                            int *found);
 void free_select_specs(compiled_select_spec_t *specs, Py_ssize_t n);
 void free_order_specs(compiled_order_spec_t *specs, Py_ssize_t n);
 int compile_select_specs(PyObject *select_val, PyObject *model,
@@ -185,7 +425,26 @@ PyObject *apply_select(PyObject *list,
                        PyObject *model, fl_state_t *state);
 PyObject *apply_order(PyObject *list,
                       compiled_order_spec_t *specs, Py_ssize_t nspecs);
+int order_spec_value(PyObject *item, compiled_order_spec_t *spec,
+                     PyObject **valp, bool *nullp);
+int order_keys_get(PyObject *row, compiled_order_spec_t *specs,
+                   Py_ssize_t nspecs, order_key_t *keys);
+void order_keys_clear(order_key_t *keys, Py_ssize_t nspecs);
+int order_keys_cmp(const compiled_order_spec_t *specs, Py_ssize_t nspecs,
+                   const order_key_t *a, const order_key_t *b);
 PyObject *apply_options(PyObject *filtered, CompiledOptionsObject *co,
-                        fl_state_t *state);
+                        fl_state_t *state, options_timing_t *timing);
+void free_agg_specs(compiled_agg_spec_t *specs, Py_ssize_t n);
+int compile_group_specs(PyObject *group_by_val, PyObject *aggregate_val,
+                        PyObject *model, fl_state_t *state,
+                        compiled_agg_spec_t **out_group, Py_ssize_t *out_ngroup,
+                        compiled_agg_spec_t **out_agg, Py_ssize_t *out_nagg);
+group_acc_t *group_acc_new(CompiledOptionsObject *co);
+int group_acc_add(group_acc_t *acc, PyObject *item);
+PyObject *group_acc_finish(group_acc_t *acc);
+Py_ssize_t group_acc_nitems(const group_acc_t *acc);
+void group_acc_free(group_acc_t *acc);
+PyObject *options_dump(CompiledOptionsObject *co);
+PyObject *options_load(PyObject *args, fl_state_t *state);
 
 #endif /* FILTER_LIST_H */
@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+/*
+ * CompiledLookup: hash-join enrichment for tnfilter(lookup=...).
+ *
+ * Middleware queries often filter one collection by attributes of a related
+ * one (shares whose dataset is encrypted, ...), which in Python means
+ * building a dict of the second collection and probing it per item.
+ * compile_lookup() builds that dict once, in C: every record of the second
+ * collection is filed under its value at the foreign path.  While tnfilter()
+ * runs with the lookup, an item's joined record is the one filed under the
+ * item's value at the local path, and filter leaves and select entries whose
+ * path starts with "lookup" read that record instead of the item
+ * (lookup_record(), called from eval_simple_from() and opt_select_value()).
+ *
+ * The join is many-to-one: foreign key values must be unique.  None never
+ * joins, on either side (absent paths read as None), as NULL never joins in
+ * SQL.  An item with no joined record fails every lookup leaf and has its
+ * lookup select entries left out.
+ */
+
+#include "filter_list.h"
+
+/* ===========================================================================
+ * Construction
+ * =========================================================================== */
+
+static int
+lookup_check_path(PyObject *path, const char *what)
+{
+    if (!PyUnicode_Check(path)) {
+        PyErr_Format(PyExc_TypeError,
+                     "compile_lookup: %s must be a string", what);
+        return -1;
+    }
+    if (PyUnicode_GET_LENGTH(path) == 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "compile_lookup: %s must not be empty", what);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+free_keys(PyObject **keys, Py_ssize_t *indices, Py_ssize_t nkeys)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < nkeys; i++)
+        Py_DECREF(keys[i]);
+    PyMem_RawFree(keys);
+    PyMem_RawFree(indices);
+}
+
+/*
+ * File every record of `data` in `table` under its value at the foreign
+ * path.  Returns 0 on success, -1 on error (exception set).
+ */
+static int
+lookup_fill(PyObject *table, PyObject *data, PyObject **keys,
+            Py_ssize_t *indices, Py_ssize_t nkeys)
+{
+    PyObject *iter = NULL;
+    PyObject *rec = NULL;
+    PyObject *key = NULL;
+    Py_ssize_t before;
+    int found;
+    int rv = -1;
+
+    iter = PyObject_GetIter(data);
+    if (!iter)
+        return -1;
+
+    while ((rec = PyIter_Next(iter)) != NULL) {
+        key = opt_traverse_keys(rec, keys, indices, nkeys, &found);
+        if (!key)
+            goto out;
+        if (key != Py_None) {
+            before = PyDict_GET_SIZE(table);
+            if (PyDict_SetDefault(table, key, rec) == NULL)
+                goto out;
+            if (PyDict_GET_SIZE(table) == before) {
+                PyErr_Format(PyExc_ValueError,
+                             "compile_lookup: duplicate foreign key %R", key);
+                goto out;
+            }
+        }
+        Py_CLEAR(key);
+        Py_CLEAR(rec);
+    }
+    rv = PyErr_Occurred() ? -1 : 0;
+
+out:
+    Py_XDECREF(key);
+    Py_XDECREF(rec);
+    Py_DECREF(iter);
+    return rv;
+}
+
+PyObject *
+lookup_new(PyObject *data, PyObject *local, PyObject *foreign)
+{
+    CompiledLookupObject *lk = NULL;
+    PyObject **fkeys = NULL;
+    Py_ssize_t *findices = NULL;
+    Py_ssize_t nforeign = 0;
+    int r;
+
+    if (lookup_check_path(local, "local") < 0 ||
+        lookup_check_path(foreign, "foreign") < 0)
+        return NULL;
+
+    lk = PyObject_GC_New(CompiledLookupObject, &CompiledLookup_Type);
+    if (!lk)
+        return NULL;
+    lk->table = NULL;
+    lk->local_keys = NULL;
+    lk->local_key_indices = NULL;
+    lk->nlocal = 0;
+    lk->local = Py_NewRef(local);
+    lk->foreign = Py_NewRef(foreign);
+    PyObject_GC_Track(lk);
+
+    lk->table = PyDict_New();
+    if (!lk->table ||
+        opt_split_keys(local, &lk->local_keys, &lk->local_key_indices,
+                       &lk->nlocal) < 0 ||
+        opt_split_keys(foreign, &fkeys, &findices, &nforeign) < 0) {
+        Py_DECREF(lk);
+        return NULL;
+    }
+
+    r = lookup_fill(lk->table, data, fkeys, findices, nforeign);
+    free_keys(fkeys, findices, nforeign);
+    if (r < 0) {
+        Py_DECREF(lk);
+        return NULL;
+    }
+    return (PyObject *)lk;
+}
+
+/* ===========================================================================
+ * Query time
+ * =========================================================================== */
+
+/*
+ * Make `lk` the join of the run about to start on `state`, saving any outer
+ * run's join (a callback may re-enter tnfilter()) into *savep.
+ */
+void
+lookup_ctx_enter(fl_state_t *state, lookup_ctx_t *ctx,
+                 CompiledLookupObject *lk, lookup_ctx_t **savep)
+{
+    *savep = state->lookup;
+    ctx->lk = lk;
+    ctx->item = NULL;
+    ctx->rec = NULL;
+    state->lookup = lk ? ctx : NULL;
+}
+
+void
+lookup_ctx_exit(fl_state_t *state, lookup_ctx_t *ctx, lookup_ctx_t *saved)
+{
+    Py_CLEAR(ctx->item);
+    state->lookup = saved;
+}
+
+/*
+ * Set *recp to the record `item` joins to in the active lookup (borrowed
+ * from the table), or NULL when it joins none.  Returns 0 on success, -1 on
+ * error (an unhashable local key value raises TypeError).
+ */
+int
+lookup_record(PyObject *item, fl_state_t *state, PyObject **recp)
+{
+    lookup_ctx_t *ctx = state->lookup;
+    CompiledLookupObject *lk = ctx->lk;
+    PyObject *key = NULL;
+    PyObject *rec = NULL;
+    int found;
+
+    if (item == ctx->item) {
+        *recp = ctx->rec;
+        return 0;
+    }
+
+    key = opt_traverse_keys(item, lk->local_keys, lk->local_key_indices,
+                            lk->nlocal, &found);
+    if (!key)
+        return -1;
+    if (key != Py_None) {
+        rec = PyDict_GetItemWithError(lk->table, key);
+        if (!rec && PyErr_Occurred()) {
+            Py_DECREF(key);
+            return -1;
+        }
+    }
+    Py_DECREF(key);
+
+    Py_XSETREF(ctx->item, Py_NewRef(item));
+    ctx->rec = rec;
+    *recp = rec;
+    return 0;
+}
+
+/* ===========================================================================
+ * CompiledLookup Python type
+ * =========================================================================== */
+
+static int
+compiled_lookup_traverse(CompiledLookupObject *self, visitproc visit,
+                         void *arg)
+{
+    Py_VISIT(self->table);
+    return 0;
+}
+
+static int
+compiled_lookup_clear(CompiledLookupObject *self)
+{
+    Py_CLEAR(self->table);
+    return 0;
+}
+
+static void
+compiled_lookup_dealloc(CompiledLookupObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    compiled_lookup_clear(self);
+    if (self->local_keys)
+        free_keys(self->local_keys, self->local_key_indices, self->nlocal);
+    Py_CLEAR(self->local);
+    Py_CLEAR(self->foreign);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+compiled_lookup_repr(CompiledLookupObject *self)
+{
+    return PyUnicode_FromFormat("CompiledLookup(local=%R, foreign=%R, records=%zd)",
+                                self->local, self->foreign,
+                                self->table ? PyDict_GET_SIZE(self->table) : 0);
+}
+
+static Py_ssize_t
+compiled_lookup_length(CompiledLookupObject *self)
+{
+    return self->table ? PyDict_GET_SIZE(self->table) : 0;
+}
+
+static PySequenceMethods compiled_lookup_as_sequence = {
+    .sq_length = (lenfunc)compiled_lookup_length,
+};
+
+static PyMemberDef compiled_lookup_members[] = {
+    {"local", Py_T_OBJECT_EX, offsetof(CompiledLookupObject, local), Py_READONLY},
+    {"foreign", Py_T_OBJECT_EX, offsetof(CompiledLookupObject, foreign), Py_READONLY},
+    {NULL}
+};
+
+PyTypeObject CompiledLookup_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "truenas_pyfilter.CompiledLookup",
+    .tp_basicsize = sizeof(CompiledLookupObject),
+    .tp_dealloc = (destructor)compiled_lookup_dealloc,
+    .tp_repr = (reprfunc)compiled_lookup_repr,
+    .tp_as_sequence = &compiled_lookup_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = PyDoc_STR("Hash-join table for tnfilter(lookup=...); see "
+                        "compile_lookup()."),
+    .tp_traverse = (traverseproc)compiled_lookup_traverse,
+    .tp_clear = (inquiry)compiled_lookup_clear,
+    .tp_members = compiled_lookup_members,
+};
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 /*
- * Result-mutation passes: select projection, order_by, count, offset, limit.
+ * Result-mutation passes: select projection, order_by, count, offset, limit,
+ * and the group_by/aggregate fold that replaces the matched list with one
+ * dict per group.
  *
  * These operate on the already-filtered list produced by filter_list_run()
  * and correspond to the Python-level do_select / do_order / do_count helpers
@@ -27,7 +29,7 @@
  *   "foo\.bar.baz" ->  ["foo.bar", "baz"]
  * =========================================================================== */
 
-static int
+int
 opt_split_keys(PyObject *path_obj,
                PyObject ***out_keys, Py_ssize_t **out_indices,
                Py_ssize_t *out_nkeys)
@@ -204,7 +206,7 @@ compile_select_specs(PyObject *select_val, PyObject *model, fl_state_t *state,
     compiled_select_spec_t *specs = NULL;
     Py_ssize_t si;
     PyObject *spec = NULL, *target = NULL, *rename = NULL;
-    int owned;
+    int owned, lookup;
 
     nspecs = PySequence_Size(select_val);
     if (nspecs < 0)
@@ -279,9 +281,19 @@ compile_select_specs(PyObject *select_val, PyObject *model, fl_state_t *state,
         if (owned)
             Py_DECREF(target);
 
+        /* lookup.<path> reads the joined record, which the model does not
+         * describe: leave it unresolved. */
+        lookup = path_is_lookup(specs[si].keys[0], model, state);
+        if (lookup < 0) {
+            Py_DECREF(spec);
+            free_select_specs(specs, si + 1);
+            return -1;
+        }
+        specs[si].lookup = lookup;
+
         /* Resolve pydantic field aliases -> attribute names so the per-item
          * select traversal reads the stored attribute. */
-        if (model != NULL && model != Py_None) {
+        if (model != NULL && model != Py_None && !specs[si].lookup) {
             if (resolve_alias_keys(specs[si].keys, specs[si].key_indices,
                                    specs[si].nkeys, model, state) < 0) {
                 Py_DECREF(spec);
@@ -409,6 +421,219 @@ error:
     return -1;
 }
 
+void
+free_agg_specs(compiled_agg_spec_t *specs, Py_ssize_t n)
+{
+    Py_ssize_t i, j;
+
+    if (!specs) return;
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < specs[i].nkeys; j++)
+            Py_DECREF(specs[i].keys[j]);
+        PyMem_RawFree(specs[i].keys);
+        PyMem_RawFree(specs[i].key_indices);
+        Py_XDECREF(specs[i].name);
+    }
+    PyMem_RawFree(specs);
+}
+
+static const struct {
+    const char *name;
+    int func;
+} agg_funcs[] = {
+    { "count",          AGG_COUNT },
+    { "sum",            AGG_SUM },
+    { "min",            AGG_MIN },
+    { "max",            AGG_MAX },
+    { "distinct_count", AGG_DISTINCT_COUNT },
+};
+
+/* Split (and alias-resolve) one group_by / aggregate field path into spec. */
+static int
+compile_agg_path(compiled_agg_spec_t *spec, PyObject *path, PyObject *model,
+                 fl_state_t *state)
+{
+    if (!PyUnicode_Check(path)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "filter_list: group_by/aggregate field path must be a string");
+        return -1;
+    }
+    if (PyUnicode_GET_LENGTH(path) == 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "filter_list: group_by/aggregate field path is empty");
+        return -1;
+    }
+    if (opt_split_keys(path, &spec->keys, &spec->key_indices, &spec->nkeys) < 0)
+        return -1;
+    if (model != NULL && model != Py_None)
+        return resolve_alias_keys(spec->keys, spec->key_indices, spec->nkeys,
+                                  model, state);
+    return 0;
+}
+
+/*
+ * Parse one aggregate mapping entry: name -> [func] or [func, path].  Only
+ * "count" may omit the path (count matching items rather than values).
+ */
+static int
+compile_agg_entry(compiled_agg_spec_t *spec, PyObject *name, PyObject *entry,
+                  PyObject *model, fl_state_t *state)
+{
+    PyObject *func = NULL;
+    const char *fname = NULL;
+    Py_ssize_t n, i;
+
+    if (!PyUnicode_Check(name)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "filter_list: aggregate names must be strings");
+        return -1;
+    }
+    spec->name = Py_NewRef(name);
+
+    if (!PyList_Check(entry) && !PyTuple_Check(entry)) {
+        PyErr_Format(PyExc_TypeError,
+                     "filter_list: aggregate %R must be [func] or [func, path]",
+                     name);
+        return -1;
+    }
+    n = PySequence_Fast_GET_SIZE(entry);
+    if (n < 1 || n > 2) {
+        PyErr_Format(PyExc_ValueError,
+                     "filter_list: aggregate %R must be [func] or [func, path]",
+                     name);
+        return -1;
+    }
+
+    func = PySequence_Fast_GET_ITEM(entry, 0);
+    fname = PyUnicode_Check(func) ? PyUnicode_AsUTF8(func) : NULL;
+    if (!fname && PyErr_Occurred())
+        return -1;
+    spec->func = -1;
+    for (i = 0; fname && i < (Py_ssize_t)(sizeof(agg_funcs) / sizeof(agg_funcs[0])); i++) {
+        if (strcmp(fname, agg_funcs[i].name) == 0) {
+            spec->func = agg_funcs[i].func;
+            break;
+        }
+    }
+    if (spec->func < 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "filter_list: aggregate %R: unknown function %R "
+                     "(expected count, sum, min, max or distinct_count)",
+                     name, func);
+        return -1;
+    }
+
+    if (n == 1) {
+        if (spec->func != AGG_COUNT) {
+            PyErr_Format(PyExc_ValueError,
+                         "filter_list: aggregate %R: %s requires a field path",
+                         name, fname);
+            return -1;
+        }
+        return 0;
+    }
+    return compile_agg_path(spec, PySequence_Fast_GET_ITEM(entry, 1), model,
+                            state);
+}
+
+/*
+ * Compile compile_options(group_by=..., aggregate=...) into group_by field
+ * specs and aggregate specs.  Either value may be NULL / None.  Output keys
+ * (group_by paths and aggregate names) must be distinct.  Returns 0 on
+ * success, -1 on error (exception set, nothing allocated).
+ */
+int
+compile_group_specs(PyObject *group_by_val, PyObject *aggregate_val,
+                    PyObject *model, fl_state_t *state,
+                    compiled_agg_spec_t **out_group, Py_ssize_t *out_ngroup,
+                    compiled_agg_spec_t **out_agg, Py_ssize_t *out_nagg)
+{
+    compiled_agg_spec_t *group = NULL;
+    compiled_agg_spec_t *agg = NULL;
+    Py_ssize_t ngroup = 0, nagg = 0;
+    PyObject *names = NULL;
+    PyObject *path = NULL;
+    PyObject *name = NULL, *entry = NULL;
+    Py_ssize_t i, pos;
+    int dup;
+
+    if (group_by_val && group_by_val != Py_None) {
+        if (PyUnicode_Check(group_by_val)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "filter_list: group_by must be a list of field paths");
+            return -1;
+        }
+        ngroup = PySequence_Size(group_by_val);
+        if (ngroup < 0)
+            return -1;
+    }
+    if (aggregate_val && aggregate_val != Py_None) {
+        if (!PyDict_Check(aggregate_val)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "filter_list: aggregate must be a dict of "
+                            "name -> [func, path]");
+            return -1;
+        }
+        nagg = PyDict_GET_SIZE(aggregate_val);
+    }
+
+    group = PyMem_RawCalloc((size_t)ngroup + 1, sizeof(*group));
+    agg = PyMem_RawCalloc((size_t)nagg + 1, sizeof(*agg));
+    names = PySet_New(NULL);
+    if (!group || !agg) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    if (!names)
+        goto error;
+
+    for (i = 0; i < ngroup; i++) {
+        path = PySequence_GetItem(group_by_val, i);
+        if (!path)
+            goto error;
+        group[i].func = AGG_KEY;
+        group[i].name = path; /* steal ref */
+        if (compile_agg_path(&group[i], path, model, state) < 0)
+            goto error;
+        if (PySet_Add(names, path) < 0)
+            goto error;
+    }
+
+    pos = 0;
+    i = 0;
+    while (i < nagg && PyDict_Next(aggregate_val, &pos, &name, &entry)) {
+        if (compile_agg_entry(&agg[i++], name, entry, model, state) < 0)
+            goto error;
+        dup = PySet_Contains(names, name);
+        if (dup < 0 || (dup == 0 && PySet_Add(names, name) < 0))
+            goto error;
+        if (dup) {
+            PyErr_Format(PyExc_ValueError,
+                         "filter_list: duplicate group_by/aggregate output key %R",
+                         name);
+            goto error;
+        }
+    }
+    if (PySet_GET_SIZE(names) != ngroup + nagg) {
+        PyErr_SetString(PyExc_ValueError,
+                        "filter_list: duplicate group_by field path");
+        goto error;
+    }
+
+    Py_DECREF(names);
+    *out_group = group;
+    *out_ngroup = ngroup;
+    *out_agg = agg;
+    *out_nagg = nagg;
+    return 0;
+
+error:
+    Py_XDECREF(names);
+    free_agg_specs(group, ngroup);
+    free_agg_specs(agg, nagg);
+    return -1;
+}
+
 /* ===========================================================================
  * Runtime value traversal helpers
  * =========================================================================== */
@@ -425,7 +650,7 @@ error:
  * paths (e.g. getattr then dict-lookup) do not leak the intermediate
  * owned ref when ownership changes mid-path.
  */
-static PyObject *
+PyObject *
 opt_traverse_keys(PyObject *item, PyObject **keys, Py_ssize_t *key_indices,
                   Py_ssize_t nkeys, int *found)
 {
@@ -570,62 +795,85 @@ opt_select_traverse(PyObject *item, PyObject **keys, Py_ssize_t nkeys, int *foun
 #define SELECT_MAX_DEPTH 64
 
 /*
- * Apply one select spec to item, writing the result into entry.
+ * Store one select spec's value into entry.
  * If spec->rename is set, stores value at that flat key.
  * Otherwise reconstructs the nested dict path in entry.
  * Returns 0 on success, -1 on error (exception set).
  */
 static int
-opt_select_apply_spec(PyObject *item, PyObject *entry,
-                      const compiled_select_spec_t *spec)
+opt_select_store(PyObject *entry, const compiled_select_spec_t *spec,
+                 PyObject *value)
 {
-    PyObject *value = NULL;
     PyObject *obj = NULL, *sub = NULL;
     Py_ssize_t ki;
-    int found, rv;
-
-    value = opt_select_traverse(item, spec->keys, spec->nkeys, &found);
-    if (!value)
-        return -1;
-    if (!found) {
-        rv = 0; /* path absent - skip */
-        goto done;
-    }
+    int rv;
 
-    if (spec->rename) {
-        rv = PyDict_SetItem(entry, spec->rename, value);
-        goto done;
-    }
+    if (spec->rename)
+        return PyDict_SetItem(entry, spec->rename, value);
 
     /* No rename: reconstruct nested dict structure in output. */
     obj = entry;
     for (ki = 0; ki < spec->nkeys - 1; ki++) {
         sub = PyDict_GetItemWithError(obj, spec->keys[ki]);
         if (!sub) {
-            if (PyErr_Occurred()) {
-                rv = -1;
-                goto done;
-            }
+            if (PyErr_Occurred())
+                return -1;
             sub = PyDict_New();
-            if (!sub) {
-                rv = -1;
-                goto done;
-            }
+            if (!sub)
+                return -1;
             rv = PyDict_SetItem(obj, spec->keys[ki], sub);
             Py_DECREF(sub);
             if (rv < 0)
-                goto done;
+                return -1;
             sub = PyDict_GetItemWithError(obj, spec->keys[ki]);
-            if (!sub) {
-                rv = PyErr_Occurred() ? -1 : 0;
-                goto done;
-            }
+            if (!sub)
+                return PyErr_Occurred() ? -1 : 0;
         }
         obj = sub;
     }
-    rv = PyDict_SetItem(obj, spec->keys[spec->nkeys - 1], value);
+    return PyDict_SetItem(obj, spec->keys[spec->nkeys - 1], value);
+}
+
+/*
+ * Value of one select spec for item, as opt_select_traverse() returns it.
+ * Under tnfilter(lookup=...) a lookup.<path> spec reads <path> from the
+ * item's joined record ("lookup" alone is the whole record); an item with
+ * no joined record leaves the path absent.
+ */
+static PyObject *
+opt_select_value(PyObject *item, const compiled_select_spec_t *spec,
+                 fl_state_t *state, int *found)
+{
+    PyObject *rec = NULL;
+
+    if (spec->lookup && state->lookup) {
+        if (lookup_record(item, state, &rec) < 0)
+            return NULL;
+        if (!rec) {
+            *found = 0;
+            Py_RETURN_NONE;
+        }
+        return opt_select_traverse(rec, spec->keys + 1, spec->nkeys - 1,
+                                   found);
+    }
+    return opt_select_traverse(item, spec->keys, spec->nkeys, found);
+}
+
+/*
+ * Apply one select spec to item, writing the result into entry (nothing
+ * when the path is absent).  Returns 0 on success, -1 on error.
+ */
+static int
+opt_select_apply_spec(PyObject *item, PyObject *entry,
+                      const compiled_select_spec_t *spec, fl_state_t *state)
+{
+    PyObject *value = NULL;
+    int found, rv;
 
-done:
+    value = opt_select_value(item, spec, state, &found);
+    if (!value)
+        return -1;
+    rv = found ? opt_select_store(entry, spec, value) : 0;
     Py_DECREF(value);
     return rv;
 }
@@ -675,7 +923,7 @@ apply_select_item(PyObject *item, compiled_select_spec_t *specs, Py_ssize_t nspe
         return NULL;
 
     for (si = 0; si < nspecs; si++) {
-        if (opt_select_apply_spec(item, entry, &specs[si]) < 0) {
+        if (opt_select_apply_spec(item, entry, &specs[si], state) < 0) {
             Py_DECREF(entry);
             return NULL;
         }
@@ -720,6 +968,96 @@ apply_select(PyObject *list, compiled_select_spec_t *specs, Py_ssize_t nspecs,
     return result;
 }
 
+/*
+ * select with distinct=True: project every item, keeping only the first item
+ * of each distinct tuple of selected values.  The tuple is hashed into a set
+ * before any output dict is built, so duplicates cost one traversal and one
+ * set probe.  An absent path is keyed by a private sentinel, since it leaves
+ * the key out of the row where None would set it.  With count_only, return
+ * the number of distinct projections and build no rows at all.  Returns a
+ * new list (or int), or NULL on error (exception set).
+ */
+static PyObject *
+apply_select_distinct(PyObject *list, CompiledOptionsObject *co,
+                      fl_state_t *state, bool count_only)
+{
+    Py_ssize_t n = PyList_GET_SIZE(list);
+    PyObject *model = co->grouped ? Py_None : co->model;
+    PyObject *absent = NULL;
+    PyObject *seen = NULL;
+    PyObject *result = NULL;
+    PyObject *key = NULL;
+    PyObject *val = NULL;
+    PyObject *entry = NULL;
+    PyObject *obj = NULL;
+    Py_ssize_t before;
+    Py_ssize_t i, si;
+    int found;
+
+    absent = PyObject_CallNoArgs((PyObject *)&PyBaseObject_Type);
+    seen = PySet_New(NULL);
+    result = count_only ? NULL : PyList_New(0);
+    if (!absent || !seen || (!count_only && !result))
+        goto fail;
+
+    for (i = 0; i < n; i++) {
+        key = PyTuple_New(co->nselect);
+        if (!key)
+            goto fail;
+        for (si = 0; si < co->nselect; si++) {
+            val = opt_select_value(PyList_GET_ITEM(list, i),
+                                   &co->select_specs[si], state, &found);
+            if (!val)
+                goto fail;
+            if (!found)
+                Py_SETREF(val, Py_NewRef(absent));
+            PyTuple_SET_ITEM(key, si, val);
+        }
+
+        before = PySet_GET_SIZE(seen);
+        if (PySet_Add(seen, key) < 0)
+            goto fail;
+        if (count_only || PySet_GET_SIZE(seen) == before) {
+            Py_CLEAR(key);
+            continue;
+        }
+
+        entry = PyDict_New();
+        if (!entry)
+            goto fail;
+        for (si = 0; si < co->nselect; si++) {
+            val = PyTuple_GET_ITEM(key, si);
+            if (val != absent &&
+                opt_select_store(entry, &co->select_specs[si], val) < 0)
+                goto fail;
+        }
+        Py_CLEAR(key);
+        if (model != NULL && model != Py_None) {
+            obj = opt_select_build_model(entry, model, state);
+            Py_SETREF(entry, obj);
+            if (!entry)
+                goto fail;
+        }
+        if (PyList_Append(result, entry) < 0)
+            goto fail;
+        Py_CLEAR(entry);
+    }
+
+    if (count_only)
+        result = PyLong_FromSsize_t(PySet_GET_SIZE(seen));
+    Py_DECREF(absent);
+    Py_DECREF(seen);
+    return result;
+
+fail:
+    Py_XDECREF(absent);
+    Py_XDECREF(seen);
+    Py_XDECREF(result);
+    Py_XDECREF(key);
+    Py_XDECREF(entry);
+    return NULL;
+}
+
 /* ===========================================================================
  * order_by implementation
  *
@@ -732,8 +1070,24 @@ apply_select(PyObject *list, compiled_select_spec_t *specs, Py_ssize_t nspecs,
  * =========================================================================== */
 
 /*
- * Partition list into (nulls, non_nulls) via a top-level dict lookup for
- * spec->top_key being absent or None.
+ * Whether partition_nulls() buckets `item` as null: a top-level dict lookup
+ * for top_key being absent or None.  Returns 1 / 0, or -1 on error.
+ */
+static int
+order_key_is_null(PyObject *item, PyObject *top_key)
+{
+    PyObject *val = NULL;
+
+    if (PyDict_CheckExact(item)) {
+        val = PyDict_GetItemWithError(item, top_key);
+        if (!val && PyErr_Occurred())
+            return -1;
+    }
+    return !val || val == Py_None;
+}
+
+/*
+ * Partition list into (nulls, non_nulls) via order_key_is_null().
  * Returns 0 on success, -1 on error (exception set).
  */
 static int
@@ -741,20 +1095,120 @@ partition_nulls(PyObject *list, PyObject *top_key,
                 PyObject *nulls, PyObject *non_nulls)
 {
     Py_ssize_t n = PyList_GET_SIZE(list);
-    PyObject *item = NULL, *val = NULL, *bucket = NULL;
+    PyObject *item = NULL;
     Py_ssize_t i;
+    int null;
 
     for (i = 0; i < n; i++) {
         item = PyList_GET_ITEM(list, i);
-        val = NULL;
-        if (PyDict_CheckExact(item)) {
-            val = PyDict_GetItemWithError(item, top_key);
-            if (!val && PyErr_Occurred())
-                return -1;
+        null = order_key_is_null(item, top_key);
+        if (null < 0)
+            return -1;
+        if (PyList_Append(null ? nulls : non_nulls, item) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Sort key of a single `item` under `spec`, exactly as sort_by_spec() sees
+ * it: *nullp is set when the spec has a nulls_ mode and the item lands in the
+ * nulls bucket (*valp is then NULL); otherwise *valp is a new reference to
+ * the traversed value (None when absent).  Returns 0 on success, -1 on error.
+ */
+int
+order_spec_value(PyObject *item, compiled_order_spec_t *spec,
+                 PyObject **valp, bool *nullp)
+{
+    int found;
+    int null;
+
+    *valp = NULL;
+    *nullp = false;
+    if (spec->nulls_mode != 0) {
+        null = order_key_is_null(item, spec->top_key);
+        if (null < 0)
+            return -1;
+        if (null) {
+            *nullp = true;
+            return 0;
         }
-        bucket = (!val || val == Py_None) ? nulls : non_nulls;
-        if (PyList_Append(bucket, item) < 0)
+    }
+    *valp = opt_traverse_keys(item, spec->keys, spec->key_indices,
+                              spec->nkeys, &found);
+    return *valp ? 0 : -1;
+}
+
+/*
+ * Fill keys[0..nspecs) with the sort keys of `row`, for ordering rows one at
+ * a time (live_query.c, filter_page.c) instead of sorting a whole list.
+ * Returns 0 on success, -1 on error (keys cleared).
+ */
+int
+order_keys_get(PyObject *row, compiled_order_spec_t *specs, Py_ssize_t nspecs,
+               order_key_t *keys)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < nspecs; i++) {
+        if (order_spec_value(row, &specs[i], &keys[i].val, &keys[i].null) < 0) {
+            order_keys_clear(keys, i);
             return -1;
+        }
+    }
+    return 0;
+}
+
+void
+order_keys_clear(order_key_t *keys, Py_ssize_t nspecs)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < nspecs; i++) {
+        Py_CLEAR(keys[i].val);
+        keys[i].null = false;
+    }
+}
+
+/* -1 / 0 / 1 for a `<` b / neither / b `<` a, or ORDER_CMP_ERROR. */
+static int
+order_value_cmp(PyObject *a, PyObject *b)
+{
+    int r;
+
+    r = PyObject_RichCompareBool(a, b, Py_LT);
+    if (r != 0)
+        return r < 0 ? ORDER_CMP_ERROR : -1;
+    r = PyObject_RichCompareBool(b, a, Py_LT);
+    return r < 0 ? ORDER_CMP_ERROR : r;
+}
+
+/*
+ * Compare two rows' sort keys the way apply_order()'s stable multi-pass sort
+ * orders them: keys compared lexicographically with `<`, nulls_first: /
+ * nulls_last: buckets and the "-" prefix honoured per key.  Returns -1 / 0 /
+ * 1 when a sorts before / ties with / sorts after b (a tie is broken by list
+ * position in apply_order()), or ORDER_CMP_ERROR with an exception set.
+ */
+int
+order_keys_cmp(const compiled_order_spec_t *specs, Py_ssize_t nspecs,
+               const order_key_t *a, const order_key_t *b)
+{
+    Py_ssize_t i;
+    int c;
+
+    for (i = 0; i < nspecs; i++) {
+        if (a[i].null != b[i].null) {
+            c = a[i].null ? -1 : 1;
+            return specs[i].nulls_mode == 1 ? c : -c;
+        }
+        if (a[i].null)
+            continue; /* both in the nulls bucket: unordered by this spec */
+        c = order_value_cmp(a[i].val, b[i].val);
+        if (c == ORDER_CMP_ERROR)
+            return c;
+        if (c)
+            return specs[i].reverse ? -c : c;
     }
     return 0;
 }
@@ -938,28 +1392,350 @@ apply_order(PyObject *list, compiled_order_spec_t *specs, Py_ssize_t nspecs)
     return rv;
 }
 
+/* ===========================================================================
+ * group_by / aggregate
+ *
+ * A grouped query never materialises the matched items.  filter_list_run()
+ * hands each matching item to group_acc_add(), which resolves the group_by
+ * paths into a key tuple, finds (or opens) that group's slot through a dict,
+ * and folds the item into the slot's running aggregates.  group_acc_finish()
+ * then builds one dict per group, in first-seen order; the remaining options
+ * apply to those dicts.  Group key and aggregate paths use the order_by
+ * traversal (opt_traverse_keys): absent resolves to None.  None values are
+ * ignored by every aggregate except a path-less count.
+ * =========================================================================== */
+
+typedef struct {
+    Py_ssize_t count;   /* count: values seen                          */
+    PyObject *obj;      /* sum/min/max: running value (NULL until the
+                           first value); distinct_count: set of values */
+} agg_val_t;
+
+typedef struct {
+    PyObject *key;      /* tuple of group_by values (owned) */
+    agg_val_t *vals;    /* owned array of nagg              */
+} group_slot_t;
+
+struct group_acc {
+    CompiledOptionsObject *co;  /* borrowed: callers hold it for the run */
+    PyObject *index;            /* dict: key tuple -> slot number, or NULL
+                                   when there is no group_by (one slot)  */
+    group_slot_t *slots;
+    Py_ssize_t nslots;
+    Py_ssize_t cap;
+    Py_ssize_t nitems;          /* matching items folded in */
+};
+
+/* Append a slot for `key` (stolen).  Returns the slot, or NULL on error. */
+static group_slot_t *
+group_slot_new(group_acc_t *acc, PyObject *key)
+{
+    group_slot_t *slots = NULL;
+    agg_val_t *vals = NULL;
+    Py_ssize_t cap;
+
+    if (acc->nslots == acc->cap) {
+        cap = acc->cap ? acc->cap * 2 : 8;
+        slots = PyMem_RawRealloc(acc->slots, (size_t)cap * sizeof(*slots));
+        if (!slots) {
+            Py_DECREF(key);
+            PyErr_NoMemory();
+            return NULL;
+        }
+        acc->slots = slots;
+        acc->cap = cap;
+    }
+    vals = PyMem_RawCalloc((size_t)acc->co->nagg + 1, sizeof(*vals));
+    if (!vals) {
+        Py_DECREF(key);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    acc->slots[acc->nslots].key = key;
+    acc->slots[acc->nslots].vals = vals;
+    return &acc->slots[acc->nslots++];
+}
+
+group_acc_t *
+group_acc_new(CompiledOptionsObject *co)
+{
+    group_acc_t *acc = NULL;
+    PyObject *key = NULL;
+
+    acc = PyMem_RawCalloc(1, sizeof(*acc));
+    if (!acc) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    acc->co = co;
+
+    /* Without group_by every item folds into one group, reported even when
+     * nothing matched (count 0), as SQL does for a bare aggregate. */
+    if (co->ngroup == 0) {
+        key = PyTuple_New(0);
+        if (!key || !group_slot_new(acc, key)) {
+            group_acc_free(acc);
+            return NULL;
+        }
+        return acc;
+    }
+
+    acc->index = PyDict_New();
+    if (!acc->index) {
+        group_acc_free(acc);
+        return NULL;
+    }
+    return acc;
+}
+
+void
+group_acc_free(group_acc_t *acc)
+{
+    Py_ssize_t i, j;
+
+    if (!acc)
+        return;
+    for (i = 0; i < acc->nslots; i++) {
+        Py_DECREF(acc->slots[i].key);
+        for (j = 0; j < acc->co->nagg; j++)
+            Py_XDECREF(acc->slots[i].vals[j].obj);
+        PyMem_RawFree(acc->slots[i].vals);
+    }
+    PyMem_RawFree(acc->slots);
+    Py_XDECREF(acc->index);
+    PyMem_RawFree(acc);
+}
+
+Py_ssize_t
+group_acc_nitems(const group_acc_t *acc)
+{
+    return acc->nitems;
+}
+
+/* Fold the value `spec` reads from `item` into `av`. */
+static int
+agg_update(agg_val_t *av, const compiled_agg_spec_t *spec, PyObject *item)
+{
+    PyObject *val = NULL;
+    PyObject *tmp = NULL;
+    int found;
+    int r = 0;
+
+    if (spec->nkeys == 0) {
+        av->count++;
+        return 0;
+    }
+
+    val = opt_traverse_keys(item, spec->keys, spec->key_indices, spec->nkeys,
+                            &found);
+    if (!val)
+        return -1;
+    if (val == Py_None) {
+        Py_DECREF(val);
+        return 0;
+    }
+
+    switch (spec->func) {
+    case AGG_COUNT:
+        av->count++;
+        break;
+    case AGG_SUM:
+        if (!av->obj) {
+            av->obj = Py_NewRef(val);
+            break;
+        }
+        tmp = PyNumber_Add(av->obj, val);
+        if (!tmp) {
+            r = -1;
+            break;
+        }
+        Py_SETREF(av->obj, tmp);
+        break;
+    case AGG_MIN:
+    case AGG_MAX:
+        if (!av->obj) {
+            av->obj = Py_NewRef(val);
+            break;
+        }
+        r = PyObject_RichCompareBool(val, av->obj,
+                                     spec->func == AGG_MIN ? Py_LT : Py_GT);
+        if (r > 0)
+            Py_SETREF(av->obj, Py_NewRef(val));
+        r = r < 0 ? -1 : 0;
+        break;
+    case AGG_DISTINCT_COUNT:
+        if (!av->obj && !(av->obj = PySet_New(NULL))) {
+            r = -1;
+            break;
+        }
+        r = PySet_Add(av->obj, val);
+        break;
+    }
+
+    Py_DECREF(val);
+    return r;
+}
+
+int
+group_acc_add(group_acc_t *acc, PyObject *item)
+{
+    CompiledOptionsObject *co = acc->co;
+    group_slot_t *slot = NULL;
+    PyObject *key = NULL;
+    PyObject *val = NULL;
+    PyObject *pos = NULL;
+    Py_ssize_t i;
+    int found;
+
+    acc->nitems++;
+
+    if (!acc->index) {
+        slot = &acc->slots[0];
+    } else {
+        key = PyTuple_New(co->ngroup);
+        if (!key)
+            return -1;
+        for (i = 0; i < co->ngroup; i++) {
+            val = opt_traverse_keys(item, co->group_specs[i].keys,
+                                    co->group_specs[i].key_indices,
+                                    co->group_specs[i].nkeys, &found);
+            if (!val) {
+                Py_DECREF(key);
+                return -1;
+            }
+            PyTuple_SET_ITEM(key, i, val);
+        }
+
+        pos = PyDict_GetItemWithError(acc->index, key);
+        if (pos) {
+            slot = &acc->slots[PyLong_AsSsize_t(pos)];
+            Py_DECREF(key);
+        } else {
+            if (PyErr_Occurred()) {
+                Py_DECREF(key);
+                return -1;
+            }
+            pos = PyLong_FromSsize_t(acc->nslots);
+            if (!pos || PyDict_SetItem(acc->index, key, pos) < 0) {
+                Py_XDECREF(pos);
+                Py_DECREF(key);
+                return -1;
+            }
+            Py_DECREF(pos);
+            slot = group_slot_new(acc, key);
+            if (!slot)
+                return -1;
+        }
+    }
+
+    for (i = 0; i < co->nagg; i++) {
+        if (agg_update(&slot->vals[i], &co->agg_specs[i], item) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Final value of one aggregate.  Returns a new reference, or NULL on error. */
+static PyObject *
+agg_result(const agg_val_t *av, const compiled_agg_spec_t *spec)
+{
+    switch (spec->func) {
+    case AGG_SUM:
+        return av->obj ? Py_NewRef(av->obj) : PyLong_FromLong(0);
+    case AGG_MIN:
+    case AGG_MAX:
+        return Py_NewRef(av->obj ? av->obj : Py_None);
+    case AGG_DISTINCT_COUNT:
+        return PyLong_FromSsize_t(av->obj ? PySet_GET_SIZE(av->obj) : 0);
+    default:
+        return PyLong_FromSsize_t(av->count);
+    }
+}
+
+PyObject *
+group_acc_finish(group_acc_t *acc)
+{
+    CompiledOptionsObject *co = acc->co;
+    group_slot_t *slot = NULL;
+    PyObject *result = NULL;
+    PyObject *row = NULL;
+    PyObject *val = NULL;
+    Py_ssize_t i, j;
+
+    result = PyList_New(acc->nslots);
+    if (!result)
+        return NULL;
+
+    for (i = 0; i < acc->nslots; i++) {
+        slot = &acc->slots[i];
+        row = PyDict_New();
+        if (!row)
+            goto fail;
+        PyList_SET_ITEM(result, i, row);
+
+        for (j = 0; j < co->ngroup; j++) {
+            if (PyDict_SetItem(row, co->group_specs[j].name,
+                               PyTuple_GET_ITEM(slot->key, j)) < 0)
+                goto fail;
+        }
+        for (j = 0; j < co->nagg; j++) {
+            val = agg_result(&slot->vals[j], &co->agg_specs[j]);
+            if (!val || PyDict_SetItem(row, co->agg_specs[j].name, val) < 0) {
+                Py_XDECREF(val);
+                goto fail;
+            }
+            Py_DECREF(val);
+        }
+    }
+    return result;
+
+fail:
+    Py_DECREF(result);
+    return NULL;
+}
+
 /* ===========================================================================
  * apply_options
  *
- * Post-filter pipeline: select -> count -> order -> offset -> limit.
- * Order matches Python's filter_list().
+ * Post-filter pipeline: select (+ distinct) -> count -> order -> offset ->
+ * limit.  Order matches Python's filter_list().  For a grouped query `filtered` is
+ * the list of group dicts from group_acc_finish().
  * =========================================================================== */
 
 PyObject *
-apply_options(PyObject *filtered, CompiledOptionsObject *co, fl_state_t *state)
+apply_options(PyObject *filtered, CompiledOptionsObject *co, fl_state_t *state,
+              options_timing_t *timing)
 {
     PyObject *rv = NULL;
     PyObject *tmp = NULL;
     Py_ssize_t n, start, end;
+    uint64_t t0 = timing ? fl_now_ns() : 0;
+
+    if (co->distinct && co->count_flag) {
+        /* count distinct: hash the projections, build no rows. */
+        rv = apply_select_distinct(filtered, co, state, true);
+        if (timing)
+            timing->select_ns = fl_now_ns() - t0;
+        return rv;
+    }
 
-    if (co->nselect > 0) {
+    if (co->distinct) {
+        rv = apply_select_distinct(filtered, co, state, false);
+        if (!rv)
+            return NULL;
+    } else if (co->nselect > 0) {
+        /* Group dicts are plain dicts: never model-constructed. */
         rv = apply_select(filtered, co->select_specs, co->nselect,
-                          co->model, state);
+                          co->grouped ? Py_None : co->model, state);
         if (!rv)
             return NULL;
     } else {
         rv = Py_NewRef(filtered);
     }
+    if (timing) {
+        timing->select_ns = fl_now_ns() - t0;
+        t0 = fl_now_ns();
+    }
 
     if (co->count_flag) {
         n = PyList_GET_SIZE(rv);
@@ -974,6 +1750,10 @@ apply_options(PyObject *filtered, CompiledOptionsObject *co, fl_state_t *state)
             return NULL;
         rv = tmp;
     }
+    if (timing) {
+        timing->order_ns = fl_now_ns() - t0;
+        t0 = fl_now_ns();
+    }
 
     if (co->offset > 0) {
         n = PyList_GET_SIZE(rv);
@@ -994,6 +1774,385 @@ apply_options(PyObject *filtered, CompiledOptionsObject *co, fl_state_t *state)
             return NULL;
         rv = tmp;
     }
+    if (timing)
+        timing->slice_ns = fl_now_ns() - t0;
 
     return rv;
 }
+
+/* ===========================================================================
+ * Pickle support
+ *
+ * CompiledOptions pickles to its compiled specs rather than to the
+ * compile_options() kwargs: paths stay split and alias-resolved, so loading
+ * in another process parses nothing and never touches the model.  Each spec
+ * carries its path as (keys, key_indices) tuples plus the spec's own fields.
+ * =========================================================================== */
+
+#define PYBOOL(b) ((b) ? Py_True : Py_False)
+
+static PyObject *
+keys_dump(PyObject **keys, Py_ssize_t *key_indices, Py_ssize_t nkeys)
+{
+    PyObject *kt = NULL;
+    PyObject *it = NULL;
+    PyObject *idx = NULL;
+    Py_ssize_t i;
+
+    kt = PyTuple_New(nkeys);
+    it = PyTuple_New(nkeys);
+    if (!kt || !it)
+        goto fail;
+    for (i = 0; i < nkeys; i++) {
+        idx = PyLong_FromSsize_t(key_indices[i]);
+        if (!idx)
+            goto fail;
+        PyTuple_SET_ITEM(kt, i, Py_NewRef(keys[i]));
+        PyTuple_SET_ITEM(it, i, idx);
+    }
+    return Py_BuildValue("(NN)", kt, it);
+
+fail:
+    Py_XDECREF(kt);
+    Py_XDECREF(it);
+    return NULL;
+}
+
+/*
+ * Inverse of keys_dump(): `path` is its (keys, key_indices) pair.  The out
+ * parameters are only written on success.  Returns 0, or -1 on error.
+ */
+static int
+keys_load(PyObject *path, PyObject ***out_keys, Py_ssize_t **out_indices,
+          Py_ssize_t *out_nkeys)
+{
+    PyObject *kt = NULL;
+    PyObject *it = NULL;
+    PyObject **keys = NULL;
+    Py_ssize_t *indices = NULL;
+    Py_ssize_t n;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTuple(path, "O!O!", &PyTuple_Type, &kt, &PyTuple_Type, &it))
+        return -1;
+    n = PyTuple_GET_SIZE(kt);
+    if (PyTuple_GET_SIZE(it) != n) {
+        PyErr_SetString(PyExc_ValueError,
+                        "filter_list: invalid pickled CompiledOptions");
+        return -1;
+    }
+
+    keys = PyMem_RawCalloc((size_t)n + 1, sizeof(*keys));
+    indices = PyMem_RawCalloc((size_t)n + 1, sizeof(*indices));
+    if (!keys || !indices) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+    for (i = 0; i < n; i++) {
+        if (!PyUnicode_Check(PyTuple_GET_ITEM(kt, i))) {
+            PyErr_SetString(PyExc_ValueError,
+                            "filter_list: invalid pickled CompiledOptions");
+            goto fail;
+        }
+        indices[i] = PyLong_AsSsize_t(PyTuple_GET_ITEM(it, i));
+        if (indices[i] == -1 && PyErr_Occurred())
+            goto fail;
+        keys[i] = Py_NewRef(PyTuple_GET_ITEM(kt, i));
+    }
+
+    *out_keys = keys;
+    *out_indices = indices;
+    *out_nkeys = n;
+    return 0;
+
+fail:
+    for (i = 0; keys && i < n; i++)
+        Py_XDECREF(keys[i]);
+    PyMem_RawFree(keys);
+    PyMem_RawFree(indices);
+    return -1;
+}
+
+static PyObject *
+select_specs_dump(const compiled_select_spec_t *specs, Py_ssize_t n)
+{
+    PyObject *out = NULL;
+    PyObject *spec = NULL;
+    Py_ssize_t i;
+
+    out = PyTuple_New(n);
+    if (!out)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        spec = Py_BuildValue("(NOO)",
+                             keys_dump(specs[i].keys, specs[i].key_indices,
+                                       specs[i].nkeys),
+                             specs[i].rename ? specs[i].rename : Py_None,
+                             PYBOOL(specs[i].lookup));
+        if (!spec) {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(out, i, spec);
+    }
+    return out;
+}
+
+static PyObject *
+order_specs_dump(const compiled_order_spec_t *specs, Py_ssize_t n)
+{
+    PyObject *out = NULL;
+    PyObject *spec = NULL;
+    Py_ssize_t i;
+
+    out = PyTuple_New(n);
+    if (!out)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        spec = Py_BuildValue("(NOOi)",
+                             keys_dump(specs[i].keys, specs[i].key_indices,
+                                       specs[i].nkeys),
+                             specs[i].top_key, PYBOOL(specs[i].reverse),
+                             specs[i].nulls_mode);
+        if (!spec) {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(out, i, spec);
+    }
+    return out;
+}
+
+static PyObject *
+agg_specs_dump(const compiled_agg_spec_t *specs, Py_ssize_t n)
+{
+    PyObject *out = NULL;
+    PyObject *spec = NULL;
+    Py_ssize_t i;
+
+    out = PyTuple_New(n);
+    if (!out)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        spec = Py_BuildValue("(NOi)",
+                             keys_dump(specs[i].keys, specs[i].key_indices,
+                                       specs[i].nkeys),
+                             specs[i].name, specs[i].func);
+        if (!spec) {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(out, i, spec);
+    }
+    return out;
+}
+
+/*
+ * The argument tuple of truenas_pyfilter._load_options() for `co`; see
+ * options_load() for the layout.
+ */
+PyObject *
+options_dump(CompiledOptionsObject *co)
+{
+    return Py_BuildValue("(i(OOOOOnn)NNNN(OOOO)OO)",
+                         PLAN_FORMAT_VERSION,
+                         PYBOOL(co->get_flag), PYBOOL(co->shortcircuit),
+                         PYBOOL(co->count_flag), PYBOOL(co->distinct),
+                         PYBOOL(co->grouped), co->offset, co->limit,
+                         select_specs_dump(co->select_specs, co->nselect),
+                         order_specs_dump(co->order_specs, co->norder),
+                         agg_specs_dump(co->group_specs, co->ngroup),
+                         agg_specs_dump(co->agg_specs, co->nagg),
+                         co->arg_select, co->arg_order_by,
+                         co->arg_group_by, co->arg_aggregate,
+                         co->model, co->repr_str);
+}
+
+static int
+select_specs_load(PyObject *t, compiled_select_spec_t **out_specs,
+                  Py_ssize_t *out_n)
+{
+    compiled_select_spec_t *specs = NULL;
+    compiled_select_spec_t *sp = NULL;
+    PyObject *path = NULL;
+    PyObject *rename = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(t);
+    Py_ssize_t i;
+    int lookup;
+
+    specs = PyMem_RawCalloc((size_t)n + 1, sizeof(*specs));
+    if (!specs) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        sp = &specs[i];
+        if (!PyArg_ParseTuple(PyTuple_GET_ITEM(t, i), "OOp", &path, &rename,
+                              &lookup) ||
+            keys_load(path, &sp->keys, &sp->key_indices, &sp->nkeys) < 0)
+            goto fail;
+        if (sp->nkeys == 0 || (rename != Py_None && !PyUnicode_Check(rename))) {
+            PyErr_SetString(PyExc_ValueError,
+                            "filter_list: invalid pickled CompiledOptions");
+            goto fail;
+        }
+        sp->rename = rename == Py_None ? NULL : Py_NewRef(rename);
+        sp->lookup = lookup;
+    }
+    *out_specs = specs;
+    *out_n = n;
+    return 0;
+
+fail:
+    free_select_specs(specs, n);
+    return -1;
+}
+
+static int
+order_specs_load(PyObject *t, compiled_order_spec_t **out_specs,
+                 Py_ssize_t *out_n)
+{
+    compiled_order_spec_t *specs = NULL;
+    compiled_order_spec_t *sp = NULL;
+    PyObject *path = NULL;
+    PyObject *top_key = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(t);
+    Py_ssize_t i;
+    int reverse;
+    int nulls_mode;
+
+    specs = PyMem_RawCalloc((size_t)n + 1, sizeof(*specs));
+    if (!specs) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        sp = &specs[i];
+        if (!PyArg_ParseTuple(PyTuple_GET_ITEM(t, i), "OUpi", &path, &top_key,
+                              &reverse, &nulls_mode) ||
+            keys_load(path, &sp->keys, &sp->key_indices, &sp->nkeys) < 0)
+            goto fail;
+        if (sp->nkeys == 0 || nulls_mode < 0 || nulls_mode > 2) {
+            PyErr_SetString(PyExc_ValueError,
+                            "filter_list: invalid pickled CompiledOptions");
+            goto fail;
+        }
+        sp->top_key = Py_NewRef(top_key);
+        sp->reverse = reverse;
+        sp->nulls_mode = nulls_mode;
+    }
+    *out_specs = specs;
+    *out_n = n;
+    return 0;
+
+fail:
+    free_order_specs(specs, n);
+    return -1;
+}
+
+static int
+agg_specs_load(PyObject *t, compiled_agg_spec_t **out_specs, Py_ssize_t *out_n)
+{
+    compiled_agg_spec_t *specs = NULL;
+    compiled_agg_spec_t *sp = NULL;
+    PyObject *path = NULL;
+    PyObject *name = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(t);
+    Py_ssize_t i;
+    int func;
+
+    specs = PyMem_RawCalloc((size_t)n + 1, sizeof(*specs));
+    if (!specs) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        sp = &specs[i];
+        if (!PyArg_ParseTuple(PyTuple_GET_ITEM(t, i), "OOi", &path, &name,
+                              &func) ||
+            keys_load(path, &sp->keys, &sp->key_indices, &sp->nkeys) < 0)
+            goto fail;
+        if (func < AGG_KEY || func > AGG_DISTINCT_COUNT ||
+            (sp->nkeys == 0 && func != AGG_COUNT)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "filter_list: invalid pickled CompiledOptions");
+            goto fail;
+        }
+        sp->name = Py_NewRef(name);
+        sp->func = func;
+    }
+    *out_specs = specs;
+    *out_n = n;
+    return 0;
+
+fail:
+    free_agg_specs(specs, n);
+    return -1;
+}
+
+/*
+ * Unpickle a CompiledOptions.  `args` is options_dump()'s tuple, version
+ * already checked by truenas_pyfilter._load_options():
+ *   (version,
+ *    (get, shortcircuit, count, distinct, grouped, offset, limit),
+ *    select specs, order_by specs, group_by specs, aggregate specs,
+ *    (arg_select, arg_order_by, arg_group_by, arg_aggregate), model, repr)
+ */
+PyObject *
+options_load(PyObject *args, fl_state_t *state)
+{
+    CompiledOptionsObject *obj = NULL;
+    PyObject *sel = NULL, *ord = NULL, *grp = NULL, *agg = NULL;
+    PyObject *arg_select = NULL, *arg_order_by = NULL;
+    PyObject *arg_group_by = NULL, *arg_aggregate = NULL;
+    PyObject *model = NULL;
+    PyObject *repr_str = NULL;
+    int version;
+    int get_flag, shortcircuit, count_flag, distinct, grouped;
+    Py_ssize_t offset, limit;
+
+    if (!PyArg_ParseTuple(args, "i(pppppnn)O!O!O!O!(OOOO)OU", &version,
+                          &get_flag, &shortcircuit, &count_flag, &distinct,
+                          &grouped, &offset, &limit,
+                          &PyTuple_Type, &sel, &PyTuple_Type, &ord,
+                          &PyTuple_Type, &grp, &PyTuple_Type, &agg,
+                          &arg_select, &arg_order_by, &arg_group_by,
+                          &arg_aggregate, &model, &repr_str))
+        return NULL;
+
+    obj = PyObject_New(CompiledOptionsObject, &CompiledOptions_Type);
+    if (!obj)
+        return NULL;
+    /* Every field is set before the first fallible load so a failure can
+     * simply drop the object. */
+    obj->get_flag = get_flag;
+    obj->shortcircuit = shortcircuit;
+    obj->count_flag = count_flag;
+    obj->distinct = distinct;
+    obj->grouped = grouped;
+    obj->offset = offset;
+    obj->limit = limit;
+    obj->select_specs = NULL;
+    obj->nselect = 0;
+    obj->order_specs = NULL;
+    obj->norder = 0;
+    obj->group_specs = NULL;
+    obj->ngroup = 0;
+    obj->agg_specs = NULL;
+    obj->nagg = 0;
+    obj->repr_str = Py_NewRef(repr_str);
+    obj->arg_select = Py_NewRef(arg_select);
+    obj->arg_order_by = Py_NewRef(arg_order_by);
+    obj->arg_group_by = Py_NewRef(arg_group_by);
+    obj->arg_aggregate = Py_NewRef(arg_aggregate);
+    obj->model = Py_NewRef(model);
+
+    if (select_specs_load(sel, &obj->select_specs, &obj->nselect) < 0 ||
+        order_specs_load(ord, &obj->order_specs, &obj->norder) < 0 ||
+        agg_specs_load(grp, &obj->group_specs, &obj->ngroup) < 0 ||
+        agg_specs_load(agg, &obj->agg_specs, &obj->nagg) < 0) {
+        Py_DECREF(obj);
+        return NULL;
+    }
+    return (PyObject *)obj;
+}
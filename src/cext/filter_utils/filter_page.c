@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+/*
+ * paginate(): keyset ("seek") pagination over compiled filters and options.
+ *
+ * tnfilter() with offset=N filters and sorts every match and then drops the
+ * first N, so each page of a deep listing costs O(total log total).  Here the
+ * caller passes the order_by key of the last row it has already shown (the
+ * cursor).  Matching rows at or before the cursor are dropped as they are
+ * filtered and the rest compete for `limit` slots in a bounded max-heap, so a
+ * page costs O(total log limit) comparisons and O(limit) memory whatever its
+ * depth.  The heap grows as rows are offered, so a generous limit over a
+ * short listing only costs the rows actually kept.  The last key of the page
+ * is handed back as the next cursor.
+ *
+ * Rows are ordered with order_keys_cmp(), ties broken by position in `data`,
+ * which is tnfilter()'s order.  The cursor holds order_by keys only, so rows
+ * tying with it on every key are skipped too: order_by should end with a
+ * unique field for consecutive pages to neither skip nor repeat rows.
+ */
+
+#include "filter_list.h"
+
+typedef struct {
+    PyObject *row;      /* owned: item, or its select projection */
+    Py_ssize_t seq;     /* position among the matches, the final tie-break */
+    order_key_t *k;     /* norder keys, within page_t.keys */
+} page_ent_t;
+
+typedef struct {
+    CompiledOptionsObject *co;
+    page_ent_t *ents;   /* max-heap of n entries, cap allocated */
+    page_ent_t scratch; /* the row being offered */
+    Py_ssize_t n;
+    Py_ssize_t cap;     /* grows by doubling up to limit */
+} page_t;
+
+/* First heap allocation; later ones double it. */
+#define PAGE_INIT_CAP 16
+
+static PyStructSequence_Field page_fields[] = {
+    {"items", "Rows of this page, in order_by order"},
+    {"cursor", "after= value for the next page, or None after the last page"},
+    {NULL}
+};
+
+static PyStructSequence_Desc page_desc = {
+    .name = "truenas_pyfilter.Page",
+    .doc = "One page of a keyset-paginated query, from paginate().",
+    .fields = page_fields,
+    .n_in_sequence = 2,
+};
+
+int
+init_page_types(PyObject *module, fl_state_t *state)
+{
+    state->PageType = (PyObject *)PyStructSequence_NewType(&page_desc);
+    if (!state->PageType)
+        return -1;
+    return PyModule_AddObjectRef(module, "Page", state->PageType);
+}
+
+/* ===========================================================================
+ * Bounded heap
+ * =========================================================================== */
+
+static void
+page_ent_clear(page_ent_t *e, Py_ssize_t norder)
+{
+    Py_CLEAR(e->row);
+    order_keys_clear(e->k, norder);
+}
+
+/* Entry order (see the file comment).  Returns ORDER_CMP_ERROR on error. */
+static int
+page_ent_cmp(page_t *pg, const page_ent_t *a, const page_ent_t *b)
+{
+    int c;
+
+    c = order_keys_cmp(pg->co->order_specs, pg->co->norder, a->k, b->k);
+    if (c)
+        return c;
+    return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+static void
+page_ent_swap(page_ent_t *a, page_ent_t *b)
+{
+    page_ent_t tmp = *a;
+
+    *a = *b;
+    *b = tmp;
+}
+
+static void
+page_swap(page_t *pg, Py_ssize_t i, Py_ssize_t j)
+{
+    page_ent_swap(&pg->ents[i], &pg->ents[j]);
+}
+
+/*
+ * Make room for one more entry, doubling the heap up to limit.  Each entry
+ * owns its own keys, so they stay put when the entry array moves.
+ */
+static int
+page_grow(page_t *pg)
+{
+    Py_ssize_t cap, i;
+    page_ent_t *ents;
+
+    cap = pg->cap ? pg->cap * 2 : PAGE_INIT_CAP;
+    if (cap > pg->co->limit)
+        cap = pg->co->limit;
+
+    ents = PyMem_Realloc(pg->ents, (size_t)cap * sizeof(*ents));
+    if (!ents) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    pg->ents = ents;
+    for (; pg->cap < cap; pg->cap++) {
+        i = pg->cap;
+        ents[i].row = NULL;
+        ents[i].k = PyMem_Calloc((size_t)pg->co->norder, sizeof(order_key_t));
+        if (!ents[i].k) {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+page_sift_up(page_t *pg, Py_ssize_t i)
+{
+    Py_ssize_t parent;
+    int c;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        c = page_ent_cmp(pg, &pg->ents[i], &pg->ents[parent]);
+        if (c == ORDER_CMP_ERROR)
+            return -1;
+        if (c <= 0)
+            break;
+        page_swap(pg, i, parent);
+        i = parent;
+    }
+    return 0;
+}
+
+/* Restore the heap below `i` within the first `n` entries. */
+static int
+page_sift_down(page_t *pg, Py_ssize_t i, Py_ssize_t n)
+{
+    Py_ssize_t child, big;
+    int c;
+
+    for (;;) {
+        big = i;
+        for (child = 2 * i + 1; child <= 2 * i + 2 && child < n; child++) {
+            c = page_ent_cmp(pg, &pg->ents[child], &pg->ents[big]);
+            if (c == ORDER_CMP_ERROR)
+                return -1;
+            if (c > 0)
+                big = child;
+        }
+        if (big == i)
+            return 0;
+        page_swap(pg, i, big);
+        i = big;
+    }
+}
+
+/*
+ * Offer the scratch entry (row and keys filled in) to the page: keep it when
+ * the page has room or it sorts before the current last row, which it then
+ * evicts.  The scratch slot is left empty either way.
+ */
+static int
+page_offer(page_t *pg)
+{
+    page_ent_t *scratch = &pg->scratch;
+    int c;
+
+    if (pg->n < pg->co->limit) {
+        if (pg->n == pg->cap && page_grow(pg) < 0)
+            return -1;
+        page_ent_swap(&pg->ents[pg->n], scratch);
+        return page_sift_up(pg, pg->n++);
+    }
+
+    c = page_ent_cmp(pg, scratch, &pg->ents[0]);
+    if (c == ORDER_CMP_ERROR)
+        return -1;
+    if (c < 0) {
+        page_ent_swap(&pg->ents[0], scratch);
+        page_ent_clear(scratch, pg->co->norder);
+        return page_sift_down(pg, 0, pg->n);
+    }
+    page_ent_clear(scratch, pg->co->norder);
+    return 0;
+}
+
+/* ===========================================================================
+ * Cursor
+ * =========================================================================== */
+
+/*
+ * Parse after= into one order_key_t per order_by spec.  None stands for the
+ * nulls bucket of a nulls_first: / nulls_last: key, as in page_cursor().
+ */
+static int
+page_parse_cursor(PyObject *after, CompiledOptionsObject *co,
+                  order_key_t *cursor)
+{
+    PyObject *v = NULL;
+    Py_ssize_t i;
+
+    if (!PyTuple_Check(after) && !PyList_Check(after)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "paginate: after must be a tuple of order_by values");
+        return -1;
+    }
+    if (PySequence_Fast_GET_SIZE(after) != co->norder) {
+        PyErr_Format(PyExc_ValueError,
+                     "paginate: after must hold one value per order_by key "
+                     "(%zd), got %zd", co->norder,
+                     PySequence_Fast_GET_SIZE(after));
+        return -1;
+    }
+    for (i = 0; i < co->norder; i++) {
+        v = PySequence_Fast_GET_ITEM(after, i);
+        if (co->order_specs[i].nulls_mode != 0 && v == Py_None)
+            cursor[i].null = true;
+        else
+            cursor[i].val = Py_NewRef(v);
+    }
+    return 0;
+}
+
+/* The cursor of a row: its order_by keys, None for the nulls bucket. */
+static PyObject *
+page_cursor(const page_ent_t *e, Py_ssize_t norder)
+{
+    PyObject *cursor = NULL;
+    Py_ssize_t i;
+
+    cursor = PyTuple_New(norder);
+    if (!cursor)
+        return NULL;
+    for (i = 0; i < norder; i++)
+        PyTuple_SET_ITEM(cursor, i,
+                         Py_NewRef(e->k[i].null ? Py_None : e->k[i].val));
+    return cursor;
+}
+
+/* ===========================================================================
+ * paginate()
+ * =========================================================================== */
+
+PyObject *
+filter_page(PyObject *data, CompiledFiltersObject *cf,
+            CompiledOptionsObject *co, PyObject *after, fl_state_t *state)
+{
+    page_t pg = { .co = co };
+    order_key_t *cursor = NULL;
+    page_ent_t *scratch = NULL;
+    PyObject *iter = NULL;
+    PyObject *item = NULL;
+    PyObject *items = NULL;
+    PyObject *next = NULL;
+    PyObject *page = NULL;
+    Py_ssize_t seq = 0;
+    Py_ssize_t i;
+    int r;
+
+    if (co->norder == 0 || co->limit <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "paginate: options must set order_by and limit");
+        return NULL;
+    }
+    if (co->offset || co->get_flag || co->count_flag || co->grouped ||
+        co->distinct) {
+        PyErr_SetString(PyExc_ValueError,
+                        "paginate: offset/get/count/group_by/distinct options "
+                        "are not supported (pass after= instead of offset)");
+        return NULL;
+    }
+
+    /* Entries are allocated by page_grow() as rows are kept, so memory
+     * follows the page actually built rather than the requested limit. */
+    scratch = &pg.scratch;
+    scratch->k = PyMem_Calloc((size_t)co->norder, sizeof(*scratch->k));
+    if (!scratch->k) {
+        PyErr_NoMemory();
+        goto out;
+    }
+
+    if (after != Py_None) {
+        cursor = PyMem_Calloc((size_t)co->norder, sizeof(*cursor));
+        if (!cursor) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        if (page_parse_cursor(after, co, cursor) < 0)
+            goto out;
+    }
+
+    /* Reset the pydantic inline cache (see fl_state_t). */
+    state->pyd_cache_type = NULL;
+
+    iter = PyObject_GetIter(data);
+    if (!iter)
+        goto out;
+
+    while ((item = PyIter_Next(iter)) != NULL) {
+        if (!check_item_model(item, cf->model, cf->nfilters, state,
+                              "paginate"))
+            goto out;
+        r = eval_filters(item, cf->filters, cf->nfilters, state);
+        if (r < 0)
+            goto out;
+        if (!r) {
+            Py_CLEAR(item);
+            continue;
+        }
+
+        /* apply_options() projects before ordering: order_by reads the
+         * projection. */
+        scratch->row = co->nselect > 0
+                     ? apply_select_item(item, co->select_specs, co->nselect,
+                                         co->model, state)
+                     : Py_NewRef(item);
+        Py_CLEAR(item);
+        if (!scratch->row)
+            goto out;
+        scratch->seq = seq++;
+        if (order_keys_get(scratch->row, co->order_specs, co->norder,
+                           scratch->k) < 0)
+            goto out;
+
+        if (cursor) {
+            r = order_keys_cmp(co->order_specs, co->norder, scratch->k,
+                               cursor);
+            if (r == ORDER_CMP_ERROR)
+                goto out;
+            if (r <= 0) {
+                page_ent_clear(scratch, co->norder);
+                continue;
+            }
+        }
+        if (page_offer(&pg) < 0)
+            goto out;
+    }
+    if (PyErr_Occurred())
+        goto out;
+
+    /* Heap sort in place: repeatedly move the last-sorting row to the end. */
+    for (i = pg.n - 1; i > 0; i--) {
+        page_swap(&pg, 0, i);
+        if (page_sift_down(&pg, 0, i) < 0)
+            goto out;
+    }
+
+    items = PyList_New(pg.n);
+    if (!items)
+        goto out;
+    for (i = 0; i < pg.n; i++)
+        PyList_SET_ITEM(items, i, Py_NewRef(pg.ents[i].row));
+
+    if (pg.n == co->limit)
+        next = page_cursor(&pg.ents[pg.n - 1], co->norder);
+    else
+        next = Py_NewRef(Py_None);
+    if (!next)
+        goto out;
+
+    page = PyStructSequence_New((PyTypeObject *)state->PageType);
+    if (!page)
+        goto out;
+    PyStructSequence_SET_ITEM(page, 0, Py_NewRef(items));
+    PyStructSequence_SET_ITEM(page, 1, Py_NewRef(next));
+
+out:
+    Py_XDECREF(item);
+    Py_XDECREF(iter);
+    Py_XDECREF(items);
+    Py_XDECREF(next);
+    for (i = 0; i < pg.cap; i++) {
+        Py_XDECREF(pg.ents[i].row);
+        if (pg.ents[i].k) {
+            order_keys_clear(pg.ents[i].k, co->norder);
+            PyMem_Free(pg.ents[i].k);
+        }
+    }
+    PyMem_Free(pg.ents);
+    if (pg.scratch.k) {
+        page_ent_clear(&pg.scratch, co->norder);
+        PyMem_Free(pg.scratch.k);
+    }
+    if (cursor) {
+        order_keys_clear(cursor, co->norder);
+        PyMem_Free(cursor);
+    }
+    return page;
+}
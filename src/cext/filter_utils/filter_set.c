@@ -0,0 +1,462 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+/*
+ * CompiledFilterSet: match one item against many subscribers' filters.
+ *
+ * Event-bus style callers hold hundreds of CompiledFilters and ask, per
+ * emitted item, which of them match.  Evaluating each in turn costs
+ * O(subscribers) even though most of them differ only in the value of a
+ * shared equality term (["event", "=", "pool.update"], ["id", "=", 7], ...).
+ *
+ * At compile_filter_set() time every subscriber with an indexable top-level
+ * [path, "=", value] term (see cf_index_term()) is filed under exactly one of
+ * them, preferring the path shared by the most subscribers, in a per-path
+ * dict of value -> subscriber positions.  Per item each indexed path is
+ * resolved once, one dict lookup yields that path's candidates, and only
+ * candidates plus the unindexed subscribers are fully evaluated.  The full
+ * evaluation re-checks the indexed term, so the index only ever prunes.
+ */
+
+#include "filter_list.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct filter_index {
+    const compiled_filter_t *term; /* borrowed from a member: resolves the path */
+    PyObject *buckets;             /* owned dict: value -> list of positions */
+};
+
+/* ===========================================================================
+ * Construction
+ * =========================================================================== */
+
+/*
+ * Pick the indexable top-level term of `cf` whose path the most subscribers
+ * can be indexed on (per `counts`: path -> int).  Returns 1 with *termp,
+ * *pathp (new ref) and *valuep (borrowed) set, 0 if no term is indexable,
+ * -1 on error.
+ */
+static int
+pick_index_term(CompiledFiltersObject *cf, PyObject *counts,
+                const compiled_filter_t **termp, PyObject **pathp,
+                PyObject **valuep)
+{
+    PyObject *path = NULL;
+    PyObject *value = NULL;
+    PyObject *cnt = NULL;
+    Py_ssize_t best = 0;
+    Py_ssize_t c;
+    Py_ssize_t i;
+    int r;
+
+    *pathp = NULL;
+    for (i = 0; i < cf->nfilters; i++) {
+        r = cf_index_term(cf->filters[i], &path, &value);
+        if (r < 0)
+            goto fail;
+        if (!r)
+            continue;
+        cnt = PyDict_GetItemWithError(counts, path);
+        if (!cnt) {
+            Py_DECREF(path);
+            if (PyErr_Occurred())
+                goto fail;
+            continue;
+        }
+        c = PyLong_AsSsize_t(cnt);
+        if (c > best) {
+            best = c;
+            *termp = cf->filters[i];
+            *valuep = value;
+            Py_XSETREF(*pathp, path);
+        } else {
+            Py_DECREF(path);
+        }
+    }
+    return *pathp != NULL;
+
+fail:
+    Py_CLEAR(*pathp);
+    return -1;
+}
+
+/*
+ * Count, per path, how many subscribers have an indexable term on it.
+ * Returns a new dict (path -> int), or NULL on error.
+ */
+static PyObject *
+count_index_paths(PyObject *filters)
+{
+    CompiledFiltersObject *cf = NULL;
+    PyObject *counts = NULL;
+    PyObject *seen = NULL;
+    PyObject *path = NULL;
+    PyObject *value = NULL;
+    PyObject *cnt = NULL;
+    Py_ssize_t i, j;
+    int r;
+
+    counts = PyDict_New();
+    if (!counts)
+        return NULL;
+
+    for (i = 0; i < PyTuple_GET_SIZE(filters); i++) {
+        cf = (CompiledFiltersObject *)PyTuple_GET_ITEM(filters, i);
+        seen = PySet_New(NULL);
+        if (!seen)
+            goto fail;
+        for (j = 0; j < cf->nfilters; j++) {
+            r = cf_index_term(cf->filters[j], &path, &value);
+            if (r < 0)
+                goto fail;
+            if (!r)
+                continue;
+            /* A subscriber counts once per path however many terms use it. */
+            r = PySet_Contains(seen, path);
+            if (r == 0)
+                r = PySet_Add(seen, path);
+            if (r == 0) {
+                cnt = PyDict_GetItemWithError(counts, path);
+                if (cnt || !PyErr_Occurred()) {
+                    cnt = PyLong_FromSsize_t(
+                        cnt ? PyLong_AsSsize_t(cnt) + 1 : 1);
+                    r = cnt ? PyDict_SetItem(counts, path, cnt) : -1;
+                    Py_XDECREF(cnt);
+                } else {
+                    r = -1;
+                }
+            }
+            Py_DECREF(path);
+            if (r < 0)
+                goto fail;
+        }
+        Py_CLEAR(seen);
+    }
+    return counts;
+
+fail:
+    Py_XDECREF(seen);
+    Py_DECREF(counts);
+    return NULL;
+}
+
+/*
+ * File subscriber `pos` under `value` in the index for `path`, creating the
+ * index (keyed by `term`) on first use.  `groups` maps path -> index slot.
+ * Returns 0 on success, -1 on error.
+ */
+static int
+index_add(CompiledFilterSetObject *fs, PyObject *groups, PyObject *path,
+          const compiled_filter_t *term, PyObject *value, Py_ssize_t pos)
+{
+    filter_index_t *ix = NULL;
+    PyObject *slot = NULL;
+    PyObject *bucket = NULL;
+    PyObject *empty = NULL;
+    PyObject *posobj = NULL;
+    int r;
+
+    slot = PyDict_GetItemWithError(groups, path);
+    if (slot) {
+        ix = &fs->indexes[PyLong_AsSsize_t(slot)];
+    } else {
+        if (PyErr_Occurred())
+            return -1;
+        slot = PyLong_FromSsize_t(fs->nindexes);
+        if (!slot)
+            return -1;
+        r = PyDict_SetItem(groups, path, slot);
+        Py_DECREF(slot);
+        if (r < 0)
+            return -1;
+        ix = &fs->indexes[fs->nindexes];
+        ix->buckets = PyDict_New();
+        if (!ix->buckets)
+            return -1;
+        ix->term = term;
+        fs->nindexes++;
+    }
+
+    empty = PyList_New(0);
+    if (!empty)
+        return -1;
+    bucket = PyDict_SetDefault(ix->buckets, value, empty); /* borrowed */
+    Py_DECREF(empty);
+    if (!bucket)
+        return -1;
+
+    posobj = PyLong_FromSsize_t(pos);
+    if (!posobj)
+        return -1;
+    r = PyList_Append(bucket, posobj);
+    Py_DECREF(posobj);
+    return r;
+}
+
+/*
+ * Build a CompiledFilterSet from a dict of id -> CompiledFilters or an
+ * iterable of (id, CompiledFilters) pairs.  Returns a new reference, or NULL
+ * on error.
+ */
+PyObject *
+filter_set_new(PyObject *subscribers)
+{
+    CompiledFilterSetObject *fs = NULL;
+    CompiledFiltersObject *cf = NULL;
+    const compiled_filter_t *term = NULL;
+    PyObject *items = NULL;
+    PyObject *pair = NULL;
+    PyObject *counts = NULL;
+    PyObject *groups = NULL;
+    PyObject *path = NULL;
+    PyObject *value = NULL;
+    Py_ssize_t n;
+    Py_ssize_t i;
+    int r;
+
+    items = PyDict_Check(subscribers) ? PyDict_Items(subscribers)
+                                      : PySequence_List(subscribers);
+    if (!items)
+        return NULL;
+    n = PyList_GET_SIZE(items);
+
+    fs = PyObject_New(CompiledFilterSetObject, &CompiledFilterSet_Type);
+    if (!fs) {
+        Py_DECREF(items);
+        return NULL;
+    }
+    fs->ids = PyTuple_New(n);
+    fs->filters = PyTuple_New(n);
+    fs->model = Py_NewRef(Py_None);
+    fs->indexes = PyMem_RawCalloc((size_t)n + 1, sizeof(filter_index_t));
+    fs->nindexes = 0;
+    fs->scan = PyMem_RawCalloc((size_t)n + 1, sizeof(Py_ssize_t));
+    fs->nscan = 0;
+    if (!fs->ids || !fs->filters || !fs->indexes || !fs->scan) {
+        if (!PyErr_Occurred())
+            PyErr_NoMemory();
+        goto fail;
+    }
+
+    for (i = 0; i < n; i++) {
+        pair = PySequence_Fast(PyList_GET_ITEM(items, i),
+                               "compile_filter_set: expected (id, CompiledFilters) pairs");
+        if (!pair)
+            goto fail;
+        if (PySequence_Fast_GET_SIZE(pair) != 2 ||
+            !PyObject_TypeCheck(PySequence_Fast_GET_ITEM(pair, 1),
+                                &CompiledFilters_Type)) {
+            Py_DECREF(pair);
+            PyErr_SetString(PyExc_TypeError,
+                            "compile_filter_set: expected (id, CompiledFilters) pairs");
+            goto fail;
+        }
+        PyTuple_SET_ITEM(fs->ids, i,
+                         Py_NewRef(PySequence_Fast_GET_ITEM(pair, 0)));
+        cf = (CompiledFiltersObject *)Py_NewRef(PySequence_Fast_GET_ITEM(pair, 1));
+        PyTuple_SET_ITEM(fs->filters, i, (PyObject *)cf);
+        Py_DECREF(pair);
+
+        /* One model check per item covers every member only if they agree. */
+        if (i == 0) {
+            Py_SETREF(fs->model, Py_NewRef(cf->model));
+        } else if (cf->model != fs->model) {
+            PyErr_SetString(PyExc_ValueError,
+                            "compile_filter_set: all filters must be compiled "
+                            "with the same model");
+            goto fail;
+        }
+    }
+    Py_CLEAR(items);
+
+    counts = count_index_paths(fs->filters);
+    groups = PyDict_New();
+    if (!counts || !groups)
+        goto fail;
+
+    for (i = 0; i < n; i++) {
+        cf = (CompiledFiltersObject *)PyTuple_GET_ITEM(fs->filters, i);
+        r = pick_index_term(cf, counts, &term, &path, &value);
+        if (r < 0)
+            goto fail;
+        if (!r) {
+            fs->scan[fs->nscan++] = i;
+            continue;
+        }
+        r = index_add(fs, groups, path, term, value, i);
+        Py_DECREF(path);
+        if (r < 0)
+            goto fail;
+    }
+
+    Py_DECREF(counts);
+    Py_DECREF(groups);
+    return (PyObject *)fs;
+
+fail:
+    Py_XDECREF(items);
+    Py_XDECREF(counts);
+    Py_XDECREF(groups);
+    Py_DECREF(fs);
+    return NULL;
+}
+
+/* ===========================================================================
+ * Matching
+ * =========================================================================== */
+
+static int
+cmp_pos(const void *a, const void *b)
+{
+    Py_ssize_t x = *(const Py_ssize_t *)a;
+    Py_ssize_t y = *(const Py_ssize_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Append the positions held in `bucket` (a list of ints) to cand[]. */
+static void
+add_bucket(PyObject *bucket, Py_ssize_t *cand, Py_ssize_t *ncand)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < PyList_GET_SIZE(bucket); i++)
+        cand[(*ncand)++] = PyLong_AsSsize_t(PyList_GET_ITEM(bucket, i));
+}
+
+/*
+ * Return a new list of the ids (in subscription order) whose filters match
+ * `item`, or NULL on error.
+ */
+PyObject *
+filter_set_match(PyObject *item, CompiledFilterSetObject *fs,
+                 fl_state_t *state)
+{
+    Py_ssize_t n = PyTuple_GET_SIZE(fs->ids);
+    CompiledFiltersObject *cf = NULL;
+    filter_index_t *ix = NULL;
+    Py_ssize_t *cand = NULL;
+    Py_ssize_t ncand;
+    PyObject *result = NULL;
+    PyObject *val = NULL;
+    PyObject *bucket = NULL;
+    Py_ssize_t pos;
+    Py_ssize_t i;
+    int r;
+
+    /* Reset the pydantic inline cache (see fl_state_t). */
+    state->pyd_cache_type = NULL;
+
+    if (!check_item_model(item, fs->model, n, state, "match_any"))
+        return NULL;
+
+    /* Each subscriber is filed under at most one index, so candidates never
+     * repeat and n slots always suffice. */
+    cand = PyMem_Malloc(((size_t)n + 1) * sizeof(*cand));
+    if (!cand)
+        return PyErr_NoMemory();
+    memcpy(cand, fs->scan, (size_t)fs->nscan * sizeof(*cand));
+    ncand = fs->nscan;
+
+    for (i = 0; i < fs->nindexes; i++) {
+        ix = &fs->indexes[i];
+        r = cf_fetch_value(item, ix->term, state, &val);
+        if (r < 0)
+            goto out;
+        if (!r)
+            continue; /* path absent: no "=" term on it can match */
+
+        bucket = PyDict_GetItemWithError(ix->buckets, val);
+        if (bucket) {
+            add_bucket(bucket, cand, &ncand);
+        } else if (PyErr_Occurred()) {
+            if (!PyErr_ExceptionMatches(PyExc_TypeError)) {
+                Py_DECREF(val);
+                goto out;
+            }
+            /* Unhashable item value: the index cannot rule anyone out. */
+            PyErr_Clear();
+            pos = 0;
+            while (PyDict_Next(ix->buckets, &pos, NULL, &bucket))
+                add_bucket(bucket, cand, &ncand);
+        }
+        Py_DECREF(val);
+    }
+
+    if (fs->nindexes > 0 && ncand > 1)
+        qsort(cand, (size_t)ncand, sizeof(*cand), cmp_pos);
+
+    result = PyList_New(0);
+    if (!result)
+        goto out;
+
+    for (i = 0; i < ncand; i++) {
+        cf = (CompiledFiltersObject *)PyTuple_GET_ITEM(fs->filters, cand[i]);
+        r = eval_filters(item, cf->filters, cf->nfilters, state);
+        if (r < 0 ||
+            (r && PyList_Append(result, PyTuple_GET_ITEM(fs->ids, cand[i])) < 0)) {
+            Py_CLEAR(result);
+            break;
+        }
+    }
+
+out:
+    PyMem_Free(cand);
+    return result;
+}
+
+/* ===========================================================================
+ * CompiledFilterSet Python type
+ * =========================================================================== */
+
+static void
+compiled_filter_set_dealloc(CompiledFilterSetObject *self)
+{
+    Py_ssize_t i;
+
+    if (self->indexes) {
+        for (i = 0; i < self->nindexes; i++)
+            Py_XDECREF(self->indexes[i].buckets);
+        PyMem_RawFree(self->indexes);
+    }
+    PyMem_RawFree(self->scan);
+    Py_CLEAR(self->ids);
+    Py_CLEAR(self->filters);
+    Py_CLEAR(self->model);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+compiled_filter_set_repr(CompiledFilterSetObject *self)
+{
+    return PyUnicode_FromFormat("CompiledFilterSet(subscribers=%zd, indexed_paths=%zd)",
+                                PyTuple_GET_SIZE(self->ids), self->nindexes);
+}
+
+static Py_ssize_t
+compiled_filter_set_length(CompiledFilterSetObject *self)
+{
+    return PyTuple_GET_SIZE(self->ids);
+}
+
+static PySequenceMethods compiled_filter_set_as_sequence = {
+    .sq_length = (lenfunc)compiled_filter_set_length,
+};
+
+static PyMemberDef compiled_filter_set_members[] = {
+    {"ids", Py_T_OBJECT_EX, offsetof(CompiledFilterSetObject, ids), Py_READONLY},
+    {"model", Py_T_OBJECT_EX, offsetof(CompiledFilterSetObject, model), Py_READONLY},
+    {NULL}
+};
+
+PyTypeObject CompiledFilterSet_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "truenas_pyfilter.CompiledFilterSet",
+    .tp_basicsize = sizeof(CompiledFilterSetObject),
+    .tp_dealloc = (destructor)compiled_filter_set_dealloc,
+    .tp_repr = (reprfunc)compiled_filter_set_repr,
+    .tp_as_sequence = &compiled_filter_set_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = PyDoc_STR("Indexed set of CompiledFilters for use with match_any()."),
+    .tp_members = compiled_filter_set_members,
+};
@@ -0,0 +1,823 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+/*
+ * LiveQuery: a tnfilter() result kept current under single-item deltas.
+ *
+ * The middleware re-runs the same compiled filters/options over a mostly
+ * unchanged collection after every insert/update/delete event.  A LiveQuery
+ * holds the matching rows keyed by a primary-key field and ordered by the
+ * compiled order_by, so a delta only evaluates the changed item and moves one
+ * row instead of re-filtering and re-sorting everything.
+ *
+ * Ordering
+ * --------
+ * Rows live in a sorted array of pointers.  The comparator reproduces what
+ * apply_order()'s stable multi-pass sort produces: order_by keys compared
+ * lexicographically with `<` (nulls_first:/nulls_last: buckets and the "-"
+ * prefix honoured per key), ties broken by each key's position in the
+ * collection.  That position is a sequence number handed out the first time
+ * a key is seen and kept until the key is deleted, so the result equals
+ * tnfilter() over an insertion-ordered mapping of the same items.  A delta
+ * costs O(log n) comparisons plus one memmove of the pointer array.
+ *
+ * Deltas
+ * ------
+ * A delta removes at most one row and inserts at most one, so every other
+ * row shifts by at most one position.  Only rows next to the offset/limit
+ * window edges can therefore enter or leave the window, and the reported
+ * LiveQueryDelta is computed from those few positions alone.
+ */
+
+#include "filter_list.h"
+#include <string.h>
+
+/* One matching row.  k[] holds the per-order_by-spec sort key. */
+typedef struct {
+    PyObject *key;     /* owned: primary key value            */
+    PyObject *row;     /* owned: item, or its select projection */
+    Py_ssize_t seq;    /* collection position, the final tie-break */
+    order_key_t k[];
+} lq_row_t;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *module;                /* keeps fl_state_t alive          */
+    CompiledFiltersObject *filters;
+    CompiledOptionsObject *options;
+    PyObject *key;                   /* primary-key field name          */
+    lq_row_t **rows;                 /* owned, sorted                   */
+    Py_ssize_t nrows;
+    Py_ssize_t cap;
+    PyObject *index;                 /* dict: key -> row pointer (int)  */
+    PyObject *seqs;                  /* dict: key -> seq, every live key */
+    Py_ssize_t next_seq;
+} LiveQueryObject;
+
+/* ===========================================================================
+ * Rows
+ * =========================================================================== */
+
+static void
+lq_row_free(lq_row_t *r, Py_ssize_t nk)
+{
+    if (!r)
+        return;
+    Py_XDECREF(r->key);
+    Py_XDECREF(r->row);
+    order_keys_clear(r->k, nk);
+    PyMem_Free(r);
+}
+
+/*
+ * Build the row for matching `item`: apply select (apply_options() projects
+ * before ordering, so order_by reads the projection) and precompute the sort
+ * key.  Returns NULL on error.
+ */
+static lq_row_t *
+lq_row_new(LiveQueryObject *lq, PyObject *key, PyObject *item,
+           Py_ssize_t seq, fl_state_t *state)
+{
+    CompiledOptionsObject *co = lq->options;
+    lq_row_t *r = NULL;
+
+    r = PyMem_Calloc(1, sizeof(*r) + (size_t)co->norder * sizeof(r->k[0]));
+    if (!r) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    r->key = Py_NewRef(key);
+    r->seq = seq;
+    r->row = co->nselect > 0
+           ? apply_select_item(item, co->select_specs, co->nselect,
+                               co->model, state)
+           : Py_NewRef(item);
+    if (!r->row)
+        goto fail;
+
+    if (order_keys_get(r->row, co->order_specs, co->norder, r->k) < 0)
+        goto fail;
+    return r;
+
+fail:
+    lq_row_free(r, co->norder);
+    return NULL;
+}
+
+/* Total order of rows, see the file comment.  Returns ORDER_CMP_ERROR on error. */
+static int
+lq_row_cmp(LiveQueryObject *lq, const lq_row_t *a, const lq_row_t *b)
+{
+    int c;
+
+    c = order_keys_cmp(lq->options->order_specs, lq->options->norder,
+                       a->k, b->k);
+    if (c)
+        return c;
+    return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+/* Stable merge sort of the initial rows; comparisons may raise. */
+static int
+lq_sort(LiveQueryObject *lq, lq_row_t **a, lq_row_t **tmp, Py_ssize_t n)
+{
+    Py_ssize_t m = n / 2;
+    Py_ssize_t i, j, k;
+    int c;
+
+    if (n < 2)
+        return 0;
+    if (lq_sort(lq, a, tmp, m) < 0 || lq_sort(lq, a + m, tmp, n - m) < 0)
+        return -1;
+
+    i = 0;
+    j = m;
+    k = 0;
+    while (i < m && j < n) {
+        c = lq_row_cmp(lq, a[j], a[i]);
+        if (c == ORDER_CMP_ERROR)
+            return -1;
+        tmp[k++] = (c < 0) ? a[j++] : a[i++];
+    }
+    while (i < m)
+        tmp[k++] = a[i++];
+    while (j < n)
+        tmp[k++] = a[j++];
+    memcpy(a, tmp, (size_t)n * sizeof(*a));
+    return 0;
+}
+
+/*
+ * Position at which `r` sorts among the rows, ignoring position `skip`
+ * (the row being replaced, or -1).  Returns -1 on error.
+ */
+static Py_ssize_t
+lq_lower_bound(LiveQueryObject *lq, const lq_row_t *r, Py_ssize_t skip)
+{
+    Py_ssize_t lo = 0;
+    Py_ssize_t hi = lq->nrows - (skip >= 0);
+    Py_ssize_t mid;
+    int c;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        c = lq_row_cmp(lq, lq->rows[mid + (skip >= 0 && mid >= skip)], r);
+        if (c == ORDER_CMP_ERROR)
+            return -1;
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Current position of row `r`, or -1 on error. */
+static Py_ssize_t
+lq_find(LiveQueryObject *lq, const lq_row_t *r)
+{
+    Py_ssize_t pos;
+
+    pos = lq_lower_bound(lq, r, -1);
+    if (pos < 0)
+        return -1;
+    if (pos < lq->nrows && lq->rows[pos] == r)
+        return pos;
+
+    /* A sort value mutated in place since the row was stored can make the
+     * comparisons inconsistent; fall back to a scan rather than lose it. */
+    for (pos = 0; pos < lq->nrows; pos++) {
+        if (lq->rows[pos] == r)
+            return pos;
+    }
+    PyErr_SetString(PyExc_RuntimeError, "LiveQuery: row index is corrupt");
+    return -1;
+}
+
+/* Primary key of `item`: item[key] for dicts, getattr otherwise. */
+static PyObject *
+lq_item_key(LiveQueryObject *lq, PyObject *item)
+{
+    PyObject *v = NULL;
+
+    if (PyDict_Check(item)) {
+        v = PyDict_GetItemWithError(item, lq->key);
+        if (!v) {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_KeyError,
+                             "LiveQuery: item has no key field %R", lq->key);
+            return NULL;
+        }
+        return Py_NewRef(v);
+    }
+    return PyObject_GetAttr(item, lq->key);
+}
+
+/* Row stored under `key`, NULL with no exception if none. */
+static lq_row_t *
+lq_lookup(LiveQueryObject *lq, PyObject *key)
+{
+    PyObject *ptr = PyDict_GetItemWithError(lq->index, key);
+
+    return ptr ? PyLong_AsVoidPtr(ptr) : NULL;
+}
+
+/* ===========================================================================
+ * Deltas
+ * =========================================================================== */
+
+static PyStructSequence_Field live_query_delta_fields[] = {
+    {"added", "(index, row) pairs that entered the result window"},
+    {"removed", "(index, row) pairs that left the result window; index is "
+                "the position in the previous window"},
+    {"moved", "(old_index, new_index, row) for the changed row when it "
+              "changed position within the window"},
+    {"changed", "(index, row) for the changed row when it kept its position"},
+    {NULL}
+};
+
+static PyStructSequence_Desc live_query_delta_desc = {
+    .name = "truenas_pyfilter.LiveQueryDelta",
+    .doc = "Change to a LiveQuery result window caused by one "
+           "insert/update/delete.",
+    .fields = live_query_delta_fields,
+    .n_in_sequence = 4,
+};
+
+int
+init_live_query_types(PyObject *module, fl_state_t *state)
+{
+    state->LiveQueryDeltaType =
+        (PyObject *)PyStructSequence_NewType(&live_query_delta_desc);
+    if (!state->LiveQueryDeltaType)
+        return -1;
+    return PyModule_AddObjectRef(module, "LiveQueryDelta",
+                                 state->LiveQueryDeltaType);
+}
+
+/* Window index of array position `pos`, or -1 if outside the window. */
+static Py_ssize_t
+lq_window_index(LiveQueryObject *lq, Py_ssize_t pos)
+{
+    Py_ssize_t off = lq->options->offset;
+    Py_ssize_t lim = lq->options->limit;
+
+    if (pos < off || (lim > 0 && pos - off >= lim))
+        return -1;
+    return pos - off;
+}
+
+static int
+lq_append(PyObject *list, PyObject *entry)
+{
+    int r;
+
+    if (!entry)
+        return -1;
+    r = PyList_Append(list, entry);
+    Py_DECREF(entry);
+    return r;
+}
+
+static PyObject *
+lq_sorted_tuple(PyObject *list)
+{
+    if (PyList_Sort(list) < 0)
+        return NULL;
+    return PyList_AsTuple(list);
+}
+
+/*
+ * Describe, against the current (old) array, the window change caused by
+ * removing `old` from position p_old (if old) and inserting `nrow` at final
+ * position q (if nrow).  Nothing is modified.
+ */
+static PyObject *
+lq_delta(LiveQueryObject *lq, fl_state_t *state, lq_row_t *old,
+         Py_ssize_t p_old, lq_row_t *nrow, Py_ssize_t q)
+{
+    Py_ssize_t off = lq->options->offset;
+    Py_ssize_t lim = lq->options->limit;
+    Py_ssize_t edges[4];
+    PyObject *lists[4] = { NULL, NULL, NULL, NULL };
+    PyObject *added, *removed, *moved, *changed;
+    PyObject *delta = NULL;
+    Py_ssize_t oi, ni, pos, np;
+    int i, j, dup;
+
+    for (i = 0; i < 4; i++) {
+        lists[i] = PyList_New(0);
+        if (!lists[i])
+            goto out;
+    }
+    added = lists[0];
+    removed = lists[1];
+    moved = lists[2];
+    changed = lists[3];
+
+    /* the changed row itself */
+    oi = old ? lq_window_index(lq, p_old) : -1;
+    ni = nrow ? lq_window_index(lq, q) : -1;
+    if (oi >= 0 && ni >= 0) {
+        if (oi == ni) {
+            if (lq_append(changed, Py_BuildValue("(nO)", ni, nrow->row)) < 0)
+                goto out;
+        } else if (lq_append(moved, Py_BuildValue("(nnO)", oi, ni,
+                                                  nrow->row)) < 0) {
+            goto out;
+        }
+    } else if (oi >= 0) {
+        if (lq_append(removed, Py_BuildValue("(nO)", oi, old->row)) < 0)
+            goto out;
+    } else if (ni >= 0) {
+        if (lq_append(added, Py_BuildValue("(nO)", ni, nrow->row)) < 0)
+            goto out;
+    }
+
+    /* rows shifted by one across a window edge */
+    edges[0] = off - 1;
+    edges[1] = off;
+    edges[2] = lim > 0 ? off + lim - 1 : -1;
+    edges[3] = lim > 0 ? off + lim : -1;
+    for (i = 0; i < 4; i++) {
+        pos = edges[i];
+        if (pos < 0 || pos >= lq->nrows || pos == p_old)
+            continue;
+        for (dup = 0, j = 0; j < i; j++)
+            dup |= edges[j] == pos;
+        if (dup)
+            continue;
+
+        np = pos - (p_old >= 0 && p_old < pos);
+        np += (q >= 0 && np >= q);
+        oi = lq_window_index(lq, pos);
+        ni = lq_window_index(lq, np);
+        if (oi >= 0 && ni < 0) {
+            if (lq_append(removed, Py_BuildValue("(nO)", oi,
+                                                 lq->rows[pos]->row)) < 0)
+                goto out;
+        } else if (oi < 0 && ni >= 0) {
+            if (lq_append(added, Py_BuildValue("(nO)", ni,
+                                               lq->rows[pos]->row)) < 0)
+                goto out;
+        }
+    }
+
+    delta = PyStructSequence_New((PyTypeObject *)state->LiveQueryDeltaType);
+    if (!delta)
+        goto out;
+    for (i = 0; i < 4; i++)
+        PyStructSequence_SET_ITEM(delta, i, lq_sorted_tuple(lists[i]));
+    for (i = 0; i < 4; i++) {
+        if (!PyStructSequence_GET_ITEM(delta, i)) {
+            Py_CLEAR(delta);
+            break;
+        }
+    }
+
+out:
+    for (i = 0; i < 4; i++)
+        Py_XDECREF(lists[i]);
+    return delta;
+}
+
+/* ===========================================================================
+ * Applying changes
+ * =========================================================================== */
+
+static int
+lq_reserve(LiveQueryObject *lq, Py_ssize_t n)
+{
+    lq_row_t **rows = NULL;
+    Py_ssize_t cap;
+
+    if (n <= lq->cap)
+        return 0;
+    cap = lq->cap ? lq->cap : 16;
+    while (cap < n)
+        cap *= 2;
+    rows = PyMem_Realloc(lq->rows, (size_t)cap * sizeof(*rows));
+    if (!rows) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    lq->rows = rows;
+    lq->cap = cap;
+    return 0;
+}
+
+/*
+ * Upsert `item` (stored under `key`), or delete `key` when item is NULL.
+ * Everything that can fail runs before the row array is touched, so an
+ * exception leaves the LiveQuery unchanged.
+ */
+static PyObject *
+lq_apply(LiveQueryObject *lq, PyObject *key, PyObject *item)
+{
+    fl_state_t *state = (fl_state_t *)PyModule_GetState(lq->module);
+    CompiledFiltersObject *cf = lq->filters;
+    lq_row_t *old = NULL;
+    lq_row_t *nrow = NULL;
+    PyObject *seqobj = NULL;
+    PyObject *ptr = NULL;
+    PyObject *delta = NULL;
+    Py_ssize_t p_old = -1;
+    Py_ssize_t q = -1;
+    Py_ssize_t seq;
+    int r;
+
+    old = lq_lookup(lq, key);
+    if (!old && PyErr_Occurred())
+        return NULL;
+    seqobj = PyDict_GetItemWithError(lq->seqs, key);
+    if (!seqobj && PyErr_Occurred())
+        return NULL;
+
+    if (item) {
+        seq = seqobj ? PyLong_AsSsize_t(seqobj) : lq->next_seq;
+
+        /* Reset the pydantic inline cache (see fl_state_t). */
+        state->pyd_cache_type = NULL;
+        if (!check_item_model(item, cf->model, cf->nfilters, state, "LiveQuery"))
+            return NULL;
+        r = eval_filters(item, cf->filters, cf->nfilters, state);
+        if (r < 0)
+            return NULL;
+        if (r) {
+            nrow = lq_row_new(lq, key, item, seq, state);
+            if (!nrow)
+                return NULL;
+        }
+    } else if (!seqobj) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    if (old) {
+        p_old = lq_find(lq, old);
+        if (p_old < 0)
+            goto fail;
+    }
+    if (nrow) {
+        q = lq_lower_bound(lq, nrow, p_old);
+        if (q < 0 || lq_reserve(lq, lq->nrows + 1) < 0)
+            goto fail;
+    }
+
+    delta = lq_delta(lq, state, old, p_old, nrow, q);
+    if (!delta)
+        goto fail;
+
+    /* -- commit ------------------------------------------------------------- */
+    if (item && !seqobj) {
+        seqobj = PyLong_FromSsize_t(lq->next_seq);
+        if (!seqobj || PyDict_SetItem(lq->seqs, key, seqobj) < 0) {
+            Py_XDECREF(seqobj);
+            goto fail;
+        }
+        Py_DECREF(seqobj);
+        lq->next_seq++;
+    }
+    if (nrow) {
+        ptr = PyLong_FromVoidPtr(nrow);
+        if (!ptr || PyDict_SetItem(lq->index, key, ptr) < 0) {
+            Py_XDECREF(ptr);
+            goto fail;
+        }
+        Py_DECREF(ptr);
+    } else if (old && PyDict_DelItem(lq->index, key) < 0) {
+        goto fail;
+    }
+    if (!item && PyDict_DelItem(lq->seqs, key) < 0)
+        PyErr_Clear(); /* present above; cannot fail */
+
+    if (old) {
+        memmove(&lq->rows[p_old], &lq->rows[p_old + 1],
+                (size_t)(lq->nrows - p_old - 1) * sizeof(*lq->rows));
+        lq->nrows--;
+        lq_row_free(old, lq->options->norder);
+    }
+    if (nrow) {
+        memmove(&lq->rows[q + 1], &lq->rows[q],
+                (size_t)(lq->nrows - q) * sizeof(*lq->rows));
+        lq->rows[q] = nrow;
+        lq->nrows++;
+    }
+    return delta;
+
+fail:
+    Py_XDECREF(delta);
+    lq_row_free(nrow, lq->options->norder);
+    return NULL;
+}
+
+/* ===========================================================================
+ * Construction
+ * =========================================================================== */
+
+PyObject *
+live_query_new(PyObject *module, PyObject *data,
+               CompiledFiltersObject *filters,
+               CompiledOptionsObject *options, PyObject *key)
+{
+    fl_state_t *state = (fl_state_t *)PyModule_GetState(module);
+    LiveQueryObject *lq = NULL;
+    lq_row_t *r = NULL;
+    lq_row_t **tmp = NULL;
+    PyObject *iter = NULL;
+    PyObject *item = NULL;
+    PyObject *k = NULL;
+    PyObject *obj = NULL;
+    int match;
+
+    if (options->count_flag || options->get_flag) {
+        PyErr_SetString(PyExc_ValueError,
+                        "live_query: get/count options are not supported "
+                        "(use result() and len())");
+        return NULL;
+    }
+    if (options->grouped || options->distinct) {
+        PyErr_SetString(PyExc_ValueError,
+                        "live_query: group_by/aggregate/distinct options are "
+                        "not supported");
+        return NULL;
+    }
+
+    lq = PyObject_GC_New(LiveQueryObject, &LiveQuery_Type);
+    if (!lq)
+        return NULL;
+    lq->module = Py_NewRef(module);
+    lq->filters = (CompiledFiltersObject *)Py_NewRef(filters);
+    lq->options = (CompiledOptionsObject *)Py_NewRef(options);
+    lq->key = Py_NewRef(key);
+    lq->rows = NULL;
+    lq->nrows = 0;
+    lq->cap = 0;
+    lq->index = PyDict_New();
+    lq->seqs = PyDict_New();
+    lq->next_seq = 0;
+    PyObject_GC_Track(lq);
+    if (!lq->index || !lq->seqs)
+        goto fail;
+
+    iter = PyObject_GetIter(data);
+    if (!iter)
+        goto fail;
+
+    state->pyd_cache_type = NULL;
+    while ((item = PyIter_Next(iter)) != NULL) {
+        k = lq_item_key(lq, item);
+        if (!k)
+            goto fail;
+        match = PyDict_Contains(lq->seqs, k);
+        if (match > 0)
+            PyErr_Format(PyExc_ValueError,
+                         "live_query: duplicate key %R", k);
+        if (match != 0)
+            goto fail;
+        obj = PyLong_FromSsize_t(lq->next_seq);
+        if (!obj || PyDict_SetItem(lq->seqs, k, obj) < 0)
+            goto fail;
+        Py_CLEAR(obj);
+
+        if (!check_item_model(item, filters->model, filters->nfilters,
+                              state, "live_query"))
+            goto fail;
+        match = eval_filters(item, filters->filters, filters->nfilters, state);
+        if (match < 0)
+            goto fail;
+        if (match) {
+            if (lq_reserve(lq, lq->nrows + 1) < 0)
+                goto fail;
+            r = lq_row_new(lq, k, item, lq->next_seq, state);
+            if (!r)
+                goto fail;
+            lq->rows[lq->nrows++] = r;
+            obj = PyLong_FromVoidPtr(r);
+            if (!obj || PyDict_SetItem(lq->index, k, obj) < 0)
+                goto fail;
+            Py_CLEAR(obj);
+        }
+        lq->next_seq++;
+        Py_CLEAR(k);
+        Py_CLEAR(item);
+    }
+    if (PyErr_Occurred())
+        goto fail;
+    Py_CLEAR(iter);
+
+    if (options->norder > 0 && lq->nrows > 1) {
+        tmp = PyMem_Malloc((size_t)lq->nrows * sizeof(*tmp));
+        if (!tmp) {
+            PyErr_NoMemory();
+            goto fail;
+        }
+        if (lq_sort(lq, lq->rows, tmp, lq->nrows) < 0)
+            goto fail;
+        PyMem_Free(tmp);
+    }
+    return (PyObject *)lq;
+
+fail:
+    PyMem_Free(tmp);
+    Py_XDECREF(obj);
+    Py_XDECREF(k);
+    Py_XDECREF(item);
+    Py_XDECREF(iter);
+    Py_DECREF(lq);
+    return NULL;
+}
+
+/* ===========================================================================
+ * LiveQuery Python type
+ * =========================================================================== */
+
+static PyObject *
+live_query_upsert(LiveQueryObject *self, PyObject *item)
+{
+    PyObject *key = NULL;
+    PyObject *delta = NULL;
+
+    key = lq_item_key(self, item);
+    if (!key)
+        return NULL;
+    delta = lq_apply(self, key, item);
+    Py_DECREF(key);
+    return delta;
+}
+
+static PyObject *
+live_query_delete(LiveQueryObject *self, PyObject *key)
+{
+    return lq_apply(self, key, NULL);
+}
+
+static PyObject *
+live_query_result(LiveQueryObject *self, PyObject *Py_UNUSED(ignored))
+{
+    Py_ssize_t start = self->options->offset;
+    Py_ssize_t end = self->nrows;
+    PyObject *result = NULL;
+    Py_ssize_t i;
+
+    if (start > end)
+        start = end;
+    if (self->options->limit > 0 && end - start > self->options->limit)
+        end = start + self->options->limit;
+
+    result = PyList_New(end - start);
+    if (!result)
+        return NULL;
+    for (i = start; i < end; i++)
+        PyList_SET_ITEM(result, i - start, Py_NewRef(self->rows[i]->row));
+    return result;
+}
+
+static void
+live_query_clear_rows(LiveQueryObject *self)
+{
+    lq_row_t **rows = self->rows;
+    Py_ssize_t n = self->nrows;
+    Py_ssize_t i;
+
+    self->rows = NULL;
+    self->nrows = 0;
+    self->cap = 0;
+    for (i = 0; i < n; i++)
+        lq_row_free(rows[i], self->options ? self->options->norder : 0);
+    PyMem_Free(rows);
+}
+
+static int
+live_query_traverse(LiveQueryObject *self, visitproc visit, void *arg)
+{
+    Py_ssize_t i, j;
+
+    Py_VISIT(self->module);
+    Py_VISIT(self->filters);
+    Py_VISIT(self->options);
+    Py_VISIT(self->key);
+    Py_VISIT(self->index);
+    Py_VISIT(self->seqs);
+    for (i = 0; i < self->nrows; i++) {
+        Py_VISIT(self->rows[i]->key);
+        Py_VISIT(self->rows[i]->row);
+        for (j = 0; j < self->options->norder; j++)
+            Py_VISIT(self->rows[i]->k[j].val);
+    }
+    return 0;
+}
+
+static int
+live_query_clear(LiveQueryObject *self)
+{
+    live_query_clear_rows(self);
+    Py_CLEAR(self->index);
+    Py_CLEAR(self->seqs);
+    Py_CLEAR(self->key);
+    Py_CLEAR(self->filters);
+    Py_CLEAR(self->options);
+    Py_CLEAR(self->module);
+    return 0;
+}
+
+static void
+live_query_dealloc(LiveQueryObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    live_query_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+live_query_repr(LiveQueryObject *self)
+{
+    return PyUnicode_FromFormat("LiveQuery(key=%R, rows=%zd)",
+                                self->key, self->nrows);
+}
+
+static Py_ssize_t
+live_query_length(LiveQueryObject *self)
+{
+    return self->nrows;
+}
+
+PyDoc_STRVAR(live_query_insert_doc,
+"insert(item) -> LiveQueryDelta\n"
+"--\n\n"
+"Add or replace the item with item's key; same as update().\n"
+);
+
+PyDoc_STRVAR(live_query_update_doc,
+"update(item) -> LiveQueryDelta\n"
+"--\n\n"
+"Re-evaluate a changed item and move, add or drop its row.\n\n"
+"Only matching items are stored, so an item that did not match before\n"
+"is indistinguishable from a new one: update() and insert() are the same\n"
+"upsert.  The item keeps its collection position for tie-breaking.\n"
+);
+
+PyDoc_STRVAR(live_query_delete_doc,
+"delete(key) -> LiveQueryDelta\n"
+"--\n\n"
+"Remove the item with `key` from the collection.  Raises KeyError if the\n"
+"key was never inserted.\n"
+);
+
+PyDoc_STRVAR(live_query_result_doc,
+"result() -> list\n"
+"--\n\n"
+"Current rows within offset/limit, as tnfilter() would return them.\n"
+);
+
+static PyMethodDef live_query_methods[] = {
+    {
+        .ml_name = "insert",
+        .ml_meth = (PyCFunction)live_query_upsert,
+        .ml_flags = METH_O,
+        .ml_doc = live_query_insert_doc,
+    },
+    {
+        .ml_name = "update",
+        .ml_meth = (PyCFunction)live_query_upsert,
+        .ml_flags = METH_O,
+        .ml_doc = live_query_update_doc,
+    },
+    {
+        .ml_name = "delete",
+        .ml_meth = (PyCFunction)live_query_delete,
+        .ml_flags = METH_O,
+        .ml_doc = live_query_delete_doc,
+    },
+    {
+        .ml_name = "result",
+        .ml_meth = (PyCFunction)live_query_result,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = live_query_result_doc,
+    },
+    { .ml_name = NULL },
+};
+
+static PyMemberDef live_query_members[] = {
+    {"key", Py_T_OBJECT_EX, offsetof(LiveQueryObject, key), Py_READONLY},
+    {NULL}
+};
+
+static PySequenceMethods live_query_as_sequence = {
+    .sq_length = (lenfunc)live_query_length,
+};
+
+PyTypeObject LiveQuery_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "truenas_pyfilter.LiveQuery",
+    .tp_basicsize = sizeof(LiveQueryObject),
+    .tp_dealloc = (destructor)live_query_dealloc,
+    .tp_repr = (reprfunc)live_query_repr,
+    .tp_as_sequence = &live_query_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = PyDoc_STR("Incrementally maintained tnfilter() result; "
+                        "see live_query()."),
+    .tp_traverse = (traverseproc)live_query_traverse,
+    .tp_clear = (inquiry)live_query_clear,
+    .tp_methods = live_query_methods,
+    .tp_members = live_query_members,
+};
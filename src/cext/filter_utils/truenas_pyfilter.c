@@ -103,32 +103,45 @@ py_compile_options(PyObject *self, PyObject *args, PyObject *kwargs)
 {
     int get_val = 0;
     int count_val = 0;
+    int distinct_val = 0;
     PyObject *select_val = NULL;
     PyObject *order_by_val = NULL;
     Py_ssize_t offset_val = 0;
     Py_ssize_t limit_val = 0;
     PyObject *model_obj = Py_None;
+    PyObject *group_by_val = NULL;
+    PyObject *aggregate_val = NULL;
+    PyObject *spec_model = NULL;
     fl_state_t *state = NULL;
     Py_ssize_t oblen;
+    bool grouped;
     PyObject *repr_str = NULL;
     compiled_select_spec_t *select_specs = NULL;
     Py_ssize_t nselect = 0;
     compiled_order_spec_t *order_specs = NULL;
     Py_ssize_t norder = 0;
+    compiled_agg_spec_t *group_specs = NULL;
+    Py_ssize_t ngroup = 0;
+    compiled_agg_spec_t *agg_specs = NULL;
+    Py_ssize_t nagg = 0;
     PyObject *arg_select = NULL;
     PyObject *arg_order_by = NULL;
+    PyObject *arg_group_by = NULL;
+    PyObject *arg_aggregate = NULL;
     CompiledOptionsObject *obj = NULL;
 
     static const char *kwnames[] = {
         "get", "count", "select", "order_by", "offset", "limit", "model",
-        NULL
+        "group_by", "aggregate", "distinct", NULL
     };
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$ppOOnnO",
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$ppOOnnOOOp",
                                      discard_const_p(char *, kwnames),
                                      &get_val, &count_val,
                                      &select_val, &order_by_val,
-                                     &offset_val, &limit_val, &model_obj))
+                                     &offset_val, &limit_val, &model_obj,
+                                     &group_by_val, &aggregate_val,
+                                     &distinct_val))
         return NULL;
 
     state = (fl_state_t *)PyModule_GetState(self);
@@ -163,44 +176,56 @@ py_compile_options(PyObject *self, PyObject *args, PyObject *kwargs)
         return NULL;
     }
 
+    /* group_by / aggregate: the model applies to the group_by and aggregate
+     * paths, which read the items; select/order_by then address the output
+     * group dicts and are compiled without it. */
+    if (compile_group_specs(group_by_val, aggregate_val, model_obj, state,
+                            &group_specs, &ngroup, &agg_specs, &nagg) < 0)
+        return NULL;
+    grouped = ngroup > 0 || nagg > 0;
+    spec_model = grouped ? Py_None : model_obj;
+
+    if (grouped && get_val) {
+        free_agg_specs(group_specs, ngroup);
+        free_agg_specs(agg_specs, nagg);
+        PyErr_SetString(PyExc_ValueError,
+                        "get=True is incompatible with group_by/aggregate");
+        return NULL;
+    }
+
     repr_str = kwargs ? PyObject_Repr(kwargs) : PyUnicode_FromString("{}");
     if (!repr_str)
-        return NULL;
+        goto fail;
 
     /* Compile select specs */
     if (select_val && select_val != Py_None) {
         oblen = PySequence_Size(select_val);
-        if (oblen < 0) {
-            Py_DECREF(repr_str);
-            return NULL;
-        }
+        if (oblen < 0)
+            goto fail;
         if (oblen > 0) {
-            if (compile_select_specs(select_val, model_obj, state,
-                                     &select_specs, &nselect) < 0) {
-                Py_DECREF(repr_str);
-                return NULL;
-            }
+            if (compile_select_specs(select_val, spec_model, state,
+                                     &select_specs, &nselect) < 0)
+                goto fail;
         }
     }
 
     /* Compile order_by specs */
     if (order_by_val && order_by_val != Py_None) {
         oblen = PySequence_Size(order_by_val);
-        if (oblen < 0) {
-            free_select_specs(select_specs, nselect);
-            Py_DECREF(repr_str);
-            return NULL;
-        }
+        if (oblen < 0)
+            goto fail;
         if (oblen > 0) {
-            if (compile_order_specs(order_by_val, model_obj, state,
-                                    &order_specs, &norder) < 0) {
-                free_select_specs(select_specs, nselect);
-                Py_DECREF(repr_str);
-                return NULL;
-            }
+            if (compile_order_specs(order_by_val, spec_model, state,
+                                    &order_specs, &norder) < 0)
+                goto fail;
         }
     }
 
+    if (distinct_val && nselect == 0) {
+        PyErr_SetString(PyExc_ValueError, "distinct=True requires select");
+        goto fail;
+    }
+
     /* The original select/order_by arguments are preserved for read-only
      * introspection.  They are always lists in the query-options convention:
      * an unsupplied (or None) value reads back as an empty list, not None.
@@ -210,30 +235,23 @@ py_compile_options(PyObject *self, PyObject *args, PyObject *kwargs)
                ? Py_NewRef(select_val) : PyList_New(0);
     arg_order_by = (order_by_val && order_by_val != Py_None)
                  ? Py_NewRef(order_by_val) : PyList_New(0);
-    if (!arg_select || !arg_order_by) {
-        Py_XDECREF(arg_select);
-        Py_XDECREF(arg_order_by);
-        free_select_specs(select_specs, nselect);
-        free_order_specs(order_specs, norder);
-        Py_DECREF(repr_str);
-        return NULL;
-    }
+    arg_group_by = (group_by_val && group_by_val != Py_None)
+                 ? Py_NewRef(group_by_val) : PyList_New(0);
+    arg_aggregate = (aggregate_val && aggregate_val != Py_None)
+                  ? Py_NewRef(aggregate_val) : PyDict_New();
+    if (!arg_select || !arg_order_by || !arg_group_by || !arg_aggregate)
+        goto fail;
 
     obj = PyObject_New(CompiledOptionsObject, &CompiledOptions_Type);
-    if (!obj) {
-        Py_DECREF(arg_select);
-        Py_DECREF(arg_order_by);
-        free_select_specs(select_specs, nselect);
-        free_order_specs(order_specs, norder);
-        Py_DECREF(repr_str);
-        return NULL;
-    }
+    if (!obj)
+        goto fail;
     obj->get_flag = get_val;
     /* shortcircuit: get=True with no ordering means we stop at the first match */
     obj->shortcircuit = get_val && (norder == 0);
     obj->count_flag = count_val;
     obj->select_specs = select_specs;
     obj->nselect = nselect;
+    obj->distinct = distinct_val;
     obj->order_specs = order_specs;
     obj->norder = norder;
     obj->offset = offset_val;
@@ -242,33 +260,70 @@ py_compile_options(PyObject *self, PyObject *args, PyObject *kwargs)
     obj->arg_select = arg_select;   /* steal ref */
     obj->arg_order_by = arg_order_by; /* steal ref */
     obj->model = Py_NewRef(model_obj);
+    obj->grouped = grouped;
+    obj->group_specs = group_specs;
+    obj->ngroup = ngroup;
+    obj->agg_specs = agg_specs;
+    obj->nagg = nagg;
+    obj->arg_group_by = arg_group_by;   /* steal ref */
+    obj->arg_aggregate = arg_aggregate; /* steal ref */
 
     return (PyObject *)obj;
+
+fail:
+    Py_XDECREF(arg_select);
+    Py_XDECREF(arg_order_by);
+    Py_XDECREF(arg_group_by);
+    Py_XDECREF(arg_aggregate);
+    free_select_specs(select_specs, nselect);
+    free_order_specs(order_specs, norder);
+    free_agg_specs(group_specs, ngroup);
+    free_agg_specs(agg_specs, nagg);
+    Py_XDECREF(repr_str);
+    return NULL;
 }
 
 static PyObject *
 py_tnfilter(PyObject *self, PyObject *args, PyObject *kwargs)
 {
     PyObject *data = NULL;
-    PyObject *filters_obj = Py_None;
-    PyObject *options_obj = Py_None;
+    PyObject *filters_obj = NULL;
+    PyObject *options_obj = NULL;
+    PyObject *lookup_obj = Py_None;
     fl_state_t *state = NULL;
     CompiledFiltersObject *cf = NULL;
     CompiledOptionsObject *co = NULL;
+    group_acc_t *groups = NULL;
+    lookup_ctx_t ctx;
+    lookup_ctx_t *saved = NULL;
     PyObject *filtered = NULL;
     PyObject *result = NULL;
 
     static const char *kwnames[] = {
-        "data", "filters", "options", NULL
+        "data", "filters", "options", "lookup", NULL
     };
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O$O!O!",
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$O!O!O",
                                      discard_const_p(char *, kwnames),
                                      &data,
                                      &CompiledFilters_Type, &filters_obj,
-                                     &CompiledOptions_Type, &options_obj))
+                                     &CompiledOptions_Type, &options_obj,
+                                     &lookup_obj))
         return NULL;
 
+    if (!filters_obj || !options_obj) {
+        PyErr_Format(PyExc_TypeError,
+                     "tnfilter() missing required keyword argument: '%s'",
+                     filters_obj ? "options" : "filters");
+        return NULL;
+    }
+    if (lookup_obj != Py_None &&
+        !PyObject_TypeCheck(lookup_obj, &CompiledLookup_Type)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "tnfilter: lookup must be a CompiledLookup or None");
+        return NULL;
+    }
+
     state = (fl_state_t *)PyModule_GetState(self);
     if (!state) {
         PyErr_SetString(PyExc_RuntimeError,
@@ -279,16 +334,85 @@ py_tnfilter(PyObject *self, PyObject *args, PyObject *kwargs)
     cf = (CompiledFiltersObject *)filters_obj;
     co = (CompiledOptionsObject *)options_obj;
 
-    filtered = filter_list_run(data, cf->filters, cf->nfilters,
-                               co->shortcircuit, cf->model, state);
-    if (!filtered)
+    if (co->grouped && !(groups = group_acc_new(co)))
         return NULL;
 
-    result = apply_options(filtered, co, state);
-    Py_DECREF(filtered);
+    lookup_ctx_enter(state, &ctx, lookup_obj == Py_None ? NULL :
+                     (CompiledLookupObject *)lookup_obj, &saved);
+    filtered = filter_list_run(data, cf->filters, cf->nfilters,
+                               co->shortcircuit, cf->model, state,
+                               groups, NULL, NULL);
+    if (filtered && groups)
+        Py_SETREF(filtered, group_acc_finish(groups));
+    group_acc_free(groups);
+    if (filtered) {
+        result = apply_options(filtered, co, state, NULL);
+        Py_DECREF(filtered);
+    }
+    lookup_ctx_exit(state, &ctx, saved);
     return result;
 }
 
+/*
+ * Check the format version leading a pickled plan's argument tuple (see
+ * PLAN_FORMAT_VERSION).  Returns 0 if it is loadable, -1 with ValueError set.
+ */
+static int
+plan_check_version(PyObject *args, const char *what)
+{
+    int version = -1;
+
+    if (PyTuple_GET_SIZE(args) > 0) {
+        version = PyLong_AsInt(PyTuple_GET_ITEM(args, 0));
+        if (version == -1 && PyErr_Occurred())
+            return -1;
+    }
+    if (version != PLAN_FORMAT_VERSION) {
+        PyErr_Format(PyExc_ValueError,
+                     "cannot load pickled %s: format version %d, expected %d",
+                     what, version, PLAN_FORMAT_VERSION);
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject *
+py_load_filters(PyObject *self, PyObject *args)
+{
+    fl_state_t *state = (fl_state_t *)PyModule_GetState(self);
+
+    if (plan_check_version(args, "CompiledFilters") < 0)
+        return NULL;
+    return filters_load(args, state);
+}
+
+static PyObject *
+py_load_options(PyObject *self, PyObject *args)
+{
+    fl_state_t *state = (fl_state_t *)PyModule_GetState(self);
+
+    if (plan_check_version(args, "CompiledOptions") < 0)
+        return NULL;
+    return options_load(args, state);
+}
+
+static PyObject *
+py_compile_lookup(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *data = NULL;
+    PyObject *local = NULL;
+    PyObject *foreign = NULL;
+
+    static const char *kwnames[] = { "data", "local", "foreign", NULL };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O$OO",
+                                     discard_const_p(char *, kwnames),
+                                     &data, &local, &foreign))
+        return NULL;
+
+    return lookup_new(data, local, foreign);
+}
+
 static PyObject *
 py_match(PyObject *self, PyObject *args, PyObject *kwargs)
 {
@@ -342,6 +466,11 @@ py_match(PyObject *self, PyObject *args, PyObject *kwargs)
 
     cf = (CompiledFiltersObject *)filters_obj;
     co = (options_obj != Py_None) ? (CompiledOptionsObject *)options_obj : NULL;
+    if (co && co->grouped) {
+        PyErr_SetString(PyExc_ValueError,
+                        "match: group_by/aggregate options are not supported");
+        return NULL;
+    }
 
     if (!match_item(item, cf->filters, cf->nfilters, cf->model, state, &matched))
         return NULL;
@@ -356,6 +485,123 @@ py_match(PyObject *self, PyObject *args, PyObject *kwargs)
     return Py_NewRef(item);
 }
 
+static PyObject *
+py_compile_filter_set(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *subscribers = NULL;
+
+    static const char *kwnames[] = { "subscribers", NULL };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O",
+                                     discard_const_p(char *, kwnames),
+                                     &subscribers))
+        return NULL;
+
+    return filter_set_new(subscribers);
+}
+
+static PyObject *
+py_match_any(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *item = NULL;
+    PyObject *fs_obj = NULL;
+    fl_state_t *state = NULL;
+
+    static const char *kwnames[] = { "item", "filter_set", NULL };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O$O!",
+                                     discard_const_p(char *, kwnames),
+                                     &item,
+                                     &CompiledFilterSet_Type, &fs_obj))
+        return NULL;
+
+    state = (fl_state_t *)PyModule_GetState(self);
+    if (!state) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "match_any: cannot retrieve module state");
+        return NULL;
+    }
+
+    return filter_set_match(item, (CompiledFilterSetObject *)fs_obj, state);
+}
+
+static PyObject *
+py_live_query(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *data = NULL;
+    PyObject *filters_obj = NULL;
+    PyObject *options_obj = NULL;
+    PyObject *key = NULL;
+
+    static const char *kwnames[] = {
+        "data", "filters", "options", "key", NULL
+    };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O$O!O!U",
+                                     discard_const_p(char *, kwnames),
+                                     &data,
+                                     &CompiledFilters_Type, &filters_obj,
+                                     &CompiledOptions_Type, &options_obj,
+                                     &key))
+        return NULL;
+
+    return live_query_new(self, data, (CompiledFiltersObject *)filters_obj,
+                          (CompiledOptionsObject *)options_obj, key);
+}
+
+static PyObject *
+py_explain(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *data = NULL;
+    PyObject *filters_obj = NULL;
+    PyObject *options_obj = NULL;
+    fl_state_t *state = (fl_state_t *)PyModule_GetState(self);
+
+    static const char *kwnames[] = { "data", "filters", "options", NULL };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O$O!O!",
+                                     discard_const_p(char *, kwnames),
+                                     &data,
+                                     &CompiledFilters_Type, &filters_obj,
+                                     &CompiledOptions_Type, &options_obj))
+        return NULL;
+
+    return filter_explain(data, (CompiledFiltersObject *)filters_obj,
+                          (CompiledOptionsObject *)options_obj, state);
+}
+
+static PyObject *
+py_paginate(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *data = NULL;
+    PyObject *filters_obj = NULL;
+    PyObject *options_obj = NULL;
+    PyObject *after = Py_None;
+    fl_state_t *state = (fl_state_t *)PyModule_GetState(self);
+
+    static const char *kwnames[] = {
+        "data", "filters", "options", "after", NULL
+    };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$O!O!O",
+                                     discard_const_p(char *, kwnames),
+                                     &data,
+                                     &CompiledFilters_Type, &filters_obj,
+                                     &CompiledOptions_Type, &options_obj,
+                                     &after))
+        return NULL;
+
+    if (!filters_obj || !options_obj) {
+        PyErr_Format(PyExc_TypeError,
+                     "paginate() missing required keyword argument: '%s'",
+                     filters_obj ? "options" : "filters");
+        return NULL;
+    }
+
+    return filter_page(data, (CompiledFiltersObject *)filters_obj,
+                       (CompiledOptionsObject *)options_obj, after, state);
+}
+
 /* -- method table -------------------------------------------------------------- */
 
 PyDoc_STRVAR(match_doc,
@@ -380,7 +626,8 @@ PyDoc_STRVAR(match_doc,
 );
 
 PyDoc_STRVAR(tnfilter_doc,
-"tnfilter(data: Iterable, *, filters: CompiledFilters, options: CompiledOptions) -> list\n"
+"tnfilter(data: Iterable, *, filters: CompiledFilters, options: CompiledOptions,\n"
+"         lookup: CompiledLookup | None = None) -> list\n"
 "--\n\n"
 "Filter an iterable using pre-compiled C-level filters.\n\n"
 "Both `filters` and `options` must be objects previously returned by\n"
@@ -392,13 +639,41 @@ PyDoc_STRVAR(tnfilter_doc,
 "filters : CompiledFilters\n"
 "    Pre-compiled filter tree from compile_filters().\n"
 "options : CompiledOptions\n"
-"    Pre-compiled options from compile_options().\n\n"
+"    Pre-compiled options from compile_options().\n"
+"lookup : CompiledLookup or None\n"
+"    Join table from compile_lookup().  Filter and select paths starting\n"
+"    with \"lookup.\" then read each item's joined record.\n\n"
 "Returns\n"
 "-------\n"
 "list\n"
 "    Items (in original order) that matched all filters.\n"
 );
 
+PyDoc_STRVAR(compile_lookup_doc,
+"compile_lookup(data: Iterable, *, local: str, foreign: str) -> CompiledLookup\n"
+"--\n\n"
+"Build a hash-join table over a second collection for tnfilter(lookup=...).\n\n"
+"Every record of `data` is filed under its value at the `foreign` path.  An\n"
+"item of the queried collection joins the record filed under the item's\n"
+"value at the `local` path; filter leaves and select entries whose path\n"
+"starts with \"lookup\" (\"lookup.<path>\", or \"lookup\" for the whole\n"
+"record) read that record instead of the item.  An item with no joined\n"
+"record fails every lookup leaf.\n\n"
+"Parameters\n"
+"----------\n"
+"data : Iterable\n"
+"    Records to join against.  Foreign key values must be unique and\n"
+"    hashable; records whose foreign key is None or absent are skipped.\n"
+"local : str\n"
+"    Dotted path of the join key in the queried items.\n"
+"foreign : str\n"
+"    Dotted path of the join key in `data`.\n\n"
+"Returns\n"
+"-------\n"
+"CompiledLookup\n"
+"    Join table; len() is the number of records filed.\n"
+);
+
 PyDoc_STRVAR(compile_filters_doc,
 "compile_filters(filters: list, *, model: type | None = None) -> CompiledFilters\n"
 "--\n\n"
@@ -427,7 +702,10 @@ PyDoc_STRVAR(compile_options_doc,
 "                select: list[str | list] | None = None,\n"
 "                order_by: list[str] | None = None,\n"
 "                offset: int = 0, limit: int = 0,\n"
-"                model: type | None = None) -> CompiledOptions\n"
+"                model: type | None = None,\n"
+"                group_by: list[str] | None = None,\n"
+"                aggregate: dict[str, list] | None = None,\n"
+"                distinct: bool = False) -> CompiledOptions\n"
 "--\n\n"
 "Pre-parse query-options into a CompiledOptions object.\n\n"
 "The returned object can be passed directly to tnfilter(), skipping\n"
@@ -450,13 +728,149 @@ PyDoc_STRVAR(compile_options_doc,
 "    Pass the pydantic model class when the options will be applied to\n"
 "    instances of that model: select/order_by field aliases are resolved to\n"
 "    attribute names at compile time (the same contract as compile_filters).\n"
-"    Must be a pydantic model class.\n\n"
+"    Must be a pydantic model class.\n"
+"group_by : list[str] or None\n"
+"    Field paths to group matching items by.  tnfilter() then returns one\n"
+"    dict per distinct combination of values, in first-seen order, and the\n"
+"    remaining options apply to those dicts.\n"
+"aggregate : dict[str, list] or None\n"
+"    Output key -> [func, path], func one of count, sum, min, max,\n"
+"    distinct_count; [\"count\"] counts items.  Folded in during the filter\n"
+"    pass.  Without group_by all matching items form one group.\n"
+"distinct : bool\n"
+"    Keep only the first result of each distinct tuple of select values\n"
+"    (deduplicated before output dicts are built).  Requires select.  With\n"
+"    count=True, returns the number of distinct projections.\n\n"
 "Returns\n"
 "-------\n"
 "CompiledOptions\n"
 "    Parsed options.  repr() shows the kwargs as passed.\n"
 );
 
+PyDoc_STRVAR(compile_filter_set_doc,
+"compile_filter_set(subscribers: dict | Iterable[tuple]) -> CompiledFilterSet\n"
+"--\n\n"
+"Index many subscribers' CompiledFilters for use with match_any().\n\n"
+"Each subscriber with a top-level [path, \"=\", value] term is filed under\n"
+"one such term in a per-path hash index, preferring paths shared by the\n"
+"most subscribers.  match_any() then resolves each indexed path once per\n"
+"item and fully evaluates only the subscribers whose indexed value\n"
+"matches, plus those with no indexable term.\n\n"
+"Parameters\n"
+"----------\n"
+"subscribers : dict or Iterable[tuple]\n"
+"    Mapping of subscriber id -> CompiledFilters, or an iterable of\n"
+"    (id, CompiledFilters) pairs.  Ids may be any object and need not be\n"
+"    unique.  All filters must share the same model= (or none).\n\n"
+"Returns\n"
+"-------\n"
+"CompiledFilterSet\n"
+"    Immutable indexed set.  len() is the number of subscribers.\n"
+);
+
+PyDoc_STRVAR(match_any_doc,
+"match_any(item, *, filter_set: CompiledFilterSet) -> list\n"
+"--\n\n"
+"Return the ids of every subscriber whose filters match a single item.\n\n"
+"Equivalent to [id for id, f in subscribers if match(item, filters=f)]\n"
+"but costs one path lookup per indexed path plus a full evaluation of\n"
+"the candidate subscribers only.\n\n"
+"Parameters\n"
+"----------\n"
+"item : Any\n"
+"    The item to test, as for match().\n"
+"filter_set : CompiledFilterSet\n"
+"    Indexed set from compile_filter_set().\n\n"
+"Returns\n"
+"-------\n"
+"list\n"
+"    Matching subscriber ids, in subscription order.\n"
+);
+
+PyDoc_STRVAR(live_query_doc,
+"live_query(data: Iterable, *, filters: CompiledFilters,\n"
+"           options: CompiledOptions, key: str) -> LiveQuery\n"
+"--\n\n"
+"Run a query once and keep its result current under item deltas.\n\n"
+"The returned LiveQuery holds the matching rows of `data` keyed by the\n"
+"`key` field and ordered by options.order_by.  insert()/update()/delete()\n"
+"re-evaluate only the changed item and return a LiveQueryDelta describing\n"
+"how the offset/limit window changed; result() returns the same list\n"
+"tnfilter() would for the updated collection.\n\n"
+"Parameters\n"
+"----------\n"
+"data : Iterable\n"
+"    Initial collection.  Every item must carry a distinct key.\n"
+"filters : CompiledFilters\n"
+"    Pre-compiled filter tree from compile_filters().\n"
+"options : CompiledOptions\n"
+"    Pre-compiled options from compile_options().  get and count are not\n"
+"    supported.\n"
+"key : str\n"
+"    Top-level primary-key field (dict key or attribute name).\n\n"
+"Returns\n"
+"-------\n"
+"LiveQuery\n"
+"    len() is the number of matching rows before offset/limit.\n"
+);
+
+PyDoc_STRVAR(explain_doc,
+"explain(data: Iterable, *, filters: CompiledFilters,\n"
+"        options: CompiledOptions) -> QueryProfile\n"
+"--\n\n"
+"Run tnfilter() with per-node profiling.\n\n"
+"Each node of the compiled filter tree records how often it was\n"
+"evaluated, how often it matched, how often a leaf found nothing at its\n"
+"path, and the time spent in it (operator calls such as regex and\n"
+"casefold included).  The select, order_by and offset/limit phases are\n"
+"timed separately.  Profiling adds clock reads per node, so absolute\n"
+"timings are higher than an unprofiled tnfilter() call; use them to\n"
+"compare terms, not as a benchmark.\n\n"
+"Parameters\n"
+"----------\n"
+"data : Iterable\n"
+"    Collection to query.\n"
+"filters : CompiledFilters\n"
+"    Pre-compiled filter tree from compile_filters().\n"
+"options : CompiledOptions\n"
+"    Pre-compiled options from compile_options().\n\n"
+"Returns\n"
+"-------\n"
+"QueryProfile\n"
+"    .result is what tnfilter() returns; .filters holds one ProfileNode\n"
+"    per top-level filter; .tree is a printable summary.\n"
+);
+
+PyDoc_STRVAR(paginate_doc,
+"paginate(data: Iterable, *, filters: CompiledFilters,\n"
+"         options: CompiledOptions, after: tuple | None = None) -> Page\n"
+"--\n\n"
+"Return one page of a query using keyset (seek) pagination.\n\n"
+"Instead of an offset, the caller passes the cursor returned with the\n"
+"previous page.  Matching rows whose order_by key sorts at or before the\n"
+"cursor are skipped during the filter pass, and only options.limit rows are\n"
+"kept, so the cost of a page does not grow with its depth.  order_by should\n"
+"end with a unique field: rows tying with the cursor on every key are\n"
+"skipped.\n\n"
+"Parameters\n"
+"----------\n"
+"data : Iterable\n"
+"    Collection to query.\n"
+"filters : CompiledFilters\n"
+"    Pre-compiled filter tree from compile_filters().\n"
+"options : CompiledOptions\n"
+"    Pre-compiled options from compile_options().  order_by and limit are\n"
+"    required; offset, get, count, group_by/aggregate and distinct are\n"
+"    rejected.\n"
+"after : tuple or None\n"
+"    Cursor of the previous page (Page.cursor), or None for the first page.\n\n"
+"Returns\n"
+"-------\n"
+"Page\n"
+"    .items equals tnfilter() for the same page; .cursor is the order_by key\n"
+"    of the last row when the page is full, else None.\n"
+);
+
 static PyMethodDef truenas_pyfilter_methods[] = {
     {
         .ml_name = "match",
@@ -482,6 +896,54 @@ static PyMethodDef truenas_pyfilter_methods[] = {
         .ml_flags = METH_VARARGS | METH_KEYWORDS,
         .ml_doc = compile_options_doc,
     },
+    {
+        .ml_name = "compile_lookup",
+        .ml_meth = (PyCFunction)(void(*)(void))py_compile_lookup,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = compile_lookup_doc,
+    },
+    {
+        .ml_name = "compile_filter_set",
+        .ml_meth = (PyCFunction)(void(*)(void))py_compile_filter_set,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = compile_filter_set_doc,
+    },
+    {
+        .ml_name = "live_query",
+        .ml_meth = (PyCFunction)(void(*)(void))py_live_query,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = live_query_doc,
+    },
+    {
+        .ml_name = "explain",
+        .ml_meth = (PyCFunction)(void(*)(void))py_explain,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = explain_doc,
+    },
+    {
+        .ml_name = "paginate",
+        .ml_meth = (PyCFunction)(void(*)(void))py_paginate,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = paginate_doc,
+    },
+    {
+        .ml_name = "match_any",
+        .ml_meth = (PyCFunction)(void(*)(void))py_match_any,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = match_any_doc,
+    },
+    {
+        .ml_name = "_load_filters",
+        .ml_meth = (PyCFunction)py_load_filters,
+        .ml_flags = METH_VARARGS,
+        .ml_doc = PyDoc_STR("Unpickle a CompiledFilters (pickle support)."),
+    },
+    {
+        .ml_name = "_load_options",
+        .ml_meth = (PyCFunction)py_load_options,
+        .ml_flags = METH_VARARGS,
+        .ml_doc = PyDoc_STR("Unpickle a CompiledOptions (pickle support)."),
+    },
     { .ml_name = NULL },
 };
 
@@ -502,6 +964,10 @@ truenas_pyfilter_traverse(PyObject *m, visitproc visit, void *arg)
     Py_VISIT(state->alias_str);
     Py_VISIT(state->annotation_str);
     Py_VISIT(state->args_str);
+    Py_VISIT(state->LiveQueryDeltaType);
+    Py_VISIT(state->QueryProfileType);
+    Py_VISIT(state->ProfileNodeType);
+    Py_VISIT(state->PageType);
     return 0;
 }
 
@@ -520,6 +986,10 @@ truenas_pyfilter_clear(PyObject *m)
     Py_CLEAR(state->alias_str);
     Py_CLEAR(state->annotation_str);
     Py_CLEAR(state->args_str);
+    Py_CLEAR(state->LiveQueryDeltaType);
+    Py_CLEAR(state->QueryProfileType);
+    Py_CLEAR(state->ProfileNodeType);
+    Py_CLEAR(state->PageType);
     /* Borrowed pointer; drop it so a stale type is never compared against. */
     state->pyd_cache_type = NULL;
     return 0;
@@ -550,6 +1020,12 @@ PyInit_truenas_pyfilter(void)
         return NULL;
     if (PyType_Ready(&CompiledOptions_Type) < 0)
         return NULL;
+    if (PyType_Ready(&CompiledFilterSet_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&LiveQuery_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&CompiledLookup_Type) < 0)
+        return NULL;
 
     m = PyModule_Create(&moduledef);
     if (!m)
@@ -606,6 +1082,18 @@ PyInit_truenas_pyfilter(void)
         goto fail;
     if (PyModule_AddType(m, &CompiledOptions_Type) < 0)
         goto fail;
+    if (PyModule_AddType(m, &CompiledFilterSet_Type) < 0)
+        goto fail;
+    if (PyModule_AddType(m, &LiveQuery_Type) < 0)
+        goto fail;
+    if (PyModule_AddType(m, &CompiledLookup_Type) < 0)
+        goto fail;
+    if (init_live_query_types(m, state) < 0)
+        goto fail;
+    if (init_explain_types(m, state) < 0)
+        goto fail;
+    if (init_page_types(m, state) < 0)
+        goto fail;
 
     /* order_by prefix constants */
 #define ADD_STR(name, val) \
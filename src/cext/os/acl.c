@@ -5,6 +5,7 @@
 #include <sys/stat.h>
 #include <sys/xattr.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include "acl.h"
@@ -50,6 +51,175 @@ read_xattr_raw(int fd, const char *name, ssize_t sz, size_t *out_len)
 	return buf;
 }
 
+/*
+ * read_xattr_once -- read an xattr whose size is not known in advance.
+ *
+ * The value is read into a stack buffer sized for typical ACLs and copied
+ * out, so the common case is a single fgetxattr(2) that both detects the
+ * xattr and returns it; only ERANGE falls back to a size probe plus
+ * read_xattr_raw().
+ *
+ * Returns 0 with *out set (NULL for an empty value), ENODATA or EOPNOTSUPP
+ * with *out untouched and no exception set, or -1 with an exception set.
+ */
+#define ACL_XATTR_STACK_BUF 4096
+
+static int
+read_xattr_once(int fd, const char *name, char **out, size_t *out_len)
+{
+	char stackbuf[ACL_XATTR_STACK_BUF];
+	ssize_t ret;
+	int async_err = 0;
+
+	do {
+		Py_BEGIN_ALLOW_THREADS
+		ret = fgetxattr(fd, name, stackbuf, sizeof(stackbuf));
+		Py_END_ALLOW_THREADS
+	} while (ret == -1 && errno == EINTR &&
+	         !(async_err = PyErr_CheckSignals()));
+
+	if (ret == -1 && errno == ERANGE && !async_err) {
+		do {
+			Py_BEGIN_ALLOW_THREADS
+			ret = fgetxattr(fd, name, NULL, 0);
+			Py_END_ALLOW_THREADS
+		} while (ret == -1 && errno == EINTR &&
+		         !(async_err = PyErr_CheckSignals()));
+
+		if (ret > 0) {
+			*out = read_xattr_raw(fd, name, ret, out_len);
+			return *out == NULL ? -1 : 0;
+		}
+	}
+
+	if (ret == -1) {
+		if (async_err)
+			return -1;
+		if (errno == ENODATA || errno == EOPNOTSUPP)
+			return errno;
+		PyErr_SetFromErrno(PyExc_OSError);
+		return -1;
+	}
+
+	*out = NULL;
+	*out_len = 0;
+	if (ret == 0)
+		return 0;
+
+	*out = PyMem_RawMalloc((size_t)ret);
+	if (*out == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+	memcpy(*out, stackbuf, (size_t)ret);
+	*out_len = (size_t)ret;
+	return 0;
+}
+
+/*
+ * remove_xattr -- fremovexattr(2) with EINTR retry.
+ * Returns 0 on success, the errno on failure (no exception set), or -1 if
+ * a signal handler raised.
+ */
+static int
+remove_xattr(int fd, const char *name)
+{
+	int ret;
+	int async_err = 0;
+
+	do {
+		Py_BEGIN_ALLOW_THREADS
+		ret = fremovexattr(fd, name);
+		Py_END_ALLOW_THREADS
+	} while (ret == -1 && errno == EINTR &&
+	         !(async_err = PyErr_CheckSignals()));
+
+	if (ret == -1)
+		return async_err ? -1 : errno;
+	return 0;
+}
+
+/*
+ * ACL flavour cache.
+ *
+ * Whether a file carries NFS4 or POSIX ACLs is a property of its mount, but
+ * the only way to learn it from an fd is to try the NFS4 xattr and look at
+ * the errno.  A bulk ACL job (one fgetacl/fsetacl per file of a tree walk)
+ * would rediscover the same answer for every file, so callers that know the
+ * file's mount id pass it and the flavour is remembered per mount.
+ *
+ * The table is direct-mapped; a collision simply evicts.  mnt_id 0 marks an
+ * empty slot and means "uncached" to callers (the kernel never hands out
+ * mount id 0).  All access happens with the GIL held.  An entry that turns
+ * out wrong (EOPNOTSUPP where the flavour said the xattr exists, e.g. after
+ * `zfs set acltype=`) is dropped and the fd probed afresh;
+ * acl_flavour_invalidate() drops entries explicitly.
+ */
+#define ACL_FLAVOUR_CACHE_BITS 6
+
+typedef struct {
+	uint64_t mnt_id;
+	acltype_t type;
+} acl_flavour_ent_t;
+
+static acl_flavour_ent_t acl_flavour_cache[1 << ACL_FLAVOUR_CACHE_BITS];
+
+static acl_flavour_ent_t *
+acl_flavour_slot(uint64_t mnt_id)
+{
+	/* Fibonacci hashing spreads the sequential unique mount ids. */
+	return &acl_flavour_cache[(mnt_id * 0x9E3779B97F4A7C15ULL) >>
+	                          (64 - ACL_FLAVOUR_CACHE_BITS)];
+}
+
+static bool
+acl_flavour_lookup(uint64_t mnt_id, acltype_t *type)
+{
+	acl_flavour_ent_t *ent;
+
+	if (mnt_id == 0)
+		return false;
+	ent = acl_flavour_slot(mnt_id);
+	if (ent->mnt_id != mnt_id)
+		return false;
+	*type = ent->type;
+	return true;
+}
+
+static void
+acl_flavour_store(uint64_t mnt_id, acltype_t type)
+{
+	acl_flavour_ent_t *ent;
+
+	if (mnt_id == 0)
+		return;
+	ent = acl_flavour_slot(mnt_id);
+	ent->mnt_id = mnt_id;
+	ent->type = type;
+}
+
+/* Drop the entry for mnt_id, if any; 0 (uncached caller) is a no-op. */
+static void
+acl_flavour_forget(uint64_t mnt_id)
+{
+	acl_flavour_ent_t *ent;
+
+	if (mnt_id == 0)
+		return;
+	ent = acl_flavour_slot(mnt_id);
+	if (ent->mnt_id == mnt_id)
+		ent->mnt_id = 0;
+}
+
+void
+acl_flavour_invalidate(uint64_t mnt_id)
+{
+	if (mnt_id == 0)
+		memset(acl_flavour_cache, 0, sizeof(acl_flavour_cache));
+	else
+		acl_flavour_forget(mnt_id);
+}
+
 void
 acl_xattr_free(acl_xattr_t *acl)
 {
@@ -114,74 +284,38 @@ synthesize_posix_access_from_mode(mode_t mode, size_t *out_len)
 }
 
 /*
- * do_fgetacl(fd, out) -- get the ACL xattr(s) on an open file descriptor.
+ * fgetacl_posix -- fill *out from the POSIX ACL xattrs on fd.
  *
- * Fills *out with type-tagged raw xattr buffers.  Returns 0 on success,
- * -1 on failure (Python exception set).
+ * cached is true when the POSIX flavour came from the flavour cache rather
+ * than a failed NFS4 read; an EOPNOTSUPP then means the entry is stale and
+ * the fd is probed afresh instead of reporting ACLs as disabled.
  */
-int
-do_fgetacl(int fd, acl_xattr_t *out)
+static int
+fgetacl_posix(int fd, uint64_t mnt_id, bool cached, acl_xattr_t *out)
 {
-	ssize_t sz;
-	ssize_t dsz;
-	int async_err = 0;
-
-	/* Probe for NFS4 ACL xattr. */
-	do {
-		Py_BEGIN_ALLOW_THREADS
-		sz = fgetxattr(fd, NFS4_ACL_XATTR, NULL, 0);
-		Py_END_ALLOW_THREADS
-	} while (sz == -1 && errno == EINTR &&
-	         !(async_err = PyErr_CheckSignals()));
-
-	if (async_err)
+	char *access_data = NULL;
+	size_t access_len = 0;
+	char *default_data = NULL;
+	size_t default_len = 0;
+	int err;
+
+	err = read_xattr_once(fd, POSIX_ACCESS_XATTR, &access_data, &access_len);
+	if (err < 0)
 		return -1;
 
-	if (sz >= 0 || errno == ENODATA) {
-		/* NFS4 filesystem. */
-		out->type = ACLTYPE_NFS4;
-		if (sz > 0) {
-			out->data.nfs4.data = read_xattr_raw(fd, NFS4_ACL_XATTR, sz,
-			                                     &out->data.nfs4.len);
-			if (out->data.nfs4.data == NULL)
-				return -1;
-		} else {
-			/* ENODATA: ACL present but empty. */
-			out->data.nfs4.data = NULL;
-			out->data.nfs4.len = 0;
-		}
-		return 0;
-	}
-
-	if (errno != EOPNOTSUPP) {
-		PyErr_SetFromErrno(PyExc_OSError);
-		return -1;
-	}
-
-	/* EOPNOTSUPP: not NFS4, try POSIX. */
-	do {
-		Py_BEGIN_ALLOW_THREADS
-		sz = fgetxattr(fd, POSIX_ACCESS_XATTR, NULL, 0);
-		Py_END_ALLOW_THREADS
-	} while (sz == -1 && errno == EINTR &&
-	         !(async_err = PyErr_CheckSignals()));
-
-	if (async_err)
-		return -1;
-
-	if (sz == -1 && errno == EOPNOTSUPP) {
+	if (err == EOPNOTSUPP) {
+		acl_flavour_forget(mnt_id);
+		if (cached)
+			return do_fgetacl(fd, mnt_id, out);
 		/* ACLs disabled entirely. */
+		errno = EOPNOTSUPP;
 		PyErr_SetFromErrno(PyExc_OSError);
 		return -1;
 	}
 
 	out->type = ACLTYPE_POSIX;
 
-	if (sz > 0) {
-		out->data.posix.access_data = read_xattr_raw(fd, POSIX_ACCESS_XATTR, sz,
-		                                             &out->data.posix.access_len);
-		if (out->data.posix.access_data == NULL)
-			return -1;
+	if (access_data != NULL) {
 		out->data.posix.access_synthesized = 0;
 	} else {
 		/*
@@ -204,56 +338,84 @@ do_fgetacl(int fd, acl_xattr_t *out)
 			return -1;
 		}
 
-		out->data.posix.access_data =
-		    synthesize_posix_access_from_mode(st.st_mode,
-		                                      &out->data.posix.access_len);
-		if (out->data.posix.access_data == NULL)
+		access_data = synthesize_posix_access_from_mode(st.st_mode,
+		                                                &access_len);
+		if (access_data == NULL)
 			return -1;
 		out->data.posix.access_synthesized = 1;
 	}
 
-	/* Probe for default ACL. */
-	do {
-		Py_BEGIN_ALLOW_THREADS
-		dsz = fgetxattr(fd, POSIX_DEFAULT_XATTR, NULL, 0);
-		Py_END_ALLOW_THREADS
-	} while (dsz == -1 && errno == EINTR &&
-	         !(async_err = PyErr_CheckSignals()));
-
-	if (async_err) {
-		free(out->data.posix.access_data);
+	err = read_xattr_once(fd, POSIX_DEFAULT_XATTR, &default_data, &default_len);
+	if (err < 0) {
+		PyMem_RawFree(access_data);
 		return -1;
 	}
-
-	if (dsz == -1 && errno == ENODATA) {
-		/* No default ACL. */
-		out->data.posix.default_data = NULL;
-		out->data.posix.default_len = 0;
-	} else if (dsz == -1) {
-		free(out->data.posix.access_data);
+	if (err == EOPNOTSUPP) {
+		PyMem_RawFree(access_data);
+		errno = err;
 		PyErr_SetFromErrno(PyExc_OSError);
 		return -1;
-	} else if (dsz > 0) {
-		out->data.posix.default_data = read_xattr_raw(fd, POSIX_DEFAULT_XATTR, dsz,
-		                                              &out->data.posix.default_len);
-		if (out->data.posix.default_data == NULL) {
-			free(out->data.posix.access_data);
-			return -1;
-		}
-	} else {
-		out->data.posix.default_data = NULL;
-		out->data.posix.default_len = 0;
+	}
+	/* ENODATA leaves default_data NULL: no default ACL. */
+
+	out->data.posix.access_data = access_data;
+	out->data.posix.access_len = access_len;
+	out->data.posix.default_data = default_data;
+	out->data.posix.default_len = default_len;
+	acl_flavour_store(mnt_id, ACLTYPE_POSIX);
+	return 0;
+}
+
+/*
+ * do_fgetacl(fd, mnt_id, out) -- get the ACL xattr(s) on an open file
+ * descriptor.
+ *
+ * The NFS4 xattr is read first; ENODATA or success means an NFS4
+ * filesystem, EOPNOTSUPP means POSIX.  When the flavour of mnt_id is cached
+ * as POSIX the NFS4 read is skipped.  Each read doubles as its own probe, so
+ * a file whose ACL fits the stack buffer costs one fgetxattr(2) per xattr.
+ *
+ * Fills *out with type-tagged raw xattr buffers.  Returns 0 on success,
+ * -1 on failure (Python exception set).
+ */
+int
+do_fgetacl(int fd, uint64_t mnt_id, acl_xattr_t *out)
+{
+	acltype_t type;
+	bool cached;
+	char *data = NULL;
+	size_t len = 0;
+	int err;
+
+	cached = acl_flavour_lookup(mnt_id, &type);
+	if (cached && type == ACLTYPE_POSIX)
+		return fgetacl_posix(fd, mnt_id, true, out);
+
+	err = read_xattr_once(fd, NFS4_ACL_XATTR, &data, &len);
+	if (err < 0)
+		return -1;
+
+	if (err == EOPNOTSUPP) {
+		/* Not NFS4 (or the cached NFS4 flavour is stale): try POSIX. */
+		acl_flavour_forget(mnt_id);
+		return fgetacl_posix(fd, mnt_id, false, out);
 	}
 
+	/* NFS4 filesystem.  ENODATA: ACL present but empty (data NULL). */
+	out->type = ACLTYPE_NFS4;
+	out->data.nfs4.data = data;
+	out->data.nfs4.len = len;
+	acl_flavour_store(mnt_id, ACLTYPE_NFS4);
 	return 0;
 }
 
 /*
- * do_fsetacl_nfs4(fd, data, len) -- set system.nfs4_acl_xdr on fd.
+ * do_fsetacl_nfs4(fd, mnt_id, data, len) -- set system.nfs4_acl_xdr on fd.
+ * A successful write records mnt_id as NFS4; EOPNOTSUPP drops its entry.
  * Returns 0 on success, -1 on failure (Python exception set).
  */
 int
-do_fsetacl_nfs4(int fd, const char *data, size_t len)
+do_fsetacl_nfs4(int fd, uint64_t mnt_id, const char *data, size_t len)
 {
 	int ret;
 	int async_err = 0;
@@ -266,31 +428,94 @@ do_fsetacl_nfs4(int fd, const char *data, size_t len)
 	         !(async_err = PyErr_CheckSignals()));
 
 	if (ret == -1) {
-		if (!async_err)
+		if (!async_err) {
+			if (errno == EOPNOTSUPP)
+				acl_flavour_forget(mnt_id);
+			PyErr_SetFromErrno(PyExc_OSError);
+		}
+		return -1;
+	}
+
+	acl_flavour_store(mnt_id, ACLTYPE_NFS4);
+	return 0;
+}
+
+/*
+ * fremoveacl_type -- remove the ACL xattr(s) of flavour type from fd.
+ * cached has the same meaning as for fgetacl_posix().
+ */
+static int
+fremoveacl_type(int fd, uint64_t mnt_id, acltype_t type, bool cached)
+{
+	int err;
+
+	if (type == ACLTYPE_NFS4) {
+		err = remove_xattr(fd, NFS4_ACL_XATTR);
+		if (err < 0)
+			return -1;
+		if (err == EOPNOTSUPP && cached) {
+			acl_flavour_forget(mnt_id);
+			return do_fremoveacl(fd, mnt_id);
+		}
+		if (err != 0 && err != ENODATA) {
+			errno = err;
 			PyErr_SetFromErrno(PyExc_OSError);
+			return -1;
+		}
+		return 0;
+	}
+
+	/* POSIX filesystem: remove access xattr (ENODATA silently ignored). */
+	err = remove_xattr(fd, POSIX_ACCESS_XATTR);
+	if (err < 0)
+		return -1;
+	if (err == EOPNOTSUPP) {
+		acl_flavour_forget(mnt_id);
+		if (cached)
+			return do_fremoveacl(fd, mnt_id);
+		/* acltype == DISABLED */
+		return 0;
+	}
+	if (err != 0 && err != ENODATA) {
+		errno = err;
+		PyErr_SetFromErrno(PyExc_OSError);
 		return -1;
 	}
 
+	/* Remove default xattr (ENODATA silently ignored). */
+	err = remove_xattr(fd, POSIX_DEFAULT_XATTR);
+	if (err < 0)
+		return -1;
+	if (err != 0 && err != ENODATA) {
+		errno = err;
+		PyErr_SetFromErrno(PyExc_OSError);
+		return -1;
+	}
+
+	acl_flavour_store(mnt_id, ACLTYPE_POSIX);
 	return 0;
 }
 
 /*
- * do_fremoveacl(fd) -- remove all ACL xattr(s) from fd.
+ * do_fremoveacl(fd, mnt_id) -- remove all ACL xattr(s) from fd.
  *
- * Probes for filesystem type using the same fgetxattr sentinel as do_fgetacl():
+ * When the flavour of mnt_id is cached the removals are issued directly.
+ * Otherwise the filesystem type is probed using the same fgetxattr
+ * sentinel as do_fgetacl():
  *   NFS4:  fgetxattr returns >= 0 or ENODATA  → fremovexattr(nfs4_acl_xdr)
  *   POSIX: fgetxattr returns EOPNOTSUPP        → fremovexattr(posix_acl_access)
  *                                                + fremovexattr(posix_acl_default)
  * ENODATA on any individual remove is silently ignored.
  */
 int
-do_fremoveacl(int fd)
+do_fremoveacl(int fd, uint64_t mnt_id)
 {
+	acltype_t type;
 	ssize_t sz;
-	int ret;
-	int async_err;
+	int async_err = 0;
 
-	async_err = 0;
+	if (acl_flavour_lookup(mnt_id, &type))
+		return fremoveacl_type(fd, mnt_id, type, true);
 
 	/* Probe for NFS4 xattr to determine filesystem type. */
 	do {
@@ -304,75 +529,34 @@ do_fremoveacl(int fd)
 		return -1;
 
 	if (sz >= 0) {
-		/* NFS4 filesystem. */
-		do {
-			Py_BEGIN_ALLOW_THREADS
-			ret = fremovexattr(fd, NFS4_ACL_XATTR);
-			Py_END_ALLOW_THREADS
-		} while (ret == -1 && errno == EINTR &&
-		         !(async_err = PyErr_CheckSignals()));
+		acl_flavour_store(mnt_id, ACLTYPE_NFS4);
+		return fremoveacl_type(fd, mnt_id, ACLTYPE_NFS4, false);
+	}
 
-		if (ret == -1 && errno != ENODATA) {
-			if (!async_err)
-				PyErr_SetFromErrno(PyExc_OSError);
-			return -1;
-		}
+	if (errno == ENODATA) {
+		/* NFS4 filesystem, no ACL present; nothing to remove. */
+		acl_flavour_store(mnt_id, ACLTYPE_NFS4);
 		return 0;
 	}
 
-	if (errno == ENODATA)
-		return 0;  /* NFS4 filesystem, no ACL present; nothing to remove. */
-
 	if (errno != EOPNOTSUPP) {
 		PyErr_SetFromErrno(PyExc_OSError);
 		return -1;
 	}
 
-	/* POSIX filesystem: remove access xattr (ENODATA silently ignored). */
-	do {
-		Py_BEGIN_ALLOW_THREADS
-		ret = fremovexattr(fd, POSIX_ACCESS_XATTR);
-		Py_END_ALLOW_THREADS
-	} while (ret == -1 && errno == EINTR &&
-	         !(async_err = PyErr_CheckSignals()));
-
-	if (ret == -1 && errno != ENODATA) {
-		if (errno == EOPNOTSUPP) {
-			/* acltype == DISABLED */
-			return 0;
-		}
-		if (!async_err)
-			PyErr_SetFromErrno(PyExc_OSError);
-		return -1;
-	}
-
-	/* Remove default xattr (ENODATA silently ignored). */
-	async_err = 0;
-	do {
-		Py_BEGIN_ALLOW_THREADS
-		ret = fremovexattr(fd, POSIX_DEFAULT_XATTR);
-		Py_END_ALLOW_THREADS
-	} while (ret == -1 && errno == EINTR &&
-	         !(async_err = PyErr_CheckSignals()));
-
-	if (ret == -1 && errno != ENODATA) {
-		if (!async_err)
-			PyErr_SetFromErrno(PyExc_OSError);
-		return -1;
-	}
-
-	return 0;
+	return fremoveacl_type(fd, mnt_id, ACLTYPE_POSIX, false);
 }
 
 /*
- * do_fsetacl_posix(fd, ...) -- set POSIX ACL xattrs on fd.
+ * do_fsetacl_posix(fd, mnt_id, ...) -- set POSIX ACL xattrs on fd.
  *
  * If default_data is NULL, the default ACL xattr is removed
  * (ENODATA is silently ignored -- it was already absent).
+ * A successful write records mnt_id as POSIX; EOPNOTSUPP drops its entry.
  * Returns 0 on success, -1 on failure (Python exception set).
  */
 int
-do_fsetacl_posix(int fd,
+do_fsetacl_posix(int fd, uint64_t mnt_id,
                  const char *access_data, size_t access_len,
                  const char *default_data, size_t default_len)
 {
@@ -387,8 +571,11 @@ do_fsetacl_posix(int fd,
 	         !(async_err = PyErr_CheckSignals()));
 
 	if (ret == -1) {
-		if (!async_err)
+		if (!async_err) {
+			if (errno == EOPNOTSUPP)
+				acl_flavour_forget(mnt_id);
 			PyErr_SetFromErrno(PyExc_OSError);
+		}
 		return -1;
 	}
 
@@ -421,5 +608,6 @@ do_fsetacl_posix(int fd,
 		}
 	}
 
+	acl_flavour_store(mnt_id, ACLTYPE_POSIX);
 	return 0;
 }
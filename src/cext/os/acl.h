@@ -2,6 +2,7 @@
 #pragma once
 #include <Python.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* ── ACL type discriminator ──────────────────────────────────────────────── */
 
@@ -39,24 +40,31 @@ void acl_xattr_free(acl_xattr_t *acl);
 
 /* ── xattr operations (acl.c) ─────────────────────────────────────────────── */
 
+/*
+ * Every operation below takes the mount id of fd (statx stx_mnt_id, either
+ * flavour) to key the per-mount ACL flavour cache; 0 bypasses the cache.
+ * A cached flavour lets get/remove skip the NFS4-vs-POSIX probe, and a
+ * successful get/set/remove records it.
+ */
+
 /*
  * do_fgetacl: fill *out with the ACL xattr(s) from fd.
  * Returns 0 on success, -1 on failure (Python exception set).
  */
-int do_fgetacl(int fd, acl_xattr_t *out);
+int do_fgetacl(int fd, uint64_t mnt_id, acl_xattr_t *out);
 
 /*
  * do_fsetacl_nfs4: write system.nfs4_acl_xdr on fd.
  * Returns 0 on success, -1 on failure (Python exception set).
  */
-int do_fsetacl_nfs4(int fd, const char *data, size_t len);
+int do_fsetacl_nfs4(int fd, uint64_t mnt_id, const char *data, size_t len);
 
 /*
  * do_fsetacl_posix: write POSIX ACL xattrs on fd.
  * default_data == NULL removes the default ACL xattr (ENODATA silently ignored).
  * Returns 0 on success, -1 on failure (Python exception set).
  */
-int do_fsetacl_posix(int fd,
+int do_fsetacl_posix(int fd, uint64_t mnt_id,
                      const char *access_data, size_t access_len,
                      const char *default_data, size_t default_len);
 
@@ -66,7 +74,10 @@ int do_fsetacl_posix(int fd,
  * ENODATA on any individual xattr is silently ignored.
  * Returns 0 on success, -1 on failure (Python exception set).
  */
-int do_fremoveacl(int fd);
+int do_fremoveacl(int fd, uint64_t mnt_id);
+
+/* Drop the cached ACL flavour of mnt_id, or of every mount if mnt_id is 0. */
+void acl_flavour_invalidate(uint64_t mnt_id);
 
 /* ── NFS4 types (nfs4acl.c) ──────────────────────────────────────────────── */
 
@@ -110,3 +121,40 @@ int init_posixacl(PyObject *module);
 int posixacl_valid(int fd,
                    const char *access_data, size_t access_len,
                    const char *default_data, size_t default_len);
+
+/* ── structural comparison (acl_diff.c) ──────────────────────────────────── */
+
+/*
+ * acl_ent_t -- one ACE flattened into fixed-width words for comparison.
+ *
+ * key identifies the principal an ACE applies to; val is the payload that
+ * may differ between two ACEs for the same principal.  Entries with equal
+ * run may be freely reordered without changing the ACL's meaning; idx is
+ * the ACE's position in the ACL as exposed to Python.
+ */
+typedef struct {
+	uint32_t key[4];
+	uint32_t val[2];
+	uint32_t run;
+	uint32_t idx;
+} acl_ent_t;
+
+/* Sort ents into canonical order: (run, key, val). */
+void acl_ents_canonicalize(acl_ent_t *ents, size_t n);
+
+/* Compare two canonicalised entry arrays; returns 1 if equal, else 0. */
+int acl_ents_equal(const acl_ent_t *a, size_t na,
+                   const acl_ent_t *b, size_t nb);
+
+/* Hash header word hdr plus a canonicalised entry array (never -1). */
+Py_hash_t acl_ents_hash(uint32_t hdr, const acl_ent_t *ents, size_t n);
+
+/*
+ * acl_ents_diff: build a truenas_os.ACLDiff describing how the canonicalised
+ * entries b differ from a.  Returns a new reference or NULL on error.
+ */
+PyObject *acl_ents_diff(const acl_ent_t *a, size_t na,
+                        const acl_ent_t *b, size_t nb,
+                        int acl_flags_changed);
+
+int init_acl_diff_types(PyObject *module);
@@ -0,0 +1,359 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * Structural comparison of NFS4ACL / POSIXACL blobs.
+ *
+ * nfs4acl.c and posixacl.c flatten their raw xattr bytes into acl_ent_t
+ * arrays; everything here operates on those arrays only, so equality,
+ * hashing and diff() never allocate NFS4Ace / POSIXAce objects.
+ */
+
+#include <Python.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "acl.h"
+#include "truenas_os_state.h"
+
+/* ── comparators ─────────────────────────────────────────────────────────── */
+
+static int
+cmp_words(const uint32_t *a, const uint32_t *b, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+static int
+ent_cmp_key(const acl_ent_t *a, const acl_ent_t *b)
+{
+	return cmp_words(a->key, b->key, 4);
+}
+
+/* key, then val: identifies an ACE independent of its position */
+static int
+ent_cmp_kv(const acl_ent_t *a, const acl_ent_t *b)
+{
+	int c = ent_cmp_key(a, b);
+
+	return c ? c : cmp_words(a->val, b->val, 2);
+}
+
+/* qsort: canonical order (run, key, val, idx) */
+static int
+ent_qsort_canon(const void *x, const void *y)
+{
+	const acl_ent_t *a = x;
+	const acl_ent_t *b = y;
+	int c;
+
+	if (a->run != b->run)
+		return a->run < b->run ? -1 : 1;
+	c = ent_cmp_kv(a, b);
+	if (c)
+		return c;
+	return a->idx < b->idx ? -1 : a->idx > b->idx;
+}
+
+/* qsort on pointers: (key, val, idx) */
+static int
+entp_qsort_kv(const void *x, const void *y)
+{
+	const acl_ent_t *a = *(const acl_ent_t * const *)x;
+	const acl_ent_t *b = *(const acl_ent_t * const *)y;
+	int c = ent_cmp_kv(a, b);
+
+	if (c)
+		return c;
+	return a->idx < b->idx ? -1 : a->idx > b->idx;
+}
+
+/* ── canonical form, equality, hash ──────────────────────────────────────── */
+
+void
+acl_ents_canonicalize(acl_ent_t *ents, size_t n)
+{
+	if (n > 1)
+		qsort(ents, n, sizeof(*ents), ent_qsort_canon);
+}
+
+int
+acl_ents_equal(const acl_ent_t *a, size_t na,
+               const acl_ent_t *b, size_t nb)
+{
+	size_t i;
+
+	if (na != nb)
+		return 0;
+	for (i = 0; i < na; i++) {
+		if (a[i].run != b[i].run || ent_cmp_kv(&a[i], &b[i]) != 0)
+			return 0;
+	}
+	return 1;
+}
+
+/* xxHash-style lane mixing, as used by CPython's tuplehash */
+#define ACL_HASH_PRIME_1 11400714785074694791ULL
+#define ACL_HASH_PRIME_2 14029467366897019727ULL
+#define ACL_HASH_PRIME_5 2870177450012600261ULL
+#define ACL_HASH_ROTATE(x) (((x) << 31) | ((x) >> 33))
+
+static inline uint64_t
+acl_hash_lane(uint64_t acc, uint64_t lane)
+{
+	acc += lane * ACL_HASH_PRIME_2;
+	acc = ACL_HASH_ROTATE(acc);
+	return acc * ACL_HASH_PRIME_1;
+}
+
+Py_hash_t
+acl_ents_hash(uint32_t hdr, const acl_ent_t *ents, size_t n)
+{
+	uint64_t acc = ACL_HASH_PRIME_5;
+	size_t i;
+
+	acc = acl_hash_lane(acc, hdr);
+	for (i = 0; i < n; i++) {
+		const acl_ent_t *e = &ents[i];
+
+		acc = acl_hash_lane(acc, ((uint64_t)e->run << 32) | e->key[0]);
+		acc = acl_hash_lane(acc, ((uint64_t)e->key[1] << 32) | e->key[2]);
+		acc = acl_hash_lane(acc, ((uint64_t)e->key[3] << 32) | e->val[0]);
+		acc = acl_hash_lane(acc, e->val[1]);
+	}
+	acc += n ^ (ACL_HASH_PRIME_5 ^ 3527539UL);
+
+	if ((Py_hash_t)acc == -1)
+		return 1546275796;
+	return (Py_hash_t)acc;
+}
+
+/* ── ACLDiff PyStructSequence ────────────────────────────────────────────── */
+
+static PyStructSequence_Field acl_diff_fields[] = {
+	{"added", "Indexes of ACEs present only in the other ACL"},
+	{"removed", "Indexes of ACEs present only in this ACL"},
+	{"changed", "(self_index, other_index) pairs for the same principal "
+	            "whose flags or permissions differ"},
+	{"acl_flags_changed", "True if the ACL-wide flags differ"},
+	{"reordered", "True if ACEs common to both ACLs appear in a "
+	              "semantically different order"},
+	{NULL}
+};
+
+static PyStructSequence_Desc acl_diff_desc = {
+	.name = "truenas_os.ACLDiff",
+	.doc = "Structural difference between two ACLs of the same type, as "
+	       "returned by NFS4ACL.diff() and POSIXACL.diff().",
+	.fields = acl_diff_fields,
+	.n_in_sequence = 5,
+};
+
+int
+init_acl_diff_types(PyObject *module)
+{
+	truenas_os_state_t *state;
+
+	state = get_truenas_os_state(module);
+	if (state == NULL)
+		return -1;
+
+	state->ACLDiffType =
+	    (PyObject *)PyStructSequence_NewType(&acl_diff_desc);
+	if (state->ACLDiffType == NULL)
+		return -1;
+	if (PyModule_AddObjectRef(module, "ACLDiff", state->ACLDiffType) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* ── diff ────────────────────────────────────────────────────────────────── */
+
+/* Sorted tuple of plain ints from a list under construction. */
+static PyObject *
+sorted_tuple(PyObject *list)
+{
+	if (PyList_Sort(list) < 0)
+		return NULL;
+	return PyList_AsTuple(list);
+}
+
+static int
+append_index(PyObject *list, uint32_t idx)
+{
+	PyObject *v = PyLong_FromUnsignedLong(idx);
+	int ret;
+
+	if (v == NULL)
+		return -1;
+	ret = PyList_Append(list, v);
+	Py_DECREF(v);
+	return ret;
+}
+
+static int
+append_pair(PyObject *list, uint32_t a, uint32_t b)
+{
+	PyObject *v = Py_BuildValue("(kk)", (unsigned long)a, (unsigned long)b);
+	int ret;
+
+	if (v == NULL)
+		return -1;
+	ret = PyList_Append(list, v);
+	Py_DECREF(v);
+	return ret;
+}
+
+/*
+ * Matching is done in two passes over (key, val)-sorted pointer arrays:
+ * first ACEs that are identical in both ACLs are paired off, then the
+ * leftovers are paired by principal alone and reported as changed.
+ * Whatever remains unpaired is removed (from a) or added (from b).
+ *
+ * peer_a[i] holds the canonical position in b of the ACE exactly matching
+ * a[i], or -1; reordered is set when those positions are not increasing.
+ */
+PyObject *
+acl_ents_diff(const acl_ent_t *a, size_t na,
+              const acl_ent_t *b, size_t nb,
+              int acl_flags_changed)
+{
+	truenas_os_state_t *state = NULL;
+	const acl_ent_t **pa = NULL;
+	const acl_ent_t **pb = NULL;
+	Py_ssize_t *peer_a = NULL;
+	Py_ssize_t *peer_b = NULL;
+	PyObject *added = NULL;
+	PyObject *removed = NULL;
+	PyObject *changed = NULL;
+	PyObject *result = NULL;
+	Py_ssize_t last;
+	size_t i, j, ua, ub;
+	int reordered = 0;
+
+	state = get_truenas_os_state(NULL);
+	if (state == NULL || state->ACLDiffType == NULL) {
+		PyErr_SetString(PyExc_SystemError, "ACLDiff type not initialized");
+		return NULL;
+	}
+
+	pa = PyMem_Malloc((na + 1) * sizeof(*pa));
+	pb = PyMem_Malloc((nb + 1) * sizeof(*pb));
+	peer_a = PyMem_Malloc((na + 1) * sizeof(*peer_a));
+	peer_b = PyMem_Malloc((nb + 1) * sizeof(*peer_b));
+	if (!pa || !pb || !peer_a || !peer_b) {
+		PyErr_NoMemory();
+		goto out;
+	}
+
+	for (i = 0; i < na; i++) {
+		pa[i] = &a[i];
+		peer_a[i] = -1;
+	}
+	for (j = 0; j < nb; j++) {
+		pb[j] = &b[j];
+		peer_b[j] = -1;
+	}
+	qsort(pa, na, sizeof(*pa), entp_qsort_kv);
+	qsort(pb, nb, sizeof(*pb), entp_qsort_kv);
+
+	/* pass 1: identical ACEs */
+	i = j = 0;
+	while (i < na && j < nb) {
+		int c = ent_cmp_kv(pa[i], pb[j]);
+
+		if (c < 0) {
+			i++;
+		} else if (c > 0) {
+			j++;
+		} else {
+			peer_a[pa[i] - a] = pb[j] - b;
+			peer_b[pb[j] - b] = pa[i] - a;
+			i++;
+			j++;
+		}
+	}
+
+	/* compact the unmatched entries; (key, val) order is preserved */
+	for (i = ua = 0; i < na; i++) {
+		if (peer_a[pa[i] - a] < 0)
+			pa[ua++] = pa[i];
+	}
+	for (j = ub = 0; j < nb; j++) {
+		if (peer_b[pb[j] - b] < 0)
+			pb[ub++] = pb[j];
+	}
+
+	added = PyList_New(0);
+	removed = PyList_New(0);
+	changed = PyList_New(0);
+	if (!added || !removed || !changed)
+		goto out;
+
+	/* pass 2: same principal, different payload */
+	i = j = 0;
+	while (i < ua || j < ub) {
+		int c;
+
+		if (i == ua)
+			c = 1;
+		else if (j == ub)
+			c = -1;
+		else
+			c = ent_cmp_key(pa[i], pb[j]);
+
+		if (c < 0) {
+			if (append_index(removed, pa[i]->idx) < 0)
+				goto out;
+			i++;
+		} else if (c > 0) {
+			if (append_index(added, pb[j]->idx) < 0)
+				goto out;
+			j++;
+		} else {
+			if (append_pair(changed, pa[i]->idx, pb[j]->idx) < 0)
+				goto out;
+			i++;
+			j++;
+		}
+	}
+
+	last = -1;
+	for (i = 0; i < na; i++) {
+		if (peer_a[i] < 0)
+			continue;
+		if (peer_a[i] < last) {
+			reordered = 1;
+			break;
+		}
+		last = peer_a[i];
+	}
+
+	result = PyStructSequence_New((PyTypeObject *)state->ACLDiffType);
+	if (result == NULL)
+		goto out;
+
+	PyStructSequence_SET_ITEM(result, 0, sorted_tuple(added));
+	PyStructSequence_SET_ITEM(result, 1, sorted_tuple(removed));
+	PyStructSequence_SET_ITEM(result, 2, sorted_tuple(changed));
+	PyStructSequence_SET_ITEM(result, 3, PyBool_FromLong(acl_flags_changed));
+	PyStructSequence_SET_ITEM(result, 4, PyBool_FromLong(reordered));
+	if (!PyStructSequence_GET_ITEM(result, 0) ||
+	    !PyStructSequence_GET_ITEM(result, 1) ||
+	    !PyStructSequence_GET_ITEM(result, 2))
+		Py_CLEAR(result);
+
+out:
+	Py_XDECREF(added);
+	Py_XDECREF(removed);
+	Py_XDECREF(changed);
+	PyMem_Free(pa);
+	PyMem_Free(pb);
+	PyMem_Free(peer_a);
+	PyMem_Free(peer_b);
+	return result;
+}
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <Python.h>
+#include <endian.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "checksum.h"
+
+/*
+ * Read size per pread(2).  Large enough to amortise syscall overhead on
+ * ZFS (default recordsize 128 KiB) without holding much memory per job.
+ */
+#define CRC_BUFSZ (1024 * 1024)
+
+/* Reflected CRC32C (Castagnoli) polynomial. */
+#define CRC32C_POLY 0x82F63B78U
+
+/* ── CRC32C implementations ─────────────────────────────────────────────── */
+
+/* slice-by-8 tables, filled once by init_checksum() */
+static uint32_t crc32c_table[8][256];
+
+static uint32_t
+crc32c_sw(uint32_t crc, const uint8_t *p, size_t len)
+{
+	while (len && ((uintptr_t)p & 7)) {
+		crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy(&v, p, sizeof(v));
+		v = le64toh(v) ^ crc;
+		crc = crc32c_table[7][v & 0xff] ^
+		      crc32c_table[6][(v >> 8) & 0xff] ^
+		      crc32c_table[5][(v >> 16) & 0xff] ^
+		      crc32c_table[4][(v >> 24) & 0xff] ^
+		      crc32c_table[3][(v >> 32) & 0xff] ^
+		      crc32c_table[2][(v >> 40) & 0xff] ^
+		      crc32c_table[1][(v >> 48) & 0xff] ^
+		      crc32c_table[0][v >> 56];
+		p += 8;
+		len -= 8;
+	}
+	while (len--)
+		crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+#if defined(__x86_64__)
+/* SSE4.2 crc32 instruction; selected at init when the CPU supports it. */
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32c_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+	uint64_t crc64;
+
+	while (len && ((uintptr_t)p & 7)) {
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+		len--;
+	}
+	crc64 = crc;
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy(&v, p, sizeof(v));
+		crc64 = __builtin_ia32_crc32di(crc64, v);
+		p += 8;
+		len -= 8;
+	}
+	crc = (uint32_t)crc64;
+	while (len--)
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+	return crc;
+}
+#endif
+
+static uint32_t (*crc32c_update)(uint32_t, const uint8_t *, size_t) = crc32c_sw;
+
+/* ── per-file job (runs without the GIL) ────────────────────────────────── */
+
+struct crc_job {
+	int fd;
+	uint32_t crc;
+	int err;  /* errno on failure, 0 on success */
+};
+
+static void
+crc_job_run(struct crc_job *job)
+{
+	uint8_t *buf = NULL;
+	uint32_t crc = 0xFFFFFFFFU;
+	off_t off = 0;
+	ssize_t n;
+
+	buf = malloc(CRC_BUFSZ);
+	if (buf == NULL) {
+		job->err = ENOMEM;
+		return;
+	}
+
+	for (;;) {
+		n = pread(job->fd, buf, CRC_BUFSZ, off);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			job->err = errno;
+			break;
+		}
+		if (n == 0)
+			break;
+		crc = crc32c_update(crc, buf, (size_t)n);
+		off += n;
+	}
+
+	free(buf);
+	job->crc = ~crc;
+}
+
+static void *
+crc_job_thread(void *arg)
+{
+	crc_job_run(arg);
+	return NULL;
+}
+
+/* ── Python-facing helpers ──────────────────────────────────────────────── */
+
+PyObject *
+do_fcrc32c(int fd)
+{
+	struct crc_job job = { .fd = fd };
+
+	Py_BEGIN_ALLOW_THREADS
+	crc_job_run(&job);
+	Py_END_ALLOW_THREADS
+
+	if (job.err) {
+		errno = job.err;
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	return PyLong_FromUnsignedLong(job.crc);
+}
+
+PyObject *
+do_fcrc32c_pair(int fd_a, int fd_b)
+{
+	struct crc_job job_a = { .fd = fd_a };
+	struct crc_job job_b = { .fd = fd_b };
+	pthread_t tid;
+	int threaded;
+
+	Py_BEGIN_ALLOW_THREADS
+	threaded = pthread_create(&tid, NULL, crc_job_thread, &job_b) == 0;
+	crc_job_run(&job_a);
+	if (threaded)
+		pthread_join(tid, NULL);
+	else
+		crc_job_run(&job_b);  /* no thread available: read serially */
+	Py_END_ALLOW_THREADS
+
+	if (job_a.err || job_b.err) {
+		errno = job_a.err ? job_a.err : job_b.err;
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	return Py_BuildValue("(kk)", (unsigned long)job_a.crc,
+	                     (unsigned long)job_b.crc);
+}
+
+int
+init_checksum(PyObject *module)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = (uint32_t)i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+		crc32c_table[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++) {
+		crc = crc32c_table[0][i];
+		for (j = 1; j < 8; j++) {
+			crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+			crc32c_table[j][i] = crc;
+		}
+	}
+
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.2"))
+		crc32c_update = crc32c_hw;
+#endif
+	return 0;
+}
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef _CHECKSUM_H_
+#define _CHECKSUM_H_
+
+#include <Python.h>
+
+/*
+ * do_fcrc32c - CRC32C (Castagnoli) of the full contents of `fd`, read
+ * with pread(2) from offset 0 so the file offset is left untouched.
+ * Runs with the GIL released.  Returns a PyLong, or NULL with OSError set.
+ */
+PyObject *do_fcrc32c(int fd);
+
+/*
+ * do_fcrc32c_pair - CRC32C of two files at once.  `fd_b` is read on a
+ * helper thread while the calling thread reads `fd_a`, so both files are
+ * streamed concurrently.  Returns a (crc_a, crc_b) tuple, or NULL with
+ * OSError set if either read fails.
+ */
+PyObject *do_fcrc32c_pair(int fd_a, int fd_b);
+
+/* Build the CRC tables and select the hardware path if available. */
+int init_checksum(PyObject *module);
+
+#endif /* _CHECKSUM_H_ */
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <Python.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fcopy.h"
+
+/*
+ * Small-file copy.
+ *
+ * Copying a tree of small files in Python costs a copy_file_range loop
+ * (which needs a final call returning 0), then fchmod, fchown and utime,
+ * each a separate trip through the interpreter.  do_fcopy_small() does the
+ * whole file in one call without the GIL: a file shorter than the buffer is
+ * one pread(2) -- a short read of a regular file means end of file -- and
+ * one pwrite(2), followed by the metadata syscalls.
+ *
+ * The buffer is allocated once per thread and freed when the thread exits,
+ * so concurrent copies on several threads never share it.
+ */
+
+static pthread_key_t fcopy_buf_key;
+static pthread_once_t fcopy_buf_once = PTHREAD_ONCE_INIT;
+static int fcopy_buf_key_err;
+
+static void
+fcopy_buf_key_create(void)
+{
+	fcopy_buf_key_err = pthread_key_create(&fcopy_buf_key, free);
+}
+
+static char *
+fcopy_buf(void)
+{
+	char *buf = pthread_getspecific(fcopy_buf_key);
+
+	if (buf != NULL)
+		return buf;
+
+	buf = malloc(FCOPY_SMALL_MAX);
+	if (buf == NULL)
+		return NULL;
+	if (pthread_setspecific(fcopy_buf_key, buf) != 0) {
+		free(buf);
+		errno = ENOMEM;
+		return NULL;
+	}
+	return buf;
+}
+
+struct fcopy_job {
+	int src_fd;
+	int dst_fd;
+	uid_t uid;
+	gid_t gid;
+	int mode;
+	const struct timespec *times;
+	off_t copied;
+	int err;  /* errno on failure, 0 on success */
+};
+
+static int
+fcopy_data(struct fcopy_job *job)
+{
+	char *buf;
+	ssize_t n;
+	ssize_t w;
+	ssize_t done;
+
+	buf = fcopy_buf();
+	if (buf == NULL)
+		return -1;
+
+	for (;;) {
+		n = pread(job->src_fd, buf, FCOPY_SMALL_MAX, job->copied);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			return 0;
+
+		for (done = 0; done < n; done += w) {
+			w = pwrite(job->dst_fd, buf + done, (size_t)(n - done),
+			           job->copied + done);
+			if (w == -1) {
+				if (errno != EINTR)
+					return -1;
+				w = 0;
+			} else if (w == 0) {
+				/* No progress and no errno; don't spin on it. */
+				errno = EIO;
+				return -1;
+			}
+		}
+		job->copied += n;
+
+		if (n < FCOPY_SMALL_MAX)
+			return 0;
+	}
+}
+
+static void
+fcopy_job_run(struct fcopy_job *job)
+{
+	if (fcopy_data(job) < 0)
+		goto fail;
+
+	/*
+	 * Owner before mode: chown(2) clears the set-user-ID and set-group-ID
+	 * bits of a regular file, so they would be lost if mode came first.
+	 */
+	if ((job->uid != (uid_t)-1 || job->gid != (gid_t)-1) &&
+	    fchown(job->dst_fd, job->uid, job->gid) == -1)
+		goto fail;
+	if (job->mode != -1 && fchmod(job->dst_fd, (mode_t)job->mode) == -1)
+		goto fail;
+	if (job->times != NULL && futimens(job->dst_fd, job->times) == -1)
+		goto fail;
+	return;
+
+fail:
+	job->err = errno;
+}
+
+PyObject *
+do_fcopy_small(int src_fd, int dst_fd, uid_t uid, gid_t gid,
+               int mode, const struct timespec *times)
+{
+	struct fcopy_job job = {
+		.src_fd = src_fd,
+		.dst_fd = dst_fd,
+		.uid = uid,
+		.gid = gid,
+		.mode = mode,
+		.times = times,
+	};
+
+	Py_BEGIN_ALLOW_THREADS
+	fcopy_job_run(&job);
+	Py_END_ALLOW_THREADS
+
+	if (job.err) {
+		errno = job.err;
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	return PyLong_FromLongLong((long long)job.copied);
+}
+
+/*
+ * fallocate(2) itself rather than posix_fallocate(3): when the filesystem
+ * has no fallocate support, glibc emulates the latter by writing a byte to
+ * every block, which would double the writes of a large copy.  Here the
+ * caller sees EOPNOTSUPP and can carry on without preallocation.
+ */
+PyObject *
+do_fallocate(int fd, int mode, off_t offset, off_t len)
+{
+	int ret;
+	int err = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	do {
+		ret = fallocate(fd, mode, offset, len);
+	} while (ret == -1 && errno == EINTR);
+	if (ret == -1)
+		err = errno;
+	Py_END_ALLOW_THREADS
+
+	if (ret == -1) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	Py_RETURN_NONE;
+}
+
+PyObject *
+do_syncfs(int fd)
+{
+	int ret;
+	int err = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	ret = syncfs(fd);
+	if (ret == -1)
+		err = errno;
+	Py_END_ALLOW_THREADS
+
+	if (ret == -1) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+	Py_RETURN_NONE;
+}
+
+int
+init_fcopy(PyObject *module)
+{
+	pthread_once(&fcopy_buf_once, fcopy_buf_key_create);
+	if (fcopy_buf_key_err) {
+		errno = fcopy_buf_key_err;
+		PyErr_SetFromErrno(PyExc_OSError);
+		return -1;
+	}
+	if (PyModule_AddIntConstant(module, "FALLOC_FL_KEEP_SIZE",
+	                            FALLOC_FL_KEEP_SIZE) < 0)
+		return -1;
+	if (PyModule_AddIntConstant(module, "FALLOC_FL_PUNCH_HOLE",
+	                            FALLOC_FL_PUNCH_HOLE) < 0)
+		return -1;
+	return PyModule_AddIntConstant(module, "FCOPY_SMALL_MAX", FCOPY_SMALL_MAX);
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef _FCOPY_H_
+#define _FCOPY_H_
+
+#include <Python.h>
+#include <sys/stat.h>
+
+/*
+ * Buffer size of do_fcopy_small().  Files smaller than this are copied
+ * with one pread(2) and one pwrite(2).
+ */
+#define FCOPY_SMALL_MAX (64 * 1024)
+
+/*
+ * do_fcopy_small - copy the contents of `src_fd` to `dst_fd` (both read /
+ * written from offset 0) through a per-thread buffer, then apply owner
+ * (uid / gid, -1 leaves unchanged), mode (-1 leaves unchanged) and
+ * timestamps (NULL leaves unchanged) to `dst_fd`.  Runs with the GIL
+ * released.  Returns the number of bytes copied as a PyLong, or NULL with
+ * OSError set.
+ */
+PyObject *do_fcopy_small(int src_fd, int dst_fd, uid_t uid, gid_t gid,
+                         int mode, const struct timespec *times);
+
+/*
+ * do_fallocate - fallocate(2) `len` bytes of `fd` at `offset` with the
+ * FALLOC_FL_* `mode` flags, with the GIL released.  Returns None, or NULL
+ * with OSError set.
+ */
+PyObject *do_fallocate(int fd, int mode, off_t offset, off_t len);
+
+/*
+ * do_syncfs - syncfs(2) the filesystem containing `fd`, with the GIL
+ * released.  Returns None, or NULL with OSError set.
+ */
+PyObject *do_syncfs(int fd);
+
+/* Create the per-thread buffer key and add FCOPY_SMALL_MAX and the FALLOC_FL_* flags. */
+int init_fcopy(PyObject *module);
+
+#endif /* _FCOPY_H_ */
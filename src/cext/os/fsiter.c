@@ -48,6 +48,11 @@
 
 /* Forward declarations */
 static PyTypeObject FilesystemIteratorType;
+static PyObject *fsiter_new(int root_fd, const struct statx *root_st,
+			    const char *root_path, const iter_state_t *state,
+			    size_t reporting_cb_increment, PyObject *reporting_cb,
+			    PyObject *reporting_cb_private_data,
+			    uint64_t *cookies, size_t cookie_sz);
 
 /* IterInstance struct sequence indices */
 enum {
@@ -128,6 +133,270 @@ static inline void cleanup_iter_dir(iter_dir_t *iter)
 
 	PyMem_RawFree(iter->path);
 	iter->path = NULL;
+
+	PyMem_RawFree(iter->fh);
+	iter->fh = NULL;
+
+	PyMem_RawFree(iter->ents);
+	PyMem_RawFree(iter->names);
+	iter->ents = NULL;
+	iter->names = NULL;
+	iter->nents = 0;
+	iter->next_ent = 0;
+	iter->loaded = false;
+}
+
+/*
+ * inode_order support.
+ *
+ * readdir() returns entries in the filesystem's hash order, so the
+ * openat2 + statx that follow each one jump around the inode table; on
+ * HDD pools and large-dnode ZFS that is a random metadata read per entry
+ * when the cache is cold.  With inode_order the whole directory is read
+ * into a buffer first and walked in d_ino order, which tracks on-disk
+ * placement closely enough to turn those reads mostly sequential.  Ties
+ * (hard links within one directory) are broken by name so the order is
+ * deterministic for a given directory state.
+ *
+ * The buffer costs about 24 bytes plus the name per entry while the
+ * directory is on the stack.
+ */
+static int
+iter_dirent_cmp(const void *a, const void *b, void *names)
+{
+	const iter_dirent_t *ea = a;
+	const iter_dirent_t *eb = b;
+
+	if (ea->ino != eb->ino)
+		return ea->ino < eb->ino ? -1 : 1;
+	return strcmp((const char *)names + ea->name_off,
+		      (const char *)names + eb->name_off);
+}
+
+/*
+ * Read all of `dir` (minus . and ..) into its entry buffer and sort it.
+ * Called with GIL released.  Returns false with errno set on error.
+ */
+static bool
+load_sorted_dir(iter_dir_t *dir)
+{
+	struct dirent *de;
+	size_t cap_ents = 0, names_len = 0, cap_names = 0;
+	size_t len;
+	void *tmp;
+
+	for (;;) {
+		errno = 0;
+		de = readdir(dir->dirp);
+		if (de == NULL) {
+			if (errno != 0)
+				return false;
+			break;
+		}
+		if (ISDOT(de->d_name) || ISDOTDOT(de->d_name))
+			continue;
+
+		if (dir->nents == cap_ents) {
+			cap_ents = cap_ents ? cap_ents * 2 : 64;
+			tmp = PyMem_RawRealloc(dir->ents, cap_ents * sizeof(*dir->ents));
+			if (tmp == NULL) {
+				errno = ENOMEM;
+				return false;
+			}
+			dir->ents = tmp;
+		}
+
+		len = strlen(de->d_name) + 1;
+		if (names_len + len > cap_names) {
+			cap_names = cap_names ? cap_names * 2 : 4096;
+			while (names_len + len > cap_names)
+				cap_names *= 2;
+			tmp = PyMem_RawRealloc(dir->names, cap_names);
+			if (tmp == NULL) {
+				errno = ENOMEM;
+				return false;
+			}
+			dir->names = tmp;
+		}
+
+		memcpy(dir->names + names_len, de->d_name, len);
+		dir->ents[dir->nents].ino = de->d_ino;
+		dir->ents[dir->nents].name_off = names_len;
+		dir->ents[dir->nents].type = de->d_type;
+		dir->nents++;
+		names_len += len;
+	}
+
+	if (dir->nents > 1)
+		qsort_r(dir->ents, dir->nents, sizeof(*dir->ents),
+			iter_dirent_cmp, dir->names);
+
+	dir->loaded = true;
+	return true;
+}
+
+/*
+ * Next entry of `dir`: straight from readdir(), or from the sorted buffer
+ * (copied into self->sorted_dirent) when inode_order is set.  Called with
+ * GIL released.  Returns NULL at end of directory with errno 0, or on
+ * error with errno set.
+ */
+static struct dirent *
+iter_readdir(FilesystemIteratorObject *self, iter_dir_t *dir)
+{
+	const iter_dirent_t *ent;
+	struct dirent *out = &self->sorted_dirent;
+
+	errno = 0;
+	if (!self->state.inode_order)
+		return readdir(dir->dirp);
+
+	if (!dir->loaded && !load_sorted_dir(dir))
+		return NULL;
+
+	if (dir->next_ent == dir->nents) {
+		errno = 0;
+		return NULL;
+	}
+
+	ent = &dir->ents[dir->next_ent++];
+	out->d_ino = ent->ino;
+	out->d_type = ent->type;
+	strlcpy(out->d_name, dir->names + ent->name_off, sizeof(out->d_name));
+	return out;
+}
+
+/*
+ * max_open_dirs support.
+ *
+ * Every directory on the stack normally keeps its DIR stream open, so a
+ * walk MAX_DEPTH deep holds MAX_DEPTH fds and a few concurrent deep walks
+ * can run a process out of them.  With a budget, pushing a directory past
+ * it first evicts the shallowest open ancestor other than the root: its
+ * readdir position is saved with telldir() (not needed once an inode_order
+ * buffer is loaded) along with a file handle, and the stream is closed.
+ * Ancestors are only read again after everything below them is done, so
+ * evicting the shallowest one defers reopening the longest.
+ *
+ * When the walk climbs back to an evicted directory it is reopened with
+ * open_by_handle_at(), which follows the directory across renames, and
+ * positioned with seekdir().  Without CAP_DAC_READ_SEARCH, or on a
+ * filesystem without file handles, it is reopened by its recorded path
+ * relative to the nearest open ancestor (the root is never evicted)
+ * instead.  Either way the inode must match or iteration fails.
+ */
+
+/*
+ * Close the shallowest open ancestor below the root.  Called with GIL
+ * released, before the push that would exceed the budget.
+ */
+static bool
+evict_ancestor(FilesystemIteratorObject *self, fsiter_error_t *err)
+{
+	iter_dir_t *dir = NULL;
+	struct file_handle *fh = NULL;
+	int mount_id;
+	size_t i;
+
+	for (i = 1; i < self->cur_depth; i++) {
+		if (self->dir_stack[i].dirp != NULL) {
+			dir = &self->dir_stack[i];
+			break;
+		}
+	}
+	FSITER_ASSERT(dir != NULL, "no open ancestor to evict");
+
+	if (!dir->loaded) {
+		dir->pos = telldir(dir->dirp);
+		if (dir->pos == -1) {
+			SET_ERROR_ERRNO(err, "telldir(%s)", dir->path);
+			return false;
+		}
+	}
+
+	/* A failure here only means reopening by path later. */
+	if (!self->no_fhandle) {
+		fh = PyMem_RawMalloc(sizeof(*fh) + MAX_HANDLE_SZ);
+		if (fh != NULL) {
+			fh->handle_bytes = MAX_HANDLE_SZ;
+			if (name_to_handle_at(dirfd(dir->dirp), "", fh, &mount_id,
+					      AT_EMPTY_PATH) < 0) {
+				PyMem_RawFree(fh);
+				fh = NULL;
+			}
+		}
+	}
+
+	closedir(dir->dirp);
+	dir->dirp = NULL;
+	dir->fh = fh;
+	self->open_dirs--;
+	return true;
+}
+
+/*
+ * Reopen the evicted directory at the top of the stack and restore its
+ * position.  Called with GIL released.
+ */
+static bool
+reopen_dir(FilesystemIteratorObject *self, fsiter_error_t *err)
+{
+	iter_dir_t *dir = &self->dir_stack[self->cur_depth - 1];
+	const iter_dir_t *anchor;
+	const char *rel;
+	struct statx st;
+	DIR *dirp;
+	int fd = -1;
+	size_t i;
+
+	if (dir->fh != NULL) {
+		fd = open_by_handle_at(dirfd(self->dir_stack[0].dirp), dir->fh,
+				       O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0 && errno == EPERM)
+			self->no_fhandle = true;
+	}
+
+	if (fd < 0) {
+		for (i = self->cur_depth - 1; self->dir_stack[i - 1].dirp == NULL; i--)
+			;
+		anchor = &self->dir_stack[i - 1];
+		rel = dir->path + strlen(anchor->path);
+		if (anchor->path[0] != '\0')
+			rel++;	/* the '/' push_dir_stack() joined with */
+
+		fd = openat2_impl(dirfd(anchor->dirp), rel, OFLAGS_DIR_ITER,
+				  RESOLVE_FLAGS_ITER);
+		if (fd < 0) {
+			SET_ERROR_ERRNO(err, "openat2(%s) [reopen]", dir->path);
+			return false;
+		}
+	}
+
+	if (statx_impl(fd, "", STATX_FLAGS_ITER, STATX_MASK_ITER, &st) < 0) {
+		SET_ERROR_ERRNO(err, "statx(%s) [reopen]", dir->path);
+		close(fd);
+		return false;
+	}
+	if (st.stx_ino != dir->ino) {
+		SET_ERROR(err, "%s: directory replaced during iteration", dir->path);
+		close(fd);
+		return false;
+	}
+
+	dirp = fdopendir(fd);
+	if (dirp == NULL) {
+		SET_ERROR_ERRNO(err, "fdopendir(%s) [reopen]", dir->path);
+		close(fd);
+		return false;
+	}
+	if (!dir->loaded)
+		seekdir(dirp, dir->pos);
+
+	dir->dirp = dirp;
+	PyMem_RawFree(dir->fh);
+	dir->fh = NULL;
+	self->open_dirs++;
+	return true;
 }
 
 /*
@@ -260,6 +529,7 @@ FilesystemIterator_cleanup(FilesystemIteratorObject *self)
 		cleanup_iter_dir(&self->dir_stack[i]);
 	}
 	self->cur_depth = 0;
+	self->open_dirs = 0;
 
 	if (self->last.fd > 0) {
 		close(self->last.fd);
@@ -462,8 +732,14 @@ push_dir_stack(FilesystemIteratorObject *self, iter_dir_t *cur_dir, fsiter_error
 	int dup_fd;
 	char full_path[PATH_MAX];
 
-	/* Build full path for the directory */
-	snprintf(full_path, sizeof(full_path), "%s/%s", cur_dir->path, self->last.name);
+	/*
+	 * Build full path for the directory.  An empty root path means the
+	 * iterator was created from a bare fd: paths are then relative to it.
+	 */
+	if (cur_dir->path[0] == '\0')
+		snprintf(full_path, sizeof(full_path), "%s", self->last.name);
+	else
+		snprintf(full_path, sizeof(full_path), "%s/%s", cur_dir->path, self->last.name);
 
 	/* Check depth limit */
 	if (self->cur_depth >= MAX_DEPTH) {
@@ -471,6 +747,11 @@ push_dir_stack(FilesystemIteratorObject *self, iter_dir_t *cur_dir, fsiter_error
 		return false;
 	}
 
+	if (self->state.max_open_dirs &&
+	    self->open_dirs >= self->state.max_open_dirs &&
+	    !evict_ancestor(self, err))
+		return false;
+
 	/* Duplicate fd since the original will be returned to Python and closed by them */
 	dup_fd = dup(self->last.fd);
 	if (dup_fd < 0) {
@@ -498,6 +779,7 @@ push_dir_stack(FilesystemIteratorObject *self, iter_dir_t *cur_dir, fsiter_error
 	new_dir->dirp = dirp;
 	new_dir->ino = self->last.st.stx_ino;
 	self->cur_depth++;
+	self->open_dirs++;
 
 	return true;
 }
@@ -516,6 +798,8 @@ pop_dir_stack(FilesystemIteratorObject *self, fsiter_error_t *err)
 	}
 
 	dir = &self->dir_stack[self->cur_depth - 1];
+	if (dir->dirp != NULL)
+		self->open_dirs--;
 
 	cleanup_iter_dir(dir);
 	self->cur_depth--;
@@ -751,6 +1035,7 @@ FilesystemIterator_next(FilesystemIteratorObject *self)
 	enum fsiter_action action;
 	PyObject *result = NULL;
 	bool push_ok;
+	bool reopen_ok;
 	struct dirent *direntp = NULL;
 	iter_dir_t *cur_dir = NULL;
 	int async_err = 0;
@@ -784,14 +1069,24 @@ FilesystemIterator_next(FilesystemIteratorObject *self)
 
 		cur_dir = &self->dir_stack[self->cur_depth -1];
 
+		/* Climbed back to a directory evicted by max_open_dirs */
+		if (cur_dir->dirp == NULL) {
+			Py_BEGIN_ALLOW_THREADS
+			reopen_ok = reopen_dir(self, &self->cerr);
+			Py_END_ALLOW_THREADS
+			if (!reopen_ok) {
+				PyErr_SetString(PyExc_OSError, self->cerr.message);
+				return NULL;
+			}
+		}
+
 		/*
 		 * We separate out the readdir call from the
 		 * process_next_entry call so that handling for EINTR
 		 * doesn't change our position in DIR
 		 */
 		Py_BEGIN_ALLOW_THREADS
-		errno = 0;
-		direntp = readdir(cur_dir->dirp);
+		direntp = iter_readdir(self, cur_dir);
 		Py_END_ALLOW_THREADS
 
 		if (direntp == NULL) {
@@ -1177,13 +1472,10 @@ create_filesystem_iterator(const char *mountpoint, const char *relative_path,
 			   PyObject *reporting_cb_private_data,
 			   PyObject *dir_stack)
 {
-	FilesystemIteratorObject *iter = NULL;
 	int root_fd;
 	struct statx root_st;
 	int ret;
 	char root_path[PATH_MAX];
-	DIR *root_dirp = NULL;
-	iter_dir_t *root_dir = NULL;
 	struct statmount *sm = NULL;
 	const char *sb_source = NULL;
 	uint64_t *cookies = NULL;
@@ -1264,6 +1556,88 @@ create_filesystem_iterator(const char *mountpoint, const char *relative_path,
 	PyMem_RawFree(sm);
 #endif /* STATMOUNT_SB_SOURCE */
 
+	return fsiter_new(root_fd, &root_st, root_path, state,
+			  reporting_cb_increment, reporting_cb,
+			  reporting_cb_private_data, cookies, cookie_sz);
+}
+
+/*
+ * Create filesystem iterator rooted at an fd the caller already holds.
+ *
+ * The directory is reopened through "." rather than dup()ed so the
+ * iterator gets its own file offset.  No path is resolved and no
+ * statmount is needed: RESOLVE_NO_XDEV on every child open already
+ * pins the walk to the mount dirfd is on.
+ */
+PyObject *
+create_filesystem_iterator_fd(int dirfd, const char *root_path,
+			      const iter_state_t *state,
+			      size_t reporting_cb_increment,
+			      PyObject *reporting_cb,
+			      PyObject *reporting_cb_private_data,
+			      PyObject *dir_stack)
+{
+	int root_fd;
+	struct statx root_st;
+	uint64_t *cookies = NULL;
+	size_t cookie_sz = 0;
+
+	if (reporting_cb != NULL && reporting_cb != Py_None) {
+		if (!PyCallable_Check(reporting_cb)) {
+			PyErr_SetString(PyExc_TypeError, "reporting_callback must be callable");
+			return NULL;
+		}
+	}
+
+	if (root_path == NULL)
+		root_path = "";
+
+	if (strlen(root_path) >= PATH_MAX) {
+		PyErr_SetString(PyExc_ValueError, "path too long");
+		return NULL;
+	}
+
+	if (!dir_stack_to_cookies(dir_stack, &cookies, &cookie_sz)) {
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	root_fd = openat2_impl(dirfd, ".", OFLAGS_DIR_ITER, RESOLVE_FLAGS_ITER);
+	if (root_fd >= 0 &&
+	    statx_impl(root_fd, "", STATX_FLAGS_ITER, STATX_MASK_ITER, &root_st) < 0) {
+		int saved_errno = errno;
+		close(root_fd);
+		errno = saved_errno;
+		root_fd = -1;
+	}
+	Py_END_ALLOW_THREADS
+
+	if (root_fd < 0) {
+		PyMem_RawFree(cookies);
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+
+	return fsiter_new(root_fd, &root_st, root_path, state,
+			  reporting_cb_increment, reporting_cb,
+			  reporting_cb_private_data, cookies, cookie_sz);
+}
+
+/*
+ * Common tail of both constructors.  Takes ownership of root_fd and
+ * cookies on success and on failure.
+ */
+static PyObject *
+fsiter_new(int root_fd, const struct statx *root_st, const char *root_path,
+	   const iter_state_t *state,
+	   size_t reporting_cb_increment,
+	   PyObject *reporting_cb,
+	   PyObject *reporting_cb_private_data,
+	   uint64_t *cookies, size_t cookie_sz)
+{
+	FilesystemIteratorObject *iter = NULL;
+	DIR *root_dirp = NULL;
+	iter_dir_t *root_dir = NULL;
+
 	/* Open DIR* from root fd */
 	root_dirp = fdopendir(root_fd);
 	if (root_dirp == NULL) {
@@ -1286,6 +1660,8 @@ create_filesystem_iterator(const char *mountpoint, const char *relative_path,
 	memset(&iter->last, 0, sizeof(iter->last));
 	iter->last.fd = -1;
 	iter->cur_depth = 0;
+	iter->open_dirs = 0;
+	iter->no_fhandle = false;
 	iter->skip_next_recursion = false;
 	iter->is_closed = false;
 
@@ -1324,8 +1700,9 @@ create_filesystem_iterator(const char *mountpoint, const char *relative_path,
 	}
 
 	root_dir->dirp = root_dirp;
-	root_dir->ino = root_st.stx_ino;
+	root_dir->ino = root_st->stx_ino;
 	iter->cur_depth = 1;
+	iter->open_dirs = 1;
 
 	return (PyObject *)iter;
 }
@@ -43,11 +43,27 @@ typedef struct {
 	bool is_mount;	/* yielded via include_mountpoints fallback; fd is O_PATH */
 } iter_entry_t;
 
+/* One buffered directory entry (inode_order) */
+typedef struct {
+	uint64_t ino;
+	size_t name_off;	/* Offset of the name in iter_dir_t.names */
+	unsigned char type;
+} iter_dirent_t;
+
 /* Directory stack entry */
 typedef struct {
 	char *path;		/* Current path string (allocated) */
-	DIR *dirp;		/* DIR pointer from fdopendir */
+	DIR *dirp;		/* DIR pointer from fdopendir; NULL while evicted */
 	uint64_t ino;		/* Inode number of directory */
+	/* max_open_dirs: where to resume once an evicted directory is reopened */
+	long pos;		/* telldir() at eviction (unused when loaded) */
+	struct file_handle *fh;	/* name_to_handle_at() at eviction, or NULL */
+	/* inode_order: whole directory read up front, sorted by inode */
+	iter_dirent_t *ents;
+	char *names;
+	size_t nents;
+	size_t next_ent;
+	bool loaded;
 } iter_dir_t;
 
 /* Iteration state parameters */
@@ -58,6 +74,8 @@ typedef struct {
 	int file_open_flags;
 	bool include_symlinks;		/* yield DT_LNK entries when true */
 	bool include_mountpoints;	/* yield child mountpoint entries (O_PATH fd) when true */
+	bool inode_order;		/* process each directory's entries in d_ino order */
+	size_t max_open_dirs;		/* directory streams kept open; 0 is unlimited */
 } iter_state_t;
 
 /* Iterator object returned by iter_filesystem_contents */
@@ -66,8 +84,11 @@ typedef struct {
 
 	iter_dir_t dir_stack[MAX_DEPTH];    /* Pre-allocated stack */
 	size_t cur_depth;                   /* Current stack depth */
+	size_t open_dirs;                   /* Stack entries with an open dirp */
+	bool no_fhandle;                    /* open_by_handle_at() not permitted */
 	iter_state_t state;                 /* Iteration state and configuration */
 	iter_entry_t last;
+	struct dirent sorted_dirent;	/* inode_order: entry handed to the loop */
 	fsiter_error_t cerr;
 
 	uint64_t *cookies;	/* array of inode numbers for where we left off last time */
@@ -92,4 +113,12 @@ PyObject* create_filesystem_iterator(const char *mountpoint, const char *relativ
 				     PyObject *reporting_cb_private_data,
 				     PyObject *dir_stack);
 
+/* Same, rooted at an already-open directory fd (borrowed, not closed) */
+PyObject* create_filesystem_iterator_fd(int dirfd, const char *root_path,
+					const iter_state_t *state,
+					size_t reporting_cb_increment,
+					PyObject *reporting_cb,
+					PyObject *reporting_cb_private_data,
+					PyObject *dir_stack);
+
 #endif /* TRUENAS_FSITER_H */
@@ -0,0 +1,761 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+/*
+ * mount_tree(): assemble a mount tree with the new mount API in one call.
+ *
+ * Building an app or container root from Python is a clone of the root
+ * (open_tree), then per mount fsopen / fsconfig ... / fsmount or a bind
+ * clone, mount_setattr and move_mount onto the target, and a final
+ * move_mount to attach the result; each a separate GIL round trip, with
+ * cleanup hand-written on every error path.  mount_tree() takes the whole
+ * list as MountSpecs and runs it with the GIL released.
+ *
+ * Every mount is attached beneath a detached clone of the root, so nothing
+ * appears in the caller's mount namespace until the final move_mount.
+ * Rolling back is closing the tree fd: the kernel dissolves a detached tree,
+ * along with every mount attached to it, when its last fd is closed.
+ * Mounting onto a detached tree needs Linux 6.15 or newer.
+ */
+
+#include <Python.h>
+#include "common/includes.h"
+#include "mount_tree.h"
+#include "openat2.h"
+#include "truenas_os_state.h"
+#include <limits.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef AT_RECURSIVE
+#define AT_RECURSIVE 0x8000
+#endif
+
+#define SPEC_FIELD_TARGET	0
+#define SPEC_FIELD_FS_TYPE	1
+#define SPEC_FIELD_SOURCE	2
+#define SPEC_FIELD_OPTIONS	3
+#define SPEC_FIELD_ATTR_SET	4
+#define SPEC_FIELD_ATTR_CLR	5
+#define SPEC_FIELD_PROPAGATION	6
+#define SPEC_FIELD_USERNS_FD	7
+#define SPEC_FIELD_RECURSIVE	8
+
+/* One fsconfig() call. */
+struct tree_opt {
+	unsigned int cmd;
+	const char *key;
+	const void *value;
+	int aux;
+};
+
+/*
+ * A parsed MountSpec.  The strings borrow from the MountSpec, which the
+ * caller keeps alive for the duration of the build.
+ */
+struct tree_spec {
+	const char *target;
+	const char *fs_type;	/* NULL: bind clone of source */
+	const char *source;
+	struct tree_opt *opts;
+	size_t nopts;
+	struct mount_attr attr;
+	bool recursive;
+};
+
+
+/* ── MountSpec PyStructSequence type ─────────────────────────────────────── */
+
+static PyStructSequence_Field mount_spec_fields[] = {
+	{"target", "Mount point, relative to the tree root"},
+	{"fs_type", "Filesystem type for fsopen(2), or None for a bind mount"},
+	{"source", "fsconfig 'source' value, or the path to bind"},
+	{"options", "Tuple of (key, value) fsconfig(2) parameters"},
+	{"attr_set", "MOUNT_ATTR_* flags to set"},
+	{"attr_clr", "MOUNT_ATTR_* flags to clear"},
+	{"propagation", "Mount propagation type (MS_SHARED, ...), or 0"},
+	{"userns_fd", "User namespace fd for an idmapped mount, or -1"},
+	{"recursive", "Bind and apply attributes recursively"},
+	{NULL}
+};
+
+static PyStructSequence_Desc mount_spec_desc = {
+	.name = "truenas_os.MountSpec",
+	.doc = "One mount of a mount_tree() build. Construct via "
+	       "truenas_os.create_mount_spec().",
+	.fields = mount_spec_fields,
+	.n_in_sequence = 9,
+};
+
+int init_mount_tree_types(PyObject *module)
+{
+	truenas_os_state_t *state;
+
+	state = get_truenas_os_state(module);
+	if (state == NULL) {
+		return -1;
+	}
+
+	state->MountSpecType =
+	    (PyObject *)PyStructSequence_NewType(&mount_spec_desc);
+	if (state->MountSpecType == NULL) {
+		return -1;
+	}
+	if (PyModule_AddObjectRef(module, "MountSpec",
+	                          state->MountSpecType) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/* ── do_create_mount_spec: validating constructor ──────────────────────── */
+
+/*
+ * Check that `obj` is a str (or None when `nullable`) the kernel can take:
+ * non-empty, without embedded NULs.
+ */
+static int check_str(PyObject *obj, const char *what, bool nullable)
+{
+	const char *s;
+	Py_ssize_t len;
+
+	if (obj == Py_None && nullable) {
+		return 0;
+	}
+	if (!PyUnicode_Check(obj)) {
+		PyErr_Format(PyExc_TypeError, "%s must be a str%s", what,
+		             nullable ? " or None" : "");
+		return -1;
+	}
+	s = PyUnicode_AsUTF8AndSize(obj, &len);
+	if (s == NULL) {
+		return -1;
+	}
+	if (len == 0 || strlen(s) != (size_t)len) {
+		PyErr_Format(PyExc_ValueError,
+		             "%s must be non-empty and contain no NUL", what);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Normalize `options` (None, a dict, or a sequence of (key, value) pairs)
+ * into a tuple of (key, value) tuples, preserving order.
+ */
+static PyObject *normalize_options(PyObject *options)
+{
+	PyObject *fast = NULL;
+	PyObject *items;
+	PyObject *out = NULL;
+	Py_ssize_t n;
+	Py_ssize_t i;
+
+	if (options == Py_None) {
+		return PyTuple_New(0);
+	}
+
+	if (PyDict_Check(options)) {
+		items = PyDict_Items(options);
+		if (items == NULL) {
+			return NULL;
+		}
+		fast = PySequence_Fast(items, "options");
+		Py_DECREF(items);
+	} else {
+		fast = PySequence_Fast(options,
+		    "options must be a dict or a sequence of (key, value) pairs");
+	}
+	if (fast == NULL) {
+		return NULL;
+	}
+
+	n = PySequence_Fast_GET_SIZE(fast);
+	out = PyTuple_New(n);
+	if (out == NULL) {
+		goto err;
+	}
+
+	for (i = 0; i < n; i++) {
+		PyObject *pair;
+		PyObject *key;
+		PyObject *value;
+		PyObject *entry;
+
+		pair = PySequence_Fast_GET_ITEM(fast, i);
+		if (!PyTuple_Check(pair) || PyTuple_GET_SIZE(pair) != 2) {
+			PyErr_Format(PyExc_TypeError,
+			             "options[%zd] must be a (key, value) tuple",
+			             i);
+			goto err;
+		}
+		key = PyTuple_GET_ITEM(pair, 0);
+		value = PyTuple_GET_ITEM(pair, 1);
+		if (check_str(key, "options key", false) < 0) {
+			goto err;
+		}
+		if (value != Py_None && value != Py_True &&
+		    !PyUnicode_Check(value) && !PyBytes_Check(value) &&
+		    !(PyLong_Check(value) && !PyBool_Check(value))) {
+			PyErr_Format(PyExc_TypeError,
+			             "options[%R]: value must be None, True, str, "
+			             "bytes or an int fd", key);
+			goto err;
+		}
+		entry = PyTuple_Pack(2, key, value);
+		if (entry == NULL) {
+			goto err;
+		}
+		PyTuple_SET_ITEM(out, i, entry);
+	}
+
+	Py_DECREF(fast);
+	return out;
+
+err:
+	Py_XDECREF(out);
+	Py_DECREF(fast);
+	return NULL;
+}
+
+PyObject *do_create_mount_spec(PyObject *target, PyObject *fs_type,
+                               PyObject *source, PyObject *options,
+                               unsigned long long attr_set,
+                               unsigned long long attr_clr,
+                               unsigned long long propagation,
+                               int userns_fd, int recursive)
+{
+	truenas_os_state_t *state;
+	PyObject *opts = NULL;
+	PyObject *values[5] = { NULL };
+	PyObject *spec;
+	size_t i;
+
+	if (check_str(target, "target", false) < 0 ||
+	    check_str(fs_type, "fs_type", true) < 0 ||
+	    check_str(source, "source", true) < 0) {
+		return NULL;
+	}
+	if (userns_fd < -1) {
+		PyErr_SetString(PyExc_ValueError,
+		                "userns_fd must be a file descriptor or -1");
+		return NULL;
+	}
+
+	opts = normalize_options(options);
+	if (opts == NULL) {
+		return NULL;
+	}
+	if (fs_type == Py_None) {
+		if (source == Py_None) {
+			PyErr_SetString(PyExc_ValueError,
+			                "a bind mount (fs_type=None) needs a source");
+			goto err;
+		}
+		if (PyTuple_GET_SIZE(opts) != 0) {
+			PyErr_SetString(PyExc_ValueError,
+			                "options need an fs_type; a bind mount "
+			                "takes none");
+			goto err;
+		}
+	}
+
+	state = get_truenas_os_state(NULL);
+	if (state == NULL || state->MountSpecType == NULL) {
+		PyErr_SetString(PyExc_SystemError,
+		                "MountSpec type not initialized");
+		goto err;
+	}
+
+	values[0] = PyLong_FromUnsignedLongLong(attr_set);
+	values[1] = PyLong_FromUnsignedLongLong(attr_clr);
+	values[2] = PyLong_FromUnsignedLongLong(propagation);
+	values[3] = PyLong_FromLong(userns_fd);
+	values[4] = PyBool_FromLong(recursive);
+	for (i = 0; i < 5; i++) {
+		if (values[i] == NULL) {
+			goto err;
+		}
+	}
+
+	spec = PyStructSequence_New((PyTypeObject *)state->MountSpecType);
+	if (spec == NULL) {
+		goto err;
+	}
+
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_TARGET, Py_NewRef(target));
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_FS_TYPE, Py_NewRef(fs_type));
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_SOURCE, Py_NewRef(source));
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_OPTIONS, opts);
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_ATTR_SET, values[0]);
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_ATTR_CLR, values[1]);
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_PROPAGATION, values[2]);
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_USERNS_FD, values[3]);
+	PyStructSequence_SET_ITEM(spec, SPEC_FIELD_RECURSIVE, values[4]);
+
+	return spec;
+
+err:
+	for (i = 0; i < 5; i++) {
+		Py_XDECREF(values[i]);
+	}
+	Py_DECREF(opts);
+	return NULL;
+}
+
+
+/* ── Parse MountSpecs into C structs ─────────────────────────────────────── */
+
+static void free_specs(struct tree_spec *specs, size_t n)
+{
+	size_t i;
+
+	if (specs == NULL) {
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		PyMem_RawFree(specs[i].opts);
+	}
+	PyMem_RawFree(specs);
+}
+
+static int parse_opts(PyObject *opts, Py_ssize_t spec_idx,
+                      struct tree_spec *spec)
+{
+	Py_ssize_t n;
+	Py_ssize_t i;
+
+	n = PyTuple_GET_SIZE(opts);
+	if (n == 0) {
+		return 0;
+	}
+	spec->opts = PyMem_RawCalloc((size_t)n, sizeof(*spec->opts));
+	if (spec->opts == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+	spec->nopts = (size_t)n;
+
+	for (i = 0; i < n; i++) {
+		PyObject *pair = PyTuple_GET_ITEM(opts, i);
+		PyObject *value = PyTuple_GET_ITEM(pair, 1);
+		struct tree_opt *opt = &spec->opts[i];
+		long fd;
+
+		opt->key = PyUnicode_AsUTF8(PyTuple_GET_ITEM(pair, 0));
+		if (opt->key == NULL) {
+			return -1;
+		}
+
+		if (value == Py_None || value == Py_True) {
+			opt->cmd = FSCONFIG_SET_FLAG;
+		} else if (PyUnicode_Check(value)) {
+			opt->cmd = FSCONFIG_SET_STRING;
+			opt->value = PyUnicode_AsUTF8(value);
+			if (opt->value == NULL) {
+				return -1;
+			}
+		} else if (PyBytes_Check(value)) {
+			if (PyBytes_GET_SIZE(value) > INT_MAX) {
+				PyErr_Format(PyExc_ValueError,
+				             "specs[%zd].options[%s]: value too "
+				             "large", spec_idx, opt->key);
+				return -1;
+			}
+			opt->cmd = FSCONFIG_SET_BINARY;
+			opt->value = PyBytes_AS_STRING(value);
+			opt->aux = (int)PyBytes_GET_SIZE(value);
+		} else {
+			fd = PyLong_AsLong(value);
+			if (fd == -1 && PyErr_Occurred()) {
+				return -1;
+			}
+			if (fd < 0 || fd > INT_MAX) {
+				PyErr_Format(PyExc_ValueError,
+				             "specs[%zd].options[%s]: invalid fd",
+				             spec_idx, opt->key);
+				return -1;
+			}
+			opt->cmd = FSCONFIG_SET_FD;
+			opt->aux = (int)fd;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Parse `fast` (a sequence of MountSpec) into a C array, freed with
+ * free_specs().  The array borrows strings from the MountSpecs, so `fast`
+ * must outlive it.  Sets a Python exception and returns -1 on error.
+ */
+static int parse_specs(PyObject *fast, struct tree_spec **out, size_t *out_n)
+{
+	truenas_os_state_t *state;
+	PyTypeObject *spec_type;
+	struct tree_spec *specs = NULL;
+	Py_ssize_t n;
+	Py_ssize_t i;
+
+	*out = NULL;
+	*out_n = 0;
+
+	state = get_truenas_os_state(NULL);
+	if (state == NULL || state->MountSpecType == NULL) {
+		PyErr_SetString(PyExc_SystemError,
+		                "MountSpec type not initialized");
+		return -1;
+	}
+	spec_type = (PyTypeObject *)state->MountSpecType;
+
+	n = PySequence_Fast_GET_SIZE(fast);
+	if (n == 0) {
+		return 0;
+	}
+	specs = PyMem_RawCalloc((size_t)n, sizeof(*specs));
+	if (specs == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+		struct tree_spec *spec = &specs[i];
+		PyObject *p;
+		long userns_fd;
+
+		if (!PyObject_TypeCheck(item, spec_type)) {
+			PyErr_Format(PyExc_TypeError,
+			             "specs[%zd] must be a MountSpec "
+			             "(use truenas_os.create_mount_spec)", i);
+			goto err;
+		}
+
+		spec->target = PyUnicode_AsUTF8(
+		    PyStructSequence_GET_ITEM(item, SPEC_FIELD_TARGET));
+		if (spec->target == NULL) {
+			goto err;
+		}
+		p = PyStructSequence_GET_ITEM(item, SPEC_FIELD_FS_TYPE);
+		if (p != Py_None && (spec->fs_type = PyUnicode_AsUTF8(p)) == NULL) {
+			goto err;
+		}
+		p = PyStructSequence_GET_ITEM(item, SPEC_FIELD_SOURCE);
+		if (p != Py_None && (spec->source = PyUnicode_AsUTF8(p)) == NULL) {
+			goto err;
+		}
+
+		spec->attr.attr_set = PyLong_AsUnsignedLongLong(
+		    PyStructSequence_GET_ITEM(item, SPEC_FIELD_ATTR_SET));
+		spec->attr.attr_clr = PyLong_AsUnsignedLongLong(
+		    PyStructSequence_GET_ITEM(item, SPEC_FIELD_ATTR_CLR));
+		spec->attr.propagation = PyLong_AsUnsignedLongLong(
+		    PyStructSequence_GET_ITEM(item, SPEC_FIELD_PROPAGATION));
+		userns_fd = PyLong_AsLong(
+		    PyStructSequence_GET_ITEM(item, SPEC_FIELD_USERNS_FD));
+		if (PyErr_Occurred()) {
+			goto err;
+		}
+		if (userns_fd >= 0) {
+			spec->attr.attr_set |= MOUNT_ATTR_IDMAP;
+			spec->attr.userns_fd = (uint64_t)userns_fd;
+		}
+		spec->recursive = PyObject_IsTrue(
+		    PyStructSequence_GET_ITEM(item, SPEC_FIELD_RECURSIVE)) == 1;
+
+		if (parse_opts(PyStructSequence_GET_ITEM(item, SPEC_FIELD_OPTIONS),
+		               i, spec) < 0) {
+			goto err;
+		}
+	}
+
+	*out = specs;
+	*out_n = (size_t)n;
+	return 0;
+
+err:
+	free_specs(specs, (size_t)n);
+	return -1;
+}
+
+
+/* ── Build (GIL released) ────────────────────────────────────────────────── */
+
+static int sys_open_tree(int dirfd, const char *path, unsigned int flags)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_open_tree, dirfd, path, flags);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static int sys_fsopen(const char *fs_type)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_fsopen, fs_type, FSOPEN_CLOEXEC);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static int sys_fsconfig(int fs_fd, unsigned int cmd, const char *key,
+                        const void *value, int aux)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_fsconfig, fs_fd, cmd, key, value, aux);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static int sys_fsmount(int fs_fd)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_fsmount, fs_fd, FSMOUNT_CLOEXEC, 0);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static int sys_mount_setattr(int mnt_fd, unsigned int flags,
+                             const struct mount_attr *attr)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_mount_setattr, mnt_fd, "", flags,
+		              attr, MOUNT_ATTR_SIZE_VER0);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static int sys_move_mount(int from_fd, int to_dirfd, const char *to_path,
+                          unsigned int flags)
+{
+	int ret;
+
+	do {
+		ret = syscall(__NR_move_mount, from_fd, "", to_dirfd, to_path,
+		              flags);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+static void close_keep_errno(int fd)
+{
+	int saved = errno;
+
+	close(fd);
+	errno = saved;
+}
+
+/*
+ * Create the detached mount for `spec`: a fresh filesystem instance, or a
+ * clone of the bind source.  Returns the mount fd, or -1 with errno set and
+ * `stage` naming the failed step.
+ */
+static int spec_mount(const struct tree_spec *spec, size_t idx,
+                      char *stage, size_t stagelen)
+{
+	unsigned int flags;
+	int fs_fd;
+	int mnt_fd;
+	size_t i;
+
+	if (spec->fs_type == NULL) {
+		flags = OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC;
+		if (spec->recursive) {
+			flags |= AT_RECURSIVE;
+		}
+		snprintf(stage, stagelen, "specs[%zu]: open_tree(%s)",
+		         idx, spec->source);
+		return sys_open_tree(AT_FDCWD, spec->source, flags);
+	}
+
+	snprintf(stage, stagelen, "specs[%zu]: fsopen(%s)", idx, spec->fs_type);
+	fs_fd = sys_fsopen(spec->fs_type);
+	if (fs_fd == -1) {
+		return -1;
+	}
+
+	if (spec->source != NULL) {
+		snprintf(stage, stagelen, "specs[%zu]: fsconfig(source)", idx);
+		if (sys_fsconfig(fs_fd, FSCONFIG_SET_STRING, "source",
+		                 spec->source, 0) == -1) {
+			goto fail;
+		}
+	}
+	for (i = 0; i < spec->nopts; i++) {
+		const struct tree_opt *opt = &spec->opts[i];
+
+		snprintf(stage, stagelen, "specs[%zu]: fsconfig(%s)",
+		         idx, opt->key);
+		if (sys_fsconfig(fs_fd, opt->cmd, opt->key, opt->value,
+		                 opt->aux) == -1) {
+			goto fail;
+		}
+	}
+
+	snprintf(stage, stagelen, "specs[%zu]: fsconfig(create)", idx);
+	if (sys_fsconfig(fs_fd, FSCONFIG_CMD_CREATE, NULL, NULL, 0) == -1) {
+		goto fail;
+	}
+
+	snprintf(stage, stagelen, "specs[%zu]: fsmount", idx);
+	mnt_fd = sys_fsmount(fs_fd);
+	close_keep_errno(fs_fd);
+	return mnt_fd;
+
+fail:
+	close_keep_errno(fs_fd);
+	return -1;
+}
+
+/*
+ * Clone `root_fd`, attach every spec beneath the clone, then attach the
+ * clone at `to_dirfd` / `to_path` (or hand it back in *tree_fdp when
+ * `to_path` is NULL).  Returns 0, or -1 with errno set, `stage` naming the
+ * failed step, and nothing left mounted.
+ */
+static int build_tree(int root_fd, const struct tree_spec *specs, size_t n,
+                      int to_dirfd, const char *to_path, int *tree_fdp,
+                      char *stage, size_t stagelen)
+{
+	int tree_fd;
+	int mnt_fd = -1;
+	int target_fd = -1;
+	unsigned int flags;
+	size_t i;
+
+	snprintf(stage, stagelen, "open_tree(root_fd)");
+	tree_fd = sys_open_tree(root_fd, "", OPEN_TREE_CLONE |
+	                        OPEN_TREE_CLOEXEC | AT_EMPTY_PATH);
+	if (tree_fd == -1) {
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		const struct tree_spec *spec = &specs[i];
+
+		mnt_fd = spec_mount(spec, i, stage, stagelen);
+		if (mnt_fd == -1) {
+			goto fail;
+		}
+
+		if (spec->attr.attr_set != 0 || spec->attr.attr_clr != 0 ||
+		    spec->attr.propagation != 0) {
+			flags = AT_EMPTY_PATH;
+			if (spec->recursive) {
+				flags |= AT_RECURSIVE;
+			}
+			snprintf(stage, stagelen, "specs[%zu]: mount_setattr", i);
+			if (sys_mount_setattr(mnt_fd, flags, &spec->attr) == -1) {
+				goto fail;
+			}
+		}
+
+		/* Resolve the target as if the tree were "/", so absolute
+		 * symlinks inside a rootfs cannot lead out of it. */
+		snprintf(stage, stagelen, "specs[%zu]: openat2(%s)",
+		         i, spec->target);
+		do {
+			target_fd = openat2_impl(tree_fd, spec->target,
+			                         O_PATH | O_CLOEXEC,
+			                         RESOLVE_IN_ROOT |
+			                         RESOLVE_NO_MAGICLINKS);
+		} while (target_fd == -1 && (errno == EINTR || errno == EAGAIN));
+		if (target_fd == -1) {
+			goto fail;
+		}
+
+		snprintf(stage, stagelen, "specs[%zu]: move_mount(%s)",
+		         i, spec->target);
+		if (sys_move_mount(mnt_fd, target_fd, "",
+		                   MOVE_MOUNT_F_EMPTY_PATH |
+		                   MOVE_MOUNT_T_EMPTY_PATH) == -1) {
+			goto fail;
+		}
+
+		close(target_fd);
+		target_fd = -1;
+		close(mnt_fd);
+		mnt_fd = -1;
+	}
+
+	if (to_path != NULL) {
+		snprintf(stage, stagelen, "move_mount(%s)", to_path);
+		if (sys_move_mount(tree_fd, to_dirfd, to_path,
+		                   MOVE_MOUNT_F_EMPTY_PATH) == -1) {
+			goto fail;
+		}
+		close(tree_fd);
+		tree_fd = -1;
+	}
+
+	*tree_fdp = tree_fd;
+	return 0;
+
+fail:
+	if (target_fd != -1) {
+		close_keep_errno(target_fd);
+	}
+	if (mnt_fd != -1) {
+		close_keep_errno(mnt_fd);
+	}
+	/* Still detached: the last close unmounts everything attached so far. */
+	close_keep_errno(tree_fd);
+	return -1;
+}
+
+PyObject *do_mount_tree(int root_fd, PyObject *specs_seq,
+                        int to_dirfd, const char *to_path)
+{
+	PyObject *fast;
+	PyObject *result = NULL;
+	struct tree_spec *specs = NULL;
+	size_t n = 0;
+	char stage[PATH_MAX + 64];
+	int tree_fd = -1;
+	int rc;
+	int saved_errno;
+
+	fast = PySequence_Fast(specs_seq, "specs must be a sequence of MountSpec");
+	if (fast == NULL) {
+		return NULL;
+	}
+	if (parse_specs(fast, &specs, &n) < 0) {
+		goto out;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	rc = build_tree(root_fd, specs, n, to_dirfd, to_path, &tree_fd,
+	                stage, sizeof(stage));
+	saved_errno = errno;
+	Py_END_ALLOW_THREADS
+
+	if (rc < 0) {
+		errno = saved_errno;
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, stage);
+		goto out;
+	}
+
+	if (to_path != NULL) {
+		result = Py_NewRef(Py_None);
+	} else {
+		result = PyLong_FromLong(tree_fd);
+		if (result == NULL) {
+			close(tree_fd);
+		}
+	}
+
+out:
+	free_specs(specs, n);
+	Py_DECREF(fast);
+	return result;
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef _MOUNT_TREE_H_
+#define _MOUNT_TREE_H_
+
+extern int init_mount_tree_types(PyObject *module);
+extern PyObject *do_create_mount_spec(PyObject *target, PyObject *fs_type,
+                                      PyObject *source, PyObject *options,
+                                      unsigned long long attr_set,
+                                      unsigned long long attr_clr,
+                                      unsigned long long propagation,
+                                      int userns_fd, int recursive);
+/*
+ * Build a detached mount tree from a clone of `root_fd` and the MountSpecs
+ * in `specs_seq`.  Attaches it at `to_dirfd` / `to_path` and returns None,
+ * or returns the detached tree fd when `to_path` is NULL.
+ */
+extern PyObject *do_mount_tree(int root_fd, PyObject *specs_seq,
+                               int to_dirfd, const char *to_path);
+
+#endif /* _MOUNT_TREE_H_ */
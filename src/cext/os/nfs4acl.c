@@ -977,6 +977,173 @@ NFS4ACL_generate_inherited_acl(NFS4ACL_t *self, PyObject *args, PyObject *kwargs
 	return result;
 }
 
+/* ── structural comparison ───────────────────────────────────────────────── */
+
+/*
+ * acl_flags bits that affect ACL semantics.  ACL_IS_TRIVIAL and ACL_IS_DIR
+ * are ZFS bookkeeping set on read, so an ACL built with from_aces() still
+ * compares equal to the same ACL fetched back with fgetacl().
+ */
+#define NFS4_ACL_CMP_FLAGS (ACL_AUTO_INHERIT | ACL_PROTECTED | ACL_DEFAULTED)
+
+/*
+ * Flatten self->data into a canonicalised acl_ent_t array.  Runs of ACEs
+ * sharing an ACE type are order-independent (evaluation of consecutive
+ * ALLOW or consecutive DENY entries commutes), so each run is sorted;
+ * ordering across runs is preserved.  The principal key is
+ * (type, iflag, who, IDENTIFIER_GROUP) and the payload is (flags, mask).
+ *
+ * On success *ents_out must be released with PyMem_Free().
+ * Returns 0 on success, -1 on failure (Python ValueError set).
+ */
+static int
+nfs4acl_load_ents(NFS4ACL_t *self, acl_ent_t **ents_out, size_t *n_out,
+                  uint32_t *flags_out)
+{
+	const uint32_t *buf = NULL;
+	const uint32_t *p = NULL;
+	acl_ent_t *ents = NULL;
+	Py_ssize_t datasz;
+	uint32_t naces;
+	uint32_t i;
+	uint32_t run = 0;
+
+	datasz = PyBytes_GET_SIZE(self->data);
+	if (datasz < NFS4_HDR_SZ) {
+		/* bare NFS4ACL(b'') -- treat as an empty ACL, as len() does */
+		*ents_out = PyMem_Malloc(sizeof(acl_ent_t));
+		if (*ents_out == NULL) {
+			PyErr_NoMemory();
+			return -1;
+		}
+		*n_out = 0;
+		*flags_out = 0;
+		return 0;
+	}
+
+	buf = (const uint32_t *)PyBytes_AS_STRING(self->data);
+	naces = be32toh(buf[1]);
+	if ((Py_ssize_t)(NFS4_HDR_SZ + (size_t)naces * NFS4_ACE_SZ) > datasz) {
+		PyErr_SetString(PyExc_ValueError, "NFS4ACL data truncated");
+		return -1;
+	}
+
+	ents = PyMem_Malloc(((size_t)naces + 1) * sizeof(acl_ent_t));
+	if (ents == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	for (i = 0; i < naces; i++) {
+		uint32_t ace_type, ace_flags;
+
+		p = buf + NFS4_HDR_WORDS + (size_t)i * NFS4_ACE_WORDS;
+		ace_type = be32toh(p[0]);
+		ace_flags = be32toh(p[1]);
+		if (i > 0 && ace_type != ents[i - 1].key[0])
+			run++;
+
+		ents[i].key[0] = ace_type;
+		ents[i].key[1] = be32toh(p[2]);
+		ents[i].key[2] = be32toh(p[4]);
+		ents[i].key[3] = ace_flags & NFS4_ACE_IDENTIFIER_GROUP;
+		ents[i].val[0] = ace_flags;
+		ents[i].val[1] = be32toh(p[3]);
+		ents[i].run = run;
+		ents[i].idx = i;
+	}
+
+	acl_ents_canonicalize(ents, naces);
+	*ents_out = ents;
+	*n_out = naces;
+	*flags_out = be32toh(buf[0]) & NFS4_ACL_CMP_FLAGS;
+	return 0;
+}
+
+/* NFS4ACL.__eq__ / __ne__ */
+static PyObject *
+NFS4ACL_richcompare(PyObject *a, PyObject *b, int op)
+{
+	acl_ent_t *ea = NULL;
+	acl_ent_t *eb = NULL;
+	size_t na, nb;
+	uint32_t fa, fb;
+	int eq;
+
+	if ((op != Py_EQ && op != Py_NE) ||
+	    !PyObject_TypeCheck(b, &NFS4ACL_Type))
+		Py_RETURN_NOTIMPLEMENTED;
+
+	if (nfs4acl_load_ents((NFS4ACL_t *)a, &ea, &na, &fa) < 0)
+		return NULL;
+	if (nfs4acl_load_ents((NFS4ACL_t *)b, &eb, &nb, &fb) < 0) {
+		PyMem_Free(ea);
+		return NULL;
+	}
+
+	eq = (fa == fb) && acl_ents_equal(ea, na, eb, nb);
+	PyMem_Free(ea);
+	PyMem_Free(eb);
+	return PyBool_FromLong(op == Py_EQ ? eq : !eq);
+}
+
+/* NFS4ACL.__hash__ */
+static Py_hash_t
+NFS4ACL_hash(NFS4ACL_t *self)
+{
+	acl_ent_t *ents = NULL;
+	size_t n;
+	uint32_t flags;
+	Py_hash_t h;
+
+	if (nfs4acl_load_ents(self, &ents, &n, &flags) < 0)
+		return -1;
+	h = acl_ents_hash(flags, ents, n);
+	PyMem_Free(ents);
+	return h;
+}
+
+PyDoc_STRVAR(NFS4ACL_diff_doc,
+"diff(other)\n"
+"\n"
+"Compare this ACL against another NFS4ACL without decoding any ACEs.\n"
+"Returns an ACLDiff: added holds indexes into other.aces with no\n"
+"counterpart here, removed holds indexes into self.aces with no\n"
+"counterpart in other, and changed holds (self_index, other_index)\n"
+"pairs for ACEs with the same type and principal whose flags or\n"
+"access mask differ.  Reordering within a run of same-type ACEs is not\n"
+"a difference.  acl_flags_changed ignores ACL_IS_TRIVIAL and ACL_IS_DIR.\n"
+"\n"
+"Raises TypeError if other is not an NFS4ACL.");
+
+static PyObject *
+NFS4ACL_diff(NFS4ACL_t *self, PyObject *other)
+{
+	acl_ent_t *ea = NULL;
+	acl_ent_t *eb = NULL;
+	size_t na, nb;
+	uint32_t fa, fb;
+	PyObject *result = NULL;
+
+	if (!PyObject_TypeCheck(other, &NFS4ACL_Type)) {
+		PyErr_SetString(PyExc_TypeError,
+		                "diff: other must be an NFS4ACL");
+		return NULL;
+	}
+
+	if (nfs4acl_load_ents(self, &ea, &na, &fa) < 0)
+		return NULL;
+	if (nfs4acl_load_ents((NFS4ACL_t *)other, &eb, &nb, &fb) < 0) {
+		PyMem_Free(ea);
+		return NULL;
+	}
+
+	result = acl_ents_diff(ea, na, eb, nb, fa != fb);
+	PyMem_Free(ea);
+	PyMem_Free(eb);
+	return result;
+}
+
 static PyMethodDef NFS4ACL_methods[] = {
 	{ "from_aces",
 	  (PyCFunction)NFS4ACL_from_aces,
@@ -990,6 +1157,10 @@ static PyMethodDef NFS4ACL_methods[] = {
 	  (PyCFunction)NFS4ACL_generate_inherited_acl,
 	  METH_VARARGS | METH_KEYWORDS,
 	  NFS4ACL_generate_inherited_acl_doc },
+	{ "diff",
+	  (PyCFunction)NFS4ACL_diff,
+	  METH_O,
+	  NFS4ACL_diff_doc },
 	{ NULL }
 };
 
@@ -1002,7 +1173,8 @@ PyDoc_STRVAR(NFS4ACL_doc,
 "\n"
 "Constructed from raw big-endian XDR bytes or via from_aces().\n"
 "Attributes: acl_flags, aces.\n"
-"Supports bytes() and len().");
+"Supports bytes(), len(), ==, hash() and diff().  Equality ignores the\n"
+"order of ACEs within a run of same-type entries.");
 
 PyTypeObject NFS4ACL_Type = {
 	PyVarObject_HEAD_INIT(NULL, 0)
@@ -1011,6 +1183,8 @@ PyTypeObject NFS4ACL_Type = {
 	.tp_dealloc     = (destructor)NFS4ACL_dealloc,
 	.tp_repr        = (reprfunc)NFS4ACL_repr,
 	.tp_as_sequence = &NFS4ACL_as_seq,
+	.tp_hash        = (hashfunc)NFS4ACL_hash,
+	.tp_richcompare = NFS4ACL_richcompare,
 	.tp_flags       = Py_TPFLAGS_DEFAULT,
 	.tp_doc         = NFS4ACL_doc,
 	.tp_methods     = NFS4ACL_methods,
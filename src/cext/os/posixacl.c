@@ -702,6 +702,170 @@ POSIXACL_generate_inherited_acl(POSIXACL_t *self, PyObject *args, PyObject *kwar
 	                             self->default_data, new_default);
 }
 
+/* ── structural comparison ───────────────────────────────────────────────── */
+
+/* Append the ACEs of one raw POSIX blob to ents starting at *n. */
+static void
+posix_blob_to_ents(const uint8_t *buf, Py_ssize_t bufsz, int is_default,
+                   acl_ent_t *ents, size_t *n)
+{
+	Py_ssize_t naces;
+	Py_ssize_t i;
+	const uint8_t *p = NULL;
+
+	naces = (bufsz - POSIX_HDR_SZ) / POSIX_ACE_SZ;
+	for (i = 0; i < naces; i++) {
+		acl_ent_t *e = &ents[*n];
+
+		p = buf + POSIX_HDR_SZ + (size_t)i * POSIX_ACE_SZ;
+		e->key[0] = (uint32_t)is_default;
+		e->key[1] = read_le16(p + 0);
+		e->key[2] = read_le32(p + 4);
+		e->key[3] = 0;
+		e->val[0] = read_le16(p + 2);
+		e->val[1] = 0;
+		e->run = 0;
+		e->idx = (uint32_t)*n;
+		(*n)++;
+	}
+}
+
+/*
+ * Flatten access_data followed by default_data into a canonicalised
+ * acl_ent_t array.  POSIX.1e ACL evaluation does not depend on entry
+ * order, so all entries sort by (is_default, tag, id).  idx counts across
+ * aces + default_aces.  A missing default ACL and an empty one compare
+ * equal; the synthesized flag is not part of the comparison.
+ *
+ * On success *ents_out must be released with PyMem_Free().
+ * Returns 0 on success, -1 on failure (Python exception set).
+ */
+static int
+posixacl_load_ents(POSIXACL_t *self, acl_ent_t **ents_out, size_t *n_out)
+{
+	const uint8_t *abuf = NULL;
+	const uint8_t *dbuf = NULL;
+	Py_ssize_t asz;
+	Py_ssize_t dsz = 0;
+	size_t total;
+	size_t n = 0;
+	acl_ent_t *ents = NULL;
+
+	abuf = (const uint8_t *)PyBytes_AS_STRING(self->access_data);
+	asz = PyBytes_GET_SIZE(self->access_data);
+	if (self->default_data != Py_None) {
+		dbuf = (const uint8_t *)PyBytes_AS_STRING(self->default_data);
+		dsz = PyBytes_GET_SIZE(self->default_data);
+	}
+
+	if ((asz != 0 && asz < POSIX_HDR_SZ) || (dsz != 0 && dsz < POSIX_HDR_SZ)) {
+		PyErr_SetString(PyExc_ValueError, "POSIXACL data too short");
+		return -1;
+	}
+	if (asz == 0)
+		asz = POSIX_HDR_SZ;
+	if (dsz == 0)
+		dsz = POSIX_HDR_SZ;
+
+	total = (size_t)(asz - POSIX_HDR_SZ) / POSIX_ACE_SZ +
+	        (size_t)(dsz - POSIX_HDR_SZ) / POSIX_ACE_SZ;
+	ents = PyMem_Malloc((total + 1) * sizeof(acl_ent_t));
+	if (ents == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	posix_blob_to_ents(abuf, asz, 0, ents, &n);
+	if (dbuf != NULL)
+		posix_blob_to_ents(dbuf, dsz, 1, ents, &n);
+
+	acl_ents_canonicalize(ents, n);
+	*ents_out = ents;
+	*n_out = n;
+	return 0;
+}
+
+/* POSIXACL.__eq__ / __ne__ */
+static PyObject *
+POSIXACL_richcompare(PyObject *a, PyObject *b, int op)
+{
+	acl_ent_t *ea = NULL;
+	acl_ent_t *eb = NULL;
+	size_t na, nb;
+	int eq;
+
+	if ((op != Py_EQ && op != Py_NE) ||
+	    !PyObject_TypeCheck(b, &POSIXACL_Type))
+		Py_RETURN_NOTIMPLEMENTED;
+
+	if (posixacl_load_ents((POSIXACL_t *)a, &ea, &na) < 0)
+		return NULL;
+	if (posixacl_load_ents((POSIXACL_t *)b, &eb, &nb) < 0) {
+		PyMem_Free(ea);
+		return NULL;
+	}
+
+	eq = acl_ents_equal(ea, na, eb, nb);
+	PyMem_Free(ea);
+	PyMem_Free(eb);
+	return PyBool_FromLong(op == Py_EQ ? eq : !eq);
+}
+
+/* POSIXACL.__hash__ */
+static Py_hash_t
+POSIXACL_hash(POSIXACL_t *self)
+{
+	acl_ent_t *ents = NULL;
+	size_t n;
+	Py_hash_t h;
+
+	if (posixacl_load_ents(self, &ents, &n) < 0)
+		return -1;
+	h = acl_ents_hash(POSIX_ACL_VERSION, ents, n);
+	PyMem_Free(ents);
+	return h;
+}
+
+PyDoc_STRVAR(POSIXACL_diff_doc,
+"diff(other)\n"
+"\n"
+"Compare this ACL against another POSIXACL without decoding any ACEs.\n"
+"Returns an ACLDiff whose indexes refer to aces + default_aces: added\n"
+"holds indexes into other with no counterpart here, removed holds\n"
+"indexes into self with no counterpart in other, and changed holds\n"
+"(self_index, other_index) pairs for entries with the same tag, id and\n"
+"default flag whose permissions differ.  Entry order is not significant\n"
+"for POSIX ACLs, so reordered and acl_flags_changed are always False.\n"
+"\n"
+"Raises TypeError if other is not a POSIXACL.");
+
+static PyObject *
+POSIXACL_diff(POSIXACL_t *self, PyObject *other)
+{
+	acl_ent_t *ea = NULL;
+	acl_ent_t *eb = NULL;
+	size_t na, nb;
+	PyObject *result = NULL;
+
+	if (!PyObject_TypeCheck(other, &POSIXACL_Type)) {
+		PyErr_SetString(PyExc_TypeError,
+		                "diff: other must be a POSIXACL");
+		return NULL;
+	}
+
+	if (posixacl_load_ents(self, &ea, &na) < 0)
+		return NULL;
+	if (posixacl_load_ents((POSIXACL_t *)other, &eb, &nb) < 0) {
+		PyMem_Free(ea);
+		return NULL;
+	}
+
+	result = acl_ents_diff(ea, na, eb, nb, 0);
+	PyMem_Free(ea);
+	PyMem_Free(eb);
+	return result;
+}
+
 static PyMethodDef POSIXACL_methods[] = {
 	{ "from_aces",
 	  (PyCFunction)POSIXACL_from_aces,
@@ -719,6 +883,10 @@ static PyMethodDef POSIXACL_methods[] = {
 	  (PyCFunction)POSIXACL_generate_inherited_acl,
 	  METH_VARARGS | METH_KEYWORDS,
 	  POSIXACL_generate_inherited_acl_doc },
+	{ "diff",
+	  (PyCFunction)POSIXACL_diff,
+	  METH_O,
+	  POSIXACL_diff_doc },
 	{ NULL }
 };
 
@@ -727,20 +895,23 @@ PyDoc_STRVAR(POSIXACL_doc,
 "\n"
 "Constructed from raw little-endian xattr bytes or via from_aces().\n"
 "Attributes: aces, default_aces.\n"
-"Methods: access_bytes(), default_bytes().");
+"Methods: access_bytes(), default_bytes(), diff().\n"
+"Supports == and hash(); entry order and the synthesized flag are ignored.");
 
 PyTypeObject POSIXACL_Type = {
 	PyVarObject_HEAD_INIT(NULL, 0)
-	.tp_name      = "truenas_os.POSIXACL",
-	.tp_basicsize = sizeof(POSIXACL_t),
-	.tp_dealloc   = (destructor)POSIXACL_dealloc,
-	.tp_repr      = (reprfunc)POSIXACL_repr,
-	.tp_flags     = Py_TPFLAGS_DEFAULT,
-	.tp_doc       = POSIXACL_doc,
-	.tp_methods   = POSIXACL_methods,
-	.tp_getset    = POSIXACL_getsets,
-	.tp_new       = POSIXACL_new,
-	.tp_init      = (initproc)POSIXACL_init,
+	.tp_name        = "truenas_os.POSIXACL",
+	.tp_basicsize   = sizeof(POSIXACL_t),
+	.tp_dealloc     = (destructor)POSIXACL_dealloc,
+	.tp_repr        = (reprfunc)POSIXACL_repr,
+	.tp_hash        = (hashfunc)POSIXACL_hash,
+	.tp_richcompare = POSIXACL_richcompare,
+	.tp_flags       = Py_TPFLAGS_DEFAULT,
+	.tp_doc         = POSIXACL_doc,
+	.tp_methods     = POSIXACL_methods,
+	.tp_getset      = POSIXACL_getsets,
+	.tp_new         = POSIXACL_new,
+	.tp_init        = (initproc)POSIXACL_init,
 };
 
 /* ── public helpers used by truenas_os.c ─────────────────────────────────── */
@@ -3,6 +3,7 @@
 #include <Python.h>
 #include "common/includes.h"
 #include "renameat2.h"
+#include "truenas_os_state.h"
 #include <unistd.h>
 #include <errno.h>
 
@@ -41,6 +42,298 @@ PyObject *do_renameat2(int olddirfd, const char *oldpath,
 	Py_RETURN_NONE;
 }
 
+/* ── RenameFailure PyStructSequence type ────────────────────────────────── */
+
+static PyStructSequence_Field rename_failure_fields[] = {
+	{"index", "Position of the failed operation in the input sequence"},
+	{"src", "Source name of the failed operation, as passed in"},
+	{"dst", "Destination name of the failed operation, as passed in"},
+	{"errnum", "errno value from the failing renameat2(2)"},
+	{NULL}
+};
+
+static PyStructSequence_Desc rename_failure_desc = {
+	.name = "truenas_os.RenameFailure",
+	.doc = "A single operation from renameat2_batch() that failed.",
+	.fields = rename_failure_fields,
+	.n_in_sequence = 4,
+};
+
+struct rename_op {
+	int src_dirfd;
+	int dst_dirfd;
+	unsigned int flags;
+	PyObject *src_obj;	/* caller's name object, echoed in failures */
+	PyObject *dst_obj;
+	PyObject *src_bytes;	/* fs-encoded names backing src/dst below */
+	PyObject *dst_bytes;
+	const char *src;
+	const char *dst;
+};
+
+struct rename_failure_rec {
+	size_t idx;
+	int err;
+};
+
+/*
+ * Caller must hold the GIL: this drops Python references per entry.
+ */
+static void free_rename_ops(struct rename_op *ops, size_t n)
+{
+	size_t i;
+
+	if (ops == NULL) {
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		Py_XDECREF(ops[i].src_obj);
+		Py_XDECREF(ops[i].dst_obj);
+		Py_XDECREF(ops[i].src_bytes);
+		Py_XDECREF(ops[i].dst_bytes);
+	}
+	PyMem_RawFree(ops);
+}
+
+/*
+ * Parse `seq` as a sequence of (src_dirfd, src, dst_dirfd, dst, flags)
+ * tuples into a C array.  Every name is converted through the filesystem
+ * encoding up front so the rename loop can run without the GIL.  The array
+ * must be freed with free_rename_ops() by the caller.  Sets a Python
+ * exception and returns -1 on error.
+ */
+static int parse_rename_ops(PyObject *seq, struct rename_op **out,
+                            size_t *out_n)
+{
+	PyObject *fast = NULL;
+	struct rename_op *arr = NULL;
+	Py_ssize_t n;
+	Py_ssize_t i;
+
+	*out = NULL;
+	*out_n = 0;
+
+	fast = PySequence_Fast(seq, "ops: expected a sequence");
+	if (fast == NULL) {
+		return -1;
+	}
+
+	n = PySequence_Fast_GET_SIZE(fast);
+	if (n == 0) {
+		Py_DECREF(fast);
+		return 0;
+	}
+
+	arr = PyMem_RawCalloc((size_t)n, sizeof(*arr));
+	if (arr == NULL) {
+		Py_DECREF(fast);
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+		PyObject *src_obj;
+		PyObject *dst_obj;
+		int src_dirfd;
+		int dst_dirfd;
+		unsigned int flags;
+
+		if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 5) {
+			PyErr_Format(PyExc_TypeError,
+			             "ops[%zd] must be a tuple of "
+			             "(src_dir_fd, src, dst_dir_fd, dst, flags)", i);
+			goto err;
+		}
+		if (!PyArg_ParseTuple(item, "iOiOI:renameat2_batch",
+		                      &src_dirfd, &src_obj,
+		                      &dst_dirfd, &dst_obj, &flags)) {
+			goto err;
+		}
+
+		arr[i].src_dirfd = src_dirfd;
+		arr[i].dst_dirfd = dst_dirfd;
+		arr[i].flags = flags;
+		arr[i].src_obj = Py_NewRef(src_obj);
+		arr[i].dst_obj = Py_NewRef(dst_obj);
+
+		if (!PyUnicode_FSConverter(src_obj, &arr[i].src_bytes) ||
+		    !PyUnicode_FSConverter(dst_obj, &arr[i].dst_bytes)) {
+			goto err;
+		}
+		arr[i].src = PyBytes_AS_STRING(arr[i].src_bytes);
+		arr[i].dst = PyBytes_AS_STRING(arr[i].dst_bytes);
+	}
+
+	Py_DECREF(fast);
+	*out = arr;
+	*out_n = (size_t)n;
+	return 0;
+
+err:
+	free_rename_ops(arr, (size_t)i + 1);
+	Py_DECREF(fast);
+	return -1;
+}
+
+/*
+ * Run every rename in `ops`, recording failures into `recs` (sized for
+ * n_ops entries).  Returns the number of failure records written.  EINTR
+ * is retried in place since signals cannot be checked without the GIL.
+ *
+ * Safe to call from within Py_BEGIN_ALLOW_THREADS — no Python state touched.
+ */
+static size_t run_rename_ops(const struct rename_op *ops, size_t n_ops,
+                             int stop_on_error,
+                             struct rename_failure_rec *recs)
+{
+	size_t i;
+	size_t n_recs = 0;
+
+	for (i = 0; i < n_ops; i++) {
+		int ret;
+
+		do {
+			ret = renameat2(ops[i].src_dirfd, ops[i].src,
+			                ops[i].dst_dirfd, ops[i].dst,
+			                ops[i].flags);
+		} while (ret == -1 && errno == EINTR);
+
+		if (ret == 0) {
+			continue;
+		}
+
+		recs[n_recs].idx = i;
+		recs[n_recs].err = errno;
+		n_recs++;
+		if (stop_on_error) {
+			break;
+		}
+	}
+
+	return n_recs;
+}
+
+/*
+ * Convert failure records into a Python list[RenameFailure].  Returns a new
+ * reference on success, or NULL with a Python exception set on error.
+ */
+static PyObject *build_rename_failure_list(const struct rename_failure_rec *recs,
+                                           size_t n_recs,
+                                           const struct rename_op *ops,
+                                           PyTypeObject *failure_type)
+{
+	PyObject *result;
+	size_t i;
+
+	result = PyList_New(0);
+	if (result == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < n_recs; i++) {
+		const struct rename_op *op = &ops[recs[i].idx];
+		PyObject *entry;
+		PyObject *idx_obj;
+		PyObject *err_obj;
+
+		idx_obj = PyLong_FromSize_t(recs[i].idx);
+		err_obj = PyLong_FromLong(recs[i].err);
+		if (idx_obj == NULL || err_obj == NULL) {
+			Py_XDECREF(idx_obj);
+			Py_XDECREF(err_obj);
+			Py_DECREF(result);
+			return NULL;
+		}
+
+		entry = PyStructSequence_New(failure_type);
+		if (entry == NULL) {
+			Py_DECREF(idx_obj);
+			Py_DECREF(err_obj);
+			Py_DECREF(result);
+			return NULL;
+		}
+		PyStructSequence_SET_ITEM(entry, 0, idx_obj);
+		PyStructSequence_SET_ITEM(entry, 1, Py_NewRef(op->src_obj));
+		PyStructSequence_SET_ITEM(entry, 2, Py_NewRef(op->dst_obj));
+		PyStructSequence_SET_ITEM(entry, 3, err_obj);
+
+		if (PyList_Append(result, entry) < 0) {
+			Py_DECREF(entry);
+			Py_DECREF(result);
+			return NULL;
+		}
+		Py_DECREF(entry);
+	}
+
+	return result;
+}
+
+PyObject *do_renameat2_batch(PyObject *ops_seq, int stop_on_error)
+{
+	struct rename_op *ops = NULL;
+	size_t n_ops = 0;
+	struct rename_failure_rec *recs = NULL;
+	size_t n_recs = 0;
+	truenas_os_state_t *state;
+	PyObject *result = NULL;
+
+	state = get_truenas_os_state(NULL);
+	if (state == NULL || state->RenameFailureType == NULL) {
+		PyErr_SetString(PyExc_SystemError,
+		                "RenameFailure type not initialized");
+		return NULL;
+	}
+
+	if (parse_rename_ops(ops_seq, &ops, &n_ops) < 0) {
+		return NULL;
+	}
+
+	if (n_ops == 0) {
+		return PyList_New(0);
+	}
+
+	recs = PyMem_RawCalloc(n_ops, sizeof(*recs));
+	if (recs == NULL) {
+		PyErr_NoMemory();
+		goto cleanup;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	n_recs = run_rename_ops(ops, n_ops, stop_on_error, recs);
+	Py_END_ALLOW_THREADS
+
+	result = build_rename_failure_list(recs, n_recs, ops,
+	                                   (PyTypeObject *)state->RenameFailureType);
+
+cleanup:
+	free_rename_ops(ops, n_ops);
+	PyMem_RawFree(recs);
+	return result;
+}
+
+int init_renameat2_types(PyObject *module)
+{
+	truenas_os_state_t *state;
+
+	state = get_truenas_os_state(module);
+	if (state == NULL) {
+		return -1;
+	}
+
+	state->RenameFailureType =
+	    (PyObject *)PyStructSequence_NewType(&rename_failure_desc);
+	if (state->RenameFailureType == NULL) {
+		return -1;
+	}
+	if (PyModule_AddObjectRef(module, "RenameFailure",
+	                          state->RenameFailureType) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
 int init_renameat2_constants(PyObject *module)
 {
 	// Add AT_RENAME_* constants
@@ -6,6 +6,8 @@
 PyObject *do_renameat2(int olddirfd, const char *oldpath,
                        int newdirfd, const char *newpath,
                        unsigned int flags);
+PyObject *do_renameat2_batch(PyObject *ops_seq, int stop_on_error);
 int init_renameat2_constants(PyObject *module);
+int init_renameat2_types(PyObject *module);
 
 #endif /* _RENAMEAT2_H_ */
@@ -12,6 +12,7 @@
 #include "move_mount.h"
 #include "mount_setattr.h"
 #include "fsmount.h"
+#include "mount_tree.h"
 #include "umount2.h"
 #include "userns.h"
 #include "fsiter.h"
@@ -20,6 +21,8 @@
 #include "acl.h"
 #include "acl_check.h"
 #include "xattr.h"
+#include "checksum.h"
+#include "fcopy.h"
 
 #define MODULE_DOC "TrueNAS OS module"
 
@@ -702,6 +705,155 @@ static PyObject *py_fsmount(PyObject *obj,
 	return do_fsmount(fs_fd, flags, attr_flags);
 }
 
+PyDoc_STRVAR(py_create_mount_spec__doc__,
+"create_mount_spec(target, /, *, fs_type=None, source=None, options=None,\n"
+"                  attr_set=0, attr_clr=0, propagation=0, userns_fd=-1,\n"
+"                  recursive=False)\n"
+"--\n\n"
+"Construct a validated MountSpec for use with mount_tree().\n\n"
+"With fs_type, the mount is a new filesystem instance: fsopen(fs_type),\n"
+"fsconfig 'source' (if given), then each option in order.  Without it,\n"
+"the mount is a bind clone of the path `source` (open_tree(2) with\n"
+"OPEN_TREE_CLONE) and options are not allowed.\n\n"
+"Parameters\n"
+"----------\n"
+"target : str\n"
+"    Mount point, resolved relative to the tree root as if it were \"/\"\n"
+"    (RESOLVE_IN_ROOT).  Must already exist.\n"
+"fs_type : str, optional\n"
+"    Filesystem type, e.g. 'tmpfs', 'proc', 'overlay'.\n"
+"source : str, optional\n"
+"    fsconfig 'source' value, or the path to bind when fs_type is None.\n"
+"options : dict or Sequence[tuple[str, value]], optional\n"
+"    fsconfig(2) parameters.  None or True sets a flag, str a string,\n"
+"    bytes a binary blob, and int a file descriptor.\n"
+"attr_set, attr_clr : int, optional\n"
+"    MOUNT_ATTR_* flags to set / clear with mount_setattr(2).\n"
+"propagation : int, optional\n"
+"    MS_SHARED, MS_SLAVE, MS_PRIVATE or MS_UNBINDABLE; 0 leaves it.\n"
+"userns_fd : int, optional\n"
+"    User namespace fd; makes the mount idmapped (MOUNT_ATTR_IDMAP).\n"
+"recursive : bool, optional\n"
+"    Bind the source's submounts too, and apply attributes recursively.\n\n"
+"Returns\n"
+"-------\n"
+"MountSpec\n"
+);
+
+static PyObject *py_create_mount_spec(PyObject *obj,
+                                      PyObject *args,
+                                      PyObject *kwargs)
+{
+	PyObject *target = NULL;
+	PyObject *fs_type = Py_None;
+	PyObject *source = Py_None;
+	PyObject *options = Py_None;
+	unsigned long long attr_set = 0;
+	unsigned long long attr_clr = 0;
+	unsigned long long propagation = 0;
+	int userns_fd = -1;
+	int recursive = 0;
+	const char *kwnames[] = { "", "fs_type", "source", "options",
+	                          "attr_set", "attr_clr", "propagation",
+	                          "userns_fd", "recursive", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+	                                 "O|$OOOKKKip:create_mount_spec",
+	                                 discard_const_p(char *, kwnames),
+	                                 &target, &fs_type, &source, &options,
+	                                 &attr_set, &attr_clr, &propagation,
+	                                 &userns_fd, &recursive)) {
+		return NULL;
+	}
+
+	return do_create_mount_spec(target, fs_type, source, options,
+	                            attr_set, attr_clr, propagation,
+	                            userns_fd, recursive);
+}
+
+PyDoc_STRVAR(py_mount_tree__doc__,
+"mount_tree(*, root_fd, specs, to_path=None, to_dirfd=AT_FDCWD)\n"
+"--\n\n"
+"Assemble a mount tree and attach it with a single move_mount().\n\n"
+"The tree root is a clone (open_tree(2) with OPEN_TREE_CLONE) of the\n"
+"mount or directory `root_fd` refers to.  Each MountSpec, in order, is\n"
+"created, given its attributes with mount_setattr(2), and attached at its\n"
+"target beneath the still-detached root, so a later spec may mount on a\n"
+"directory provided by an earlier one.  The whole build runs with the GIL\n"
+"released.\n\n"
+"Nothing is visible in the caller's mount namespace until the final\n"
+"move_mount().  If any step fails the detached tree is closed, which\n"
+"unmounts every mount created so far, and OSError is raised with the\n"
+"failed step (e.g. 'specs[2]: fsconfig(size)') as its filename.\n\n"
+"Mounting onto a detached tree requires Linux 6.15 or newer.  All\n"
+"parameters are keyword-only.\n\n"
+"Parameters\n"
+"----------\n"
+"root_fd : int\n"
+"    Mount or directory to clone as the tree root.\n"
+"specs : Sequence[MountSpec]\n"
+"    Mounts to create, from truenas_os.create_mount_spec().\n"
+"to_path : str, optional\n"
+"    Where to attach the tree, relative to to_dirfd.  When None, the tree\n"
+"    is left detached and its fd returned.\n"
+"to_dirfd : int, optional\n"
+"    Directory fd for a relative to_path, default=AT_FDCWD.\n\n"
+"Returns\n"
+"-------\n"
+"None or int\n"
+"    None once attached; the detached tree fd (O_CLOEXEC) when to_path\n"
+"    is None.  Closing that fd before attaching it unmounts the tree.\n\n"
+"Raises\n"
+"------\n"
+"OSError\n"
+"    If any step fails; nothing is left mounted.\n"
+"TypeError\n"
+"    If an element of specs is not a MountSpec.\n\n"
+"Examples\n"
+"--------\n"
+">>> import truenas_os, os\n"
+">>> root = os.open('/mnt/tank/apps/rootfs', os.O_PATH | os.O_DIRECTORY)\n"
+">>> truenas_os.mount_tree(root_fd=root, to_path='/run/app/root', specs=[\n"
+"...     truenas_os.create_mount_spec('proc', fs_type='proc'),\n"
+"...     truenas_os.create_mount_spec('tmp', fs_type='tmpfs',\n"
+"...                                  options={'size': '64M'}),\n"
+"...     truenas_os.create_mount_spec('data', source='/mnt/tank/data',\n"
+"...                                  attr_set=truenas_os.MOUNT_ATTR_RDONLY),\n"
+"... ])\n"
+);
+
+static PyObject *py_mount_tree(PyObject *obj,
+                               PyObject *args,
+                               PyObject *kwargs)
+{
+	int root_fd = -1;
+	PyObject *specs = NULL;
+	const char *to_path = NULL;
+	int to_dirfd = AT_FDCWD;
+	const char *kwnames[] = { "root_fd", "specs", "to_path", "to_dirfd",
+	                          NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$iOzi:mount_tree",
+	                                 discard_const_p(char *, kwnames),
+	                                 &root_fd, &specs, &to_path,
+	                                 &to_dirfd)) {
+		return NULL;
+	}
+
+	if (root_fd < 0) {
+		PyErr_SetString(PyExc_TypeError,
+		                "mount_tree() missing required keyword-only argument: 'root_fd'");
+		return NULL;
+	}
+	if (specs == NULL) {
+		PyErr_SetString(PyExc_TypeError,
+		                "mount_tree() missing required keyword-only argument: 'specs'");
+		return NULL;
+	}
+
+	return do_mount_tree(root_fd, specs, to_dirfd, to_path);
+}
+
 PyDoc_STRVAR(py_umount2__doc__,
 "umount2(*, target, flags=0)\n"
 "--\n\n"
@@ -896,6 +1048,53 @@ static PyObject *py_renameat2(PyObject *obj,
 	return do_renameat2(olddirfd, oldpath, newdirfd, newpath, flags);
 }
 
+PyDoc_STRVAR(py_renameat2_batch__doc__,
+"renameat2_batch(ops, *, stop_on_error=False)\n"
+"--\n\n"
+"Perform many renameat2() operations in a single call.\n\n"
+"Each operation is a (src_dir_fd, src, dst_dir_fd, dst, flags) tuple with\n"
+"the same meaning as the corresponding renameat2() arguments; flags are\n"
+"honoured per operation, so AT_RENAME_NOREPLACE and AT_RENAME_EXCHANGE may\n"
+"be mixed freely.  All names are converted up front and the renames then\n"
+"run in order in one loop with the GIL released.  Failures do not raise;\n"
+"they are returned as RenameFailure records.\n\n"
+"Parameters\n"
+"----------\n"
+"ops : Sequence[tuple[int, str | bytes, int, str | bytes, int]]\n"
+"    Rename operations to perform, in order.  Use AT_FDCWD as the dir fd\n"
+"    for paths relative to the current directory.\n"
+"stop_on_error : bool, keyword-only, optional, default=False\n"
+"    When True, stop after the first failing operation; every operation\n"
+"    before it succeeded and none after it was attempted.\n\n"
+"Returns\n"
+"-------\n"
+"list of RenameFailure\n"
+"    One RenameFailure (index, src, dst, errnum) per failed operation.\n"
+"    Empty list means every operation succeeded.\n\n"
+"Raises\n"
+"------\n"
+"TypeError\n"
+"    If ops is not a sequence of 5-tuples of the expected types.  No\n"
+"    rename is attempted in that case.\n"
+);
+
+static PyObject *py_renameat2_batch(PyObject *obj,
+                                     PyObject *args,
+                                     PyObject *kwargs)
+{
+	PyObject *ops;
+	int stop_on_error = 0;
+	const char *kwnames[] = { "ops", "stop_on_error", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|$p:renameat2_batch",
+	                                 discard_const_p(char *, kwnames),
+	                                 &ops, &stop_on_error)) {
+		return NULL;
+	}
+
+	return do_renameat2_batch(ops, stop_on_error);
+}
+
 static PyObject *py_create_idmap_mapping(PyObject *obj,
                                           PyObject *args)
 {
@@ -1046,7 +1245,8 @@ PyDoc_STRVAR(py_iter_filesystem_contents__doc__,
 "                         file_open_flags=0, reporting_increment=1000,\n"
 "                         reporting_callback=None, reporting_private_data=None,\n"
 "                         dir_stack=None, include_symlinks=False,\n"
-"                         include_mountpoints=False)\n"
+"                         include_mountpoints=False, inode_order=False,\n"
+"                         max_open_dirs=0)\n"
 "--\n\n"
 "Iterate over all files and directories in a filesystem.\n"
 "Provides secure iteration using openat2 and statx, preventing symlink attacks\n"
@@ -1101,6 +1301,55 @@ PyDoc_STRVAR(py_iter_filesystem_contents__doc__,
 "    descends into these entries regardless of skip() state — its\n"
 "    single-filesystem guarantee is preserved.  When False (default),\n"
 "    child mountpoints are silently skipped.\n"
+"inode_order : bool, keyword-only, optional, default=False\n"
+"    When True, each directory is read in full before any of its entries\n"
+"    is opened, and entries are processed in ascending inode order (ties\n"
+"    broken by name) rather than readdir order.  On HDD and large-dnode\n"
+"    ZFS pools this turns cold-cache metadata reads mostly sequential,\n"
+"    and yields a deterministic order for a given directory state.  Costs\n"
+"    a buffer of the directory's names per directory on the stack.\n"
+"max_open_dirs : int, keyword-only, optional, default=0\n"
+"    Upper bound on the directory streams the iterator keeps open, one per\n"
+"    level of the directory stack by default (up to 2048).  When a descent\n"
+"    would exceed it, the shallowest open ancestor other than the root is\n"
+"    closed after recording its read position and a file handle, and is\n"
+"    reopened (open_by_handle_at(2), or by path relative to an open\n"
+"    ancestor without CAP_DAC_READ_SEARCH) and repositioned when the walk\n"
+"    returns to it.  Fd usage then stays constant however deep the tree.\n"
+"    OSError is raised if a reopened directory is no longer the same inode.\n"
+"    0 (default) is unlimited; otherwise it must be at least 2.\n"
+"Returns\n"
+"-------\n"
+"iterator : FilesystemIterator\n"
+"    Iterator yielding IterInstance objects for each file and directory\n"
+);
+
+PyDoc_STRVAR(py_iter_filesystem_contents_fd__doc__,
+"iter_filesystem_contents_fd(dirfd, /, *, path=None, btime_cutoff=0,\n"
+"                            file_open_flags=0, reporting_increment=1000,\n"
+"                            reporting_callback=None,\n"
+"                            reporting_private_data=None, dir_stack=None,\n"
+"                            include_symlinks=False,\n"
+"                            include_mountpoints=False, inode_order=False,\n"
+"                            max_open_dirs=0)\n"
+"--\n\n"
+"Iterate over a directory tree starting from an open directory fd.\n"
+"Behaves like iter_filesystem_contents() but skips its mountpoint and\n"
+"filesystem-name validation: no path is resolved and no statmount is\n"
+"issued.  The walk is confined to the mount dirfd is on.\n"
+"Parameters\n"
+"----------\n"
+"dirfd : int\n"
+"    Open directory fd (O_PATH is sufficient).  Borrowed: the iterator\n"
+"    reopens it and the caller may close it once this returns\n"
+"path : str, optional\n"
+"    Path reported for dirfd itself; IterInstance.parent and dir_stack()\n"
+"    paths are built on it.  If None, those paths are relative to dirfd\n"
+"    (entries directly in dirfd have parent '')\n"
+"btime_cutoff, file_open_flags, reporting_increment, reporting_callback,\n"
+"reporting_private_data, dir_stack, include_symlinks, include_mountpoints,\n"
+"inode_order, max_open_dirs\n"
+"    As for iter_filesystem_contents()\n"
 "Returns\n"
 "-------\n"
 "iterator : FilesystemIterator\n"
@@ -1108,7 +1357,7 @@ PyDoc_STRVAR(py_iter_filesystem_contents__doc__,
 );
 
 PyDoc_STRVAR(py_fgetacl__doc__,
-"fgetacl(fd)\n"
+"fgetacl(fd, *, mnt_id=0)\n"
 "--\n\n"
 "Get the ACL on an open file descriptor.\n\n"
 "Probes the filesystem by attempting to read the NFS4 xattr\n"
@@ -1116,10 +1365,16 @@ PyDoc_STRVAR(py_fgetacl__doc__,
 "NFS4ACL object is returned.  Otherwise the POSIX ACL xattrs\n"
 "(system.posix_acl_access / system.posix_acl_default) are read and a\n"
 "POSIXACL object is returned.\n\n"
+"When mnt_id is given the ACL flavour detected for that mount is cached,\n"
+"and later calls with the same mnt_id skip the probe on POSIX mounts.\n"
+"See invalidate_acl_cache().\n\n"
 "Parameters\n"
 "----------\n"
 "fd : int\n"
-"    Open file descriptor\n\n"
+"    Open file descriptor\n"
+"mnt_id : int, optional\n"
+"    Mount id of fd (StatxResult.stx_mnt_id) keying the ACL flavour\n"
+"    cache; 0 (the default) bypasses the cache\n\n"
 "Returns\n"
 "-------\n"
 "NFS4ACL or POSIXACL\n\n"
@@ -1131,16 +1386,20 @@ PyDoc_STRVAR(py_fgetacl__doc__,
 );
 
 static PyObject *
-py_fgetacl(PyObject *obj, PyObject *args)
+py_fgetacl(PyObject *obj, PyObject *args, PyObject *kwargs)
 {
 	int fd;
+	uint64_t mnt_id = 0;
 	acl_xattr_t acl;
 	PyObject *result = NULL;
+	const char *kwnames[] = { "fd", "mnt_id", NULL };
 
-	if (!PyArg_ParseTuple(args, "i:fgetacl", &fd))
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|$K:fgetacl",
+					 discard_const_p(char *, kwnames),
+					 &fd, &mnt_id))
 		return NULL;
 
-	if (do_fgetacl(fd, &acl) < 0)
+	if (do_fgetacl(fd, mnt_id, &acl) < 0)
 		return NULL;
 
 	if (acl.type == ACLTYPE_NFS4) {
@@ -1175,7 +1434,7 @@ py_fgetacl(PyObject *obj, PyObject *args)
 }
 
 PyDoc_STRVAR(py_fsetacl__doc__,
-"fsetacl(fd, acl)\n"
+"fsetacl(fd, acl, *, mnt_id=0)\n"
 "--\n\n"
 "Set the ACL on an open file descriptor.\n\n"
 "acl must be an NFS4ACL or POSIXACL matching the filesystem ACL type,\n"
@@ -1188,7 +1447,10 @@ PyDoc_STRVAR(py_fsetacl__doc__,
 "fd : int\n"
 "    Open file descriptor\n"
 "acl : NFS4ACL, POSIXACL, or None\n"
-"    ACL to set, or None to remove existing ACL xattr(s)\n\n"
+"    ACL to set, or None to remove existing ACL xattr(s)\n"
+"mnt_id : int, optional\n"
+"    Mount id of fd keying the ACL flavour cache, as for fgetacl().  A\n"
+"    cached flavour lets acl=None skip the filesystem probe\n\n"
 "Returns\n"
 "-------\n"
 "None\n\n"
@@ -1201,16 +1463,20 @@ PyDoc_STRVAR(py_fsetacl__doc__,
 );
 
 static PyObject *
-py_fsetacl(PyObject *obj, PyObject *args)
+py_fsetacl(PyObject *obj, PyObject *args, PyObject *kwargs)
 {
 	int fd;
 	PyObject *acl;
+	uint64_t mnt_id = 0;
+	const char *kwnames[] = { "fd", "acl", "mnt_id", NULL };
 
-	if (!PyArg_ParseTuple(args, "iO:fsetacl", &fd, &acl))
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iO|$K:fsetacl",
+					 discard_const_p(char *, kwnames),
+					 &fd, &acl, &mnt_id))
 		return NULL;
 
 	if (acl == Py_None) {
-		if (do_fremoveacl(fd) < 0)
+		if (do_fremoveacl(fd, mnt_id) < 0)
 			return NULL;
 		Py_RETURN_NONE;
 	}
@@ -1226,7 +1492,7 @@ py_fsetacl(PyObject *obj, PyObject *args)
 		    PyBytes_AS_STRING(data),
 		    (size_t)PyBytes_GET_SIZE(data));
 		if (ret == 0)
-			ret = do_fsetacl_nfs4(fd,
+			ret = do_fsetacl_nfs4(fd, mnt_id,
 			    PyBytes_AS_STRING(data),
 			    (size_t)PyBytes_GET_SIZE(data));
 		Py_DECREF(data);
@@ -1252,7 +1518,7 @@ py_fsetacl(PyObject *obj, PyObject *args)
 		    (size_t)PyBytes_GET_SIZE(access_data),
 		    def_ptr, def_len);
 		if (ret == 0)
-			ret = do_fsetacl_posix(fd,
+			ret = do_fsetacl_posix(fd, mnt_id,
 			    PyBytes_AS_STRING(access_data),
 			    (size_t)PyBytes_GET_SIZE(access_data),
 			    def_ptr, def_len);
@@ -1379,7 +1645,7 @@ py_fsetacl_nfs4(PyObject *obj, PyObject *args)
 		return NULL;
 	if (nfs4acl_valid(fd, data, (size_t)len) < 0)
 		return NULL;
-	if (do_fsetacl_nfs4(fd, data, (size_t)len) < 0)
+	if (do_fsetacl_nfs4(fd, 0, data, (size_t)len) < 0)
 		return NULL;
 	Py_RETURN_NONE;
 }
@@ -1442,12 +1708,286 @@ py_fsetacl_posix(PyObject *obj, PyObject *args)
 	if (posixacl_valid(fd, access_data, (size_t)access_len,
 	                   default_data, (size_t)default_len) < 0)
 		return NULL;
-	if (do_fsetacl_posix(fd, access_data, (size_t)access_len,
+	if (do_fsetacl_posix(fd, 0, access_data, (size_t)access_len,
 	                     default_data, (size_t)default_len) < 0)
 		return NULL;
 	Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR(py_invalidate_acl_cache__doc__,
+"invalidate_acl_cache(mnt_id=0)\n"
+"--\n\n"
+"Forget the ACL flavour cached for a mount by fgetacl()/fsetacl().\n\n"
+"Call after changing a mount's ACL type (e.g. zfs set acltype=) or when\n"
+"a mount id may be reused.  A stale entry is also dropped automatically\n"
+"the first time the kernel rejects the cached flavour.\n\n"
+"Parameters\n"
+"----------\n"
+"mnt_id : int, optional\n"
+"    Mount id to forget; 0 (the default) clears the whole cache\n\n"
+"Returns\n"
+"-------\n"
+"None\n"
+);
+
+static PyObject *
+py_invalidate_acl_cache(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	uint64_t mnt_id = 0;
+	const char *kwnames[] = { "mnt_id", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|K:invalidate_acl_cache",
+					 discard_const_p(char *, kwnames),
+					 &mnt_id))
+		return NULL;
+
+	acl_flavour_invalidate(mnt_id);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(py_fcrc32c__doc__,
+"fcrc32c(fd, /)\n"
+"--\n\n"
+"Compute the CRC32C (Castagnoli) checksum of a file's full contents.\n\n"
+"The file is read with pread(2) from offset 0, so the fd's file offset is\n"
+"not changed.  The read and checksum run with the GIL released and use\n"
+"the SSE4.2 crc32 instruction when the CPU supports it.\n\n"
+"Parameters\n"
+"----------\n"
+"fd : int\n"
+"    File descriptor open for reading\n\n"
+"Returns\n"
+"-------\n"
+"int\n"
+"    32-bit CRC32C of the file contents\n\n"
+"Raises\n"
+"------\n"
+"OSError\n"
+"    Errnos as documented in pread(2).\n"
+);
+
+static PyObject *
+py_fcrc32c(PyObject *obj, PyObject *args)
+{
+	int fd;
+
+	if (!PyArg_ParseTuple(args, "i:fcrc32c", &fd))
+		return NULL;
+
+	return do_fcrc32c(fd);
+}
+
+PyDoc_STRVAR(py_fcrc32c_pair__doc__,
+"fcrc32c_pair(fd_a, fd_b, /)\n"
+"--\n\n"
+"Compute the CRC32C checksums of two files concurrently.\n\n"
+"Equivalent to (fcrc32c(fd_a), fcrc32c(fd_b)) but fd_b is read on a\n"
+"helper thread while the calling thread reads fd_a, so verifying a copy\n"
+"streams source and destination in parallel.  The GIL is released for\n"
+"the whole operation.\n\n"
+"Parameters\n"
+"----------\n"
+"fd_a : int\n"
+"    First file descriptor open for reading\n"
+"fd_b : int\n"
+"    Second file descriptor open for reading\n\n"
+"Returns\n"
+"-------\n"
+"tuple[int, int]\n"
+"    (crc_a, crc_b)\n\n"
+"Raises\n"
+"------\n"
+"OSError\n"
+"    If reading either file fails; errnos as documented in pread(2).\n"
+);
+
+static PyObject *
+py_fcrc32c_pair(PyObject *obj, PyObject *args)
+{
+	int fd_a;
+	int fd_b;
+
+	if (!PyArg_ParseTuple(args, "ii:fcrc32c_pair", &fd_a, &fd_b))
+		return NULL;
+
+	return do_fcrc32c_pair(fd_a, fd_b);
+}
+
+PyDoc_STRVAR(py_fcopy_small__doc__,
+"fcopy_small(src_fd, dst_fd, /, *, uid=-1, gid=-1, mode=-1, ns=None)\n"
+"--\n\n"
+"Copy a file's contents and apply its metadata in one call.\n\n"
+"Data is copied from offset 0 with pread(2) / pwrite(2) through a\n"
+"per-thread FCOPY_SMALL_MAX-byte buffer, so a file smaller than that is\n"
+"one read and one write.  Larger files are copied buffer by buffer, but\n"
+"copy_file_range(2) / sendfile(2) are better suited to them.  A short\n"
+"read is taken as end of file, so src_fd must be a regular file on a\n"
+"filesystem that reports file contents normally (not procfs / sysfs).\n\n"
+"After the data, dst_fd gets the owner (fchown), then the mode (fchmod;\n"
+"after the owner so set-ID bits survive), then the timestamps\n"
+"(futimens).  The whole operation runs with the GIL released.\n\n"
+"Parameters\n"
+"----------\n"
+"src_fd : int\n"
+"    File descriptor open for reading\n"
+"dst_fd : int\n"
+"    File descriptor open for writing, normally an empty file\n"
+"uid, gid : int, optional\n"
+"    Owner to set, in [0, UINT32_MAX] as for os.fchown(); -1 (the\n"
+"    default) leaves that id unchanged\n"
+"mode : int, optional\n"
+"    Permission bits to set; -1 (the default) leaves the mode unchanged\n"
+"ns : tuple[int, int], optional\n"
+"    (atime_ns, mtime_ns) to set, as for os.utime(ns=...)\n\n"
+"Returns\n"
+"-------\n"
+"int\n"
+"    Number of bytes copied\n\n"
+"Raises\n"
+"------\n"
+"ValueError\n"
+"    If uid or gid is neither -1 nor in [0, UINT32_MAX].\n"
+"OSError\n"
+"    Errnos as documented in pread(2), pwrite(2), fchown(2), fchmod(2)\n"
+"    and futimens(3).\n"
+);
+
+static PyObject *
+py_fcopy_small(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	int src_fd;
+	int dst_fd;
+	long long uid = -1;
+	long long gid = -1;
+	int mode = -1;
+	PyObject *ns = Py_None;
+	long long atime_ns;
+	long long mtime_ns;
+	struct timespec times[2];
+	const char *kwnames[] = { "", "", "uid", "gid", "mode", "ns", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii|$LLiO:fcopy_small",
+					 discard_const_p(char *, kwnames),
+					 &src_fd, &dst_fd, &uid, &gid, &mode, &ns))
+		return NULL;
+
+	/* Ids are 32-bit unsigned; -1 is the "leave unchanged" sentinel. */
+	if (uid < -1 || uid > UINT32_MAX) {
+		PyErr_SetString(PyExc_ValueError,
+		                "uid must be -1 or in [0, UINT32_MAX]");
+		return NULL;
+	}
+	if (gid < -1 || gid > UINT32_MAX) {
+		PyErr_SetString(PyExc_ValueError,
+		                "gid must be -1 or in [0, UINT32_MAX]");
+		return NULL;
+	}
+
+	if (ns != Py_None) {
+		if (!PyTuple_Check(ns) || PyTuple_GET_SIZE(ns) != 2) {
+			PyErr_SetString(PyExc_TypeError,
+			                "fcopy_small: ns must be a tuple of two ints");
+			return NULL;
+		}
+		atime_ns = PyLong_AsLongLong(PyTuple_GET_ITEM(ns, 0));
+		if (atime_ns == -1 && PyErr_Occurred())
+			return NULL;
+		mtime_ns = PyLong_AsLongLong(PyTuple_GET_ITEM(ns, 1));
+		if (mtime_ns == -1 && PyErr_Occurred())
+			return NULL;
+		times[0].tv_sec = atime_ns / 1000000000LL;
+		times[0].tv_nsec = atime_ns % 1000000000LL;
+		times[1].tv_sec = mtime_ns / 1000000000LL;
+		times[1].tv_nsec = mtime_ns % 1000000000LL;
+		/* Floor division, as os.utime() does for pre-epoch times. */
+		if (times[0].tv_nsec < 0) {
+			times[0].tv_sec--;
+			times[0].tv_nsec += 1000000000LL;
+		}
+		if (times[1].tv_nsec < 0) {
+			times[1].tv_sec--;
+			times[1].tv_nsec += 1000000000LL;
+		}
+	}
+
+	return do_fcopy_small(src_fd, dst_fd, (uid_t)uid, (gid_t)gid, mode,
+	                      ns != Py_None ? times : NULL);
+}
+
+PyDoc_STRVAR(py_fallocate__doc__,
+"fallocate(fd, offset, length, /, *, mode=0)\n"
+"--\n\n"
+"Allocate disk space for a range of a file with fallocate(2).\n\n"
+"Unlike os.posix_fallocate(), a filesystem that cannot preallocate\n"
+"raises OSError(EOPNOTSUPP) instead of having every block of the range\n"
+"written by the C library.  Runs with the GIL released.\n\n"
+"Parameters\n"
+"----------\n"
+"fd : int\n"
+"    File descriptor open for writing\n"
+"offset : int\n"
+"    Start of the range in bytes\n"
+"length : int\n"
+"    Length of the range in bytes; must be greater than zero\n"
+"mode : int, optional\n"
+"    Bitwise OR of FALLOC_FL_* flags.  0 (the default) allocates the range\n"
+"    and extends the file size to cover it; FALLOC_FL_KEEP_SIZE allocates\n"
+"    without changing the size.\n\n"
+"Raises\n"
+"------\n"
+"OSError\n"
+"    EOPNOTSUPP if the filesystem does not support the mode, ENOSPC if\n"
+"    there is not enough space; other errnos as documented in\n"
+"    fallocate(2).\n"
+);
+
+static PyObject *
+py_fallocate(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	int fd;
+	long long offset;
+	long long length;
+	int mode = 0;
+	const char *kwnames[] = { "", "", "", "mode", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iLL|$i:fallocate",
+					 discard_const_p(char *, kwnames),
+					 &fd, &offset, &length, &mode))
+		return NULL;
+
+	return do_fallocate(fd, mode, (off_t)offset, (off_t)length);
+}
+
+PyDoc_STRVAR(py_syncfs__doc__,
+"syncfs(fd, /)\n"
+"--\n\n"
+"Write all of the filesystem's dirty data and metadata to stable storage.\n\n"
+"Flushes the filesystem containing fd with syncfs(2), with the GIL\n"
+"released.  One call replaces an fsync(2) of every file written to that\n"
+"filesystem.\n\n"
+"Parameters\n"
+"----------\n"
+"fd : int\n"
+"    Any file descriptor on the filesystem, e.g. a directory opened with\n"
+"    O_RDONLY or O_PATH\n\n"
+"Raises\n"
+"------\n"
+"OSError\n"
+"    EBADF for a bad fd, or a writeback error (e.g. EIO, ENOSPC) recorded\n"
+"    on the filesystem since fd was opened.\n"
+);
+
+static PyObject *
+py_syncfs(PyObject *obj, PyObject *args)
+{
+	int fd;
+
+	if (!PyArg_ParseTuple(args, "i:syncfs", &fd))
+		return NULL;
+
+	return do_syncfs(fd);
+}
+
 PyDoc_STRVAR(py_fgetxattr__doc__,
 "fgetxattr(fd, name)\n"
 "--\n\n"
@@ -1570,6 +2110,71 @@ py_flistxattr(PyObject *obj, PyObject *args, PyObject *kwargs)
 	return do_flistxattr(fd);
 }
 
+PyDoc_STRVAR(py_fremovexattrs__doc__,
+"fremovexattrs(fd, *, names=None, prefix=None)\n"
+"--\n\n"
+"Remove matching extended attributes from an open fd in one call.\n\n"
+"The name list is read and every matching attribute removed with the\n"
+"GIL released, instead of one flistxattr() plus one fremovexattr()\n"
+"round trip per name.\n\n"
+"Parameters\n"
+"----------\n"
+"fd : int\n"
+"    Open file descriptor (not O_PATH)\n"
+"names : sequence of str, keyword-only, optional\n"
+"    Remove these attributes.  Names that are not present are ignored.\n"
+"prefix : str, keyword-only, optional\n"
+"    Remove attributes whose name starts with `prefix` (e.g. 'user.').\n"
+"    An attribute matching either `names` or `prefix` is removed; when\n"
+"    both are None every attribute is removed.\n\n"
+"Returns\n"
+"-------\n"
+"list of str\n"
+"    Names of the attributes removed, in listing order.\n\n"
+"Raises\n"
+"------\n"
+"TypeError\n"
+"    If names is not a sequence of str.\n"
+"OSError\n"
+"    From flistxattr(2), or from fremovexattr(2) with the attribute\n"
+"    name as filename.  Removal stops there; attributes already\n"
+"    removed stay removed.\n"
+);
+
+static PyObject *
+py_fremovexattrs(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	int fd = -1;
+	PyObject *names = Py_None;
+	const char *prefix = NULL;
+	static const char * const kwnames[] = {
+	    "fd", "names", "prefix", NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|$Oz:fremovexattrs",
+	                                 discard_const_p(char *, kwnames),
+	                                 &fd, &names, &prefix))
+		return NULL;
+
+	return do_fremovexattrs(fd, names, prefix);
+}
+
+/*
+ * Validate max_open_dirs into state.  The root and the directory being
+ * read are always open, so a budget below 2 could never be met.
+ */
+static bool
+set_max_open_dirs(iter_state_t *state, Py_ssize_t max_open_dirs)
+{
+	if (max_open_dirs < 0 || max_open_dirs == 1) {
+		PyErr_SetString(PyExc_ValueError,
+				"max_open_dirs must be 0 (unlimited) or at least 2");
+		return false;
+	}
+	state->max_open_dirs = (size_t)max_open_dirs;
+	return true;
+}
+
 /*
  * Python wrapper for iter_filesystem_contents
  */
@@ -1588,34 +2193,87 @@ py_iter_filesystem_contents(PyObject *self, PyObject *args, PyObject *kwargs)
 	PyObject *dir_stack = NULL;
 	int include_symlinks = 0;
 	int include_mountpoints = 0;
+	int inode_order = 0;
+	Py_ssize_t max_open_dirs = 0;
 
 	static char *kwlist[] = {
 		"mountpoint", "filesystem_name", "relative_path",
 		"btime_cutoff", "cnt", "cnt_bytes", "file_open_flags",
 		"reporting_increment", "reporting_callback", "reporting_private_data",
 		"dir_stack", "include_symlinks", "include_mountpoints",
-		NULL
+		"inode_order", "max_open_dirs", NULL
 	};
 
 	if (!PyArg_ParseTupleAndKeywords(args, kwargs,
-					  "ss|zLKKiKOOOpp:iter_filesystem_contents",
+					  "ss|zLKKiKOOOpppn:iter_filesystem_contents",
 					  kwlist,
 					  &mountpoint, &filesystem_name, &relative_path,
 					  &state.btime_cutoff, &state.cnt, &state.cnt_bytes,
 					  &state.file_open_flags,
 					  &reporting_cb_increment, &reporting_cb, &reporting_cb_private_data,
-					  &dir_stack, &include_symlinks, &include_mountpoints)) {
+					  &dir_stack, &include_symlinks, &include_mountpoints,
+					  &inode_order, &max_open_dirs)) {
 		return NULL;
 	}
 
 	state.include_symlinks = (include_symlinks != 0);
 	state.include_mountpoints = (include_mountpoints != 0);
+	state.inode_order = (inode_order != 0);
+	if (!set_max_open_dirs(&state, max_open_dirs))
+		return NULL;
 
 	return create_filesystem_iterator(mountpoint, relative_path, filesystem_name, &state,
 	                                  reporting_cb_increment, reporting_cb, reporting_cb_private_data,
 	                                  dir_stack);
 }
 
+/*
+ * Python wrapper for iter_filesystem_contents_fd
+ */
+static PyObject *
+py_iter_filesystem_contents_fd(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+	int dirfd;
+	const char *path = NULL;
+	iter_state_t state = {0};
+	size_t reporting_cb_increment = 1000;
+	PyObject *reporting_cb = NULL;
+	PyObject *reporting_cb_private_data = NULL;
+	PyObject *dir_stack = NULL;
+	int include_symlinks = 0;
+	int include_mountpoints = 0;
+	int inode_order = 0;
+	Py_ssize_t max_open_dirs = 0;
+
+	static char *kwlist[] = {
+		"", "path", "btime_cutoff", "file_open_flags",
+		"reporting_increment", "reporting_callback", "reporting_private_data",
+		"dir_stack", "include_symlinks", "include_mountpoints",
+		"inode_order", "max_open_dirs", NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+					  "i|$zLiKOOOpppn:iter_filesystem_contents_fd",
+					  kwlist,
+					  &dirfd, &path, &state.btime_cutoff,
+					  &state.file_open_flags,
+					  &reporting_cb_increment, &reporting_cb, &reporting_cb_private_data,
+					  &dir_stack, &include_symlinks, &include_mountpoints,
+					  &inode_order, &max_open_dirs)) {
+		return NULL;
+	}
+
+	state.include_symlinks = (include_symlinks != 0);
+	state.include_mountpoints = (include_mountpoints != 0);
+	state.inode_order = (inode_order != 0);
+	if (!set_max_open_dirs(&state, max_open_dirs))
+		return NULL;
+
+	return create_filesystem_iterator_fd(dirfd, path, &state,
+	                                     reporting_cb_increment, reporting_cb,
+	                                     reporting_cb_private_data, dir_stack);
+}
+
 static PyMethodDef truenas_os_methods[] = {
 	{
 		.ml_name = "open_mount_by_id",
@@ -1689,6 +2347,18 @@ static PyMethodDef truenas_os_methods[] = {
 		.ml_flags = METH_VARARGS|METH_KEYWORDS,
 		.ml_doc = py_fsmount__doc__
 	},
+	{
+		.ml_name = "create_mount_spec",
+		.ml_meth = (PyCFunction)py_create_mount_spec,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc = py_create_mount_spec__doc__
+	},
+	{
+		.ml_name = "mount_tree",
+		.ml_meth = (PyCFunction)py_mount_tree,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc = py_mount_tree__doc__
+	},
 	{
 		.ml_name = "umount2",
 		.ml_meth = (PyCFunction)py_umount2,
@@ -1725,24 +2395,42 @@ static PyMethodDef truenas_os_methods[] = {
 		.ml_flags = METH_VARARGS|METH_KEYWORDS,
 		.ml_doc = py_renameat2__doc__
 	},
+	{
+		.ml_name = "renameat2_batch",
+		.ml_meth = (PyCFunction)py_renameat2_batch,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc = py_renameat2_batch__doc__
+	},
 	{
 		.ml_name = "iter_filesystem_contents",
 		.ml_meth = (PyCFunction)py_iter_filesystem_contents,
 		.ml_flags = METH_VARARGS|METH_KEYWORDS,
 		.ml_doc = py_iter_filesystem_contents__doc__
 	},
+	{
+		.ml_name = "iter_filesystem_contents_fd",
+		.ml_meth = (PyCFunction)py_iter_filesystem_contents_fd,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc = py_iter_filesystem_contents_fd__doc__
+	},
 	{
 		.ml_name  = "fgetacl",
 		.ml_meth  = (PyCFunction)py_fgetacl,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
 		.ml_doc   = py_fgetacl__doc__
 	},
 	{
 		.ml_name  = "fsetacl",
 		.ml_meth  = (PyCFunction)py_fsetacl,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
 		.ml_doc   = py_fsetacl__doc__
 	},
+	{
+		.ml_name  = "invalidate_acl_cache",
+		.ml_meth  = (PyCFunction)py_invalidate_acl_cache,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc   = py_invalidate_acl_cache__doc__
+	},
 	{
 		.ml_name  = "validate_acl",
 		.ml_meth  = (PyCFunction)py_validate_acl,
@@ -1761,6 +2449,36 @@ static PyMethodDef truenas_os_methods[] = {
 		.ml_flags = METH_VARARGS,
 		.ml_doc   = py_fsetacl_posix__doc__
 	},
+	{
+		.ml_name  = "fcrc32c",
+		.ml_meth  = (PyCFunction)py_fcrc32c,
+		.ml_flags = METH_VARARGS,
+		.ml_doc   = py_fcrc32c__doc__
+	},
+	{
+		.ml_name  = "fcrc32c_pair",
+		.ml_meth  = (PyCFunction)py_fcrc32c_pair,
+		.ml_flags = METH_VARARGS,
+		.ml_doc   = py_fcrc32c_pair__doc__
+	},
+	{
+		.ml_name  = "fcopy_small",
+		.ml_meth  = (PyCFunction)py_fcopy_small,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc   = py_fcopy_small__doc__
+	},
+	{
+		.ml_name  = "fallocate",
+		.ml_meth  = (PyCFunction)py_fallocate,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc   = py_fallocate__doc__
+	},
+	{
+		.ml_name  = "syncfs",
+		.ml_meth  = (PyCFunction)py_syncfs,
+		.ml_flags = METH_VARARGS,
+		.ml_doc   = py_syncfs__doc__
+	},
 	{
 		.ml_name  = "fgetxattr",
 		.ml_meth  = (PyCFunction)py_fgetxattr,
@@ -1779,6 +2497,12 @@ static PyMethodDef truenas_os_methods[] = {
 		.ml_flags = METH_VARARGS|METH_KEYWORDS,
 		.ml_doc   = py_flistxattr__doc__
 	},
+	{
+		.ml_name  = "fremovexattrs",
+		.ml_meth  = (PyCFunction)py_fremovexattrs,
+		.ml_flags = METH_VARARGS|METH_KEYWORDS,
+		.ml_doc   = py_fremovexattrs__doc__
+	},
 	{ .ml_name = NULL }
 };
 
@@ -1874,6 +2598,12 @@ PyObject* module_init(void)
 		return NULL;
 	}
 
+	// Initialize MountSpec type (used by mount_tree)
+	if (init_mount_tree_types(m) < 0) {
+		Py_DECREF(m);
+		return NULL;
+	}
+
 	// Initialize umount2 constants
 	if (init_umount2_constants(m) < 0) {
 		Py_DECREF(m);
@@ -1898,6 +2628,24 @@ PyObject* module_init(void)
 		return NULL;
 	}
 
+	// Initialize RenameFailure type (used by renameat2_batch)
+	if (init_renameat2_types(m) < 0) {
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	// Initialize CRC32C tables (used by fcrc32c / fcrc32c_pair)
+	if (init_checksum(m) < 0) {
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	// Initialize per-thread buffer and constants for fcopy_small / fallocate
+	if (init_fcopy(m) < 0) {
+		Py_DECREF(m);
+		return NULL;
+	}
+
 	// Initialize filesystem iterator types
 	if (init_iter_types(m) < 0) {
 		Py_DECREF(m);
@@ -1916,6 +2664,12 @@ PyObject* module_init(void)
 		return NULL;
 	}
 
+	// Initialize ACLDiff type (used by NFS4ACL.diff / POSIXACL.diff)
+	if (init_acl_diff_types(m) < 0) {
+		Py_DECREF(m);
+		return NULL;
+	}
+
 	// Initialize xattr constants
 	if (init_xattr_constants(m) < 0) {
 		Py_DECREF(m);
@@ -11,7 +11,10 @@ typedef struct {
 	PyObject *StatmountResultType;
 	PyObject *IdmapMappingEntryType;
 	PyObject *CredEntryType;
+	PyObject *MountSpecType;
 	PyObject *AccessFailureType;
+	PyObject *RenameFailureType;
+	PyObject *ACLDiffType;
 	PyObject *IterInstanceType;
 	PyObject *FilesystemIterStateType;
 	PyObject *IteratorRestoreError;
@@ -2,6 +2,7 @@
 
 #include <Python.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <string.h>
 #include <sys/xattr.h>
 #include "xattr.h"
@@ -107,6 +108,51 @@ do_fgetxattr(int fd, const char *name)
 }
 
 
+/* Name-list buffer sizes tried in turn by do_flistxattr / do_fremovexattrs. */
+static const size_t xattr_list_sizes[] = {
+    256, XATTR_LIST_MAX, 0
+};
+
+/*
+ * Convert a kernel NUL-separated xattr name list of `len` bytes into a
+ * Python list of str.  Returns NULL with the error indicator set on
+ * failure.
+ */
+static PyObject *
+xattr_names_to_list(const char *buf, size_t len)
+{
+	PyObject *result = NULL;
+	PyObject *name_obj = NULL;
+	const char *p = buf;
+	const char *end = buf + len;
+	size_t name_len = 0;
+	int rc = 0;
+
+	result = PyList_New(0);
+	if (result == NULL)
+		return NULL;
+
+	while (p < end) {
+		name_len = strlen(p);
+		name_obj = PyUnicode_DecodeFSDefaultAndSize(
+		    p, (Py_ssize_t)name_len);
+		if (name_obj == NULL) {
+			Py_DECREF(result);
+			return NULL;
+		}
+		rc = PyList_Append(result, name_obj);
+		Py_DECREF(name_obj);
+		if (rc < 0) {
+			Py_DECREF(result);
+			return NULL;
+		}
+		p += name_len + 1;
+	}
+
+	return result;
+}
+
+
 /*
  * do_flistxattr - try a small fast-path buffer first and escalate to
  * the kernel-defined XATTR_LIST_MAX on ERANGE.  Mirrors CPython's
@@ -121,22 +167,14 @@ do_fgetxattr(int fd, const char *name)
 PyObject *
 do_flistxattr(int fd)
 {
-	static const size_t buffer_sizes[] = {
-	    256, XATTR_LIST_MAX, 0
-	};
 	char *buf = NULL;
 	size_t bufsize = 0;
 	ssize_t read_size = -1;
 	int async_err = 0;
 	int i = 0;
 	PyObject *result = NULL;
-	PyObject *name_obj = NULL;
-	const char *p = NULL;
-	const char *end = NULL;
-	size_t name_len = 0;
-	int rc = 0;
 
-	for (i = 0; (bufsize = buffer_sizes[i]) != 0; i++) {
+	for (i = 0; (bufsize = xattr_list_sizes[i]) != 0; i++) {
 		buf = PyMem_RawMalloc(bufsize);
 		if (buf == NULL) {
 			PyErr_NoMemory();
@@ -178,31 +216,207 @@ do_flistxattr(int fd)
 		goto cleanup;
 	}
 
-	result = PyList_New(0);
-	if (result == NULL)
-		goto cleanup;
+	result = xattr_names_to_list(buf, (size_t)read_size);
 
-	p = buf;
-	end = buf + read_size;
-	while (p < end) {
-		name_len = strlen(p);
-		name_obj = PyUnicode_DecodeFSDefaultAndSize(
-		    p, (Py_ssize_t)name_len);
-		if (name_obj == NULL) {
-			Py_CLEAR(result);
-			goto cleanup;
+cleanup:
+	PyMem_RawFree(buf);
+	return result;
+}
+
+
+/*
+ * do_fremovexattrs state.  The listing and the removals each run with
+ * the GIL released; on EINTR the removal loop returns so signals can be
+ * checked and then resumes at `pos`.  Removed names are compacted to the
+ * front of `buf` (below `out`), which is where the result list is built
+ * from; `out` never passes `pos`, so unexamined names are not clobbered.
+ */
+typedef struct {
+	int fd;
+	const char **names;
+	size_t n_names;
+	const char *prefix;
+	size_t prefix_len;
+	char *buf;
+	size_t len;
+	size_t pos;
+	size_t out;
+	const char *failed;
+} xattr_rm_state_t;
+
+/*
+ * List the xattr names on `fd` into a PyMem_RawMalloc'd buffer.  Safe to
+ * call without the GIL.  Returns 0 or an errno value.
+ */
+static int
+xattr_list_raw(int fd, char **bufp, size_t *lenp)
+{
+	char *buf = NULL;
+	size_t bufsize = 0;
+	ssize_t read_size = -1;
+	int err = 0;
+	int i = 0;
+
+	for (i = 0; (bufsize = xattr_list_sizes[i]) != 0; i++) {
+		buf = PyMem_RawMalloc(bufsize);
+		if (buf == NULL)
+			return ENOMEM;
+
+		read_size = flistxattr(fd, buf, bufsize);
+		if (read_size >= 0) {
+			*bufp = buf;
+			*lenp = (size_t)read_size;
+			return 0;
 		}
-		rc = PyList_Append(result, name_obj);
-		Py_DECREF(name_obj);
-		if (rc < 0) {
-			Py_CLEAR(result);
+
+		err = errno;
+		PyMem_RawFree(buf);
+		if (err != ERANGE)
+			return err;
+	}
+
+	return E2BIG;
+}
+
+static bool
+xattr_rm_match(const xattr_rm_state_t *st, const char *name)
+{
+	size_t i;
+
+	if ((st->names == NULL) && (st->prefix == NULL))
+		return true;
+
+	if ((st->prefix != NULL) &&
+	    (strncmp(name, st->prefix, st->prefix_len) == 0))
+		return true;
+
+	for (i = 0; i < st->n_names; i++) {
+		if (strcmp(name, st->names[i]) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Remove the matching names from `pos` onwards.  Called without the GIL.
+ * An attribute that vanished since the listing (ENODATA) is skipped.
+ * Returns 0, EINTR to be resumed, or the errno of the failed removal
+ * with `failed` pointing at its name.
+ */
+static int
+xattr_rm_run(xattr_rm_state_t *st)
+{
+	char *name = NULL;
+	size_t name_len = 0;
+
+	while (st->pos < st->len) {
+		name = st->buf + st->pos;
+		name_len = strlen(name);
+
+		if (xattr_rm_match(st, name)) {
+			if (fremovexattr(st->fd, name) == 0) {
+				memmove(st->buf + st->out, name, name_len + 1);
+				st->out += name_len + 1;
+			} else if (errno == EINTR) {
+				return EINTR;
+			} else if (errno != ENODATA) {
+				st->failed = name;
+				return errno;
+			}
+		}
+
+		st->pos += name_len + 1;
+	}
+
+	return 0;
+}
+
+PyObject *
+do_fremovexattrs(int fd, PyObject *names, const char *prefix)
+{
+	xattr_rm_state_t st = { .fd = fd, .prefix = prefix };
+	PyObject *seq = NULL;
+	PyObject *encoded = NULL;
+	PyObject *item = NULL;
+	PyObject *result = NULL;
+	Py_ssize_t i, n = 0;
+	int async_err = 0;
+	int err = 0;
+
+	if (prefix != NULL)
+		st.prefix_len = strlen(prefix);
+
+	if (names != Py_None) {
+		if (PyUnicode_Check(names) || PyBytes_Check(names)) {
+			PyErr_SetString(PyExc_TypeError,
+			                "names must be a sequence of str, not a "
+			                "single name");
+			return NULL;
+		}
+
+		seq = PySequence_Fast(names, "names must be a sequence of str");
+		if (seq == NULL)
+			return NULL;
+
+		n = PySequence_Fast_GET_SIZE(seq);
+		encoded = PyList_New(n);
+		if (encoded == NULL)
+			goto cleanup;
+
+		st.names = PyMem_Calloc(n ? n : 1, sizeof(char *));
+		if (st.names == NULL) {
+			PyErr_NoMemory();
 			goto cleanup;
 		}
-		p += name_len + 1;
+
+		for (i = 0; i < n; i++) {
+			if (!PyUnicode_FSConverter(
+			    PySequence_Fast_GET_ITEM(seq, i), &item))
+				goto cleanup;
+			PyList_SET_ITEM(encoded, i, item);
+			st.names[i] = PyBytes_AS_STRING(item);
+		}
+		st.n_names = (size_t)n;
 	}
 
+	do {
+		Py_BEGIN_ALLOW_THREADS
+		err = xattr_list_raw(fd, &st.buf, &st.len);
+		Py_END_ALLOW_THREADS
+	} while (err == EINTR && !(async_err = PyErr_CheckSignals()));
+
+	if (async_err)
+		goto cleanup;
+
+	if (err) {
+		errno = err;
+		PyErr_SetFromErrno(PyExc_OSError);
+		goto cleanup;
+	}
+
+	do {
+		Py_BEGIN_ALLOW_THREADS
+		err = xattr_rm_run(&st);
+		Py_END_ALLOW_THREADS
+	} while (err == EINTR && !(async_err = PyErr_CheckSignals()));
+
+	if (async_err)
+		goto cleanup;
+
+	if (err) {
+		errno = err;
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, st.failed);
+		goto cleanup;
+	}
+
+	result = xattr_names_to_list(st.buf, st.out);
+
 cleanup:
-	PyMem_RawFree(buf);
+	PyMem_RawFree(st.buf);
+	PyMem_Free(st.names);
+	Py_XDECREF(encoded);
+	Py_XDECREF(seq);
 	return result;
 }
 
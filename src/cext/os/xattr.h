@@ -50,6 +50,19 @@ int do_fsetxattr(int fd, const char *name,
  */
 PyObject *do_flistxattr(int fd);
 
+/*
+ * do_fremovexattrs - remove the xattrs on open `fd` that are listed in
+ * `names` (a sequence of str, or Py_None) or start with `prefix` (may be
+ * NULL); with neither, every xattr is removed.  The name list is read
+ * and the removals issued in a single GIL release.  Attributes that
+ * disappear concurrently are skipped.
+ *
+ * Returns a PyList of the removed names on success, or NULL with the
+ * Python error indicator set (OSError carries the failing name as
+ * filename; earlier removals are not undone).
+ */
+PyObject *do_fremovexattrs(int fd, PyObject *names, const char *prefix);
+
 /*
  * init_xattr_constants - export XATTR_CREATE, XATTR_REPLACE, and
  * XATTR_SIZE_MAX module-level int constants on `module`.
@@ -1,13 +1,15 @@
 # Recursive file-tree copy and the file-level copy/clone primitives that
-# back it.  Iteration is driven by truenas_os.iter_filesystem_contents
-# (depth-first, GIL released, mountpoint-validated).
+# back it.  Iteration is driven by truenas_os.iter_filesystem_contents_fd
+# (depth-first, GIL released, confined to the starting fd's mount).
 #
 # - copy.py: file-level primitives (copy_permissions, copy_xattrs,
-#   copyuserspace, copysendfile, clonefile, copyfile)
+#   copyuserspace, copysendfile, clonefile, copyfile, CopyMethodCache)
 # - copytree.py: tree-level recursion (CopyFlags, CopyTreeOp, CopyJob,
-#   CopyTreeConfig, CopyTreeStats, copytree)
+#   CopyTreeConfig, CopyTreeDurability, CopyTreeStats, CopyTreeUpdate,
+#   CopyTreeMismatch, copytree)
 from .copy import (
     MAX_RW_SZ,
+    CopyMethodCache,
     clonefile,
     copy_permissions,
     copy_xattrs,
@@ -20,8 +22,12 @@ from .copytree import (
     DEF_CP_FLAGS,
     CopyFlags,
     CopyTreeConfig,
+    CopyTreeDurability,
+    CopyTreeMismatch,
+    CopyTreeMismatchKind,
     CopyTreeOp,
     CopyTreeStats,
+    CopyTreeUpdate,
     ReportingCallback,
     copytree,
 )
@@ -31,9 +37,14 @@ __all__ = [
     "DEF_CP_FLAGS",
     "MAX_RW_SZ",
     "CopyFlags",
+    "CopyMethodCache",
     "CopyTreeConfig",
+    "CopyTreeDurability",
+    "CopyTreeMismatch",
+    "CopyTreeMismatchKind",
     "CopyTreeOp",
     "CopyTreeStats",
+    "CopyTreeUpdate",
     "ReportingCallback",
     "clonefile",
     "copy_permissions",
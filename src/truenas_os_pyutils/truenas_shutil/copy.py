@@ -7,23 +7,33 @@
 # Tests are in tests/utils/test_truenas_shutil_copy.py.
 from __future__ import annotations
 
-from errno import EXDEV
+from errno import EOPNOTSUPP, EXDEV
 from os import (
+    POSIX_FADV_DONTNEED,
+    POSIX_FADV_SEQUENTIAL,
     SEEK_CUR,
     copy_file_range,
     fchmod,
     fstat,
+    ftruncate,
     lseek,
+    posix_fadvise,
     sendfile,
 )
 from shutil import copyfileobj
 from stat import S_IMODE
 
-from truenas_os import fgetxattr, fsetxattr
+from truenas_os import (
+    FALLOC_FL_KEEP_SIZE,
+    fallocate,
+    fgetxattr,
+    fsetxattr,
+)
 
 
 __all__ = [
     "MAX_RW_SZ",
+    "CopyMethodCache",
     "clonefile",
     "copy_permissions",
     "copy_xattrs",
@@ -128,7 +138,58 @@ def copyuserspace(src_fd: int, dst_fd: int) -> int:
     return fstat(dst_fd).st_size
 
 
-def copysendfile(src_fd: int, dst_fd: int) -> int:
+def _check_chunk_size(chunk_size: int) -> None:
+    # A zero-length sendfile / copy_file_range returns 0, which the copy
+    # loops would take as end of file and silently copy nothing.
+    if chunk_size <= 0:
+        raise ValueError(f"{chunk_size}: chunk_size must be positive")
+
+
+def _preallocate(src_fd: int, dst_fd: int) -> int:
+    """Reserve ``src_fd``'s size in ``dst_fd`` without changing its size.
+
+    Returns the number of bytes reserved: 0 for an empty source or a
+    filesystem that does not support ``fallocate(2)``.  ``ENOSPC`` is
+    raised so the copy fails before any data is written.
+    """
+    size = fstat(src_fd).st_size
+    if size == 0:
+        return 0
+    try:
+        fallocate(dst_fd, 0, size, mode=FALLOC_FL_KEEP_SIZE)
+    except OSError as err:
+        if err.errno != EOPNOTSUPP:
+            raise
+        return 0
+    return size
+
+
+def _drop_cached(
+    src_fd: int, dst_fd: int, prev: int, offset: int, length: int
+) -> None:
+    # DONTNEED drops clean pages only.  The source chunk just read is clean
+    # and goes at once.  On the destination the call starts writeback of
+    # the chunk just written, so the previous chunk (from ``prev``), whose
+    # writeback has had a chunk's time to finish, is advised again with it.
+    posix_fadvise(src_fd, offset, length, POSIX_FADV_DONTNEED)
+    posix_fadvise(dst_fd, prev, offset + length - prev, POSIX_FADV_DONTNEED)
+
+
+def _drop_written(dst_fd: int, length: int) -> None:
+    # Final sweep for destination pages that were still under writeback
+    # when their chunk was last advised.
+    if length:
+        posix_fadvise(dst_fd, 0, length, POSIX_FADV_DONTNEED)
+
+
+def copysendfile(
+    src_fd: int,
+    dst_fd: int,
+    *,
+    chunk_size: int = MAX_RW_SZ,
+    preallocate: bool = False,
+    fadvise: bool = False,
+) -> int:
     """Optimized file copy using ``sendfile(2)``.
 
     Falls back to ``copyuserspace`` if ``sendfile`` writes nothing
@@ -138,63 +199,197 @@ def copysendfile(src_fd: int, dst_fd: int) -> int:
     Args:
         src_fd: Source file descriptor.
         dst_fd: Destination file descriptor.
+        chunk_size: Bytes requested per ``sendfile`` call.
+        preallocate: Reserve the source's size in the destination with
+            ``fallocate(2)`` first, so a full filesystem fails the copy
+            before any data is written and the file is laid out in as few
+            extents as the filesystem can manage.  Silently skipped where
+            ``fallocate`` is unsupported.
+        fadvise: Declare sequential access on the source and drop the
+            copied data of both files from the page cache, so a very large
+            copy does not evict other cached data.  Source chunks are
+            dropped as they are read; destination chunks once their
+            writeback completes, re-advised one chunk later and again at
+            the end of the copy.
 
     Returns:
         Number of bytes written.
 
     Raises:
-        OSError: As documented in the ``sendfile(2)`` manpage.
+        ValueError: ``chunk_size`` is not positive.
+        OSError: As documented in the ``sendfile(2)`` manpage; ``ENOSPC``
+            from ``fallocate(2)`` with ``preallocate``.
     """
-    offset = 0
-    while (sent := sendfile(dst_fd, src_fd, offset, MAX_RW_SZ)) > 0:
+    _check_chunk_size(chunk_size)
+    reserved = _preallocate(src_fd, dst_fd) if preallocate else 0
+    if fadvise:
+        posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL)
+
+    offset = prev = 0
+    while (sent := sendfile(dst_fd, src_fd, offset, chunk_size)) > 0:
+        if fadvise:
+            _drop_cached(src_fd, dst_fd, prev, offset, sent)
+        prev = offset
         offset += sent
+    if fadvise:
+        _drop_written(dst_fd, offset)
 
     if offset == 0 and lseek(dst_fd, 0, SEEK_CUR) == 0:
-        return copyuserspace(src_fd, dst_fd)
+        offset = copyuserspace(src_fd, dst_fd)
+
+    if reserved > offset:
+        # The source shrank while it was copied.  Truncating to the size
+        # already written frees the blocks reserved past end of file (a
+        # hole punch there is a no-op on ext4).
+        ftruncate(dst_fd, offset)
 
     return offset
 
 
-def clonefile(src_fd: int, dst_fd: int) -> int:
+def clonefile(
+    src_fd: int,
+    dst_fd: int,
+    *,
+    chunk_size: int = MAX_RW_SZ,
+    fadvise: bool = False,
+) -> int:
     """Block-level clone via ``copy_file_range(2)``.
 
+    There is no ``preallocate`` option: blocks reserved in the destination
+    would be allocated for nothing when the filesystem shares the source's
+    blocks instead.
+
     Args:
         src_fd: Source file descriptor.
         dst_fd: Destination file descriptor.
+        chunk_size: Bytes requested per ``copy_file_range`` call.
+        fadvise: As for ``copysendfile``.  Only matters when the kernel
+            copies the data instead of sharing blocks.
 
     Returns:
         Number of bytes written.
 
     Raises:
+        ValueError: ``chunk_size`` is not positive.
         OSError: ``EXDEV`` when source and destination are on different
             filesystems (or different ZFS pools); other errnos as documented
             in ``copy_file_range(2)``.
     """
-    offset = 0
+    _check_chunk_size(chunk_size)
+    if fadvise:
+        posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL)
+
+    offset = prev = 0
     # Loop until copy_file_range returns 0 to catch any TOCTOU races where
     # data is appended after the initial statx call.
     while (
         copied := copy_file_range(
-            src_fd, dst_fd, MAX_RW_SZ, offset_src=offset, offset_dst=offset
+            src_fd, dst_fd, chunk_size, offset_src=offset, offset_dst=offset
         )
     ) > 0:
+        if fadvise:
+            _drop_cached(src_fd, dst_fd, prev, offset, copied)
+        prev = offset
         offset += copied
+    if fadvise:
+        _drop_written(dst_fd, offset)
     return offset
 
 
-def copyfile(src_fd: int, dst_fd: int) -> int:
+def copyfile(
+    src_fd: int,
+    dst_fd: int,
+    *,
+    chunk_size: int = MAX_RW_SZ,
+    preallocate: bool = False,
+    fadvise: bool = False,
+) -> int:
     """Try ``clonefile``; on ``EXDEV`` fall back to ``copysendfile``.
 
     Args:
         src_fd: Source file descriptor.
         dst_fd: Destination file descriptor.
+        chunk_size: Passed to ``clonefile`` / ``copysendfile``.
+        preallocate: Passed to ``copysendfile`` only.
+        fadvise: Passed to ``clonefile`` / ``copysendfile``.
 
     Returns:
         Number of bytes written.
     """
     try:
-        return clonefile(src_fd, dst_fd)
+        return clonefile(src_fd, dst_fd, chunk_size=chunk_size, fadvise=fadvise)
     except OSError as err:
         if err.errno == EXDEV:
-            return copysendfile(src_fd, dst_fd)
+            return copysendfile(
+                src_fd,
+                dst_fd,
+                chunk_size=chunk_size,
+                preallocate=preallocate,
+                fadvise=fadvise,
+            )
         raise
+
+
+class CopyMethodCache:
+    """Remembers which filesystem pairs cannot clone, for ``copyfile``.
+
+    ``copyfile`` only learns that a source/destination pair cannot share
+    blocks by trying: ``copy_file_range`` fails with ``EXDEV``.  A tree copy
+    between two pools would repeat that failing syscall for every file, so
+    ``CopyMethodCache.copyfile`` records the ``EXDEV`` per pair of
+    filesystem device numbers and sends later files between the same pair
+    straight to ``copysendfile``.
+
+    Only the ``EXDEV`` outcome is cached.  ``copysendfile``'s own userspace
+    fallback depends on the individual file (it also fires for an empty
+    source), so it is never remembered.  Device numbers can be reused once
+    a filesystem is unmounted, so an instance should live only as long as
+    the job that fills it; ``clear()`` forgets everything.
+    """
+
+    __slots__ = ("_no_clone",)
+
+    def __init__(self) -> None:
+        self._no_clone: set[tuple[int, int]] = set()
+
+    def copyfile(
+        self,
+        src_fd: int,
+        dst_fd: int,
+        devs: tuple[int, int],
+        *,
+        chunk_size: int = MAX_RW_SZ,
+        preallocate: bool = False,
+        fadvise: bool = False,
+    ) -> int:
+        """``copyfile``, skipping ``clonefile`` for pairs known to fail.
+
+        Args:
+            src_fd: Source file descriptor.
+            dst_fd: Destination file descriptor.
+            devs: ``(st_dev of src_fd, st_dev of dst_fd)``.
+            chunk_size, preallocate, fadvise: As for ``copyfile``.
+
+        Returns:
+            Number of bytes written.
+        """
+        if devs not in self._no_clone:
+            try:
+                return clonefile(
+                    src_fd, dst_fd, chunk_size=chunk_size, fadvise=fadvise
+                )
+            except OSError as err:
+                if err.errno != EXDEV:
+                    raise
+                self._no_clone.add(devs)
+        return copysendfile(
+            src_fd,
+            dst_fd,
+            chunk_size=chunk_size,
+            preallocate=preallocate,
+            fadvise=fadvise,
+        )
+
+    def clear(self) -> None:
+        """Forget every recorded filesystem pair."""
+        self._no_clone.clear()
@@ -1,20 +1,22 @@
 # Recursive directory-tree copy.
 #
-# Driven by truenas_os.iter_filesystem_contents (fsiter): depth-first,
-# GIL released, mountpoint-validated.  Cross-mount recursion is performed
-# by enumerating child mounts via iter_mount after the root pass — this
-# mirrors the AclTool pattern in middleware plugins/filesystem_/utils.py.
+# Driven by truenas_os.iter_filesystem_contents_fd (fsiter): depth-first,
+# GIL released, confined to the mount of the fd it starts from.
+# Cross-mount recursion is performed by enumerating child mounts via
+# iter_mount after the root pass — this mirrors the AclTool pattern in
+# middleware plugins/filesystem_/utils.py.
 # ZFS snapshot mounts and the .zfs ctldir are always skipped.
 #
 # Tests are in tests/utils/test_truenas_shutil_copytree.py.
 from __future__ import annotations
 
 import enum
+import errno
 import os
 from typing import Any
 
 from collections.abc import Callable
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from os import (
     O_CREAT,
     O_DIRECTORY,
@@ -24,22 +26,39 @@ from os import (
     O_RDWR,
     O_TRUNC,
     close,
+    dup,
     fchown,
+    fdatasync,
     fstat,
+    fsync,
+    link,
+    listdir,
     makedev,
     mkdir,
     readlink,
+    stat,
     stat_result,
     symlink,
+    unlink,
     utime,
 )
 from pathlib import Path
+from stat import S_IFMT, S_IMODE, S_ISREG
 
 import truenas_os
-from truenas_os import RESOLVE_NO_SYMLINKS, flistxattr, openat2
+from truenas_os import (
+    RESOLVE_BENEATH,
+    RESOLVE_NO_SYMLINKS,
+    fgetxattr,
+    flistxattr,
+    openat2,
+)
 
-from ..mount import statmount as _statmount
 from .copy import (
+    ACCESS_ACL_XATTRS,
+    ACL_XATTRS,
+    MAX_RW_SZ,
+    CopyMethodCache,
     clonefile,
     copy_permissions,
     copy_xattrs,
@@ -54,8 +73,12 @@ __all__ = [
     "DEF_CP_FLAGS",
     "CopyFlags",
     "CopyTreeConfig",
+    "CopyTreeDurability",
+    "CopyTreeMismatch",
+    "CopyTreeMismatchKind",
     "CopyTreeOp",
     "CopyTreeStats",
+    "CopyTreeUpdate",
     "ReportingCallback",
     "copytree",
 ]
@@ -70,6 +93,12 @@ CLONETREE_ROOT_DEPTH = 0
 # avoid descending into a user-visible snapshot directory.
 _ZFSCTL_INO_ROOT = 0x0000FFFFFFFFFFFF
 
+# Upper bound on CopyFlags.HARDLINKS bookkeeping: inodes whose other
+# links have not all been seen yet.  Entries are evicted as soon as their
+# last link is recreated; once the table is full, further multiply-linked
+# inodes are copied as independent files.
+_HARDLINK_TABLE_MAX = 1 << 16
+
 _STATX_DEFAULT_MASK = (
     truenas_os.STATX_BASIC_STATS
     | truenas_os.STATX_BTIME
@@ -77,10 +106,8 @@ _STATX_DEFAULT_MASK = (
 )
 
 # STATMOUNT_SB_SOURCE requires kernel 6.18+; the C extension defines the
-# constant only when the header has it.  When unavailable the traverse code
-# falls back to the mountpoint as the filesystem source name (matches the
-# fsiter fallback path that is also gated on STATMOUNT_SB_SOURCE in the C
-# code), so requesting the field here is best-effort.
+# constant only when the header has it.  It is only used to recognise ZFS
+# snapshot mounts, so requesting the field here is best-effort.
 _STATMOUNT_TRAVERSE_FLAGS = truenas_os.STATMOUNT_MNT_POINT | truenas_os.STATMOUNT_FS_TYPE
 if hasattr(truenas_os, "STATMOUNT_SB_SOURCE"):
     _STATMOUNT_TRAVERSE_FLAGS |= truenas_os.STATMOUNT_SB_SOURCE
@@ -96,6 +123,7 @@ class CopyFlags(enum.IntFlag):
     PERMISSIONS = 0x0002  # copy ACL xattrs (or fchmod if no ACL is present)
     TIMESTAMPS = 0x0004  # copy atime / mtime (in nanoseconds)
     OWNER = 0x0008  # copy uid / gid
+    HARDLINKS = 0x0010  # recreate hard links between copied files
 
 
 class CopyTreeOp(enum.Enum):
@@ -115,6 +143,36 @@ class CopyTreeOp(enum.Enum):
     USERSPACE = enum.auto()  # same as shutil.copyfileobj
 
 
+class CopyTreeUpdate(enum.Enum):
+    """When an existing destination file may be left in place.
+
+    Every mode first requires the destination to be a regular file with
+    the source's size and mtime, so it is only useful together with
+    ``CopyFlags.TIMESTAMPS``.  A file that is left in place has only the
+    metadata that differs rewritten.
+    """
+
+    NONE = enum.auto()  # always copy data (default)
+    SIZE_MTIME = enum.auto()  # skip if size + mtime match
+    CTIME = enum.auto()  # ... and src ctime / btime are not newer than dst's
+    CHECKSUM = enum.auto()  # ... and CRC32C of the contents match
+
+
+class CopyTreeDurability(enum.Enum):
+    """When copied data is forced to stable storage.
+
+    PER_FILE pays one flush per file and directory and leaves every entry
+    durable as soon as its directory is finished.  END defers everything
+    to one ``syncfs(2)`` per destination filesystem after the last mount
+    pass, which is far cheaper for bulk copies but durable only once
+    ``copytree`` returns.
+    """
+
+    NONE = enum.auto()  # leave writeback to the kernel (default)
+    PER_FILE = enum.auto()  # fdatasync each file, fsync each directory
+    END = enum.auto()  # syncfs each destination filesystem at the end
+
+
 DEF_CP_FLAGS = (
     CopyFlags.XATTRS | CopyFlags.PERMISSIONS | CopyFlags.OWNER | CopyFlags.TIMESTAMPS
 )
@@ -143,10 +201,34 @@ class CopyTreeConfig:
         raise_error: Re-raise exceptions from metadata copy (xattr/perm/owner/
             timestamp). When False the operation continues despite failures.
         exist_ok: Do not raise if a target file or directory already exists.
+        update: Leave existing destination files whose data is unchanged in
+            place instead of recopying them; see ``CopyTreeUpdate``.  Only
+            applies with ``exist_ok``.  Not evaluated by ``dry_run``.
         traverse: Recurse into child filesystem mounts under ``src``.  ZFS
             snapshot mounts are always skipped.
         op: Per-file copy operation; see ``CopyTreeOp``.
         flags: Bitmask of metadata categories to preserve.
+        verify: After copying, re-walk source and destination in lockstep
+            and record every difference in ``CopyTreeStats.mismatches``.
+            Metadata is only compared for the categories in ``flags``;
+            file contents are compared by CRC32C.  Ignored with ``dry_run``.
+        dry_run: Walk the source exactly as a copy would (same ``traverse``
+            rules, snapshot and ctldir exclusions) but write nothing.  The
+            returned ``CopyTreeStats`` is an estimate of the work and space
+            the copy needs; ``dst`` is not created.
+        chunk_size: Bytes requested per ``copy_file_range`` / ``sendfile``
+            call for files that are not small enough for
+            ``truenas_os.fcopy_small``.  Ignored with ``CopyTreeOp.USERSPACE``.
+        preallocate: Reserve each file's size in the destination with
+            ``fallocate(2)`` before ``sendfile`` copies it, so a full pool
+            fails the file up front and its blocks are allocated together.
+            Never applied to a block clone.
+        fadvise: Declare sequential reads and drop copied data of large
+            files from the page cache as the copy proceeds, so a bulk copy
+            does not evict the system's cached working set.  Ignored with
+            ``CopyTreeOp.USERSPACE``.
+        durability: When written data is flushed to stable storage; see
+            ``CopyTreeDurability``.  Ignored with ``dry_run``.
     """
 
     reporting_callback: ReportingCallback | None = None
@@ -154,31 +236,111 @@ class CopyTreeConfig:
     reporting_increment: int = 1000
     raise_error: bool = True
     exist_ok: bool = True
+    update: CopyTreeUpdate = CopyTreeUpdate.NONE
     traverse: bool = False
     op: CopyTreeOp = CopyTreeOp.DEFAULT
     flags: CopyFlags = DEF_CP_FLAGS
+    verify: bool = False
+    dry_run: bool = False
+    chunk_size: int = MAX_RW_SZ
+    preallocate: bool = False
+    fadvise: bool = False
+    durability: CopyTreeDurability = CopyTreeDurability.NONE
+
+
+class CopyTreeMismatchKind(enum.Enum):
+    """What differed between a source entry and its copy."""
+
+    MISSING = enum.auto()  # source entry has no destination counterpart
+    EXTRA = enum.auto()  # destination entry has no source counterpart
+    TYPE = enum.auto()  # file type differs (S_IFMT)
+    SIZE = enum.auto()  # regular-file size differs
+    CHECKSUM = enum.auto()  # regular-file CRC32C differs
+    SYMLINK = enum.auto()  # symlink target differs
+    MODE = enum.auto()  # permission bits differ (CopyFlags.PERMISSIONS)
+    ACL = enum.auto()  # access ACL xattr differs (CopyFlags.PERMISSIONS)
+    OWNER = enum.auto()  # (uid, gid) differs (CopyFlags.OWNER)
+    XATTRS = enum.auto()  # non-ACL xattrs differ (CopyFlags.XATTRS)
+    MTIME = enum.auto()  # mtime differs (CopyFlags.TIMESTAMPS)
+
+
+@dataclass(frozen=True, slots=True)
+class CopyTreeMismatch:
+    """One difference found by the ``CopyTreeConfig.verify`` pass.
+
+    Attributes:
+        path: Path relative to the copy root (``"."`` for the root itself).
+        kind: Which property differed.
+        src_value: The source's value for that property, or ``None`` if the
+            source side has none (e.g. ``EXTRA``).
+        dst_value: The destination's value, or ``None`` if absent.
+    """
+
+    path: str
+    kind: CopyTreeMismatchKind
+    src_value: Any
+    dst_value: Any
 
 
 @dataclass(slots=True)
 class CopyTreeStats:
     """Counters returned from ``copytree``.
 
+    With ``CopyTreeConfig.dry_run`` the same counters describe what the copy
+    would do.
+
     Attributes
     ----------
     dirs : int
         Number of directories created in the destination.
     files : int
         Number of regular files copied.
+    skipped : int
+        Number of regular files left in place by ``CopyTreeConfig.update``.
+    skipped_bytes : int
+        Total size of the files counted in ``skipped``.
     symlinks : int
         Number of symlinks recreated.
+    hardlinks : int
+        Number of regular files recreated as hard links to an earlier copy
+        (``CopyFlags.HARDLINKS``).  They are not counted in ``files`` or
+        ``bytes``.
     bytes : int
-        Total bytes written across all regular-file copies.
+        Total bytes written across all regular-file copies (for a dry run,
+        the sum of the source file sizes).
+    blocks : int
+        512-byte blocks allocated to the source regular files.  Sparse,
+        compressed or deduplicated sources allocate fewer blocks than
+        ``bytes`` implies.
+    mounts : int
+        Number of child mounts traversed (``CopyTreeConfig.traverse``).
+    ctldirs : int
+        Number of ZFS ``.zfs`` ctldirs skipped.
+    dst_bytes_free : int | None
+        Space available to unprivileged users on the destination
+        filesystem, sampled by a dry run; ``None`` for a real copy.  A
+        copy that does not clone blocks needs up to ``bytes`` of it.
+    verified : int
+        Number of entries compared by the verify pass (0 unless
+        ``CopyTreeConfig.verify`` is set).
+    mismatches : list[CopyTreeMismatch]
+        Differences found by the verify pass; empty means the destination
+        matches the source.
     """
 
     dirs: int = 0
     files: int = 0
+    skipped: int = 0
+    skipped_bytes: int = 0
     symlinks: int = 0
+    hardlinks: int = 0
     bytes: int = 0
+    blocks: int = 0
+    mounts: int = 0
+    ctldirs: int = 0
+    dst_bytes_free: int | None = None
+    verified: int = 0
+    mismatches: list[CopyTreeMismatch] = field(default_factory=list)
 
 
 # ── Internal helpers ─────────────────────────────────────────────────────────
@@ -204,28 +366,7 @@ def _path_in_ctldir(path: str) -> bool:
     return False
 
 
-def _get_mount_info(fd: int) -> tuple[str, str, str | None, int]:
-    """Resolve ``(mnt_point, fs_source, rel_path, mnt_id)`` for an open fd.
-
-    ``rel_path`` is ``None`` when the fd refers to the mount root itself,
-    which lets ``iter_filesystem_contents`` accept it as a positional
-    argument.  ``fs_source`` falls back to ``mnt_point`` on kernels without
-    ``STATMOUNT_SB_SOURCE`` (kernel < 6.18); fsiter's strict source-name
-    check is also gated on that constant in the C code, so the fallback is
-    benign.
-    """
-    sm = _statmount(fd=fd, as_dict=False)
-    abs_path = readlink(f"/proc/self/fd/{fd}")
-    assert sm.mnt_point is not None
-    assert sm.mnt_id is not None
-    rel = os.path.relpath(abs_path, sm.mnt_point)
-    rel_path = None if rel == "." else rel
-    sb_source = getattr(sm, "sb_source", None)
-    fs_source = sb_source if sb_source is not None else sm.mnt_point
-    return sm.mnt_point, fs_source, rel_path, sm.mnt_id
-
-
-def _select_copy_fn(op: CopyTreeOp) -> Callable[[int, int], int]:
+def _select_copy_fn(op: CopyTreeOp) -> Callable[..., int]:
     match op:
         case CopyTreeOp.DEFAULT:
             return copyfile
@@ -239,6 +380,22 @@ def _select_copy_fn(op: CopyTreeOp) -> Callable[[int, int], int]:
             raise ValueError(f"{op}: unexpected copy operation")
 
 
+def _select_copy_kwargs(
+    config: CopyTreeConfig, c_fn: Callable[..., int]
+) -> dict[str, Any]:
+    if c_fn is not copyfile and c_fn is not clonefile and c_fn is not copysendfile:
+        return {}
+    if config.chunk_size <= 0:
+        raise ValueError(f"{config.chunk_size}: chunk_size must be positive")
+    kwargs: dict[str, Any] = {
+        "chunk_size": config.chunk_size,
+        "fadvise": config.fadvise,
+    }
+    if c_fn is not clonefile:
+        kwargs["preallocate"] = config.preallocate
+    return kwargs
+
+
 @dataclass(frozen=True, slots=True)
 class _Frame:
     """One entry on _CopyTreeRunner's destination-side directory stack.
@@ -258,6 +415,44 @@ class _Frame:
     src_statx: truenas_os.StatxResult
 
 
+@dataclass(slots=True)
+class _LinkTarget:
+    """Destination of the first copy of a multiply-linked source inode.
+
+    While ``frame`` is still ``_CopyTreeRunner.frames[depth]`` its
+    ``dst_fd`` is the directory holding the copy; once it has been popped
+    the directory is reopened from the mount pass's destination root via
+    ``rel_dir``.  ``frame`` is ``None`` in a dry run, which only counts.
+    ``remaining`` is the number of source links not yet seen; the entry is
+    evicted when it reaches zero.
+    """
+
+    frame: _Frame | None
+    depth: int
+    rel_dir: str
+    name: str
+    remaining: int
+
+
+@dataclass(frozen=True, slots=True)
+class _VerifyFrame:
+    """One entry on the verify pass's destination-side directory stack.
+
+    ``dst_fd`` is a read-only directory fd with the same ownership rules
+    as ``_Frame.dst_fd``.  ``path`` is the directory's path relative to
+    the copy root and ``seen`` collects the source names visited in it,
+    so destination-only names can be reported when the frame is popped.
+    """
+
+    dst_fd: int
+    path: str
+    seen: set[str]
+
+
+def _read_xattrs(fd: int, names: set[str]) -> dict[str, bytes]:
+    return {name: fgetxattr(fd, name) for name in names}
+
+
 # ── Recursive copy runner (private) ──────────────────────────────────────────
 
 
@@ -271,27 +466,60 @@ class _CopyTreeRunner:
     stats : CopyTreeStats
         Mutable counters returned to ``copytree``'s caller.  Updated
         in place as files / dirs / symlinks / bytes are processed.
-    c_fn : Callable[[int, int], int]
+    c_fn : Callable[..., int]
         Per-file copy primitive selected from ``config.op``
         (``copyfile`` / ``clonefile`` / ``copysendfile`` /
         ``copyuserspace``).
+    copy_methods : CopyMethodCache | None
+        Set when ``c_fn`` is ``copyfile``; regular files are then copied
+        through it so a filesystem pair that cannot clone fails
+        ``copy_file_range`` once per run rather than once per file.
+    small_copy : bool
+        True when ``c_fn`` is one of ``copyfile`` / ``copysendfile``, i.e.
+        when a regular file smaller than ``truenas_os.FCOPY_SMALL_MAX``
+        may be copied with ``truenas_os.fcopy_small`` instead.  Never set
+        for ``CopyTreeOp.CLONE`` (which must clone) or ``USERSPACE``
+        (meant for filesystems whose reads ``fcopy_small`` cannot trust).
+    copy_kwargs : dict[str, Any]
+        ``chunk_size`` / ``preallocate`` / ``fadvise`` from ``config``, as
+        accepted by ``c_fn``: without ``preallocate`` for ``clonefile``,
+        empty for ``copyuserspace``.
+    devs : tuple[int, int]
+        ``(src st_dev, dst st_dev)`` of the mount pass in progress; the
+        ``copy_methods`` key.  fsiter stays on one source mount per pass
+        and every destination file is created under that pass's
+        destination root.
     src_fd : int
         Caller-owned source-root directory fd.  Borrowed for the
         lifetime of the runner; not closed here.
     dst_fd : int
         Caller-owned destination-root directory fd.  Borrowed for the
-        lifetime of the runner; not closed here.
+        lifetime of the runner; not closed here.  ``-1`` for a dry run
+        whose destination does not exist yet.
     src_root_real : str
         ``readlink('/proc/self/fd/<src_fd>')`` — the canonical
-        absolute path of ``src_fd``.  Used to compute relative paths
-        when traversing into child mounts.
-    target_st : os.stat_result
+        absolute path of ``src_fd``.  Reported as ``item.parent`` root
+        for the first pass and used to compute relative paths when
+        traversing into child mounts.
+    target_st : os.stat_result | None
         ``fstat(dst_fd)`` snapshot.  Used by ``_is_dst_into_self`` to
         skip an entry whose dev_t + inode match the dst root
-        (prevents copying the destination back into itself).
+        (prevents copying the destination back into itself).  ``None``
+        when ``dst_fd`` is ``-1``.
+    sync_fds : dict[int, int]
+        ``CopyTreeDurability.END`` only: destination ``st_dev`` → runner-
+        owned ``dup`` of the first mount-pass destination root on that
+        filesystem, to be ``syncfs``'d once every pass is done.
     frames : list[_Frame]
         Destination-side directory stack — one ``_Frame`` per source
         directory level we've descended into.  See `Notes`.
+    links : dict[tuple[int, int], _LinkTarget]
+        ``CopyFlags.HARDLINKS`` table: ``(st_dev, st_ino)`` of a source
+        file with ``stx_nlink > 1`` → where its first copy was written.
+        Reset for every mount pass, since links cannot cross mounts.
+    link_root : tuple[str, int]
+        ``(root_path, root_dst_fd)`` of the mount pass in progress;
+        ``_LinkTarget.rel_dir`` is relative to these.
 
     Notes
     -----
@@ -323,11 +551,18 @@ class _CopyTreeRunner:
         "config",
         "stats",
         "c_fn",
+        "copy_methods",
+        "small_copy",
+        "copy_kwargs",
+        "devs",
         "src_fd",
         "dst_fd",
         "src_root_real",
         "target_st",
+        "sync_fds",
         "frames",
+        "links",
+        "link_root",
     )
 
     def __init__(self, config: CopyTreeConfig, src_fd: int, dst_fd: int) -> None:
@@ -340,30 +575,71 @@ class _CopyTreeRunner:
         self.config = config
         self.stats = CopyTreeStats()
         self.c_fn = _select_copy_fn(config.op)
+        self.copy_methods = CopyMethodCache() if self.c_fn is copyfile else None
+        self.small_copy = self.c_fn is copyfile or self.c_fn is copysendfile
+        self.copy_kwargs = _select_copy_kwargs(config, self.c_fn)
+        self.devs = (0, 0)
         self.src_fd = src_fd
         self.dst_fd = dst_fd
         self.src_root_real = readlink(f"/proc/self/fd/{src_fd}")
         # st_ino + st_dev of the destination root: used to detect copying
         # the destination back into itself (e.g. dst is a subdirectory of src).
-        self.target_st: stat_result = fstat(dst_fd)
+        self.target_st: stat_result | None = fstat(dst_fd) if dst_fd >= 0 else None
+        self.sync_fds: dict[int, int] = {}
         # frames[i] is one _Frame per destination-side directory level we
         # have descended into.  See class docstring for ownership rules.
         self.frames: list[_Frame] = []
+        self.links: dict[tuple[int, int], _LinkTarget] = {}
+        self.link_root = ("", -1)
 
     # ── per-entry handlers ───────────────────────────────────────────────
 
     def _do_mkfile(self, item: truenas_os.IterInstance, dst_file_fd: int) -> None:
         """Copy file metadata + data from ``item.fd`` to ``dst_file_fd``."""
         flags = self.config.flags
+        stx = item.statxinfo
         xattrs: list[str] = []
         if flags & (CopyFlags.PERMISSIONS | CopyFlags.XATTRS):
             xattrs = flistxattr(item.fd)
 
-        if flags & CopyFlags.PERMISSIONS:
+        # Small files take the native path: data, owner, mode and
+        # timestamps in one fcopy_small() call.  Mode is only folded in
+        # when no access ACL xattr has to be copied instead, and metadata
+        # only when its errors are fatal anyway (raise_error).
+        #
+        # Every path sets the owner before the mode, ACL and xattrs:
+        # chown(2) clears the set-ID bits and security.capability, so
+        # either would be lost if applied first.  Small files therefore
+        # get their remaining metadata after fcopy_small(); large files
+        # get all of it before the data copy.
+        small = self.small_copy and stx.stx_size < truenas_os.FCOPY_SMALL_MAX
+        native_meta = small and self.config.raise_error
+        mode = -1
+        ns = None
+
+        if small:
+            uid = gid = -1
+            if flags & CopyFlags.OWNER:
+                uid, gid = stx.stx_uid, stx.stx_gid
+            if (
+                native_meta
+                and flags & CopyFlags.PERMISSIONS
+                and not ACCESS_ACL_XATTRS.intersection(xattrs)
+            ):
+                mode = S_IMODE(stx.stx_mode)
+            if native_meta and flags & CopyFlags.TIMESTAMPS:
+                ns = (stx.stx_atime_ns, stx.stx_mtime_ns)
+            self.stats.bytes += truenas_os.fcopy_small(
+                item.fd, dst_file_fd, uid=uid, gid=gid, mode=mode, ns=ns
+            )
+        elif flags & CopyFlags.OWNER:
+            fchown(dst_file_fd, stx.stx_uid, stx.stx_gid)
+
+        # fchmod and fsetxattr change only ctime, so running them after
+        # fcopy_small() has set the timestamps leaves those intact.
+        if flags & CopyFlags.PERMISSIONS and mode == -1:
             try:
-                copy_permissions(
-                    item.fd, dst_file_fd, xattrs, item.statxinfo.stx_mode
-                )
+                copy_permissions(item.fd, dst_file_fd, xattrs, stx.stx_mode)
             except Exception:
                 if self.config.raise_error:
                     raise
@@ -375,21 +651,230 @@ class _CopyTreeRunner:
                 if self.config.raise_error:
                     raise
 
-        if flags & CopyFlags.OWNER:
-            fchown(dst_file_fd, item.statxinfo.stx_uid, item.statxinfo.stx_gid)
-
-        self.stats.bytes += self.c_fn(item.fd, dst_file_fd)
+        if small:
+            if ns is not None or not flags & CopyFlags.TIMESTAMPS:
+                return
+        elif self.copy_methods is not None:
+            self.stats.bytes += self.copy_methods.copyfile(
+                item.fd, dst_file_fd, self.devs, **self.copy_kwargs
+            )
+        else:
+            self.stats.bytes += self.c_fn(
+                item.fd, dst_file_fd, **self.copy_kwargs
+            )
 
         # Write timestamps last so that data and metadata writes do not
         # bump them.
         if flags & CopyFlags.TIMESTAMPS:
-            ns_ts = (item.statxinfo.stx_atime_ns, item.statxinfo.stx_mtime_ns)
+            ns_ts = (stx.stx_atime_ns, stx.stx_mtime_ns)
             try:
                 utime(dst_file_fd, ns=ns_ts)
             except Exception:
                 if self.config.raise_error:
                     raise
 
+    def _reconcile_metadata(
+        self,
+        item: truenas_os.IterInstance,
+        dst_fd: int,
+        dst_stx: truenas_os.StatxResult,
+    ) -> None:
+        """Rewrite only the ``config.flags`` metadata that differs on ``dst_fd``.
+
+        Used for files left in place by ``config.update``; their size and
+        mtime already match, so timestamps are never touched.
+        """
+        flags = self.config.flags
+        src_stx = item.statxinfo
+        xattrs: list[str] = []
+        dst_names: set[str] = set()
+        try:
+            if flags & (CopyFlags.PERMISSIONS | CopyFlags.XATTRS):
+                xattrs = flistxattr(item.fd)
+                dst_names = set(flistxattr(dst_fd))
+            src_names = set(xattrs)
+
+            # Owner first, as in _do_mkfile: chown(2) clears the set-ID
+            # bits, so the mode has to be rewritten after it.
+            chowned = False
+            if flags & CopyFlags.OWNER and (
+                (src_stx.stx_uid, src_stx.stx_gid)
+                != (dst_stx.stx_uid, dst_stx.stx_gid)
+            ):
+                fchown(dst_fd, src_stx.stx_uid, src_stx.stx_gid)
+                chowned = True
+
+            if flags & CopyFlags.PERMISSIONS:
+                acl = src_names & ACCESS_ACL_XATTRS
+                if (
+                    chowned
+                    or S_IMODE(src_stx.stx_mode) != S_IMODE(dst_stx.stx_mode)
+                    or _read_xattrs(item.fd, acl)
+                    != _read_xattrs(dst_fd, dst_names & ACCESS_ACL_XATTRS)
+                ):
+                    copy_permissions(item.fd, dst_fd, xattrs, src_stx.stx_mode)
+
+            if flags & CopyFlags.XATTRS:
+                names = {
+                    n for n in src_names - ACL_XATTRS if not n.startswith("system")
+                }
+                if not names <= dst_names or _read_xattrs(
+                    item.fd, names
+                ) != _read_xattrs(dst_fd, names):
+                    copy_xattrs(item.fd, dst_fd, xattrs)
+        except Exception:
+            if self.config.raise_error:
+                raise
+
+    def _try_skip_file(self, item: truenas_os.IterInstance, dst_dir_fd: int) -> bool:
+        """Apply ``config.update`` to the regular file ``item``.
+
+        Returns True if the existing destination file already holds the
+        source's data; its differing metadata has then been reconciled and
+        the caller must not copy it.  Returns False if the file has to be
+        copied as usual.
+        """
+        mode = self.config.update
+        if mode is CopyTreeUpdate.NONE or not self.config.exist_ok:
+            return False
+
+        try:
+            dst_stx = truenas_os.statx(
+                item.name,
+                dir_fd=dst_dir_fd,
+                flags=truenas_os.AT_SYMLINK_NOFOLLOW,
+                mask=_STATX_DEFAULT_MASK,
+            )
+        except FileNotFoundError:
+            return False
+
+        src_stx = item.statxinfo
+        if (
+            not S_ISREG(dst_stx.stx_mode)
+            or src_stx.stx_size != dst_stx.stx_size
+            or src_stx.stx_mtime_ns != dst_stx.stx_mtime_ns
+        ):
+            return False
+
+        # The copy was written after the source last changed, so a source
+        # ctime / btime past the destination's means it changed since
+        # (e.g. rewritten with its mtime restored, or replaced).
+        if mode is CopyTreeUpdate.CTIME and (
+            src_stx.stx_ctime_ns > dst_stx.stx_ctime_ns
+            or src_stx.stx_btime_ns > dst_stx.stx_btime_ns
+        ):
+            return False
+
+        # Read-only is enough for the checksum and the f*() metadata calls,
+        # and unlike O_RDWR it opens a running binary (ETXTBSY) or an
+        # immutable file.  Any open failure leaves the file to the normal
+        # copy path, which applies config.raise_error.
+        try:
+            dst_fd = openat2(
+                item.name, O_RDONLY | O_NOFOLLOW,
+                dir_fd=dst_dir_fd, resolve=RESOLVE_NO_SYMLINKS,
+            )
+        except OSError:
+            return False
+        try:
+            if mode is CopyTreeUpdate.CHECKSUM:
+                src_crc, dst_crc = truenas_os.fcrc32c_pair(item.fd, dst_fd)
+                if src_crc != dst_crc:
+                    return False
+            self._reconcile_metadata(item, dst_fd, dst_stx)
+        finally:
+            close(dst_fd)
+
+        self.stats.skipped += 1
+        self.stats.skipped_bytes += src_stx.stx_size
+        return True
+
+    def _link_key(self, item: truenas_os.IterInstance) -> tuple[int, int] | None:
+        """``(st_dev, st_ino)`` of ``item`` if ``HARDLINKS`` applies to it."""
+        stx = item.statxinfo
+        if stx.stx_nlink < 2 or not self.config.flags & CopyFlags.HARDLINKS:
+            return None
+        return (makedev(stx.stx_dev_major, stx.stx_dev_minor), stx.stx_ino)
+
+    def _remember_link(
+        self, key: tuple[int, int] | None, item: truenas_os.IterInstance
+    ) -> None:
+        """Record the copy of ``item`` as the target of its later links."""
+        if key is None or len(self.links) >= _HARDLINK_TABLE_MAX:
+            return
+        if self.frames:
+            frame = self.frames[-1]
+            rel_dir = os.path.relpath(item.parent, self.link_root[0])
+        else:
+            frame, rel_dir = None, ""
+        self.links[key] = _LinkTarget(
+            frame, len(self.frames) - 1, rel_dir, item.name,
+            item.statxinfo.stx_nlink - 1,
+        )
+
+    def _seen_link(self, key: tuple[int, int], target: _LinkTarget) -> None:
+        target.remaining -= 1
+        if target.remaining == 0:
+            del self.links[key]
+        self.stats.hardlinks += 1
+
+    def _try_link(
+        self,
+        key: tuple[int, int] | None,
+        item: truenas_os.IterInstance,
+        dst_dir_fd: int,
+    ) -> bool:
+        """Recreate ``item`` as a hard link to an earlier copy of its inode.
+
+        Returns False if no copy of the inode has been recorded, or if the
+        recorded copy has disappeared from the destination; the caller then
+        copies ``item`` as an independent file.
+        """
+        target = self.links.get(key) if key is not None else None
+        if target is None:
+            return False
+
+        frames = self.frames
+        if target.depth < len(frames) and frames[target.depth] is target.frame:
+            src_dir_fd = target.frame.dst_fd
+            opened = False
+        else:
+            try:
+                src_dir_fd = openat2(
+                    target.rel_dir,
+                    O_RDONLY | O_DIRECTORY,
+                    dir_fd=self.link_root[1],
+                    resolve=RESOLVE_NO_SYMLINKS | RESOLVE_BENEATH,
+                )
+            except FileNotFoundError:
+                del self.links[key]
+                return False
+            opened = True
+
+        try:
+            link(target.name, item.name, src_dir_fd=src_dir_fd,
+                 dst_dir_fd=dst_dir_fd, follow_symlinks=False)
+        except FileNotFoundError:
+            # The first copy was removed or renamed under us.
+            del self.links[key]
+            return False
+        except FileExistsError:
+            if not self.config.exist_ok:
+                raise
+            old = stat(item.name, dir_fd=dst_dir_fd, follow_symlinks=False)
+            new = stat(target.name, dir_fd=src_dir_fd, follow_symlinks=False)
+            # An earlier run may already have linked the pair.
+            if (old.st_dev, old.st_ino) != (new.st_dev, new.st_ino):
+                unlink(item.name, dir_fd=dst_dir_fd)
+                link(target.name, item.name, src_dir_fd=src_dir_fd,
+                     dst_dir_fd=dst_dir_fd, follow_symlinks=False)
+        finally:
+            if opened:
+                close(src_dir_fd)
+
+        self._seen_link(key, target)
+        return True
+
     def _do_mkdir(self, item: truenas_os.IterInstance, parent_dst_fd: int) -> int:
         """Create the destination subdirectory and copy non-timestamp metadata.
 
@@ -460,17 +945,25 @@ class _CopyTreeRunner:
         to the caller.
         """
         frame = self.frames.pop()
-        if self.config.flags & CopyFlags.TIMESTAMPS:
-            try:
-                utime(
-                    frame.dst_fd,
-                    ns=(frame.src_statx.stx_atime_ns, frame.src_statx.stx_mtime_ns),
-                )
-            except Exception:
-                if self.config.raise_error:
-                    close(frame.dst_fd)
-                    raise
-        close(frame.dst_fd)
+        try:
+            if self.config.flags & CopyFlags.TIMESTAMPS:
+                try:
+                    utime(
+                        frame.dst_fd,
+                        ns=(
+                            frame.src_statx.stx_atime_ns,
+                            frame.src_statx.stx_mtime_ns,
+                        ),
+                    )
+                except Exception:
+                    if self.config.raise_error:
+                        raise
+            if self.config.durability is CopyTreeDurability.PER_FILE:
+                # Every entry of this directory is in place: make their
+                # names durable along with the directory's own metadata.
+                fsync(frame.dst_fd)
+        finally:
+            close(frame.dst_fd)
 
     def _is_dst_into_self(self, item: truenas_os.IterInstance) -> bool:
         """True if ``item`` is the destination root.
@@ -478,6 +971,8 @@ class _CopyTreeRunner:
         Checked via dev_t + inode, since bind mounts of the same filesystem
         share ``stx_dev`` but differ in ``stx_mnt_id``.
         """
+        if self.target_st is None:
+            return False
         if item.statxinfo.stx_ino != self.target_st.st_ino:
             return False
         return (
@@ -490,17 +985,18 @@ class _CopyTreeRunner:
     def _process_mount(
         self,
         src_root_fd: int,
-        mnt_point: str,
-        fs_name: str,
-        rel_path: str | None,
+        root_path: str,
         root_dst_fd: int,
     ) -> None:
         """Iterate one filesystem mount and apply its copy operations.
 
         ``src_root_fd`` and ``root_dst_fd`` are owned by the caller; this
-        method does not close them.  Their metadata is applied at the end
-        of iteration so children are processed before the directory's
-        timestamps are stamped.
+        method does not close them.  ``root_path`` is the absolute path of
+        ``src_root_fd``, used only to build ``item.parent``.
+
+        Directory metadata is applied when the directory's frame is
+        popped, and the root's at the end of iteration, so children are
+        processed before a directory's timestamps are stamped.
         """
         root_stat = truenas_os.statx(
             "",
@@ -511,16 +1007,27 @@ class _CopyTreeRunner:
         root_xattrs: list[str] = []
         if self.config.flags & (CopyFlags.PERMISSIONS | CopyFlags.XATTRS):
             root_xattrs = flistxattr(src_root_fd)
+        self.devs = (
+            makedev(root_stat.stx_dev_major, root_stat.stx_dev_minor),
+            fstat(root_dst_fd).st_dev,
+        )
+        self.links.clear()
+        self.link_root = (root_path, root_dst_fd)
+        if (
+            self.config.durability is CopyTreeDurability.END
+            and self.devs[1] not in self.sync_fds
+        ):
+            self.sync_fds[self.devs[1]] = dup(root_dst_fd)
 
         # Stack invariant: at function exit (normal or exceptional) the
         # frame count is restored.
         initial_len = len(self.frames)
         self.frames.append(_Frame(root_dst_fd, root_stat))
+        durability = self.config.durability
         try:
-            with truenas_os.iter_filesystem_contents(
-                mnt_point,
-                fs_name,
-                rel_path,
+            with truenas_os.iter_filesystem_contents_fd(
+                src_root_fd,
+                path=root_path,
                 reporting_increment=self.config.reporting_increment,
                 reporting_callback=self.config.reporting_callback,
                 reporting_private_data=self.config.reporting_private_data,
@@ -546,6 +1053,7 @@ class _CopyTreeRunner:
                             os.path.join(item.parent, item.name)
                         ):
                             it.skip()
+                            self.stats.ctldirs += 1
                             continue
                         if self._is_dst_into_self(item):
                             it.skip()
@@ -556,6 +1064,13 @@ class _CopyTreeRunner:
                         self.stats.dirs += 1
 
                     elif item.isreg:
+                        link_key = self._link_key(item)
+                        if self._try_link(link_key, item, dst_dir_fd):
+                            continue
+                        if self._try_skip_file(item, dst_dir_fd):
+                            self._remember_link(link_key, item)
+                            continue
+
                         open_flags = O_RDWR | O_NOFOLLOW | O_CREAT | O_TRUNC
                         if not self.config.exist_ok:
                             open_flags |= O_EXCL
@@ -572,9 +1087,13 @@ class _CopyTreeRunner:
                         )
                         try:
                             self._do_mkfile(item, dst_file_fd)
+                            if durability is CopyTreeDurability.PER_FILE:
+                                fdatasync(dst_file_fd)
                         finally:
                             close(dst_file_fd)
                         self.stats.files += 1
+                        self.stats.blocks += item.statxinfo.stx_blocks
+                        self._remember_link(link_key, item)
 
                     elif item.islnk:
                         self._handle_symlink(item, dst_dir_fd)
@@ -592,6 +1111,8 @@ class _CopyTreeRunner:
             self._apply_root_metadata(
                 src_root_fd, root_dst_fd, root_xattrs, root_stat
             )
+            if durability is CopyTreeDurability.PER_FILE:
+                fsync(root_dst_fd)
         finally:
             # Cleanup invariant: at function exit, frames length is
             # restored to ``initial_len``.  In the normal path only the
@@ -645,27 +1166,351 @@ class _CopyTreeRunner:
             if self.config.raise_error:
                 raise
 
+    def _estimate_mount(
+        self,
+        src_root_fd: int,
+        root_path: str,
+        root_dst_fd: int,
+    ) -> None:
+        """Dry-run counterpart of ``_process_mount``: count, never write.
+
+        Same signature and skip rules as ``_process_mount`` so it can be
+        handed to ``_traverse_child_mounts``.  No frame stack is needed
+        because nothing is opened on the destination side; ``root_dst_fd``
+        is unused.
+        """
+        self.links.clear()
+        with truenas_os.iter_filesystem_contents_fd(
+            src_root_fd,
+            path=root_path,
+            reporting_increment=self.config.reporting_increment,
+            reporting_callback=self.config.reporting_callback,
+            reporting_private_data=self.config.reporting_private_data,
+            include_symlinks=True,
+        ) as it:
+            for item in it:
+                if item.isdir:
+                    if item.name == ".zfs" and _path_in_ctldir(
+                        os.path.join(item.parent, item.name)
+                    ):
+                        it.skip()
+                        self.stats.ctldirs += 1
+                        continue
+                    if self._is_dst_into_self(item):
+                        it.skip()
+                        continue
+                    self.stats.dirs += 1
+
+                elif item.isreg:
+                    link_key = self._link_key(item)
+                    target = self.links.get(link_key) if link_key else None
+                    if target is not None:
+                        self._seen_link(link_key, target)
+                        continue
+                    self.stats.files += 1
+                    self.stats.bytes += item.statxinfo.stx_size
+                    self.stats.blocks += item.statxinfo.stx_blocks
+                    self._remember_link(link_key, item)
+
+                elif item.islnk:
+                    self.stats.symlinks += 1
+
+    # ── verify pass ──────────────────────────────────────────────────────
+
+    def _mismatch(
+        self, path: str, kind: CopyTreeMismatchKind, src_value: Any, dst_value: Any
+    ) -> None:
+        self.stats.mismatches.append(
+            CopyTreeMismatch(path, kind, src_value, dst_value)
+        )
+
+    def _verify_metadata(
+        self,
+        path: str,
+        src_fd: int,
+        dst_fd: int,
+        src_stx: truenas_os.StatxResult,
+        dst_stx: truenas_os.StatxResult,
+    ) -> None:
+        """Compare the metadata categories selected by ``config.flags``.
+
+        Only what ``copytree`` actually copies is compared: the access ACL
+        xattrs (not the POSIX default ACL) and non-``system`` xattrs.
+        """
+        flags = self.config.flags
+        if flags & CopyFlags.PERMISSIONS:
+            src_mode, dst_mode = S_IMODE(src_stx.stx_mode), S_IMODE(dst_stx.stx_mode)
+            if src_mode != dst_mode:
+                self._mismatch(path, CopyTreeMismatchKind.MODE, src_mode, dst_mode)
+
+        if flags & CopyFlags.OWNER:
+            src_owner = (src_stx.stx_uid, src_stx.stx_gid)
+            dst_owner = (dst_stx.stx_uid, dst_stx.stx_gid)
+            if src_owner != dst_owner:
+                self._mismatch(path, CopyTreeMismatchKind.OWNER, src_owner, dst_owner)
+
+        if flags & CopyFlags.TIMESTAMPS and src_stx.stx_mtime_ns != dst_stx.stx_mtime_ns:
+            self._mismatch(
+                path, CopyTreeMismatchKind.MTIME,
+                src_stx.stx_mtime_ns, dst_stx.stx_mtime_ns,
+            )
+
+        if not flags & (CopyFlags.PERMISSIONS | CopyFlags.XATTRS):
+            return
+
+        src_names = set(flistxattr(src_fd))
+        dst_names = set(flistxattr(dst_fd))
+        if flags & CopyFlags.PERMISSIONS:
+            src_acl = _read_xattrs(src_fd, src_names & ACCESS_ACL_XATTRS)
+            dst_acl = _read_xattrs(dst_fd, dst_names & ACCESS_ACL_XATTRS)
+            if src_acl != dst_acl:
+                self._mismatch(path, CopyTreeMismatchKind.ACL, src_acl, dst_acl)
+
+        if flags & CopyFlags.XATTRS:
+            src_x = _read_xattrs(src_fd, {
+                n for n in src_names - ACL_XATTRS if not n.startswith("system")
+            })
+            dst_x = _read_xattrs(dst_fd, {
+                n for n in dst_names - ACL_XATTRS if not n.startswith("system")
+            })
+            if src_x != dst_x:
+                self._mismatch(path, CopyTreeMismatchKind.XATTRS, src_x, dst_x)
+
+    def _verify_entry(
+        self, item: truenas_os.IterInstance, dst_dir_fd: int, path: str
+    ) -> int | None:
+        """Compare one source directory, regular file or symlink.
+
+        The destination is ``statx``-ed by name before anything is opened,
+        so a destination fifo or device in place of a file is reported as
+        a ``TYPE`` mismatch instead of blocking in ``open``.
+
+        Returns a read-only fd to the destination directory when ``item``
+        is a directory that exists on both sides (the caller pushes it on
+        the verify frame stack), otherwise ``None``.
+        """
+        src_stx = item.statxinfo
+        try:
+            dst_stx = truenas_os.statx(
+                item.name,
+                dir_fd=dst_dir_fd,
+                flags=truenas_os.AT_SYMLINK_NOFOLLOW,
+                mask=_STATX_DEFAULT_MASK,
+            )
+        except FileNotFoundError:
+            self._mismatch(
+                path, CopyTreeMismatchKind.MISSING, S_IFMT(src_stx.stx_mode), None
+            )
+            return None
+
+        self.stats.verified += 1
+        if S_IFMT(src_stx.stx_mode) != S_IFMT(dst_stx.stx_mode):
+            self._mismatch(
+                path, CopyTreeMismatchKind.TYPE,
+                S_IFMT(src_stx.stx_mode), S_IFMT(dst_stx.stx_mode),
+            )
+            return None
+
+        if item.islnk:
+            src_target = readlink("", dir_fd=item.fd)
+            dst_target = readlink(item.name, dir_fd=dst_dir_fd)
+            if src_target != dst_target:
+                self._mismatch(
+                    path, CopyTreeMismatchKind.SYMLINK, src_target, dst_target
+                )
+            return None
+
+        open_flags = O_RDONLY | O_NOFOLLOW
+        if item.isdir:
+            open_flags |= O_DIRECTORY
+        dst_fd = openat2(
+            item.name, open_flags, dir_fd=dst_dir_fd, resolve=RESOLVE_NO_SYMLINKS
+        )
+        try:
+            self._verify_metadata(path, item.fd, dst_fd, src_stx, dst_stx)
+            if item.isreg:
+                if src_stx.stx_size != dst_stx.stx_size:
+                    self._mismatch(
+                        path, CopyTreeMismatchKind.SIZE,
+                        src_stx.stx_size, dst_stx.stx_size,
+                    )
+                else:
+                    # Both files are streamed concurrently in C, GIL released.
+                    src_crc, dst_crc = truenas_os.fcrc32c_pair(item.fd, dst_fd)
+                    if src_crc != dst_crc:
+                        self._mismatch(
+                            path, CopyTreeMismatchKind.CHECKSUM, src_crc, dst_crc
+                        )
+        except BaseException:
+            close(dst_fd)
+            raise
+
+        if item.isdir:
+            return dst_fd
+        close(dst_fd)
+        return None
+
+    def _pop_verify_frame(self, frames: list[_VerifyFrame]) -> None:
+        """Pop a runner-owned verify frame, report EXTRA names, then close."""
+        frame = frames.pop()
+        try:
+            self._check_extras(frame)
+        finally:
+            close(frame.dst_fd)
+
+    def _check_extras(self, frame: _VerifyFrame) -> None:
+        for name in sorted(set(listdir(frame.dst_fd)) - frame.seen):
+            self._mismatch(
+                os.path.normpath(os.path.join(frame.path, name)),
+                CopyTreeMismatchKind.EXTRA, None, None,
+            )
+
+    def _verify_mount(
+        self,
+        src_root_fd: int,
+        root_path: str,
+        root_dst_fd: int,
+    ) -> None:
+        """Re-walk one mount and compare it against the destination.
+
+        Same signature, iteration and frame bookkeeping as
+        ``_process_mount``, but nothing is written: destination
+        directories are opened read-only and every difference is
+        appended to ``stats.mismatches``.  Child mountpoints are
+        requested from fsiter only so their names are not reported as
+        ``EXTRA``; their contents are verified by their own pass.
+        """
+        rel_root = os.path.relpath(root_path, self.src_root_real)
+        src_root_stat = truenas_os.statx(
+            "", dir_fd=src_root_fd, flags=truenas_os.AT_EMPTY_PATH,
+            mask=_STATX_DEFAULT_MASK,
+        )
+        dst_root_stat = truenas_os.statx(
+            "", dir_fd=root_dst_fd, flags=truenas_os.AT_EMPTY_PATH,
+            mask=_STATX_DEFAULT_MASK,
+        )
+        self.stats.verified += 1
+        self._verify_metadata(
+            rel_root, src_root_fd, root_dst_fd, src_root_stat, dst_root_stat
+        )
+
+        # frames[0] is the caller-owned mount root; all others are ours.
+        frames = [_VerifyFrame(root_dst_fd, rel_root, set())]
+        try:
+            with truenas_os.iter_filesystem_contents_fd(
+                src_root_fd,
+                path=root_path,
+                reporting_increment=self.config.reporting_increment,
+                reporting_callback=self.config.reporting_callback,
+                reporting_private_data=self.config.reporting_private_data,
+                include_symlinks=True,
+                include_mountpoints=True,
+            ) as it:
+                for item in it:
+                    # Same dir_stack arithmetic as _process_mount;
+                    # mountpoints are yielded like files (never descended).
+                    ds_len = len(it.dir_stack())
+                    descend = item.isdir and not item.ismount
+                    target = ds_len - 1 if descend else ds_len
+                    while len(frames) > target:
+                        self._pop_verify_frame(frames)
+
+                    parent = frames[-1]
+                    parent.seen.add(item.name)
+                    path = os.path.normpath(os.path.join(parent.path, item.name))
+
+                    if item.ismount:
+                        continue
+
+                    if item.isdir:
+                        if item.name == ".zfs" and _path_in_ctldir(
+                            os.path.join(item.parent, item.name)
+                        ):
+                            it.skip()
+                            continue
+                        if self._is_dst_into_self(item):
+                            it.skip()
+                            continue
+
+                        new_dst_fd = self._verify_entry(item, parent.dst_fd, path)
+                        if new_dst_fd is None:
+                            it.skip()
+                            continue
+                        frames.append(_VerifyFrame(new_dst_fd, path, set()))
+
+                    elif item.isreg or item.islnk:
+                        self._verify_entry(item, parent.dst_fd, path)
+
+                    # Irregular types are never copied, so not verified.
+
+            while len(frames) > 1:
+                self._pop_verify_frame(frames)
+            self._check_extras(frames[0])
+        finally:
+            while len(frames) > 1:
+                try:
+                    close(frames.pop().dst_fd)
+                except OSError:
+                    pass
+
     # ── entry point ──────────────────────────────────────────────────────
 
     def run(self) -> CopyTreeStats:
         """Execute the copy and return ``CopyTreeStats``.
 
-        Resolves the source mount via ``_get_mount_info``, runs one
-        ``_process_mount`` pass against it, and (when
+        Runs one ``_process_mount`` pass over the source root, and (when
         ``config.traverse=True``) repeats for each child mount under
-        ``src_fd`` via ``_traverse_child_mounts``.
+        ``src_fd`` via ``_traverse_child_mounts``.  With ``config.dry_run``
+        ``_estimate_mount`` stands in for ``_process_mount``.  With
+        ``config.verify`` the same sequence is then repeated with
+        ``_verify_mount``.  ``CopyTreeDurability.END`` flushes the
+        destination in between.
         """
-        mnt_point, fs_name, rel_path, mnt_id = _get_mount_info(self.src_fd)
-        self._process_mount(self.src_fd, mnt_point, fs_name, rel_path, self.dst_fd)
+        mnt_id = truenas_os.statx(
+            "", dir_fd=self.src_fd, flags=truenas_os.AT_EMPTY_PATH,
+            mask=truenas_os.STATX_MNT_ID_UNIQUE,
+        ).stx_mnt_id
+        if self.config.dry_run:
+            process = self._estimate_mount
+        else:
+            process = self._process_mount
+        try:
+            process(self.src_fd, self.src_root_real, self.dst_fd)
 
-        if self.config.traverse:
-            self._traverse_child_mounts(mnt_id)
+            if self.config.traverse:
+                self.stats.mounts = self._traverse_child_mounts(mnt_id, process)
+
+            # CopyTreeDurability.END: one flush per destination filesystem,
+            # after the last pass that could write to it.
+            for sync_fd in self.sync_fds.values():
+                truenas_os.syncfs(sync_fd)
+        finally:
+            for sync_fd in self.sync_fds.values():
+                close(sync_fd)
+            self.sync_fds.clear()
+
+        if self.config.verify and not self.config.dry_run:
+            self._verify_mount(self.src_fd, self.src_root_real, self.dst_fd)
+            if self.config.traverse:
+                self._traverse_child_mounts(mnt_id, self._verify_mount)
 
         return self.stats
 
-    def _traverse_child_mounts(self, root_mnt_id: int) -> None:
-        """Run ``_process_mount`` for each child mount under the source root."""
+    def _traverse_child_mounts(
+        self,
+        root_mnt_id: int,
+        process: Callable[[int, str, int], None],
+    ) -> int:
+        """Run ``process`` for each child mount under the source root.
+
+        ``process`` is ``_process_mount`` for the copy, ``_estimate_mount``
+        for a dry run and ``_verify_mount`` for the verify pass; all take
+        the same arguments.  A dry run is passed ``-1`` as the destination
+        fd since the destination subtree need not exist.  Returns the
+        number of mounts processed.
+        """
         prefix = self.src_root_real + "/"
+        count = 0
         for entry in truenas_os.iter_mount(
             mnt_id=root_mnt_id, statmount_flags=_STATMOUNT_TRAVERSE_FLAGS
         ):
@@ -682,10 +1527,6 @@ class _CopyTreeRunner:
                 and "@" in entry_sb_source
             ):
                 continue
-            child_fs_source = (
-                entry_sb_source if entry_sb_source is not None else child_mnt
-            )
-
             rel = child_mnt[len(self.src_root_real):].lstrip("/")
             child_src_fd = openat2(
                 child_mnt,
@@ -693,24 +1534,54 @@ class _CopyTreeRunner:
                 resolve=RESOLVE_NO_SYMLINKS,
             )
             try:
-                child_dst_fd = openat2(
-                    rel,
-                    O_RDONLY | O_DIRECTORY,
-                    dir_fd=self.dst_fd,
-                    resolve=RESOLVE_NO_SYMLINKS,
-                )
-                try:
-                    self._process_mount(
-                        child_src_fd,
-                        child_mnt,
-                        child_fs_source,
-                        None,
-                        child_dst_fd,
+                if self.config.dry_run:
+                    process(child_src_fd, child_mnt, -1)
+                else:
+                    child_dst_fd = openat2(
+                        rel,
+                        O_RDONLY | O_DIRECTORY,
+                        dir_fd=self.dst_fd,
+                        resolve=RESOLVE_NO_SYMLINKS,
                     )
-                finally:
-                    close(child_dst_fd)
+                    try:
+                        process(child_src_fd, child_mnt, child_dst_fd)
+                    finally:
+                        close(child_dst_fd)
             finally:
                 close(child_src_fd)
+            count += 1
+
+        return count
+
+
+def _estimate(src_fd: int, dst: str, config: CopyTreeConfig) -> CopyTreeStats:
+    """Dry-run body of ``copytree``; ``dst`` is opened only if it exists.
+
+    Raises the same ``FileExistsError`` a real copy would when ``dst``
+    exists and ``config.exist_ok`` is False.  Free space is sampled from
+    ``dst`` or, if it does not exist yet, its nearest existing ancestor.
+    """
+    try:
+        dst_fd = openat2(dst, O_RDONLY | O_DIRECTORY, resolve=RESOLVE_NO_SYMLINKS)
+    except FileNotFoundError:
+        dst_fd = -1
+    else:
+        if not config.exist_ok:
+            close(dst_fd)
+            raise FileExistsError(errno.EEXIST, os.strerror(errno.EEXIST), dst)
+
+    try:
+        stats = _CopyTreeRunner(config, src_fd, dst_fd).run()
+    finally:
+        if dst_fd >= 0:
+            close(dst_fd)
+
+    probe = dst
+    while not os.path.exists(probe):
+        probe = os.path.dirname(probe)
+    vfs = os.statvfs(probe)
+    stats.dst_bytes_free = vfs.f_bavail * vfs.f_frsize
+    return stats
 
 
 # ── Public entry point ───────────────────────────────────────────────────────
@@ -719,7 +1590,7 @@ class _CopyTreeRunner:
 def copytree(src: str, dst: str, config: CopyTreeConfig) -> CopyTreeStats:
     """Recursively copy ``src`` to ``dst`` preserving selected metadata.
 
-    Iteration is driven by ``truenas_os.iter_filesystem_contents`` (fsiter),
+    Iteration is driven by ``truenas_os.iter_filesystem_contents_fd`` (fsiter),
     which traverses depth-first in C with the GIL released.  Cross-mount
     recursion is performed by enumerating child mounts via ``iter_mount``
     after the root pass — controlled by ``config.traverse``.  ZFS snapshot
@@ -732,7 +1603,12 @@ def copytree(src: str, dst: str, config: CopyTreeConfig) -> CopyTreeStats:
 
     Returns:
         ``CopyTreeStats`` with counts for directories, files, symlinks, and
-        bytes written.
+        bytes written.  With ``config.verify`` it also carries the verify
+        pass results; differences are returned as ``CopyTreeMismatch``
+        records in ``stats.mismatches`` rather than raised.  With
+        ``config.dry_run`` nothing is written and the counts are an
+        estimate; ``stats.dst_bytes_free`` is then set so callers can
+        compare it against ``stats.bytes`` before starting the copy.
 
     Raises:
         ValueError: ``src`` or ``dst`` is not an absolute path.
@@ -753,6 +1629,9 @@ def copytree(src: str, dst: str, config: CopyTreeConfig) -> CopyTreeStats:
         resolve=RESOLVE_NO_SYMLINKS,
     )
     try:
+        if config.dry_run:
+            return _estimate(src_fd, dst, config)
+
         try:
             mkdir(dst)
         except FileExistsError:
@@ -0,0 +1,111 @@
+"""Recursive extended-attribute removal.
+
+Walks a directory tree with :func:`truenas_os.iter_filesystem_contents_fd`
+and strips matching xattrs from every entry with one
+:func:`truenas_os.fremovexattrs` call each, so no per-name Python round
+trip or GIL release is paid.  Sockets and device nodes are the exception:
+they are never opened, and their attributes are removed by name through
+``/proc/self/fd``.  Used to clear stale metadata (``user.*`` xattrs, DOS
+attributes) before re-applying it during a migration.
+
+Tests are in tests/utils/test_xattr.py.
+"""
+from __future__ import annotations
+
+import errno
+import os
+import stat
+from collections.abc import Sequence
+
+import truenas_os
+
+
+__all__ = ["removexattrs_tree"]
+
+
+def _removexattrs_path(
+    path: str,
+    names: Sequence[str] | None,
+    prefix: str | None,
+) -> int:
+    """Remove matching xattrs from `path` one name at a time, matching as
+    :func:`truenas_os.fremovexattrs` does.  Names that vanish after the
+    listing are skipped."""
+    removed = 0
+    for name in os.listxattr(path):
+        if names is not None or prefix is not None:
+            if not ((prefix is not None and name.startswith(prefix))
+                    or (names is not None and name in names)):
+                continue
+        try:
+            os.removexattr(path, name)
+        except OSError as e:
+            if e.errno != errno.ENODATA:
+                raise
+            continue
+        removed += 1
+    return removed
+
+
+def removexattrs_tree(
+    dirfd: int,
+    /,
+    *,
+    names: Sequence[str] | None = None,
+    prefix: str | None = None,
+    max_open_dirs: int = 0,
+) -> int:
+    """Remove matching xattrs from the directory `dirfd` and everything
+    below it on the same mount.
+
+    `names` and `prefix` select attributes as for
+    :func:`truenas_os.fremovexattrs`; with neither, all are removed.
+    Symlinks and child mountpoints are not touched.  `max_open_dirs` is
+    passed to the iterator.  `dirfd` is borrowed (O_PATH is sufficient).
+
+    Non-directories are walked as O_PATH fds: a UNIX socket cannot be
+    opened (ENXIO) and opening a device node may have side effects.
+    Regular files and FIFOs are reopened read-only through
+    ``/proc/self/fd``; sockets and devices are handled by path there.
+
+    Returns the number of attributes removed.  The first ``OSError`` stops
+    the walk; attributes already removed stay removed.
+    """
+    removed = 0
+    root_fd = os.open(".", os.O_RDONLY | os.O_DIRECTORY, dir_fd=dirfd)
+    try:
+        removed += len(truenas_os.fremovexattrs(
+            root_fd, names=names, prefix=prefix,
+        ))
+    finally:
+        os.close(root_fd)
+
+    with truenas_os.iter_filesystem_contents_fd(
+        dirfd,
+        file_open_flags=os.O_PATH,
+        reporting_increment=0,
+        max_open_dirs=max_open_dirs,
+    ) as it:
+        for item in it:
+            if item.isdir:
+                removed += len(truenas_os.fremovexattrs(
+                    item.fd, names=names, prefix=prefix,
+                ))
+                continue
+
+            path = f"/proc/self/fd/{item.fd}"
+            mode = item.statxinfo.stx_mode
+            if not (stat.S_ISREG(mode) or stat.S_ISFIFO(mode)):
+                removed += _removexattrs_path(path, names, prefix)
+                continue
+
+            # O_NONBLOCK so that opening a FIFO does not wait for a writer.
+            fd = os.open(path, os.O_RDONLY | os.O_NONBLOCK)
+            try:
+                removed += len(truenas_os.fremovexattrs(
+                    fd, names=names, prefix=prefix,
+                ))
+            finally:
+                os.close(fd)
+
+    return removed
@@ -4,7 +4,7 @@ This module provides Python bindings to Linux kernel system calls for
 advanced filesystem and mount operations, plus ACL support.
 """
 
-from typing import Any, Callable, ClassVar, Iterable, Iterator, Literal, NamedTuple, final, type_check_only
+from typing import Any, Callable, ClassVar, Iterable, Iterator, Literal, NamedTuple, Sequence, final, type_check_only
 from enum import IntEnum, IntFlag
 
 # StatxResult type - PyStructSequence from statx(2)
@@ -203,6 +203,38 @@ class CredEntry(tuple[Any, ...]):  # PyStructSequence, not a true NamedTuple
     @property
     def groups(self) -> tuple[int, ...]: ...
 
+# MountSpec type - PyStructSequence describing one mount of a mount_tree() build
+@final
+class MountSpec(tuple[Any, ...]):  # PyStructSequence, not a true NamedTuple
+    """One mount of a :func:`mount_tree` build.
+
+    Construct via :func:`create_mount_spec`, which validates and normalizes
+    the fields.
+    """
+    n_fields: ClassVar[int]
+    n_sequence_fields: ClassVar[int]
+    n_unnamed_fields: ClassVar[int]
+    __match_args__: ClassVar[tuple[str, ...]]
+    def __replace__(self, /, **changes: Any) -> MountSpec: ...
+    @property
+    def target(self) -> str: ...
+    @property
+    def fs_type(self) -> str | None: ...
+    @property
+    def source(self) -> str | None: ...
+    @property
+    def options(self) -> tuple[tuple[str, str | bytes | int | bool | None], ...]: ...
+    @property
+    def attr_set(self) -> int: ...
+    @property
+    def attr_clr(self) -> int: ...
+    @property
+    def propagation(self) -> int: ...
+    @property
+    def userns_fd(self) -> int: ...
+    @property
+    def recursive(self) -> bool: ...
+
 # AccessFailure type - PyStructSequence describing one denied (cred, component) probe
 @final
 class AccessFailure(tuple[Any, ...]):  # PyStructSequence, not a true NamedTuple
@@ -221,6 +253,27 @@ class AccessFailure(tuple[Any, ...]):  # PyStructSequence, not a true NamedTuple
     @property
     def errnum(self) -> int: ...
 
+# RenameFailure type - PyStructSequence describing one failed renameat2_batch op
+@final
+class RenameFailure(tuple[Any, ...]):  # PyStructSequence, not a true NamedTuple
+    """A single operation that failed, as returned by :func:`renameat2_batch`.
+
+    ``src`` and ``dst`` are the name objects exactly as passed in.
+    """
+    n_fields: ClassVar[int]
+    n_sequence_fields: ClassVar[int]
+    n_unnamed_fields: ClassVar[int]
+    __match_args__: ClassVar[tuple[str, ...]]
+    def __replace__(self, /, **changes: Any) -> RenameFailure: ...
+    @property
+    def index(self) -> int: ...
+    @property
+    def src(self) -> str | bytes: ...
+    @property
+    def dst(self) -> str | bytes: ...
+    @property
+    def errnum(self) -> int: ...
+
 # statx function
 def statx(
     path: str | bytes,
@@ -549,6 +602,59 @@ def fsmount(
     """
     ...
 
+# Declarative mount-tree builder
+def create_mount_spec(
+    target: str,
+    /,
+    *,
+    fs_type: str | None = None,
+    source: str | None = None,
+    options: dict[str, str | bytes | int | bool | None]
+    | Iterable[tuple[str, str | bytes | int | bool | None]]
+    | None = None,
+    attr_set: int = 0,
+    attr_clr: int = 0,
+    propagation: int = 0,
+    userns_fd: int = -1,
+    recursive: bool = False,
+) -> MountSpec:
+    """Construct a validated MountSpec for use with :func:`mount_tree`.
+
+    With ``fs_type`` the mount is a new filesystem instance (fsopen, then
+    fsconfig ``source`` and each option in order); without it, a bind clone
+    of the path ``source``.  Option values: None / True set a flag, str a
+    string, bytes a binary blob, int a file descriptor.  ``userns_fd`` makes
+    the mount idmapped.  ``target`` is resolved beneath the tree root
+    (RESOLVE_IN_ROOT) and must exist.
+
+    Raises
+    ------
+    TypeError, ValueError
+        On malformed fields.
+    """
+    ...
+
+def mount_tree(
+    *,
+    root_fd: int,
+    specs: Iterable[MountSpec],
+    to_path: str | None = None,
+    to_dirfd: int = ...,
+) -> int | None:
+    """Assemble a mount tree and attach it with a single move_mount().
+
+    Clones ``root_fd`` (OPEN_TREE_CLONE), then creates each spec, applies its
+    attributes and attaches it beneath the detached clone, with the GIL
+    released.  The tree is attached at ``to_path`` (relative to
+    ``to_dirfd``) and None returned, or, when ``to_path`` is None, left
+    detached and its fd returned.
+
+    If any step fails the detached tree is closed, unmounting everything
+    created so far, and OSError is raised with the failed step as its
+    filename.  Requires Linux >= 6.15.
+    """
+    ...
+
 # umount2 function
 def umount2(
     *,
@@ -782,6 +888,43 @@ def renameat2(
     """
     ...
 
+def renameat2_batch(
+    ops: Iterable[tuple[int, str | bytes, int, str | bytes, int]],
+    *,
+    stop_on_error: bool = False,
+) -> list[RenameFailure]:
+    """Perform many renameat2() operations in a single call.
+
+    Each operation is a ``(src_dir_fd, src, dst_dir_fd, dst, flags)`` tuple
+    with the same meaning as the corresponding :func:`renameat2` arguments.
+    Flags are honoured per operation, so AT_RENAME_NOREPLACE and
+    AT_RENAME_EXCHANGE may be mixed freely.  All names are converted up front
+    and the renames then run in order in one loop with the GIL released.
+
+    Parameters
+    ----------
+    ops : Iterable[tuple[int, str | bytes, int, str | bytes, int]]
+        Rename operations to perform, in order.  Use AT_FDCWD as the dir fd
+        for paths relative to the current directory.
+    stop_on_error : bool, optional
+        When True, stop after the first failing operation; every operation
+        before it succeeded and none after it was attempted.  Defaults to
+        False, which attempts every operation.
+
+    Returns
+    -------
+    list[RenameFailure]
+        One RenameFailure per failed operation.  Empty list means every
+        operation succeeded.
+
+    Raises
+    ------
+    TypeError
+        If ops is not a sequence of 5-tuples of the expected types.  No
+        rename is attempted in that case.
+    """
+    ...
+
 # STATX constants
 STATX_TYPE: int
 STATX_MODE: int
@@ -1124,6 +1267,8 @@ def iter_filesystem_contents(
     dir_stack: tuple[tuple[str, int], ...] | None = None,
     include_symlinks: bool = False,
     include_mountpoints: bool = False,
+    inode_order: bool = False,
+    max_open_dirs: int = 0,
 ) -> FilesystemIterator:
     """Iterate filesystem contents with mount validation.
 
@@ -1163,6 +1308,17 @@ def iter_filesystem_contents(
             regardless of ``skip()`` state, so the single-filesystem
             invariant is preserved.  When False (default), child
             mountpoints are silently skipped.
+        inode_order: When True, each directory is read in full and its
+            entries processed in ascending inode order (ties by name)
+            instead of readdir order, which makes cold-cache metadata
+            reads mostly sequential on HDD / large-dnode ZFS pools and the
+            output order deterministic.  Buffers each directory's names.
+        max_open_dirs: Maximum directory streams held open (0, the default,
+            is one per stack level; otherwise at least 2).  Past it the
+            shallowest open ancestor is closed, recording its position and
+            a file handle, and reopened (open_by_handle_at, or by path
+            without CAP_DAC_READ_SEARCH) on ascent, so deep walks use a
+            constant number of fds.
 
     Returns:
         FilesystemIterator that yields IterInstance objects
@@ -1172,6 +1328,7 @@ def iter_filesystem_contents(
         RuntimeError: Mount validation failures
         NotADirectoryError: Path is not a directory
         TypeError: reporting_callback is not callable
+        ValueError: max_open_dirs is negative or 1
         IteratorRestoreError: Cannot restore to the saved dir_stack position (directory
             not found or inode mismatch). Exception includes depth and path attributes.
 
@@ -1187,6 +1344,47 @@ def iter_filesystem_contents(
     """
     ...
 
+def iter_filesystem_contents_fd(
+    dirfd: int,
+    /,
+    *,
+    path: str | None = None,
+    btime_cutoff: int = 0,
+    file_open_flags: int = ...,
+    reporting_increment: int = 1000,
+    reporting_callback: Callable[[tuple[tuple[str, int], ...], FilesystemIterState, Any], Any] | None = None,
+    reporting_private_data: Any = None,
+    dir_stack: tuple[tuple[str, int], ...] | None = None,
+    include_symlinks: bool = False,
+    include_mountpoints: bool = False,
+    inode_order: bool = False,
+    max_open_dirs: int = 0,
+) -> FilesystemIterator:
+    """Iterate filesystem contents starting from an open directory fd.
+
+    Same iteration as ``iter_filesystem_contents`` without its mountpoint
+    and filesystem-name validation: no path is resolved and no statmount
+    is issued.  The walk stays on the mount ``dirfd`` belongs to.
+
+    Args:
+        dirfd: Open directory fd (O_PATH is sufficient).  Borrowed — the
+            iterator reopens it, so the caller may close it immediately.
+        path: Path reported for ``dirfd``; ``IterInstance.parent`` and
+            ``dir_stack()`` paths are built on it.  When None they are
+            relative to ``dirfd`` and top-level entries have parent ``""``.
+        Other arguments: as for ``iter_filesystem_contents``.
+
+    Returns:
+        FilesystemIterator that yields IterInstance objects
+
+    Raises:
+        OSError: ``dirfd`` is invalid or not a directory (ENOTDIR)
+        TypeError: reporting_callback is not callable
+        ValueError: max_open_dirs is negative or 1
+        IteratorRestoreError: Cannot restore to the saved dir_stack position
+    """
+    ...
+
 # ── NFS4 enums ────────────────────────────────────────────────────────────────
 
 class NFS4AceType(IntEnum):
@@ -1327,6 +1525,16 @@ class NFS4ACL:
     @property
     def trivial(self) -> bool: ...
     def generate_inherited_acl(self, is_dir: bool = False) -> NFS4ACL: ...
+    def diff(self, other: NFS4ACL) -> ACLDiff:
+        """Compare against another NFS4ACL without decoding ACEs.
+
+        Indexes refer to ``self.aces`` (removed, changed[0]) and
+        ``other.aces`` (added, changed[1]).  Reordering within a run of
+        same-type ACEs is not a difference.
+        """
+        ...
+    def __eq__(self, other: object) -> bool: ...
+    def __hash__(self) -> int: ...
     def __bytes__(self) -> bytes: ...
     def __len__(self) -> int: ...
     def __repr__(self) -> str: ...
@@ -1353,15 +1561,47 @@ class POSIXACL:
     def generate_inherited_acl(self, is_dir: bool = True) -> POSIXACL: ...
     def access_bytes(self) -> bytes: ...
     def default_bytes(self) -> bytes | None: ...
+    def diff(self, other: POSIXACL) -> ACLDiff:
+        """Compare against another POSIXACL without decoding ACEs.
+
+        Indexes refer to ``aces + default_aces`` of the respective ACL.
+        Entry order is not significant for POSIX ACLs.
+        """
+        ...
+    def __eq__(self, other: object) -> bool: ...
+    def __hash__(self) -> int: ...
     def __repr__(self) -> str: ...
 
+@final
+class ACLDiff(tuple[Any, ...]):  # PyStructSequence, not a true NamedTuple
+    """Structural difference between two ACLs of the same type, as returned
+    by :meth:`NFS4ACL.diff` and :meth:`POSIXACL.diff`.
+    """
+    n_fields: ClassVar[int]
+    n_sequence_fields: ClassVar[int]
+    n_unnamed_fields: ClassVar[int]
+    __match_args__: ClassVar[tuple[str, ...]]
+    def __replace__(self, /, **changes: Any) -> ACLDiff: ...
+    @property
+    def added(self) -> tuple[int, ...]: ...
+    @property
+    def removed(self) -> tuple[int, ...]: ...
+    @property
+    def changed(self) -> tuple[tuple[int, int], ...]: ...
+    @property
+    def acl_flags_changed(self) -> bool: ...
+    @property
+    def reordered(self) -> bool: ...
+
 # ── ACL functions ─────────────────────────────────────────────────────────────
 
-def fgetacl(fd: int) -> NFS4ACL | POSIXACL:
+def fgetacl(fd: int, *, mnt_id: int = 0) -> NFS4ACL | POSIXACL:
     """Get the ACL on an open file descriptor.
 
     Returns NFS4ACL for NFS4/ZFS filesystems, POSIXACL for POSIX1E.
     Raises OSError(EOPNOTSUPP) if ACLs are disabled on the filesystem.
+    A non-zero mnt_id (StatxResult.stx_mnt_id of fd) caches the detected
+    ACL flavour per mount so later calls skip the filesystem probe.
     """
     ...
 
@@ -1376,16 +1616,23 @@ def validate_acl(fd: int, acl: NFS4ACL | POSIXACL) -> None:
     """
     ...
 
-def fsetacl(fd: int, acl: NFS4ACL | POSIXACL | None) -> None:
+def fsetacl(
+    fd: int, acl: NFS4ACL | POSIXACL | None, *, mnt_id: int = 0
+) -> None:
     """Set the ACL on an open file descriptor.
 
     acl must match the ACL type supported by the filesystem, or None to
-    remove the ACL xattr(s) entirely.
+    remove the ACL xattr(s) entirely.  mnt_id keys the ACL flavour cache
+    as for fgetacl().
     Raises OSError on failure, TypeError if acl is not NFS4ACL, POSIXACL,
     or None.
     """
     ...
 
+def invalidate_acl_cache(mnt_id: int = 0) -> None:
+    """Forget the ACL flavour cached for mnt_id, or for every mount if 0."""
+    ...
+
 def fsetacl_nfs4(fd: int, data: bytes) -> None:
     """Set system.nfs4_acl_xdr from raw XDR bytes.  Low-level interface."""
     ...
@@ -1431,6 +1678,80 @@ def flistxattr(fd: int) -> list[str]:
     """
     ...
 
+def fremovexattrs(
+    fd: int,
+    *,
+    names: Sequence[str] | None = None,
+    prefix: str | None = None,
+) -> list[str]:
+    """Remove the extended attributes on an open fd that are listed in
+    `names` or start with `prefix` (all of them when both are None).
+
+    Listing and removal run in one call with the GIL released.  Returns
+    the removed names.  A failed removal raises ``OSError`` with the
+    attribute name as ``filename``; earlier removals are not undone.
+    """
+    ...
+
+# ── Content checksums ────────────────────────────────────────────────────────
+
+def fcrc32c(fd: int, /) -> int:
+    """Return the CRC32C of the file's full contents.
+
+    Reads with ``pread`` from offset 0 (the fd offset is unchanged) with
+    the GIL released.
+    """
+    ...
+
+def fcrc32c_pair(fd_a: int, fd_b: int, /) -> tuple[int, int]:
+    """Return ``(fcrc32c(fd_a), fcrc32c(fd_b))``, reading both files
+    concurrently with the GIL released.
+    """
+    ...
+
+# ── Small-file copy ──────────────────────────────────────────────────────────
+
+FCOPY_SMALL_MAX: int  # 64 * 1024 — fcopy_small buffer size
+
+def fcopy_small(
+    src_fd: int,
+    dst_fd: int,
+    /,
+    *,
+    uid: int = -1,
+    gid: int = -1,
+    mode: int = -1,
+    ns: tuple[int, int] | None = None,
+) -> int:
+    """Copy ``src_fd``'s contents to ``dst_fd``, then apply owner, mode and
+    timestamps, all with the GIL released.
+
+    Data goes through a per-thread ``FCOPY_SMALL_MAX``-byte buffer with
+    ``pread`` / ``pwrite``; a short read is end of file.  ``uid`` / ``gid``
+    take the full 32-bit id range (``0`` to ``2**32 - 1``) as ``os.fchown``
+    does, and anything else but ``-1`` raises ``ValueError``.  ``-1`` /
+    ``None`` leave the corresponding metadata unchanged.  Owner is set before
+    mode so set-ID bits survive.  Returns the number of bytes copied.
+    """
+    ...
+
+FALLOC_FL_KEEP_SIZE: int   # 0x01 — allocate without changing the file size
+FALLOC_FL_PUNCH_HOLE: int  # 0x02 — deallocate the range (with KEEP_SIZE)
+
+def fallocate(fd: int, offset: int, length: int, /, *, mode: int = 0) -> None:
+    """Allocate disk space for a range of ``fd`` with ``fallocate(2)``.
+
+    A filesystem that cannot preallocate raises ``OSError(EOPNOTSUPP)``
+    rather than having every block written as ``os.posix_fallocate`` does.
+    """
+    ...
+
+def syncfs(fd: int, /) -> None:
+    """Flush the filesystem containing ``fd`` with ``syncfs(2)``, with the
+    GIL released.
+    """
+    ...
+
 XATTR_CREATE: int    # 1 — fail if attribute exists
 XATTR_REPLACE: int   # 2 — fail if attribute does not exist
 XATTR_SIZE_MAX: int  # 2 * 1024 * 1024 — TrueNAS xattr value cap
@@ -1,6 +1,6 @@
 """Type stubs for truenas_pyfilter module."""
 
-from typing import Any, Iterable, final
+from typing import Any, Iterable, Mapping, final
 
 # order_by prefix constants
 FILTER_ORDER_NULLS_FIRST_PREFIX: str
@@ -28,13 +28,17 @@ FILTER_OP_CI_PREFIX: str
 
 @final
 class CompiledFilters:
-    """Pre-compiled filter tree produced by compile_filters()."""
+    """Pre-compiled filter tree produced by compile_filters().
+
+    Picklable: the compiled tree is serialised, not the original filters.
+    """
     def __repr__(self) -> str: ...
+    def __reduce__(self) -> tuple[Any, ...]: ...
 
 
 @final
 class CompiledOptions:
-    """Pre-compiled options produced by compile_options()."""
+    """Pre-compiled options produced by compile_options(). Picklable."""
     get: bool
     count: bool
     select: list[str | list[Any]]
@@ -42,9 +46,111 @@ class CompiledOptions:
     offset: int
     limit: int
     model: type[Any] | None
+    group_by: list[str]
+    aggregate: dict[str, list[str]]
+    distinct: bool
+    def __repr__(self) -> str: ...
+    def __reduce__(self) -> tuple[Any, ...]: ...
+
+
+@final
+class CompiledFilterSet:
+    """Indexed set of CompiledFilters produced by compile_filter_set()."""
+    ids: tuple[Any, ...]
+    model: type[Any] | None
+    def __len__(self) -> int: ...
+    def __repr__(self) -> str: ...
+
+
+@final
+class CompiledLookup:
+    """Hash-join table produced by compile_lookup()."""
+    local: str
+    foreign: str
+    def __len__(self) -> int: ...
+    def __repr__(self) -> str: ...
+
+
+@final
+class LiveQueryDelta(tuple[Any, ...]):
+    """Change to a LiveQuery result window caused by one delta.
+
+    Indexes in ``removed`` and the first element of ``moved`` refer to the
+    previous window; all other indexes refer to the new one.
+    """
+    @property
+    def added(self) -> tuple[tuple[int, Any], ...]: ...
+    @property
+    def removed(self) -> tuple[tuple[int, Any], ...]: ...
+    @property
+    def moved(self) -> tuple[tuple[int, int, Any], ...]: ...
+    @property
+    def changed(self) -> tuple[tuple[int, Any], ...]: ...
+
+
+@final
+class LiveQuery:
+    """Incrementally maintained tnfilter() result produced by live_query()."""
+    key: str
+    def insert(self, item: Any) -> LiveQueryDelta: ...
+    def update(self, item: Any) -> LiveQueryDelta: ...
+    def delete(self, key: Any) -> LiveQueryDelta: ...
+    def result(self) -> list[Any]: ...
+    def __len__(self) -> int: ...
     def __repr__(self) -> str: ...
 
 
+@final
+class Page(tuple[Any, ...]):
+    """One page of a keyset-paginated query, from paginate()."""
+    @property
+    def items(self) -> list[Any]: ...
+    @property
+    def cursor(self) -> tuple[Any, ...] | None: ...
+
+
+@final
+class ProfileNode(tuple[Any, ...]):
+    """Counters for one node of a compiled filter tree, from explain()."""
+    @property
+    def term(self) -> list[Any] | str: ...
+    @property
+    def evaluations(self) -> int: ...
+    @property
+    def matches(self) -> int: ...
+    @property
+    def path_misses(self) -> int: ...
+    @property
+    def time_ns(self) -> int: ...
+    @property
+    def children(self) -> tuple[ProfileNode, ...]: ...
+
+
+@final
+class QueryProfile(tuple[Any, ...]):
+    """Profiled tnfilter() run, from explain()."""
+    @property
+    def result(self) -> Any: ...
+    @property
+    def items(self) -> int: ...
+    @property
+    def matched(self) -> int: ...
+    @property
+    def filter_ns(self) -> int: ...
+    @property
+    def select_ns(self) -> int: ...
+    @property
+    def order_ns(self) -> int: ...
+    @property
+    def slice_ns(self) -> int: ...
+    @property
+    def total_ns(self) -> int: ...
+    @property
+    def filters(self) -> tuple[ProfileNode, ...]: ...
+    @property
+    def tree(self) -> str: ...
+
+
 def match(
     item: Any,
     *,
@@ -66,11 +172,28 @@ def tnfilter(
     *,
     filters: CompiledFilters,
     options: CompiledOptions,
+    lookup: CompiledLookup | None = None,
 ) -> list[Any]:
     """Filter an iterable using pre-compiled C-level filters.
 
     Both arguments must be pre-compiled objects from compile_filters() and
-    compile_options() respectively.
+    compile_options() respectively. With ``lookup``, filter and select paths
+    starting with ``lookup.`` read each item's joined record.
+    """
+    ...
+
+
+def compile_lookup(
+    data: Iterable[Any],
+    *,
+    local: str,
+    foreign: str,
+) -> CompiledLookup:
+    """Build a hash-join table over ``data`` for tnfilter(lookup=...).
+
+    Each record is filed under its value at the ``foreign`` path (values must
+    be unique; None never joins). An item joins the record filed under its
+    value at the ``local`` path.
     """
     ...
 
@@ -100,6 +223,9 @@ def compile_options(
     offset: int = 0,
     limit: int = 0,
     model: type[Any] | None = None,
+    group_by: list[str] | None = None,
+    aggregate: dict[str, list[str] | tuple[str, ...]] | None = None,
+    distinct: bool = False,
 ) -> CompiledOptions:
     """Pre-parse query-options into a CompiledOptions object.
 
@@ -108,5 +234,92 @@ def compile_options(
     resolved to attribute names at compile time, the same way
     ``compile_filters`` resolves filter paths. With a ``model``, ``select``
     projections are returned as ``model_construct`` instances instead of dicts.
+
+    ``group_by`` and/or ``aggregate`` (``{name: [func, path]}`` with func one
+    of ``count``, ``sum``, ``min``, ``max``, ``distinct_count``; ``["count"]``
+    counts items) make tnfilter() return one dict per group, built during the
+    filter pass. ``select``/``order_by``/``offset``/``limit``/``count`` then
+    apply to those dicts.
+
+    ``distinct=True`` (requires ``select``) keeps only the first result of each
+    distinct tuple of selected values; with ``count=True`` it returns the
+    number of distinct projections without building any rows.
+    """
+    ...
+
+
+def compile_filter_set(
+    subscribers: Mapping[Any, CompiledFilters] | Iterable[tuple[Any, CompiledFilters]],
+) -> CompiledFilterSet:
+    """Index many subscribers' CompiledFilters for use with match_any().
+
+    Each subscriber with a top-level ``[path, "=", value]`` term is filed
+    under one such term in a per-path hash index. All filters must have been
+    compiled with the same ``model`` (or none), else ``ValueError``.
+    """
+    ...
+
+
+def match_any(
+    item: Any,
+    *,
+    filter_set: CompiledFilterSet,
+) -> list[Any]:
+    """Return the ids of every subscriber whose filters match ``item``.
+
+    Same result as testing each subscriber with match(), in subscription
+    order, but each indexed field path is resolved once per item and only
+    candidate subscribers are fully evaluated.
+    """
+    ...
+
+
+def live_query(
+    data: Iterable[Any],
+    *,
+    filters: CompiledFilters,
+    options: CompiledOptions,
+    key: str,
+) -> LiveQuery:
+    """Run a query once and keep its result current under item deltas.
+
+    ``insert``/``update``/``delete`` re-evaluate only the changed item and
+    return the resulting window change; ``result()`` equals what tnfilter()
+    would return for the updated collection. ``get``/``count`` options are
+    rejected with ``ValueError``.
+    """
+    ...
+
+
+def explain(
+    data: Iterable[Any],
+    *,
+    filters: CompiledFilters,
+    options: CompiledOptions,
+) -> QueryProfile:
+    """Run tnfilter() with per-node profiling.
+
+    ``result`` is what tnfilter() returns for the same arguments. Each
+    ProfileNode counts evaluations, matches and path misses and accumulates
+    the time spent in the node; select, order_by and offset/limit are timed
+    as separate phases.
+    """
+    ...
+
+
+def paginate(
+    data: Iterable[Any],
+    *,
+    filters: CompiledFilters,
+    options: CompiledOptions,
+    after: tuple[Any, ...] | None = None,
+) -> Page:
+    """Return one page of a query using keyset (seek) pagination.
+
+    ``options`` must set ``order_by`` and ``limit``. Rows whose order_by key
+    sorts at or before ``after`` (the previous page's ``cursor``) are skipped
+    during the filter pass and only ``limit`` rows are kept, so deep pages
+    cost no more than the first. ``cursor`` is None once the last page has
+    been returned. End ``order_by`` with a unique field.
     """
     ...
@@ -870,6 +870,180 @@ def test_posixacl_trivial_with_default_is_false():
     assert t.POSIXACL(b"", _POSIX_HDR.pack(2)).trivial is False
 
 
+# ═══════════════════════════════════════════════════════════════════════════
+# NFS4ACL / POSIXACL equality, hashing and diff() — pure unit tests
+# ═══════════════════════════════════════════════════════════════════════════
+
+# Raw ACE tuples: (type, flags, iflag, access_mask, who)
+_RAW_OWNER   = (0, 0,    1, int(_NFS4_FULL),      1)
+_RAW_GROUP   = (0, 0x40, 1, int(_NFS4_READ_EXEC), 2)
+_RAW_EVERY   = (0, 0,    1, int(_NFS4_READ_EXEC), 3)
+_RAW_USER    = (0, 0,    0, int(_NFS4_READ_EXEC), 1001)
+_RAW_DENY    = (1, 0,    0, int(t.NFS4Perm.WRITE_DATA), 1002)
+
+
+def _pack_nfs4_acl(aces, acl_flags=0):
+    """Build raw XDR bytes in exactly the given ACE order (no sorting)."""
+    return t.NFS4ACL(_NFS4_HDR.pack(acl_flags, len(aces)) +
+                     b''.join(_NFS4_ACE.pack(*a) for a in aces))
+
+
+def test_nfs4acl_eq_identical():
+    a = t.NFS4ACL.from_aces(_BASE_NFS4_ACES)
+    b = t.NFS4ACL.from_aces(list(reversed(_BASE_NFS4_ACES)))
+    assert a == b
+    assert not (a != b)
+    assert hash(a) == hash(b)
+
+
+def test_nfs4acl_eq_reorder_within_allow_run():
+    a = _pack_nfs4_acl([_RAW_OWNER, _RAW_GROUP, _RAW_EVERY])
+    b = _pack_nfs4_acl([_RAW_EVERY, _RAW_OWNER, _RAW_GROUP])
+    assert bytes(a) != bytes(b)
+    assert a == b
+    assert hash(a) == hash(b)
+
+
+def test_nfs4acl_ne_reorder_across_deny():
+    # Moving an ALLOW ahead of a DENY changes evaluation order.
+    a = _pack_nfs4_acl([_RAW_DENY, _RAW_USER, _RAW_OWNER])
+    b = _pack_nfs4_acl([_RAW_USER, _RAW_DENY, _RAW_OWNER])
+    assert a != b
+    d = a.diff(b)
+    assert d.added == () and d.removed == () and d.changed == ()
+    assert d.reordered is True
+
+
+def test_nfs4acl_eq_ignores_zfs_acl_flags():
+    a = _pack_nfs4_acl([_RAW_OWNER], acl_flags=int(t.NFS4ACLFlag.ACL_IS_DIR))
+    b = _pack_nfs4_acl([_RAW_OWNER])
+    assert a == b
+    assert hash(a) == hash(b)
+
+
+def test_nfs4acl_ne_acl_flags():
+    a = _pack_nfs4_acl([_RAW_OWNER], acl_flags=int(t.NFS4ACLFlag.PROTECTED))
+    b = _pack_nfs4_acl([_RAW_OWNER])
+    assert a != b
+    d = a.diff(b)
+    assert d.acl_flags_changed is True
+    assert d.added == () and d.removed == () and d.changed == ()
+
+
+def test_nfs4acl_eq_other_type_not_implemented():
+    a = t.NFS4ACL.from_aces(_BASE_NFS4_ACES)
+    assert a != bytes(a)
+    assert a != t.POSIXACL.from_aces(_MINIMAL_POSIX_ACES)
+
+
+def test_nfs4acl_usable_as_dict_key():
+    a = _pack_nfs4_acl([_RAW_OWNER, _RAW_GROUP])
+    b = _pack_nfs4_acl([_RAW_GROUP, _RAW_OWNER])
+    assert {a: 1}[b] == 1
+
+
+def test_nfs4acl_diff_identical_is_empty():
+    a = t.NFS4ACL.from_aces(_BASE_NFS4_ACES)
+    d = a.diff(t.NFS4ACL(bytes(a)))
+    assert isinstance(d, t.ACLDiff)
+    assert d == ((), (), (), False, False)
+
+
+def test_nfs4acl_diff_added_removed_changed():
+    a = _pack_nfs4_acl([_RAW_OWNER, _RAW_GROUP, _RAW_EVERY])
+    everyone_rw = _RAW_EVERY[:3] + (int(_NFS4_FULL),) + _RAW_EVERY[4:]
+    b = _pack_nfs4_acl([_RAW_USER, _RAW_OWNER, everyone_rw])
+    d = a.diff(b)
+    # GROUP@ (index 1 in a) is gone; named user (index 0 in b) is new;
+    # EVERYONE@ keeps its slot but gains permissions.
+    assert d.removed == (1,)
+    assert d.added == (0,)
+    assert d.changed == ((2, 2),)
+    assert d.acl_flags_changed is False
+    assert d.reordered is False
+
+
+def test_nfs4acl_diff_user_and_group_with_same_id_distinct():
+    user = (0, 0, 0, int(_NFS4_READ_EXEC), 1001)
+    group = (0, 0x40, 0, int(_NFS4_READ_EXEC), 1001)
+    d = _pack_nfs4_acl([user]).diff(_pack_nfs4_acl([group]))
+    assert d.removed == (0,)
+    assert d.added == (0,)
+    assert d.changed == ()
+
+
+def test_nfs4acl_diff_wrong_type_raises():
+    with pytest.raises(TypeError):
+        t.NFS4ACL.from_aces(_BASE_NFS4_ACES).diff(bytes(1))
+
+
+def test_nfs4acl_eq_truncated_raises():
+    bad = t.NFS4ACL(_NFS4_HDR.pack(0, 3))
+    with pytest.raises(ValueError):
+        bad == t.NFS4ACL.from_aces(_BASE_NFS4_ACES)
+    with pytest.raises(ValueError):
+        hash(bad)
+
+
+def _pack_posix(entries):
+    return _POSIX_HDR.pack(2) + b''.join(_POSIX_ACE.pack(*e) for e in entries)
+
+
+_RAW_POSIX_MIN = [
+    (int(t.POSIXTag.USER_OBJ), 7, POSIX_SPECIAL_ID),
+    (int(t.POSIXTag.GROUP_OBJ), 5, POSIX_SPECIAL_ID),
+    (int(t.POSIXTag.OTHER), 0, POSIX_SPECIAL_ID),
+]
+
+
+def test_posixacl_eq_ignores_entry_order():
+    a = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN))
+    b = t.POSIXACL(_pack_posix(list(reversed(_RAW_POSIX_MIN))))
+    assert a == b
+    assert hash(a) == hash(b)
+    assert a.diff(b).reordered is False
+
+
+def test_posixacl_eq_from_aces_round_trip():
+    a = t.POSIXACL.from_aces(_EXTENDED_POSIX_ACES)
+    b = t.POSIXACL(a.access_bytes(), a.default_bytes())
+    assert a == b
+    assert hash(a) == hash(b)
+
+
+def test_posixacl_eq_missing_default_equals_empty():
+    a = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN))
+    b = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN), _POSIX_HDR.pack(2))
+    assert a == b
+
+
+def test_posixacl_ne_access_vs_default():
+    access = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN) + _pack_posix(_RAW_POSIX_MIN)[4:])
+    split = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN), _pack_posix(_RAW_POSIX_MIN))
+    assert access != split
+
+
+def test_posixacl_diff_indexes_span_default():
+    a = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN), _pack_posix(_RAW_POSIX_MIN))
+    named = (int(t.POSIXTag.USER), 5, 1001)
+    mask = (int(t.POSIXTag.MASK), 5, POSIX_SPECIAL_ID)
+    other_rx = (int(t.POSIXTag.OTHER), 5, POSIX_SPECIAL_ID)
+    b = t.POSIXACL(_pack_posix(_RAW_POSIX_MIN),
+                   _pack_posix(_RAW_POSIX_MIN[:2] + [other_rx, named, mask]))
+    d = a.diff(b)
+    # default OTHER is index 3 + 2 = 5 in both; new default entries 6 and 7.
+    assert d.changed == ((5, 5),)
+    assert d.added == (6, 7)
+    assert d.removed == ()
+    assert d.acl_flags_changed is False
+
+
+def test_posixacl_diff_wrong_type_raises():
+    with pytest.raises(TypeError):
+        t.POSIXACL.from_aces(_MINIMAL_POSIX_ACES).diff(
+            t.NFS4ACL.from_aces(_BASE_NFS4_ACES))
+
+
 # ═══════════════════════════════════════════════════════════════════════════
 # Live POSIXACL — fgetacl / fsetacl
 # (posix_dataset: ZFS posixacl dataset, or tmpdir fallback)
@@ -1236,6 +1410,46 @@ def test_posix_fgetacl_default_xattr_only_preserves_default_aces(posix_dataset):
         os.rmdir(path)
 
 
+def _mnt_id(fd):
+    return t.statx('', dir_fd=fd, flags=t.AT_EMPTY_PATH,
+                   mask=t.STATX_MNT_ID_UNIQUE).stx_mnt_id
+
+
+def test_posix_fgetacl_mnt_id_matches_uncached(posix_dataset):
+    # The first call detects and caches the flavour, the second uses it.
+    fd = _open_file(posix_dataset, 'mnt_id_get')
+    try:
+        t.fsetacl(fd, t.POSIXACL.from_aces(_EXTENDED_POSIX_ACES))
+        mnt_id = _mnt_id(fd)
+        t.invalidate_acl_cache(mnt_id)
+        expected = t.fgetacl(fd)
+        assert t.fgetacl(fd, mnt_id=mnt_id) == expected
+        assert t.fgetacl(fd, mnt_id=mnt_id) == expected
+    finally:
+        os.close(fd)
+
+
+def test_posix_fsetacl_mnt_id_set_and_remove(posix_dataset):
+    fd = _open_file(posix_dataset, 'mnt_id_set')
+    try:
+        mnt_id = _mnt_id(fd)
+        t.fsetacl(fd, t.POSIXACL.from_aces(_EXTENDED_POSIX_ACES), mnt_id=mnt_id)
+        assert t.POSIXTag.USER in {a.tag for a in t.fgetacl(fd, mnt_id=mnt_id).aces}
+        t.fsetacl(fd, None, mnt_id=mnt_id)
+        t.fsetacl(fd, None, mnt_id=mnt_id)  # idempotent with a cached flavour
+        assert t.POSIXTag.USER not in {a.tag for a in t.fgetacl(fd).aces}
+    finally:
+        os.close(fd)
+
+
+def test_invalidate_acl_cache():
+    t.invalidate_acl_cache(12345)
+    t.invalidate_acl_cache(mnt_id=12345)
+    t.invalidate_acl_cache()
+    with pytest.raises(TypeError):
+        t.invalidate_acl_cache('x')
+
+
 # ═══════════════════════════════════════════════════════════════════════════
 # Live NFS4ACL — fgetacl / fsetacl
 # (nfs4_dataset: ZFS nfsv4 dataset; skipped if ZFS unavailable)
@@ -0,0 +1,78 @@
+# SPDX-License-Identifier: LGPL-3.0-or-later
+#
+# Tests for truenas_os.fcrc32c / fcrc32c_pair.
+
+import errno
+import os
+
+import pytest
+import truenas_os
+
+
+def _crc32c_ref(data):
+    """Bitwise reference CRC32C (reflected polynomial 0x82F63B78)."""
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+    return crc ^ 0xFFFFFFFF
+
+
+@pytest.fixture
+def open_file(tmp_path):
+    fds = []
+
+    def _open(data, name="f"):
+        path = tmp_path / name
+        path.write_bytes(data)
+        fd = os.open(str(path), os.O_RDONLY)
+        fds.append(fd)
+        return fd
+
+    yield _open
+    for fd in fds:
+        os.close(fd)
+
+
+def test_fcrc32c_check_value(open_file):
+    # Standard CRC-32C check value for the ASCII string "123456789".
+    assert truenas_os.fcrc32c(open_file(b"123456789")) == 0xE3069283
+
+
+def test_fcrc32c_empty_file(open_file):
+    assert truenas_os.fcrc32c(open_file(b"")) == 0
+
+
+def test_fcrc32c_matches_reference_unaligned_length(open_file):
+    data = os.urandom(4099)
+    assert truenas_os.fcrc32c(open_file(data)) == _crc32c_ref(data)
+
+
+def test_fcrc32c_preserves_file_offset(open_file):
+    fd = open_file(b"abcdef")
+    os.lseek(fd, 3, os.SEEK_SET)
+    truenas_os.fcrc32c(fd)
+    assert os.lseek(fd, 0, os.SEEK_CUR) == 3
+
+
+def test_fcrc32c_pair(open_file):
+    a = os.urandom(3 * 1024 * 1024 + 17)
+    fd_a = open_file(a, "a")
+    fd_b = open_file(a[:-1] + b"\x00", "b")
+    crc_a, crc_b = truenas_os.fcrc32c_pair(fd_a, fd_b)
+    assert crc_a == truenas_os.fcrc32c(fd_a)
+    assert crc_b == truenas_os.fcrc32c(fd_b)
+    assert truenas_os.fcrc32c_pair(fd_a, fd_a) == (crc_a, crc_a)
+
+
+def test_fcrc32c_bad_fd():
+    with pytest.raises(OSError) as exc:
+        truenas_os.fcrc32c(-1)
+    assert exc.value.errno == errno.EBADF
+
+
+def test_fcrc32c_pair_bad_second_fd(open_file):
+    with pytest.raises(OSError) as exc:
+        truenas_os.fcrc32c_pair(open_file(b"x"), -1)
+    assert exc.value.errno == errno.EBADF
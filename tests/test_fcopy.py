@@ -0,0 +1,163 @@
+# SPDX-License-Identifier: LGPL-3.0-or-later
+#
+# Tests for truenas_os.fcopy_small and the fallocate / syncfs copy helpers.
+
+import errno
+import os
+import stat
+
+import pytest
+import truenas_os
+
+
+def _open_fd(path):
+    return os.open(str(path), os.O_RDWR | os.O_CREAT | os.O_EXCL, 0o600)
+
+
+@pytest.fixture
+def src_fd(tmp_path):
+    fd_ = _open_fd(tmp_path / "src")
+    try:
+        yield fd_
+    finally:
+        os.close(fd_)
+
+
+@pytest.fixture
+def dst_fd(tmp_path):
+    fd_ = _open_fd(tmp_path / "dst")
+    try:
+        yield fd_
+    finally:
+        os.close(fd_)
+
+
+def _read_all(fd):
+    return os.pread(fd, os.fstat(fd).st_size, 0)
+
+
+def test_fcopy_small_copies_data(src_fd, dst_fd):
+    data = os.urandom(4099)
+    os.pwrite(src_fd, data, 0)
+    assert truenas_os.fcopy_small(src_fd, dst_fd) == len(data)
+    assert _read_all(dst_fd) == data
+
+
+def test_fcopy_small_empty_file(src_fd, dst_fd):
+    assert truenas_os.fcopy_small(src_fd, dst_fd) == 0
+    assert os.fstat(dst_fd).st_size == 0
+
+
+def test_fcopy_small_larger_than_buffer(src_fd, dst_fd):
+    data = os.urandom(2 * truenas_os.FCOPY_SMALL_MAX + 17)
+    os.pwrite(src_fd, data, 0)
+    assert truenas_os.fcopy_small(src_fd, dst_fd) == len(data)
+    assert _read_all(dst_fd) == data
+
+
+def test_fcopy_small_preserves_file_offsets(src_fd, dst_fd):
+    os.pwrite(src_fd, b"abcdef", 0)
+    os.lseek(src_fd, 3, os.SEEK_SET)
+    truenas_os.fcopy_small(src_fd, dst_fd)
+    assert os.lseek(src_fd, 0, os.SEEK_CUR) == 3
+    assert os.lseek(dst_fd, 0, os.SEEK_CUR) == 0
+
+
+def test_fcopy_small_applies_metadata(src_fd, dst_fd):
+    os.pwrite(src_fd, b"x" * 100, 0)
+    st = os.fstat(dst_fd)
+    ns = (1_000_000_001, 2_000_000_002)
+    truenas_os.fcopy_small(src_fd, dst_fd, uid=st.st_uid, gid=st.st_gid,
+                           mode=0o640, ns=ns)
+    st = os.fstat(dst_fd)
+    assert stat.S_IMODE(st.st_mode) == 0o640
+    assert (st.st_atime_ns, st.st_mtime_ns) == ns
+
+
+def test_fcopy_small_large_ids(src_fd, dst_fd):
+    # uid_t / gid_t are 32-bit unsigned; ids at or above 2**31 are valid.
+    if os.geteuid() != 0:
+        pytest.skip("chown to an arbitrary owner needs root")
+    os.pwrite(src_fd, b"x", 0)
+    truenas_os.fcopy_small(src_fd, dst_fd, uid=3_000_000_000,
+                           gid=2**32 - 2)
+    st = os.fstat(dst_fd)
+    assert (st.st_uid, st.st_gid) == (3_000_000_000, 2**32 - 2)
+
+
+@pytest.mark.parametrize("kw", [{"uid": -2}, {"gid": -2}, {"uid": 2**32},
+                                {"gid": 2**32}])
+def test_fcopy_small_bad_ids(src_fd, dst_fd, kw):
+    os.pwrite(src_fd, b"x", 0)
+    with pytest.raises(ValueError):
+        truenas_os.fcopy_small(src_fd, dst_fd, **kw)
+
+
+def test_fcopy_small_pre_epoch_timestamps(src_fd, dst_fd):
+    os.pwrite(src_fd, b"x", 0)
+    ns = (-1, -1_500_000_000)
+    truenas_os.fcopy_small(src_fd, dst_fd, ns=ns)
+    st = os.fstat(dst_fd)
+    assert (st.st_atime_ns, st.st_mtime_ns) == ns
+
+
+def test_fcopy_small_defaults_leave_metadata(src_fd, dst_fd):
+    os.pwrite(src_fd, b"x", 0)
+    before = os.fstat(dst_fd)
+    truenas_os.fcopy_small(src_fd, dst_fd)
+    after = os.fstat(dst_fd)
+    assert after.st_mode == before.st_mode
+    assert (after.st_uid, after.st_gid) == (before.st_uid, before.st_gid)
+
+
+def test_fcopy_small_bad_ns(src_fd, dst_fd):
+    os.pwrite(src_fd, b"x", 0)
+    with pytest.raises(TypeError):
+        truenas_os.fcopy_small(src_fd, dst_fd, ns=(1,))
+
+
+def test_fcopy_small_bad_fd(src_fd):
+    os.pwrite(src_fd, b"x", 0)
+    with pytest.raises(OSError) as exc:
+        truenas_os.fcopy_small(src_fd, -1)
+    assert exc.value.errno == errno.EBADF
+
+
+def test_fallocate_keep_size(dst_fd):
+    try:
+        truenas_os.fallocate(dst_fd, 0, 1 << 20,
+                             mode=truenas_os.FALLOC_FL_KEEP_SIZE)
+    except OSError as e:
+        if e.errno == errno.EOPNOTSUPP:
+            pytest.skip("filesystem does not support fallocate")
+        raise
+    st = os.fstat(dst_fd)
+    assert st.st_size == 0
+    assert st.st_blocks * 512 >= 1 << 20
+
+
+def test_fallocate_extends_size(dst_fd):
+    try:
+        truenas_os.fallocate(dst_fd, 0, 8192)
+    except OSError as e:
+        if e.errno == errno.EOPNOTSUPP:
+            pytest.skip("filesystem does not support fallocate")
+        raise
+    assert os.fstat(dst_fd).st_size == 8192
+
+
+def test_fallocate_bad_length(dst_fd):
+    with pytest.raises(OSError) as exc:
+        truenas_os.fallocate(dst_fd, 0, 0)
+    assert exc.value.errno == errno.EINVAL
+
+
+def test_syncfs(dst_fd):
+    os.write(dst_fd, b"data")
+    assert truenas_os.syncfs(dst_fd) is None
+
+
+def test_syncfs_bad_fd():
+    with pytest.raises(OSError) as exc:
+        truenas_os.syncfs(-1)
+    assert exc.value.errno == errno.EBADF
@@ -24,7 +24,12 @@ from __future__ import annotations
 import dataclasses
 import datetime
 import operator
+import os
+import pickle
+import random
 import re
+import time
+import tracemalloc
 
 import pytest
 
@@ -32,11 +37,20 @@ from typing import NamedTuple
 
 from truenas_pyfilter import (
     CompiledFilters,
+    CompiledFilterSet,
+    CompiledLookup,
     CompiledOptions,
+    LiveQuery,
+    compile_filter_set,
     compile_filters,
+    compile_lookup,
     compile_options,
+    explain,
+    live_query,
+    paginate,
     tnfilter,
     match,
+    match_any,
 )
 
 # ── Convenience wrapper ───────────────────────────────────────────────────────
@@ -1473,6 +1487,689 @@ def test_nt_mixed_with_dicts():
     assert result[0]["name"] == "alice"
 
 
+# ═════════════════════════════════════════════════════════════════════════════
+# Struct-sequence support (slot-index fast path)
+# ═════════════════════════════════════════════════════════════════════════════
+
+def _st(ino, size, mtime_ns=None):
+    """os.stat_result with 10 visible fields; st_mtime_ns is a hidden one."""
+    hidden = {} if mtime_ns is None else {"st_mtime_ns": mtime_ns}
+    return os.stat_result((0o100644, ino, 1, 1, 0, 0, size, 0, 0, 0), hidden)
+
+
+_SS_STATS = [_st(1, 10, 100), _st(2, 1 << 31, 200), _st(3, 1 << 40)]
+
+
+def test_structseq_visible_field():
+    assert fl(_SS_STATS, [["st_size", ">", 1 << 30]]) == _SS_STATS[1:]
+
+
+def test_structseq_hidden_field():
+    assert fl(_SS_STATS, [["st_mtime_ns", "=", 200]]) == [_SS_STATS[1]]
+    # unset hidden fields read as None, as via getattr
+    assert fl(_SS_STATS, [["st_mtime_ns", "=", None]]) == [_SS_STATS[2]]
+
+
+def test_structseq_nested_in_dict():
+    data = [{"name": f"f{i}", "stat": st} for i, st in enumerate(_SS_STATS)]
+    assert fl(data, [["stat.st_size", ">", 1 << 30]]) == data[1:]
+
+
+def test_structseq_missing_field_no_match():
+    assert fl(_SS_STATS, [["st_nope", "=", 1]]) == []
+
+
+def test_structseq_mixed_types():
+    # Same compiled term alternates between struct-sequence types and a
+    # NamedTuple; the per-term type cache must be re-validated each time.
+    tm = time.gmtime(0)
+    data = [_SS_STATS[0], tm, _SS_STATS[1], tm, _User(1, "a", True, 1.0)]
+    assert fl(data, [["tm_year", "=", 1970]]) == [tm, tm]
+    assert fl(data, [["st_ino", "in", [1, 2]]]) == _SS_STATS[:2]
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# CompiledFilterSet / match_any()
+# ═════════════════════════════════════════════════════════════════════════════
+
+_FS_SUBS = {
+    "pool": [["event", "=", "pool.update"]],
+    "pool7": [["event", "=", "pool.update"], ["fields.id", "=", 7]],
+    "ds": [["event", "=", "dataset.update"]],
+    "nested": [["fields.id", "=", 7]],
+    "or": [["OR", [["event", "=", "ds.x"], ["fields.id", "in", [700, 800]]]]],
+    "all": [],
+}
+
+_FS_ITEMS = [
+    {"event": "pool.update", "fields": {"id": 7}},
+    {"event": "pool.update", "fields": {"id": 8}},
+    {"event": "dataset.update", "fields": {"id": 700}},
+    {"event": "ds.x"},
+    {"fields": {"id": [7]}},  # unhashable value on an indexed path
+    {},
+]
+
+
+def _fs_ref(subs, item):
+    return [k for k, f in subs.items() if match(item, filters=f) is not None]
+
+
+def test_filter_set_matches_reference():
+    subs = {k: compile_filters(v) for k, v in _FS_SUBS.items()}
+    fs = compile_filter_set(subs)
+    assert isinstance(fs, CompiledFilterSet)
+    assert len(fs) == len(subs)
+    assert fs.ids == tuple(subs)
+    for item in _FS_ITEMS:
+        assert match_any(item, filter_set=fs) == _fs_ref(subs, item), item
+
+
+def test_filter_set_indexes_shared_path():
+    fs = compile_filter_set(
+        (i, compile_filters([["event", "=", f"ev.{i % 5}"], ["n", "=", i]]))
+        for i in range(50)
+    )
+    # "event" is shared by all fifty subscribers, so it is the only index
+    assert repr(fs) == "CompiledFilterSet(subscribers=50, indexed_paths=1)"
+    assert match_any({"event": "ev.3", "n": 13}, filter_set=fs) == [13]
+    assert match_any({"event": "ev.3", "n": 14}, filter_set=fs) == []
+
+
+def test_filter_set_duplicate_ids_and_order():
+    eq = compile_filters([["x", "=", 1]])
+    fs = compile_filter_set([("b", eq), ("a", compile_filters([])), ("b", eq)])
+    assert match_any({"x": 1}, filter_set=fs) == ["b", "a", "b"]
+    assert match_any({"x": 2}, filter_set=fs) == ["a"]
+
+
+def test_filter_set_equal_values_share_bucket():
+    # 1 == 1.0 == True hash alike; the full evaluation decides
+    fs = compile_filter_set([
+        ("int", compile_filters([["x", "=", 1]])),
+        ("float", compile_filters([["x", "=", 1.0]])),
+        ("str", compile_filters([["x", "=", "1"]])),
+    ])
+    assert match_any({"x": True}, filter_set=fs) == ["int", "float"]
+
+
+def test_filter_set_non_dict_items():
+    # struct sequences, NamedTuples and the getattr leaf fallback resolve the
+    # indexed path exactly as match() does
+    subs = {
+        "ino2": compile_filters([["st_ino", "=", 2]]),
+        "user": compile_filters([["name", "=", "alice"]]),
+        "leaf": compile_filters([["obj.missing", "=", _User(1, "x", True, 1.0)]]),
+    }
+    fs = compile_filter_set(subs)
+    items = [_SS_STATS[1], _User(1, "alice", True, 1.0),
+             {"obj": _User(1, "x", True, 1.0)}]
+    for item in items:
+        assert match_any(item, filter_set=fs) == _fs_ref(subs, item)
+
+
+def test_filter_set_empty():
+    fs = compile_filter_set({})
+    assert len(fs) == 0
+    assert match_any({"x": 1}, filter_set=fs) == []
+
+
+def test_filter_set_rejects_bad_input():
+    with pytest.raises(TypeError):
+        compile_filter_set([("a", [["x", "=", 1]])])
+    with pytest.raises(TypeError):
+        compile_filter_set(["a"])
+    with pytest.raises(TypeError):
+        match_any({}, filter_set=compile_filters([]))
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# LiveQuery (incrementally maintained tnfilter results)
+# ═════════════════════════════════════════════════════════════════════════════
+
+_LQ_ACTIVE = compile_filters([["active", "=", True]])
+
+
+def _lq(data, **co_kwargs):
+    return live_query(data, filters=_LQ_ACTIVE,
+                      options=compile_options(**co_kwargs), key="id")
+
+
+def _lq_apply_delta(window, delta):
+    """Client-side patch: drop removed/moved-from, then insert by new index."""
+    drop = [i for i, _ in delta.removed] + [o for o, _, _ in delta.moved]
+    for i in sorted(drop, reverse=True):
+        del window[i]
+    add = list(delta.added) + [(n, r) for _, n, r in delta.moved]
+    for i, row in sorted(add, key=lambda e: e[0]):
+        window.insert(i, row)
+    for i, row in delta.changed:
+        window[i] = row
+
+
+def test_live_query_initial_result():
+    data = [{"id": i, "active": i % 2 == 0, "score": -i} for i in range(10)]
+    lq = _lq(data, order_by=["score"], offset=1, limit=2)
+    assert isinstance(lq, LiveQuery)
+    assert len(lq) == 5
+    assert lq.key == "id"
+    assert lq.result() == [data[6], data[4]]
+
+
+def test_live_query_deltas():
+    data = [{"id": i, "active": True, "score": i} for i in range(4)]
+    lq = _lq(data, order_by=["-score"], limit=3)   # window: 3, 2, 1
+
+    d = lq.update({"id": 1, "active": True, "score": 10})
+    assert d.moved == ((2, 0, {"id": 1, "active": True, "score": 10}),)
+    assert not d.added and not d.removed and not d.changed
+
+    d = lq.update({"id": 1, "active": True, "score": 9})
+    assert d.changed == ((0, {"id": 1, "active": True, "score": 9}),)
+
+    # dropping out of the filter pulls the next row into the window
+    d = lq.update({"id": 3, "active": False, "score": 3})
+    assert d.removed == ((1, data[3]),)
+    assert d.added == ((2, data[0]),)
+    assert len(lq) == 3
+
+    # a new top row pushes the last one out
+    d = lq.insert({"id": 7, "active": True, "score": 100})
+    assert [i for i, _ in d.added] == [0]
+    assert d.removed == ((2, data[0]),)
+
+    d = lq.delete(3)  # known key, not matching: no visible change
+    assert d == ((), (), (), ())
+
+
+def test_live_query_matches_tnfilter_random():
+    rng = random.Random(7)
+    options = [
+        {"order_by": ["-score", "name"]},
+        {"order_by": ["nulls_first:grp", "score"], "offset": 2, "limit": 4},
+        {"order_by": ["name"], "select": ["id", "name"], "limit": 3},
+        {"offset": 1},
+    ]
+
+    def item(i):
+        it = {"id": i, "active": rng.random() < 0.7,
+              "score": rng.randrange(4), "name": rng.choice("abc")}
+        if rng.random() < 0.6:
+            it["grp"] = rng.choice([None, 1, 2])
+        return it
+
+    for co_kwargs in options:
+        co = compile_options(**co_kwargs)
+        coll = {i: item(i) for i in range(12)}
+        lq = live_query(list(coll.values()), filters=_LQ_ACTIVE, options=co,
+                        key="id")
+        window = lq.result()
+        for _ in range(200):
+            if coll and rng.random() < 0.3:
+                key = rng.choice(list(coll))
+                del coll[key]
+                delta = lq.delete(key)
+            else:
+                it = item(rng.randrange(20))
+                coll[it["id"]] = it
+                delta = lq.update(it)
+            expected = tnfilter(list(coll.values()), filters=_LQ_ACTIVE,
+                                options=co)
+            assert lq.result() == expected
+            _lq_apply_delta(window, delta)
+            assert window == expected
+
+
+def test_live_query_failed_update_is_atomic():
+    data = [{"id": i, "active": True, "score": i} for i in range(3)]
+    lq = _lq(data, order_by=["score"])
+    with pytest.raises(TypeError):
+        lq.update({"id": 1, "active": True, "score": "x"})
+    assert lq.result() == data
+
+
+def test_live_query_errors():
+    with pytest.raises(ValueError, match="duplicate key"):
+        _lq([{"id": 1}, {"id": 1}])
+    with pytest.raises(ValueError, match="get/count"):
+        _lq([], count=True)
+    lq = _lq([{"id": 1, "active": False}])
+    with pytest.raises(KeyError):
+        lq.insert({"active": True})
+    with pytest.raises(KeyError):
+        lq.delete(2)
+    assert lq.delete(1) == ((), (), (), ())
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# group_by / aggregate options
+# ═════════════════════════════════════════════════════════════════════════════
+
+_GB_DATA = [
+    {"id": i, "pool": ("tank", "boot", "data")[i % 3], "type": ("FS", "VOL")[i % 2],
+     "used": i * 10, "owner": {"uid": i % 4} if i % 5 else {}}
+    for i in range(30)
+]
+
+
+def _gb(filters=None, **co_kwargs):
+    return tnfilter(_GB_DATA, filters=compile_filters(filters or []),
+                    options=compile_options(**co_kwargs))
+
+
+def test_group_by_aggregates_ref():
+    out = _gb([["id", ">", 2]], group_by=["pool"], aggregate={
+        "n": ["count"],
+        "used": ["sum", "used"],
+        "lo": ["min", "used"],
+        "hi": ["max", "used"],
+        "owners": ["distinct_count", "owner.uid"],
+        "with_owner": ["count", "owner.uid"],
+    })
+    groups = {}
+    for it in _GB_DATA:
+        if it["id"] > 2:
+            groups.setdefault(it["pool"], []).append(it)
+    expected = []
+    for pool, items in groups.items():
+        uids = [it["owner"]["uid"] for it in items if "uid" in it["owner"]]
+        used = [it["used"] for it in items]
+        expected.append({"pool": pool, "n": len(items), "used": sum(used),
+                         "lo": min(used), "hi": max(used),
+                         "owners": len(set(uids)), "with_owner": len(uids)})
+    assert out == expected
+
+
+def test_group_by_multiple_keys_and_options():
+    out = _gb(group_by=["pool", "type"], aggregate={"n": ["count"]},
+              order_by=["pool", "-type"])
+    assert [(r["pool"], r["type"]) for r in out][:2] == [("boot", "VOL"),
+                                                         ("boot", "FS")]
+    assert all(r["n"] == 5 for r in out)
+    assert _gb(group_by=["pool", "type"], count=True) == 6
+    assert _gb(group_by=["pool"], select=["pool"], order_by=["pool"],
+               offset=1, limit=1) == [{"pool": "data"}]
+    # a group_by path that is absent groups under None
+    assert _gb(group_by=["owner.uid"], aggregate={"n": ["count"]})[0] == \
+        {"owner.uid": None, "n": 6}
+
+
+def test_aggregate_without_group_by():
+    assert _gb(aggregate={"n": ["count"], "used": ["sum", "used"]}) == \
+        [{"n": 30, "used": sum(range(0, 300, 10))}]
+    # one row even when nothing matched
+    assert _gb([["id", "<", 0]], aggregate={
+        "n": ["count"], "s": ["sum", "used"], "m": ["max", "used"],
+        "d": ["distinct_count", "pool"],
+    }) == [{"n": 0, "s": 0, "m": None, "d": 0}]
+    # grouping with no matches yields no groups
+    assert _gb([["id", "<", 0]], group_by=["pool"]) == []
+
+
+def test_group_by_introspection_and_errors():
+    co = compile_options(group_by=["pool"], aggregate={"n": ["count"]})
+    assert co.group_by == ["pool"]
+    assert co.aggregate == {"n": ["count"]}
+    assert compile_options().group_by == []
+    assert compile_options().aggregate == {}
+
+    for kwargs, exc in [
+        ({"group_by": "pool"}, TypeError),
+        ({"aggregate": [["count"]]}, TypeError),
+        ({"aggregate": {"x": ["avg", "used"]}}, ValueError),
+        ({"aggregate": {"x": ["sum"]}}, ValueError),
+        ({"aggregate": {"x": "count"}}, TypeError),
+        ({"group_by": ["a"], "aggregate": {"a": ["count"]}}, ValueError),
+        ({"group_by": ["a", "a"]}, ValueError),
+        ({"group_by": [""]}, ValueError),
+        ({"group_by": ["a"], "get": True}, ValueError),
+    ]:
+        with pytest.raises(exc):
+            compile_options(**kwargs)
+
+    with pytest.raises(ValueError, match="group_by"):
+        match({}, filters=compile_filters([]), options=co)
+    with pytest.raises(ValueError, match="group_by"):
+        live_query([], filters=compile_filters([]), options=co, key="id")
+    with pytest.raises(TypeError):
+        _gb(group_by=["owner"])     # dict group values are unhashable
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# distinct option
+# ═════════════════════════════════════════════════════════════════════════════
+
+def test_distinct_select_ref():
+    out = _gb([["id", ">", 2]], select=["pool", ["type", "kind"]], distinct=True)
+    expected, seen = [], set()
+    for it in _GB_DATA:
+        key = (it["pool"], it["type"])
+        if it["id"] > 2 and key not in seen:
+            seen.add(key)
+            expected.append({"pool": it["pool"], "kind": it["type"]})
+    assert out == expected
+    assert _gb(select=["pool"], distinct=True, order_by=["-pool"], limit=2) == \
+        [{"pool": "tank"}, {"pool": "data"}]
+    # nested paths are rebuilt only for the rows kept
+    assert _gb([["id", "<", 10]], select=["owner.uid"], distinct=True) == \
+        [{}, {"owner": {"uid": 1}}, {"owner": {"uid": 2}},
+         {"owner": {"uid": 3}}, {"owner": {"uid": 0}}]
+
+
+def test_distinct_count_and_absent_vs_none():
+    assert _gb(select=["pool", "type"], distinct=True, count=True) == 6
+    assert _gb(select=["owner.uid"], distinct=True, count=True) == 5
+    data = [{"a": None}, {}, {"a": None}, {}, {"a": 1}]
+    out = tnfilter(data, filters=compile_filters([]),
+                   options=compile_options(select=["a"], distinct=True))
+    assert out == [{"a": None}, {}, {"a": 1}]
+
+
+def test_distinct_errors():
+    assert compile_options(select=["a"], distinct=True).distinct is True
+    assert compile_options().distinct is False
+    with pytest.raises(ValueError, match="requires select"):
+        compile_options(distinct=True)
+    co = compile_options(select=["owner"], distinct=True)
+    with pytest.raises(TypeError):
+        tnfilter(_GB_DATA, filters=compile_filters([]), options=co)
+    co = compile_options(select=["id"], order_by=["id"], limit=5, distinct=True)
+    with pytest.raises(ValueError, match="distinct"):
+        paginate([], filters=compile_filters([]), options=co)
+    with pytest.raises(ValueError, match="distinct"):
+        live_query([], filters=compile_filters([]), options=co, key="id")
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# lookup (hash join)
+# ═════════════════════════════════════════════════════════════════════════════
+
+_LK_DATASETS = [
+    {"name": f"tank/ds{i}", "encrypted": i % 3 == 0, "quota": {"value": i * 100}}
+    for i in range(10)
+] + [{"name": None, "encrypted": True}, {"encrypted": True}]
+
+_LK_SHARES = [
+    {"id": i, "path": f"tank/ds{i % 12}"} if i % 7 else {"id": i}
+    for i in range(40)
+]
+
+
+def _lk(filters, **co_kwargs):
+    return tnfilter(_LK_SHARES, filters=compile_filters(filters),
+                    options=compile_options(**co_kwargs),
+                    lookup=compile_lookup(_LK_DATASETS, local="path",
+                                          foreign="name"))
+
+
+def test_lookup_filter_ref():
+    by_name = {d["name"]: d for d in _LK_DATASETS if d.get("name") is not None}
+    joined = [(s, by_name.get(s.get("path"))) for s in _LK_SHARES]
+
+    assert _lk([["lookup.encrypted", "=", True]]) == \
+        [s for s, d in joined if d and d["encrypted"]]
+    assert _lk([["OR", [["lookup.quota.value", ">=", 800],
+                        ["id", "<", 3]]]]) == \
+        [s for s, d in joined if (d and d["quota"]["value"] >= 800) or s["id"] < 3]
+    # "lookup" alone is the joined record: != None keeps joined items
+    assert _lk([["lookup", "!=", None]], count=True) == \
+        sum(1 for _, d in joined if d)
+    # without lookup= the path reads the item as usual
+    assert tnfilter(_LK_SHARES, filters=compile_filters([["lookup.x", "=", 1]]),
+                    options=compile_options()) == []
+
+
+def test_lookup_select_splice():
+    out = _lk([["id", "in", [1, 7, 11]]],
+              select=["id", ["lookup.quota.value", "quota"], "lookup.encrypted"],
+              order_by=["-id"])
+    assert out == [
+        {"id": 11},                         # tank/ds11: no such dataset
+        {"id": 7},                          # no path
+        {"id": 1, "quota": 100, "lookup": {"encrypted": False}},
+    ]
+    row = _lk([["id", "=", 3]], select=["id", "lookup"])[0]
+    assert row["lookup"] is _LK_DATASETS[3]
+    # order_by reads the projection, so a selected lookup path sorts
+    out = _lk([["lookup", "!=", None]], select=["id", ["lookup.quota.value", "q"]],
+              order_by=["-q", "id"], limit=2)
+    assert out == [{"id": 9, "q": 900}, {"id": 33, "q": 900}]
+
+
+def test_lookup_errors_and_introspection():
+    lk = compile_lookup(_LK_DATASETS, local="path", foreign="name")
+    assert isinstance(lk, CompiledLookup)
+    assert len(lk) == 10
+    assert (lk.local, lk.foreign) == ("path", "name")
+    assert "records=10" in repr(lk)
+
+    with pytest.raises(ValueError, match="duplicate"):
+        compile_lookup([{"k": 1}, {"k": 1}], local="k", foreign="k")
+    with pytest.raises(TypeError):
+        compile_lookup([{"k": [1]}], local="k", foreign="k")
+    with pytest.raises(ValueError):
+        compile_lookup([], local="", foreign="k")
+    with pytest.raises(TypeError):
+        compile_lookup([], local=1, foreign="k")
+    with pytest.raises(TypeError):
+        tnfilter([], filters=compile_filters([]), options=compile_options(),
+                 lookup={})
+    with pytest.raises(TypeError, match="options"):
+        tnfilter([], filters=compile_filters([]))
+    with pytest.raises(TypeError):
+        tnfilter([{"path": ["x"]}], filters=compile_filters([["lookup.a", "=", 1]]),
+                 options=compile_options(), lookup=lk)
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# Pickling compiled filters / options
+# ═════════════════════════════════════════════════════════════════════════════
+
+_PK_FILTERS = [
+    ["name", "~", "u1.*"],
+    ["OR", [
+        ["grp.gid", "=", 1],
+        [["id", ">", 12], ["name", "C^", "U1"]],
+        ["tags.*", "in", ["x"]],
+    ]],
+    ["name", "!$", "9"],
+]
+
+
+@pytest.mark.parametrize("co_kwargs", [
+    {},
+    {"select": ["id", ["grp.gid", "gid"]], "order_by": ["nulls_first:-gid", "id"],
+     "offset": 1, "limit": 3},
+    {"group_by": ["grp.gid"], "aggregate": {"n": ["count"], "hi": ["max", "id"]},
+     "order_by": ["-n"]},
+    {"select": ["grp.gid"], "distinct": True, "count": True},
+    {"get": True},
+])
+def test_pickle_roundtrip(co_kwargs):
+    data = [{"id": i, "name": f"u{i}", "grp": {"gid": i % 3} if i % 2 else {},
+             "tags": ["x"] if i % 5 == 0 else []} for i in range(40)]
+    cf = compile_filters(_PK_FILTERS)
+    co = compile_options(**co_kwargs)
+    cf2, co2 = pickle.loads(pickle.dumps((cf, co)))
+    assert isinstance(cf2, CompiledFilters) and isinstance(co2, CompiledOptions)
+    assert repr(cf2) == repr(cf) and repr(co2) == repr(co)
+    assert (co2.select, co2.order_by, co2.group_by, co2.aggregate, co2.limit) == \
+        (co.select, co.order_by, co.group_by, co.aggregate, co.limit)
+    assert tnfilter(data, filters=cf2, options=co2) == \
+        tnfilter(data, filters=cf, options=co)
+    assert match(data[13], filters=cf2) == match(data[13], filters=cf)
+
+
+def test_pickle_rejects_other_versions():
+    import truenas_pyfilter
+
+    loader, args = compile_filters([["a", "=", 1]]).__reduce__()
+    assert loader is truenas_pyfilter._load_filters
+    with pytest.raises(ValueError, match="version"):
+        loader(args[0] + 1, *args[1:])
+    with pytest.raises(ValueError):
+        loader(args[0], ((0, ("a",), 999, False, 1),), None, "")
+    loader, args = compile_options(select=["a"]).__reduce__()
+    with pytest.raises(ValueError, match="version"):
+        loader(args[0] + 1, *args[1:])
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# paginate() (keyset pagination)
+# ═════════════════════════════════════════════════════════════════════════════
+
+def _pg_data():
+    rng = random.Random(11)
+    data = []
+    for i in range(200):
+        it = {"id": i, "score": rng.randrange(10), "name": rng.choice("abc")}
+        if i % 3:
+            it["grp"] = rng.choice([None, 1, 2])
+        data.append(it)
+    return data
+
+
+@pytest.mark.parametrize("order_by", [
+    ["score", "id"],
+    ["-score", "name", "-id"],
+    ["nulls_first:grp", "-score", "id"],
+    ["nulls_last:-grp", "id"],
+])
+@pytest.mark.parametrize("limit", [1, 9, 64, 100])
+def test_paginate_walks_tnfilter_order(order_by, limit):
+    data = _pg_data()
+    cf = compile_filters([["name", "!=", "c"]])
+    expected = tnfilter(data, filters=cf,
+                        options=compile_options(order_by=order_by))
+    co = compile_options(order_by=order_by, limit=limit)
+    seen = []
+    page = paginate(data, filters=cf, options=co)
+    assert page.items == tnfilter(data, filters=cf, options=co)
+    while True:
+        seen += page.items
+        if page.cursor is None:
+            break
+        assert len(page.items) == limit
+        page = paginate(data, filters=cf, options=co, after=page.cursor)
+    assert seen == expected
+
+
+def test_paginate_cursor_and_select():
+    data = _pg_data()
+    cf = compile_filters([])
+    co = compile_options(order_by=["score", "id"], select=["id", "score"],
+                         limit=5)
+    page = paginate(data, filters=cf, options=co, after=[3, 1000])
+    assert all(r["score"] > 3 for r in page.items)
+    assert page.cursor == (page.items[-1]["score"], page.items[-1]["id"])
+    assert set(page.items[0]) == {"id", "score"}
+
+    # the cursor is a key, not a position: a row inserted before it does
+    # not shift the next page
+    nxt = paginate(data, filters=cf, options=co, after=page.cursor)
+    data.insert(0, {"id": -1, "score": 0, "name": "a"})
+    assert paginate(data, filters=cf, options=co,
+                    after=page.cursor).items == nxt.items
+
+    last = paginate(data, filters=cf, options=co, after=(9, 10**6))
+    assert last.items == [] and last.cursor is None
+
+
+def test_paginate_large_limit_short_listing():
+    # The heap grows with the rows kept, not with the requested limit.
+    data = [{"id": i} for i in range(10)]
+    cf = compile_filters([])
+    co = compile_options(order_by=["-id"], limit=10000)
+    tracemalloc.start()
+    try:
+        page = paginate(data, filters=cf, options=co)
+        _, peak = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+    assert [r["id"] for r in page.items] == list(range(9, -1, -1))
+    assert page.cursor is None
+    assert peak < 32 * 1024
+
+def test_paginate_errors():
+    cf = compile_filters([])
+    with pytest.raises(ValueError, match="order_by and limit"):
+        paginate([], filters=cf, options=compile_options(limit=5))
+    with pytest.raises(ValueError, match="order_by and limit"):
+        paginate([], filters=cf, options=compile_options(order_by=["id"]))
+    with pytest.raises(ValueError, match="offset"):
+        paginate([], filters=cf,
+                 options=compile_options(order_by=["id"], limit=5, offset=5))
+    co = compile_options(order_by=["id"], limit=5)
+    with pytest.raises(ValueError, match="one value per order_by key"):
+        paginate([], filters=cf, options=co, after=(1, 2))
+    with pytest.raises(TypeError):
+        paginate([], filters=cf, options=co, after="1")
+    with pytest.raises(TypeError):
+        paginate([], filters=cf)
+    with pytest.raises(TypeError):
+        paginate([{"id": 1}], filters=cf, options=co, after=("x",))
+
+
+# ═════════════════════════════════════════════════════════════════════════════
+# explain() (profiled tnfilter)
+# ═════════════════════════════════════════════════════════════════════════════
+
+_EX_DATA = [
+    {"id": i, "name": f"u{i}", "grp": {"gid": i % 3} if i % 2 else {}}
+    for i in range(20)
+]
+
+
+def test_explain_counts():
+    cf = compile_filters([
+        ["id", ">=", 10],
+        ["OR", [[["grp.gid", "=", 1]], [["name", "~", "^u1[5-9]$"]]]],
+    ])
+    co = compile_options(order_by=["-id"], select=["id"], limit=3)
+    prof = explain(_EX_DATA, filters=cf, options=co)
+
+    assert prof.result == tnfilter(_EX_DATA, filters=cf, options=co)
+    assert prof.items == 20
+    expected = [it for it in _EX_DATA
+                if it["id"] >= 10 and (it["grp"].get("gid") == 1
+                                       or it["id"] >= 15)]
+    assert prof.matched == len(expected)
+
+    first, branch = prof.filters
+    assert first.term == ["id", ">=", 10]
+    assert (first.evaluations, first.matches, first.path_misses) == (20, 10, 0)
+    assert first.children == ()
+
+    # OR is only reached by items that passed the first filter
+    assert branch.term == "OR"
+    assert (branch.evaluations, branch.matches) == (10, len(expected))
+    gid_and, name_and = branch.children
+    gid = gid_and.children[0]
+    assert gid.term == ["grp.gid", "=", 1]
+    assert (gid.evaluations, gid.path_misses) == (10, 5)
+    # the second branch only runs when the first did not match
+    assert name_and.evaluations == 10 - gid.matches
+
+    for ns in (prof.filter_ns, prof.select_ns, prof.order_ns, prof.slice_ns):
+        assert 0 <= ns <= prof.total_ns
+    assert branch.time_ns >= gid_and.time_ns
+
+
+def test_explain_tree_and_get():
+    cf = compile_filters([["name", "C=", "U3"]])
+    prof = explain(_EX_DATA, filters=cf, options=compile_options(get=True))
+    assert prof.result == [_EX_DATA[3]]
+    assert prof.items == 4
+    assert prof.matched == 1
+    lines = prof.tree.splitlines()
+    assert lines[0].startswith("tnfilter: 4 items, 1 matched")
+    assert "evals=4 matches=1 (25.0%)" in lines[2]
+
+    prof = explain([], filters=compile_filters([]),
+                   options=compile_options())
+    assert prof.result == [] and prof.filters == ()
+
+
 # ═════════════════════════════════════════════════════════════════════════════
 # dataclass support (getattr fallback path, non-tuple)
 # ═════════════════════════════════════════════════════════════════════════════
@@ -15,15 +15,19 @@ Covers:
 from __future__ import annotations
 
 import dataclasses
+import pickle
 
 import pydantic
 import pytest
 
 from truenas_pyfilter import (
+    compile_filter_set,
     compile_filters,
+    compile_lookup,
     compile_options,
     tnfilter,
     match,
+    match_any,
 )
 
 
@@ -126,6 +130,25 @@ def test_pydantic_match_single_item():
     assert match(m, filters=compile_filters([["age", "=", 99]], model=type(m))) is None
 
 
+def test_pydantic_filter_set():
+    data = _models()
+    M = type(data[0])
+    fs = compile_filter_set({
+        "alice": compile_filters([["name", "=", "alice"]], model=M),
+        "inner2": compile_filters([["inner.val", "=", 2]], model=M),
+        "bonus": compile_filters([["bonus", "=", 200]], model=M),
+    })
+    assert match_any(data[0], filter_set=fs) == ["alice"]
+    assert match_any(data[1], filter_set=fs) == ["inner2", "bonus"]
+    # one model check per item, as for match()
+    with pytest.raises(TypeError):
+        match_any(data[0], filter_set=compile_filter_set(
+            {"a": compile_filters([["name", "=", "alice"]])}))
+    with pytest.raises(ValueError, match="same model"):
+        compile_filter_set([("a", compile_filters([], model=M)),
+                            ("b", compile_filters([]))])
+
+
 def test_pydantic_filtering_without_model_is_rejected():
     # A filter compiled without model= must refuse pydantic model instances
     # rather than silently matching against unresolved attribute names.
@@ -438,3 +461,51 @@ def test_options_model_none_is_noop():
     co = compile_options(order_by=["id"], model=None)
     out = tnfilter(BASIC, filters=compile_filters([]), options=co)
     assert [o["id"] for o in out] == sorted(o["id"] for o in BASIC)
+
+
+def test_options_model_group_by_alias():
+    # group_by/aggregate paths read the model instances and are alias-resolved;
+    # the output rows are plain dicts keyed by the paths as passed, which
+    # order_by/select then address without resolution.
+    Item, data = _aliased_models()
+    out = _opts_run(Item, data, group_by=["nested.theVal"],
+                    aggregate={"age": ["sum", "years"]},
+                    order_by=["-age"])
+    assert out == [{"nested.theVal": 1, "age": 30},
+                   {"nested.theVal": 2, "age": 20}]
+
+
+def test_model_lookup_field_is_not_the_join():
+    # A model with its own ``lookup`` field keeps alias resolution for paths
+    # under it; only models without one treat ``lookup.`` as the joined record.
+    Field = pydantic.Field
+
+    class Pool(pydantic.BaseModel):
+        pool_name: str = Field(alias="pool")
+
+    class Item(pydantic.BaseModel):
+        id: int
+        lookup: Pool
+
+    class Plain(pydantic.BaseModel):
+        id: int
+
+    data = [Item(id=1, lookup={"pool": "tank"}),
+            Item(id=2, lookup={"pool": "boot"})]
+    lk = compile_lookup([{"id": 1, "pool": "boot"}], local="id", foreign="id")
+
+    cf = compile_filters([["lookup.pool", "=", "tank"]], model=Item)
+    out = tnfilter(data, filters=cf, options=compile_options(), lookup=lk)
+    assert [o.id for o in out] == [1]
+    out = tnfilter(data, filters=pickle.loads(pickle.dumps(cf)),
+                   options=compile_options(), lookup=lk)
+    assert [o.id for o in out] == [1]
+
+    co = compile_options(select=["lookup.pool"], model=Item)
+    out = tnfilter(data, filters=compile_filters([]), options=co, lookup=lk)
+    assert [o.lookup for o in out] == [{"pool_name": "tank"}, {"pool_name": "boot"}]
+
+    plain = [Plain(id=1), Plain(id=2)]
+    cf = compile_filters([["lookup.pool", "=", "boot"]], model=Plain)
+    out = tnfilter(plain, filters=cf, options=compile_options(), lookup=lk)
+    assert [o.id for o in out] == [1]
@@ -1840,3 +1840,244 @@ def test_iter_mountpoint_fd_is_o_path(temp_mount_tree_with_submount):
             list(os.scandir(item.fd))
         return
     pytest.fail("no mountpoint yielded")
+
+
+# ── iter_filesystem_contents_fd ───────────────────────────────────────────────
+
+
+def _open_dir(path, flags=os.O_RDONLY):
+    return os.open(str(path), flags | os.O_DIRECTORY)
+
+
+def test_iter_fd_path_prefix(temp_mount_tree):
+    """With path= set, parents are built on it, as for the path entry point."""
+    expected = set()
+    for dirpath, dirnames, filenames in os.walk(str(temp_mount_tree)):
+        expected.update((dirpath, n) for n in dirnames + filenames)
+
+    fd = _open_dir(temp_mount_tree)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, path=str(temp_mount_tree)) as it:
+            got = {(i.parent, i.name) for i in it}
+    finally:
+        os.close(fd)
+    assert got == expected
+
+
+def test_iter_fd_relative_parents(temp_mount_tree):
+    """Without path=, parents are relative to the fd."""
+    fd = _open_dir(temp_mount_tree, os.O_PATH)
+    try:
+        it = truenas_os.iter_filesystem_contents_fd(fd)
+    finally:
+        os.close(fd)  # the iterator holds its own fd
+
+    with it:
+        paths = {os.path.join(i.parent, i.name) for i in it}
+    assert paths == {
+        "file1.txt", "file2.txt", "dir1", "dir1/nested1.txt", "dir1/nested2.txt",
+        "dir2", "dir2/subdir", "dir2/subdir/deep.txt", "emptydir",
+    }
+
+
+def test_iter_fd_independent_offset(temp_mount_tree):
+    """Iterating does not move the caller's directory offset."""
+    fd = _open_dir(temp_mount_tree)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd) as it:
+            list(it)
+        assert len(os.listdir(fd)) == 5
+    finally:
+        os.close(fd)
+
+
+def test_iter_fd_not_a_directory(temp_mount_tree):
+    fd = os.open(str(temp_mount_tree / "file1.txt"), os.O_RDONLY)
+    try:
+        with pytest.raises(NotADirectoryError):
+            truenas_os.iter_filesystem_contents_fd(fd)
+    finally:
+        os.close(fd)
+
+
+def test_iter_fd_bad_fd():
+    with pytest.raises(OSError):
+        truenas_os.iter_filesystem_contents_fd(-1)
+
+
+@pytest.mark.skipif(os.geteuid() != 0, reason="requires root for mount(2)")
+def test_iter_fd_does_not_descend_into_mountpoints(temp_mount_tree_with_submount):
+    fd = _open_dir(temp_mount_tree_with_submount)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, include_mountpoints=True) as it:
+            items = list(it)
+    finally:
+        os.close(fd)
+    assert "inside.txt" not in {i.name for i in items}
+    assert any(i.ismount for i in items)
+
+
+# ── inode_order=True ─────────────────────────────────────────────────────────
+
+@pytest.fixture
+def wide_tree(tmp_path):
+    """Two directories wide enough that readdir order differs from inode
+    order, plus a hard link so two names share an inode."""
+    for i in range(200):
+        (tmp_path / f"f{i:03}").write_bytes(b"x")
+    (tmp_path / "sub").mkdir()
+    for i in range(50):
+        (tmp_path / "sub" / f"g{i:03}").write_bytes(b"y")
+    os.link(tmp_path / "f001", tmp_path / "f001.link")
+    return tmp_path
+
+
+def _walk_fd(dir_path, /, **kwargs):
+    fd = _open_dir(dir_path, os.O_PATH)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, **kwargs) as it:
+            return [(i.parent, i.name, i.statxinfo.stx_ino) for i in it]
+    finally:
+        os.close(fd)
+
+
+def test_iter_inode_order_same_entries(wide_tree):
+    assert sorted(_walk_fd(wide_tree, inode_order=True)) == sorted(_walk_fd(wide_tree))
+
+
+def test_iter_inode_order_sorted_per_directory(wide_tree):
+    items = _walk_fd(wide_tree, inode_order=True)
+    for parent in ("", "sub"):
+        entries = [(ino, name) for p, name, ino in items if p == parent]
+        assert entries == sorted(entries)
+
+
+def test_iter_inode_order_deterministic(wide_tree):
+    assert _walk_fd(wide_tree, inode_order=True) == _walk_fd(wide_tree, inode_order=True)
+
+
+def test_iter_inode_order_skip(wide_tree):
+    fd = _open_dir(wide_tree, os.O_PATH)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, inode_order=True) as it:
+            names = []
+            for item in it:
+                names.append(item.name)
+                if item.name == "sub":
+                    it.skip()
+    finally:
+        os.close(fd)
+    assert "sub" in names
+    assert not any(n.startswith("g") for n in names)
+    assert len(names) == 202
+
+
+def test_iter_inode_order_restore(wide_tree):
+    """dir_stack cookies resume into the saved directory in inode order too."""
+    fd = _open_dir(wide_tree, os.O_PATH)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, inode_order=True) as it:
+            saved = None
+            for item in it:
+                if len(it.dir_stack()) == 2:
+                    saved = it.dir_stack()
+                    break
+        assert saved is not None and saved[-1][0] == "sub"
+
+        with truenas_os.iter_filesystem_contents_fd(
+            fd, inode_order=True, dir_stack=saved
+        ) as it:
+            items = [(i.parent, i.name) for i in it]
+    finally:
+        os.close(fd)
+    assert [n for p, n in items if p == "sub"] == [
+        n for p, n, _ in _walk_fd(wide_tree, inode_order=True) if p == "sub"
+    ]
+    assert ("", "sub") not in items
+
+
+# ── max_open_dirs ────────────────────────────────────────────────────────────
+
+@pytest.fixture
+def deep_tree(tmp_path):
+    """A 40-level chain of directories, each with two files and a leaf
+    subdirectory, so every ancestor still has entries left on ascent."""
+    p = tmp_path
+    for depth in range(40):
+        (p / "a").write_bytes(b"a")
+        (p / "leaf").mkdir()
+        (p / "leaf" / "x").write_bytes(b"x")
+        p = p / f"d{depth}"
+        p.mkdir()
+        (p / "z").write_bytes(b"z")
+    return tmp_path
+
+
+def _open_fds():
+    return len(os.listdir("/proc/self/fd"))
+
+
+@pytest.mark.parametrize("root", [None, "/root/of/walk"])
+@pytest.mark.parametrize("inode_order", [False, True])
+def test_iter_max_open_dirs_same_walk(deep_tree, root, inode_order):
+    unbounded = _walk_fd(deep_tree, path=root, inode_order=inode_order)
+    bounded = _walk_fd(deep_tree, path=root, inode_order=inode_order,
+                       max_open_dirs=2)
+    assert bounded == unbounded
+    assert len(bounded) == 40 * 5
+
+
+def test_iter_max_open_dirs_bounds_fds(deep_tree):
+    fd = _open_dir(deep_tree, os.O_PATH)
+    try:
+        base = _open_fds()
+        peak = {}
+        for limit in (0, 3):
+            with truenas_os.iter_filesystem_contents_fd(
+                fd, max_open_dirs=limit
+            ) as it:
+                peak[limit] = max(_open_fds() for _ in it) - base
+    finally:
+        os.close(fd)
+    # One DIR stream per level plus the yielded entry, against the budget.
+    assert peak[0] > 40
+    assert peak[3] <= 3 + 2
+
+
+def test_iter_max_open_dirs_skip(deep_tree):
+    fd = _open_dir(deep_tree, os.O_PATH)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, max_open_dirs=2) as it:
+            names = []
+            for item in it:
+                names.append(item.name)
+                if item.name == "d5":
+                    it.skip()
+    finally:
+        os.close(fd)
+    assert "d5" in names and "d6" not in names
+    assert names.count("leaf") == 6
+
+
+@pytest.mark.skipif(os.geteuid() != 0,
+                    reason="open_by_handle_at requires CAP_DAC_READ_SEARCH")
+def test_iter_max_open_dirs_follows_renamed_ancestor(deep_tree):
+    """An evicted ancestor is reopened by file handle, so renaming it while
+    the walk is below it does not lose the rest of its entries."""
+    fd = _open_dir(deep_tree, os.O_PATH)
+    try:
+        with truenas_os.iter_filesystem_contents_fd(fd, max_open_dirs=2) as it:
+            names = []
+            for item in it:
+                names.append(item.name)
+                if item.name == "d10":
+                    os.rename(deep_tree / "d0" / "d1", deep_tree / "d0" / "moved")
+    finally:
+        os.close(fd)
+    assert names.count("leaf") == 40
+
+
+@pytest.mark.parametrize("limit", [-1, 1])
+def test_iter_max_open_dirs_invalid(tmp_path, limit):
+    with pytest.raises(ValueError):
+        _walk_fd(tmp_path, max_open_dirs=limit)
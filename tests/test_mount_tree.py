@@ -0,0 +1,188 @@
+# SPDX-License-Identifier: LGPL-3.0-or-later
+
+"""Tests for create_mount_spec / mount_tree."""
+
+import errno
+import os
+import subprocess
+
+import pytest
+
+import truenas_os
+from truenas_os_pyutils.namespace import idmap_userns
+
+
+NEEDS_ROOT = pytest.mark.skipif(
+    os.geteuid() != 0,
+    reason="Requires CAP_SYS_ADMIN to create mounts",
+)
+
+
+def _is_mount(path):
+    # os.path.ismount() misses a bind of a directory on the same filesystem.
+    stx = truenas_os.statx(path, mask=truenas_os.STATX_BASIC_STATS)
+    return bool(stx.stx_attributes & truenas_os.STATX_ATTR_MOUNT_ROOT)
+
+
+@pytest.fixture
+def tree(tmp_path):
+    """A root directory with empty mount points, a bind source and an
+    empty destination.  Anything attached at the destination is unmounted
+    on teardown."""
+    root = tmp_path / "root"
+    for name in ("proc", "tmp", "data"):
+        (root / name).mkdir(parents=True)
+    source = tmp_path / "source"
+    source.mkdir()
+    (source / "hello").write_text("hi")
+    dest = tmp_path / "dest"
+    dest.mkdir()
+
+    root_fd = os.open(root, os.O_PATH | os.O_DIRECTORY)
+    try:
+        yield root_fd, str(source), str(dest)
+    finally:
+        os.close(root_fd)
+        subprocess.run(["umount", "-R", str(dest)], capture_output=True,
+                       check=False)
+
+
+# ── create_mount_spec: validation surface ───────────────────────────────────
+
+def test_create_mount_spec_fields():
+    spec = truenas_os.create_mount_spec(
+        "tmp", fs_type="tmpfs", options={"size": "1M", "noswap": None},
+        attr_set=truenas_os.MOUNT_ATTR_NOSUID,
+    )
+    assert isinstance(spec, truenas_os.MountSpec)
+    assert spec.target == "tmp"
+    assert spec.fs_type == "tmpfs"
+    assert spec.source is None
+    assert spec.options == (("size", "1M"), ("noswap", None))
+    assert spec.attr_set == truenas_os.MOUNT_ATTR_NOSUID
+    assert spec.userns_fd == -1
+    assert spec.recursive is False
+
+
+def test_create_mount_spec_bind_needs_source():
+    with pytest.raises(ValueError):
+        truenas_os.create_mount_spec("data")
+
+
+def test_create_mount_spec_bind_rejects_options():
+    with pytest.raises(ValueError):
+        truenas_os.create_mount_spec("data", source="/", options={"a": "b"})
+
+
+@pytest.mark.parametrize("options", [
+    [("size", 1.5)],
+    [("size", False)],
+    [("size",)],
+    ["size"],
+])
+def test_create_mount_spec_bad_options(options):
+    with pytest.raises(TypeError):
+        truenas_os.create_mount_spec("tmp", fs_type="tmpfs", options=options)
+
+
+@pytest.mark.parametrize("target", ["", "a\0b"])
+def test_create_mount_spec_bad_target(target):
+    with pytest.raises(ValueError):
+        truenas_os.create_mount_spec(target, fs_type="tmpfs")
+
+
+def test_mount_tree_rejects_non_spec():
+    with pytest.raises(TypeError):
+        truenas_os.mount_tree(root_fd=0, specs=[("tmp", "tmpfs")])
+
+
+def test_mount_tree_requires_root_fd():
+    with pytest.raises(TypeError):
+        truenas_os.mount_tree(specs=[])
+
+
+# ── mount_tree: builds ─────────────────────────────────────────────────────
+
+@NEEDS_ROOT
+def test_mount_tree_attaches_whole_tree(tree):
+    root_fd, source, dest = tree
+    truenas_os.mount_tree(root_fd=root_fd, to_path=dest, specs=[
+        truenas_os.create_mount_spec("proc", fs_type="proc"),
+        truenas_os.create_mount_spec("tmp", fs_type="tmpfs",
+                                     options={"size": "1M"}),
+        truenas_os.create_mount_spec("/data", source=source,
+                                     attr_set=truenas_os.MOUNT_ATTR_RDONLY),
+    ])
+
+    assert _is_mount(dest)
+    assert os.path.exists(os.path.join(dest, "proc", "self"))
+    assert _is_mount(os.path.join(dest, "tmp"))
+    assert os.listdir(os.path.join(dest, "data")) == ["hello"]
+    with pytest.raises(OSError) as exc:
+        open(os.path.join(dest, "data", "new"), "w")
+    assert exc.value.errno == errno.EROFS
+
+
+@NEEDS_ROOT
+def test_mount_tree_nests_on_earlier_spec(tree):
+    root_fd, source, dest = tree
+    os.mkdir(os.path.join(source, "sub"))
+    # "data/sub" only exists once the bind of `source` is attached.
+    truenas_os.mount_tree(root_fd=root_fd, to_path=dest, specs=[
+        truenas_os.create_mount_spec("data", source=source),
+        truenas_os.create_mount_spec("data/sub", fs_type="tmpfs"),
+    ])
+    assert _is_mount(os.path.join(dest, "data", "sub"))
+    assert os.listdir(os.path.join(dest, "data", "sub")) == []
+
+
+@NEEDS_ROOT
+def test_mount_tree_detached_fd(tree):
+    root_fd, _, dest = tree
+    fd = truenas_os.mount_tree(root_fd=root_fd, specs=[
+        truenas_os.create_mount_spec("tmp", fs_type="tmpfs"),
+    ])
+    try:
+        assert not _is_mount(dest)
+        assert sorted(os.listdir(f"/proc/self/fd/{fd}")) == ["data", "proc", "tmp"]
+        truenas_os.move_mount(from_path="", from_dirfd=fd, to_path=dest,
+                              flags=truenas_os.MOVE_MOUNT_F_EMPTY_PATH)
+    finally:
+        os.close(fd)
+    assert _is_mount(os.path.join(dest, "tmp"))
+
+
+@NEEDS_ROOT
+@pytest.mark.parametrize("bad_spec,stage", [
+    (truenas_os.create_mount_spec("missing", fs_type="tmpfs"),
+     "specs[1]: openat2(missing)"),
+    (truenas_os.create_mount_spec("data", fs_type="tmpfs",
+                                  options={"bogus": "1"}),
+     "specs[1]: fsconfig(bogus)"),
+    (truenas_os.create_mount_spec("data", source="/nonexistent"),
+     "specs[1]: open_tree(/nonexistent)"),
+])
+def test_mount_tree_rolls_back(tree, bad_spec, stage):
+    root_fd, _, dest = tree
+    with pytest.raises(OSError) as exc:
+        truenas_os.mount_tree(root_fd=root_fd, to_path=dest, specs=[
+            truenas_os.create_mount_spec("tmp", fs_type="tmpfs"),
+            bad_spec,
+        ])
+    assert exc.value.filename == stage
+    assert not _is_mount(dest)
+
+
+@NEEDS_ROOT
+def test_mount_tree_idmapped_bind(tree):
+    root_fd, source, dest = tree
+    os.chown(os.path.join(source, "hello"), 0, 0)
+    uid_map = [truenas_os.create_idmap_mapping(0, 100000, 65536)]
+    gid_map = [truenas_os.create_idmap_mapping(0, 100000, 65536)]
+    with idmap_userns(uid_map, gid_map) as userns_fd:
+        truenas_os.mount_tree(root_fd=root_fd, to_path=dest, specs=[
+            truenas_os.create_mount_spec("data", source=source,
+                                         userns_fd=userns_fd),
+        ])
+    st = os.stat(os.path.join(dest, "data", "hello"))
+    assert (st.st_uid, st.st_gid) == (100000, 100000)
@@ -1,5 +1,6 @@
 # SPDX-License-Identifier: LGPL-3.0-or-later
 
+import errno
 import pytest
 import truenas_os
 import os
@@ -301,3 +302,142 @@ def test_renameat2_exchange_preserves_inodes():
         # Verify inodes were swapped (file_a now has file_b's inode and vice versa)
         assert os.stat(file_a).st_ino == inode_b
         assert os.stat(file_b).st_ino == inode_a
+
+
+def test_renameat2_batch_function_exists():
+    """Test that renameat2_batch and RenameFailure are available."""
+    assert hasattr(truenas_os, 'renameat2_batch')
+    assert hasattr(truenas_os, 'RenameFailure')
+
+
+def test_renameat2_batch_empty():
+    """Test that an empty batch returns an empty failure list."""
+    assert truenas_os.renameat2_batch([]) == []
+
+
+def test_renameat2_batch_moves_across_dirfds():
+    """Test moving many entries between directories in one call."""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        src_dir = os.path.join(tmpdir, 'src')
+        dst_dir = os.path.join(tmpdir, 'dst')
+        os.mkdir(src_dir)
+        os.mkdir(dst_dir)
+        for i in range(50):
+            with open(os.path.join(src_dir, f'file{i}'), 'w') as f:
+                f.write(str(i))
+
+        src_dirfd = os.open(src_dir, os.O_RDONLY | os.O_DIRECTORY)
+        dst_dirfd = os.open(dst_dir, os.O_RDONLY | os.O_DIRECTORY)
+        try:
+            ops = [
+                (src_dirfd, f'file{i}', dst_dirfd, f'moved{i}', 0)
+                for i in range(50)
+            ]
+            assert truenas_os.renameat2_batch(ops) == []
+        finally:
+            os.close(src_dirfd)
+            os.close(dst_dirfd)
+
+        assert os.listdir(src_dir) == []
+        for i in range(50):
+            with open(os.path.join(dst_dir, f'moved{i}'), 'r') as f:
+                assert f.read() == str(i)
+
+
+def test_renameat2_batch_per_item_flags():
+    """Test that NOREPLACE and EXCHANGE are honoured per operation."""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for name in ('a', 'b', 'c', 'd'):
+            with open(os.path.join(tmpdir, name), 'w') as f:
+                f.write(name)
+
+        dirfd = os.open(tmpdir, os.O_RDONLY | os.O_DIRECTORY)
+        try:
+            failures = truenas_os.renameat2_batch([
+                (dirfd, 'a', dirfd, 'b', truenas_os.AT_RENAME_EXCHANGE),
+                (dirfd, 'c', dirfd, 'd', truenas_os.AT_RENAME_NOREPLACE),
+                (dirfd, 'c', dirfd, 'e', truenas_os.AT_RENAME_NOREPLACE),
+            ])
+        finally:
+            os.close(dirfd)
+
+        assert len(failures) == 1
+        failure = failures[0]
+        assert isinstance(failure, truenas_os.RenameFailure)
+        assert failure.index == 1
+        assert failure.src == 'c'
+        assert failure.dst == 'd'
+        assert failure.errnum == errno.EEXIST
+
+        with open(os.path.join(tmpdir, 'a'), 'r') as f:
+            assert f.read() == 'b'
+        with open(os.path.join(tmpdir, 'b'), 'r') as f:
+            assert f.read() == 'a'
+        with open(os.path.join(tmpdir, 'e'), 'r') as f:
+            assert f.read() == 'c'
+        assert not os.path.exists(os.path.join(tmpdir, 'c'))
+
+
+def test_renameat2_batch_stop_on_error():
+    """Test that stop_on_error leaves later operations unattempted."""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for name in ('a', 'c'):
+            with open(os.path.join(tmpdir, name), 'w') as f:
+                f.write(name)
+
+        ops = [
+            (truenas_os.AT_FDCWD, os.path.join(tmpdir, 'a'),
+             truenas_os.AT_FDCWD, os.path.join(tmpdir, 'b'), 0),
+            (truenas_os.AT_FDCWD, os.path.join(tmpdir, 'missing'),
+             truenas_os.AT_FDCWD, os.path.join(tmpdir, 'x'), 0),
+            (truenas_os.AT_FDCWD, os.path.join(tmpdir, 'c'),
+             truenas_os.AT_FDCWD, os.path.join(tmpdir, 'd'), 0),
+        ]
+        failures = truenas_os.renameat2_batch(ops, stop_on_error=True)
+
+        assert [(f.index, f.errnum) for f in failures] == [(1, errno.ENOENT)]
+        assert os.path.exists(os.path.join(tmpdir, 'b'))
+        assert os.path.exists(os.path.join(tmpdir, 'c'))
+        assert not os.path.exists(os.path.join(tmpdir, 'd'))
+
+
+def test_renameat2_batch_continues_past_errors():
+    """Test that every failure is reported when stop_on_error is False."""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        with open(os.path.join(tmpdir, 'c'), 'w') as f:
+            f.write('c')
+
+        dirfd = os.open(tmpdir, os.O_RDONLY | os.O_DIRECTORY)
+        try:
+            failures = truenas_os.renameat2_batch([
+                (dirfd, b'missing1', dirfd, b'x', 0),
+                (dirfd, b'missing2', dirfd, b'y', 0),
+                (dirfd, b'c', dirfd, b'd', 0),
+            ])
+        finally:
+            os.close(dirfd)
+
+        assert [f.index for f in failures] == [0, 1]
+        assert failures[0].src == b'missing1'
+        assert all(f.errnum == errno.ENOENT for f in failures)
+        assert os.path.exists(os.path.join(tmpdir, 'd'))
+
+
+def test_renameat2_batch_invalid_op_raises_before_renaming():
+    """Test that a malformed op raises TypeError and nothing is renamed."""
+    with tempfile.TemporaryDirectory() as tmpdir:
+        with open(os.path.join(tmpdir, 'a'), 'w') as f:
+            f.write('a')
+
+        dirfd = os.open(tmpdir, os.O_RDONLY | os.O_DIRECTORY)
+        try:
+            with pytest.raises(TypeError):
+                truenas_os.renameat2_batch([
+                    (dirfd, 'a', dirfd, 'b', 0),
+                    (dirfd, 'a', dirfd),
+                ])
+        finally:
+            os.close(dirfd)
+
+        assert os.path.exists(os.path.join(tmpdir, 'a'))
+        assert not os.path.exists(os.path.join(tmpdir, 'b'))
@@ -1,6 +1,6 @@
 # SPDX-License-Identifier: LGPL-3.0-or-later
 #
-# Tests for truenas_os.fgetxattr / fsetxattr / flistxattr.
+# Tests for truenas_os.fgetxattr / fsetxattr / flistxattr / fremovexattrs.
 #
 # Note: the user.* xattr namespace on stock Linux kernels has a hard
 # 64 KiB cap on individual values.  Tests that exercise the > 64 KiB
@@ -211,6 +211,76 @@ def test_fsetxattr_flags_keyword_only(fd):
         truenas_os.fsetxattr(fd, "user.kw", b"v", truenas_os.XATTR_CREATE)
 
 
+# ── fremovexattrs ─────────────────────────────────────────────────────────────
+
+
+def _set_names(fd, *names):
+    for name in names:
+        truenas_os.fsetxattr(fd, name, b"v")
+
+
+def test_fremovexattrs_all(fd):
+    _set_names(fd, "user.a", "user.b", "user.c")
+    assert set(truenas_os.fremovexattrs(fd)) == {"user.a", "user.b", "user.c"}
+    assert truenas_os.flistxattr(fd) == []
+
+
+def test_fremovexattrs_empty_returns_empty_list(fd):
+    assert truenas_os.fremovexattrs(fd) == []
+
+
+def test_fremovexattrs_names(fd):
+    _set_names(fd, "user.a", "user.b", "user.c")
+    # Absent names are ignored.
+    removed = truenas_os.fremovexattrs(fd, names=["user.a", "user.c", "user.zz"])
+    assert set(removed) == {"user.a", "user.c"}
+    assert truenas_os.flistxattr(fd) == ["user.b"]
+
+
+def test_fremovexattrs_empty_names_removes_nothing(fd):
+    _set_names(fd, "user.a")
+    assert truenas_os.fremovexattrs(fd, names=[]) == []
+    assert truenas_os.flistxattr(fd) == ["user.a"]
+
+
+def test_fremovexattrs_prefix(fd):
+    _set_names(fd, "user.DOSATTRIB", "user.DosStream.x", "user.keep")
+    removed = truenas_os.fremovexattrs(fd, prefix="user.Dos")
+    assert removed == ["user.DosStream.x"]
+    assert set(truenas_os.flistxattr(fd)) == {"user.DOSATTRIB", "user.keep"}
+
+
+def test_fremovexattrs_names_or_prefix(fd):
+    _set_names(fd, "user.a", "user.pfx_1", "user.pfx_2", "user.keep")
+    removed = truenas_os.fremovexattrs(fd, names=["user.a"], prefix="user.pfx_")
+    assert set(removed) == {"user.a", "user.pfx_1", "user.pfx_2"}
+    assert truenas_os.flistxattr(fd) == ["user.keep"]
+
+
+def test_fremovexattrs_growth_path(fd):
+    # Past the 256-byte initial name-list buffer.
+    names = {f"user.growthtest_{i:02d}" for i in range(32)}
+    _set_names(fd, *names)
+    assert set(truenas_os.fremovexattrs(fd, prefix="user.")) == names
+    assert truenas_os.flistxattr(fd) == []
+
+
+def test_fremovexattrs_rejects_single_name(fd):
+    with pytest.raises(TypeError):
+        truenas_os.fremovexattrs(fd, names="user.a")
+
+
+def test_fremovexattrs_keyword_only(fd):
+    with pytest.raises(TypeError):
+        truenas_os.fremovexattrs(fd, ["user.a"])
+
+
+def test_fremovexattrs_bad_fd():
+    with pytest.raises(OSError) as exc:
+        truenas_os.fremovexattrs(-1)
+    assert exc.value.errno == errno.EBADF
+
+
 # ── boundary stress ──────────────────────────────────────────────────────────
 
 
@@ -14,6 +14,7 @@ from truenas_os_pyutils.truenas_shutil.copy import (
     ACCESS_ACL_XATTRS,
     ACL_XATTRS,
     MAX_RW_SZ,
+    CopyMethodCache,
     clonefile,
     copy_permissions,
     copy_xattrs,
@@ -200,6 +201,79 @@ def test_copyfile_propagates_other_oserror(tmp_path, monkeypatch):
         os.close(dst_fd)
 
 
+def test_copy_method_cache_skips_clone_after_exdev(tmp_path, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as mod
+
+    calls = []
+
+    def fake_copy_file_range(*a, **kw):
+        calls.append(a)
+        raise OSError(errno.EXDEV, "Invalid cross-device link")
+
+    monkeypatch.setattr(mod, "copy_file_range", fake_copy_file_range)
+
+    cache = CopyMethodCache()
+    for i in range(3):
+        src = tmp_path / f"src{i}.bin"
+        dst = tmp_path / f"dst{i}.bin"
+        src.write_bytes(b"payload %d" % i)
+        dst.write_bytes(b"")
+        src_fd = os.open(str(src), os.O_RDONLY)
+        dst_fd = os.open(str(dst), os.O_RDWR)
+        try:
+            assert cache.copyfile(src_fd, dst_fd, (1, 2)) == len(src.read_bytes())
+        finally:
+            os.close(src_fd)
+            os.close(dst_fd)
+        assert dst.read_bytes() == src.read_bytes()
+
+    # Only the first file paid for the failing clone attempt.
+    assert len(calls) == 1
+
+    # A different filesystem pair is tried afresh, and clear() forgets.
+    src_fd = os.open(str(tmp_path / "src0.bin"), os.O_RDONLY)
+    dst_fd = os.open(str(tmp_path / "dst0.bin"), os.O_RDWR | os.O_TRUNC)
+    try:
+        cache.copyfile(src_fd, dst_fd, (1, 3))
+        assert len(calls) == 2
+        cache.clear()
+        os.ftruncate(dst_fd, 0)
+        cache.copyfile(src_fd, dst_fd, (1, 2))
+        assert len(calls) == 3
+    finally:
+        os.close(src_fd)
+        os.close(dst_fd)
+
+
+def test_copy_method_cache_does_not_cache_other_errors(tmp_path, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as mod
+
+    calls = []
+
+    def fake_copy_file_range(*a, **kw):
+        calls.append(a)
+        raise OSError(errno.EIO, "I/O error")
+
+    monkeypatch.setattr(mod, "copy_file_range", fake_copy_file_range)
+
+    src = tmp_path / "src.bin"
+    dst = tmp_path / "dst.bin"
+    src.write_bytes(b"data")
+    dst.write_bytes(b"")
+    cache = CopyMethodCache()
+    src_fd = os.open(str(src), os.O_RDONLY)
+    dst_fd = os.open(str(dst), os.O_RDWR)
+    try:
+        for _ in range(2):
+            with pytest.raises(OSError) as exc_info:
+                cache.copyfile(src_fd, dst_fd, (1, 2))
+            assert exc_info.value.errno == errno.EIO
+    finally:
+        os.close(src_fd)
+        os.close(dst_fd)
+    assert len(calls) == 2
+
+
 # ── copy_permissions ──────────────────────────────────────────────────────────
 
 
@@ -385,3 +459,186 @@ def test_copysendfile_does_not_fall_through_when_sendfile_works(
 
     assert n == len(payload)
     assert dst.read_bytes() == payload
+
+
+# ── chunk_size / preallocate / fadvise ────────────────────────────────────────
+
+
+@pytest.fixture
+def io_pair(tmp_path):
+    """(src_fd, dst_fd) with 1 MiB + 1 byte of random data in the source."""
+    payload = random.Random(1234).randbytes(1024 * 1024 + 1)
+    (tmp_path / "io_src").write_bytes(payload)
+    src_fd = os.open(str(tmp_path / "io_src"), os.O_RDONLY)
+    dst_fd = os.open(str(tmp_path / "io_dst"), os.O_CREAT | os.O_RDWR, 0o600)
+    try:
+        yield src_fd, dst_fd, payload
+    finally:
+        os.close(src_fd)
+        os.close(dst_fd)
+
+
+@pytest.mark.parametrize("fn", [clonefile, copysendfile, copyfile])
+def test_copy_chunk_size(io_pair, fn, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    src_fd, dst_fd, payload = io_pair
+    sizes = []
+    real_cfr, real_sf = copy_mod.copy_file_range, copy_mod.sendfile
+
+    def cfr(src, dst, count, **kw):
+        sizes.append(count)
+        return real_cfr(src, dst, count, **kw)
+
+    def sf(dst, src, offset, count):
+        sizes.append(count)
+        return real_sf(dst, src, offset, count)
+
+    monkeypatch.setattr(copy_mod, "copy_file_range", cfr)
+    monkeypatch.setattr(copy_mod, "sendfile", sf)
+
+    assert fn(src_fd, dst_fd, chunk_size=65536) == len(payload)
+    assert os.pread(dst_fd, len(payload) + 1, 0) == payload
+    # 16 full chunks, the final byte, and the call that returns 0.
+    assert sizes == [65536] * 18
+
+
+@pytest.mark.parametrize("fn", [clonefile, copysendfile, copyfile])
+def test_copy_chunk_size_must_be_positive(io_pair, fn):
+    src_fd, dst_fd, _ = io_pair
+    with pytest.raises(ValueError):
+        fn(src_fd, dst_fd, chunk_size=0)
+    assert os.fstat(dst_fd).st_size == 0
+
+
+def test_copysendfile_preallocate(io_pair, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    src_fd, dst_fd, payload = io_pair
+    calls = []
+    real = copy_mod.fallocate
+
+    def fake(fd, offset, length, *, mode=0):
+        calls.append((fd, offset, length, mode))
+        return real(fd, offset, length, mode=mode)
+
+    monkeypatch.setattr(copy_mod, "fallocate", fake)
+    assert copysendfile(src_fd, dst_fd, preallocate=True) == len(payload)
+    assert calls == [(dst_fd, 0, len(payload), copy_mod.FALLOC_FL_KEEP_SIZE)]
+    assert os.pread(dst_fd, len(payload) + 1, 0) == payload
+
+
+def test_copysendfile_preallocate_enospc_fails_before_writing(io_pair, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    src_fd, dst_fd, _ = io_pair
+
+    def enospc(*a, **kw):
+        raise OSError(errno.ENOSPC, "MOCK ENOSPC")
+
+    def boom(*a, **kw):
+        raise AssertionError("sendfile must not be called")
+
+    monkeypatch.setattr(copy_mod, "fallocate", enospc)
+    monkeypatch.setattr(copy_mod, "sendfile", boom)
+    with pytest.raises(OSError) as exc:
+        copysendfile(src_fd, dst_fd, preallocate=True)
+    assert exc.value.errno == errno.ENOSPC
+
+
+def test_copysendfile_preallocate_unsupported_is_ignored(io_pair, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    src_fd, dst_fd, payload = io_pair
+
+    def eopnotsupp(*a, **kw):
+        raise OSError(errno.EOPNOTSUPP, "MOCK EOPNOTSUPP")
+
+    monkeypatch.setattr(copy_mod, "fallocate", eopnotsupp)
+    assert copysendfile(src_fd, dst_fd, preallocate=True) == len(payload)
+    assert os.pread(dst_fd, len(payload) + 1, 0) == payload
+
+
+def test_copysendfile_preallocate_releases_unused_reservation(
+    io_pair, monkeypatch
+):
+    """A source that shrinks after the reservation leaves no blocks past
+    the destination's end of file."""
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    src_fd, dst_fd, payload = io_pair
+    real_sf = copy_mod.sendfile
+    remaining = [4096]
+
+    def short_sendfile(dst, src, offset, count):
+        # Behave as if the source were truncated to 4 KiB mid-copy.
+        n = real_sf(dst, src, offset, min(count, remaining[0]))
+        remaining[0] -= n
+        return n
+
+    monkeypatch.setattr(copy_mod, "sendfile", short_sendfile)
+    assert copysendfile(src_fd, dst_fd, preallocate=True) == 4096
+    st = os.fstat(dst_fd)
+    assert st.st_size == 4096
+    assert st.st_blocks * 512 < len(payload)
+    assert os.pread(dst_fd, 8192, 0) == payload[:4096]
+
+
+@pytest.mark.parametrize("fn", [clonefile, copysendfile])
+def test_copy_fadvise(io_pair, fn, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    src_fd, dst_fd, payload = io_pair
+    calls = []
+    monkeypatch.setattr(
+        copy_mod, "posix_fadvise", lambda *a: calls.append(a)
+    )
+    assert fn(src_fd, dst_fd, chunk_size=524288, fadvise=True) == len(payload)
+
+    assert calls[0] == (src_fd, 0, 0, os.POSIX_FADV_SEQUENTIAL)
+    dropped = [c[:3] for c in calls[1:] if c[3] == os.POSIX_FADV_DONTNEED]
+    # Each destination range reaches back over the previous chunk, whose
+    # writeback the previous call started, and a final sweep covers it all.
+    assert dropped == [
+        (src_fd, 0, 524288), (dst_fd, 0, 524288),
+        (src_fd, 524288, 524288), (dst_fd, 0, 1048576),
+        (src_fd, 1048576, 1), (dst_fd, 524288, 524289),
+        (dst_fd, 0, 1048577),
+    ]
+
+
+def test_copy_without_io_options_makes_no_hints(io_pair, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    def boom(*a, **kw):
+        raise AssertionError("no hint expected")
+
+    monkeypatch.setattr(copy_mod, "posix_fadvise", boom)
+    monkeypatch.setattr(copy_mod, "fallocate", boom)
+    src_fd, dst_fd, payload = io_pair
+    assert copyfile(src_fd, dst_fd) == len(payload)
+
+
+def test_copy_method_cache_forwards_io_options(io_pair, monkeypatch):
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    seen = {}
+
+    def fake_clone(src, dst, **kw):
+        seen["clone"] = kw
+        raise OSError(errno.EXDEV, "MOCK EXDEV")
+
+    def fake_sendfile(src, dst, **kw):
+        seen["sendfile"] = kw
+        return 0
+
+    monkeypatch.setattr(copy_mod, "clonefile", fake_clone)
+    monkeypatch.setattr(copy_mod, "copysendfile", fake_sendfile)
+    src_fd, dst_fd, _ = io_pair
+    CopyMethodCache().copyfile(
+        src_fd, dst_fd, (1, 2), chunk_size=4096, preallocate=True, fadvise=True
+    )
+    assert seen == {
+        "clone": {"chunk_size": 4096, "fadvise": True},
+        "sendfile": {"chunk_size": 4096, "preallocate": True, "fadvise": True},
+    }
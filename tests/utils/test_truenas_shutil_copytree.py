@@ -5,20 +5,33 @@
 # which validates the source against statmount, so all tests use real
 # directories on a real mount (tmp_path or a ZFS dataset fixture).
 import errno
+import importlib
 import os
 import random
 import stat
+import subprocess
 from operator import eq, ne
 
 import pytest
+import truenas_os
 
 from truenas_os_pyutils.truenas_shutil import (
     DEF_CP_FLAGS,
     CopyFlags,
     CopyTreeConfig,
+    CopyTreeDurability,
+    CopyTreeMismatchKind,
     CopyTreeOp,
     CopyTreeStats,
+    CopyTreeUpdate,
     copytree,
+    copyuserspace,
+)
+
+# The package re-exports the copytree() function under the submodule's
+# name, so fetch the module itself for monkeypatching.
+_copytree_mod = importlib.import_module(
+    "truenas_os_pyutils.truenas_shutil.copytree"
 )
 
 
@@ -324,6 +337,220 @@ def test_copytree_no_callback_runs_silently(tmp_path):
     assert stats.files >= 1
 
 
+# ── verify pass ──────────────────────────────────────────────────────────────
+
+
+def test_copytree_verify_off_by_default(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    stats = copytree(str(src), str(tmp_path / "dst"), CopyTreeConfig())
+    assert stats.verified == 0
+    assert stats.mismatches == []
+
+
+def test_copytree_verify_clean_copy(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+
+    stats = copytree(str(src), str(tmp_path / "dst"), CopyTreeConfig(verify=True))
+
+    assert stats.mismatches == []
+    # root + a.txt, b.bin, sub, sub/nested.txt, empty, link
+    assert stats.verified == 7
+
+
+def test_copytree_verify_reports_extra(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+    (dst / "sub").mkdir(parents=True)
+    (dst / "sub" / "stale.txt").write_bytes(b"old")
+
+    stats = copytree(str(src), str(dst), CopyTreeConfig(verify=True))
+
+    assert [(m.path, m.kind) for m in stats.mismatches] == [
+        ("sub/stale.txt", CopyTreeMismatchKind.EXTRA),
+    ]
+
+
+@pytest.mark.parametrize("damage,kind", [
+    (lambda fd: os.pwrite(fd, b"X", 0), CopyTreeMismatchKind.CHECKSUM),
+    (lambda fd: os.pwrite(fd, b"X", os.fstat(fd).st_size), CopyTreeMismatchKind.SIZE),
+])
+def test_copytree_verify_reports_content_damage(tmp_path, monkeypatch, damage, kind):
+    """A copy primitive that corrupts its output is caught by verify."""
+    def corrupting_copy(src_fd, dst_fd):
+        written = copyuserspace(src_fd, dst_fd)
+        damage(dst_fd)
+        return written
+
+    monkeypatch.setattr(_copytree_mod, "_select_copy_fn", lambda op: corrupting_copy)
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+
+    stats = copytree(
+        str(src), str(tmp_path / "dst"),
+        CopyTreeConfig(verify=True, flags=CopyFlags(0)),
+    )
+
+    assert sorted(m.path for m in stats.mismatches) == [
+        "a.txt", "b.bin", "sub/nested.txt",
+    ]
+    assert {m.kind for m in stats.mismatches} == {kind}
+
+
+# ── dry run ──────────────────────────────────────────────────────────────────
+
+
+def test_copytree_dry_run_writes_nothing(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+
+    stats = copytree(str(src), str(dst), CopyTreeConfig(dry_run=True))
+
+    assert not dst.exists()
+    assert (stats.dirs, stats.files, stats.symlinks) == (2, 3, 1)
+    assert stats.bytes == len("hello world") + 4096 + len("nest!")
+    assert stats.mounts == 0 and stats.ctldirs == 0
+    # sampled from tmp_path, the nearest existing ancestor of dst
+    assert stats.dst_bytes_free > 0
+
+
+def test_copytree_dry_run_matches_copy(tmp_path):
+    """The estimate's counters equal those of the copy that follows."""
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = str(tmp_path / "dst")
+
+    estimate = copytree(str(src), dst, CopyTreeConfig(dry_run=True, verify=True))
+    stats = copytree(str(src), dst, CopyTreeConfig())
+
+    assert estimate.verified == 0
+    assert stats.dst_bytes_free is None
+    for name in ("dirs", "files", "symlinks", "bytes", "blocks"):
+        assert getattr(estimate, name) == getattr(stats, name), name
+
+
+def test_copytree_dry_run_exist_ok_false_raises_on_existing_dst(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+    dst.mkdir()
+
+    with pytest.raises(FileExistsError):
+        copytree(str(src), str(dst), CopyTreeConfig(dry_run=True, exist_ok=False))
+    assert os.listdir(dst) == []
+
+
+# ── update mode ──────────────────────────────────────────────────────────────
+
+
+def _rewrite_keep_mtime(path, data):
+    """Overwrite ``path`` with same-size ``data`` and restore its mtime."""
+    st = os.stat(path)
+    path.write_bytes(data)
+    os.utime(path, ns=(st.st_atime_ns, st.st_mtime_ns))
+
+
+def test_copytree_update_none_recopies(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = str(tmp_path / "dst")
+    copytree(str(src), dst, CopyTreeConfig())
+
+    stats = copytree(str(src), dst, CopyTreeConfig())
+
+    assert (stats.files, stats.skipped) == (3, 0)
+
+
+@pytest.mark.parametrize("update", [
+    CopyTreeUpdate.SIZE_MTIME, CopyTreeUpdate.CTIME, CopyTreeUpdate.CHECKSUM,
+])
+def test_copytree_update_skips_unchanged(tmp_path, update):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+    copytree(str(src), str(dst), CopyTreeConfig())
+    (src / "sub" / "nested.txt").write_text("changed!")
+
+    stats = copytree(str(src), str(dst), CopyTreeConfig(update=update))
+
+    assert (stats.files, stats.skipped) == (1, 2)
+    assert stats.skipped_bytes == len("hello world") + 4096
+    assert (dst / "sub" / "nested.txt").read_text() == "changed!"
+
+
+@pytest.mark.parametrize("update,recopied", [
+    (CopyTreeUpdate.SIZE_MTIME, False),
+    (CopyTreeUpdate.CTIME, True),
+    (CopyTreeUpdate.CHECKSUM, True),
+])
+def test_copytree_update_same_size_and_mtime(tmp_path, update, recopied):
+    """Only the stricter modes see through a rewrite that restored mtime."""
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+    copytree(str(src), str(dst), CopyTreeConfig())
+    _rewrite_keep_mtime(src / "a.txt", b"HELLO WORLD")
+
+    stats = copytree(str(src), str(dst), CopyTreeConfig(update=update))
+
+    assert stats.files == int(recopied)
+    expected = b"HELLO WORLD" if recopied else b"hello world"
+    assert (dst / "a.txt").read_bytes() == expected
+
+
+def test_copytree_update_reconciles_metadata(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+    copytree(str(src), str(dst), CopyTreeConfig())
+    os.chmod(src / "a.txt", 0o604)
+
+    stats = copytree(
+        str(src), str(dst), CopyTreeConfig(update=CopyTreeUpdate.SIZE_MTIME)
+    )
+
+    assert stats.skipped == 3
+    assert stat.S_IMODE(os.stat(dst / "a.txt").st_mode) == 0o604
+
+
+
+def test_copytree_update_running_binary(tmp_path):
+    """A skipped destination is opened read-only, so a running executable
+    (ETXTBSY for O_RDWR) is still reconciled in place."""
+    src = tmp_path / "src"
+    src.mkdir()
+    (src / "sleep").write_bytes(open("/bin/sleep", "rb").read())
+    os.chmod(src / "sleep", 0o755)
+    dst = tmp_path / "dst"
+    copytree(str(src), str(dst), CopyTreeConfig())
+    os.chmod(src / "sleep", 0o750)
+
+    proc = subprocess.Popen([str(dst / "sleep"), "30"])
+    try:
+        stats = copytree(
+            str(src), str(dst), CopyTreeConfig(update=CopyTreeUpdate.SIZE_MTIME)
+        )
+    finally:
+        proc.kill()
+        proc.wait()
+
+    assert (stats.files, stats.skipped) == (0, 1)
+    assert stat.S_IMODE(os.stat(dst / "sleep").st_mode) == 0o750
+
 # ── ZFS-only behavior ────────────────────────────────────────────────────────
 
 
@@ -354,7 +581,8 @@ def test_copytree_skips_zfs_ctldir(zfs_dataset, tmp_path):
     subprocess.run(["zfs", "snapshot", f"{pool_ds}@s1"], check=True)
     try:
         dst = os.path.join(zfs_dataset, "dst")
-        copytree(src, dst, CopyTreeConfig())
+        stats = copytree(src, dst, CopyTreeConfig())
+        assert stats.ctldirs == 1
 
         # .zfs must NOT have been copied into dst
         assert not os.path.exists(os.path.join(dst, ".zfs"))
@@ -534,6 +762,16 @@ def test_copytree_e2e_default_flags_preserve_everything(
     assert stats.symlinks > 0
 
 
+def test_copytree_e2e_verify_rich_tree(rich_source_tree, tmp_path):
+    """verify=True finds no differences after a full-metadata copy."""
+    stats = copytree(
+        str(rich_source_tree), str(tmp_path / "DEST"),
+        CopyTreeConfig(verify=True),
+    )
+    assert stats.mismatches == []
+    assert stats.verified == stats.dirs + stats.files + stats.symlinks + 1
+
+
 @pytest.mark.parametrize("flag", [
     CopyFlags.XATTRS,
     CopyFlags.PERMISSIONS,
@@ -595,3 +833,328 @@ def test_copytree_into_itself_deeper(rich_source_tree):
     # Everything up to (but not into) the destination should exist.
     assert (dst / "FOO" / "BAR").exists()
     assert not (dst / "FOO" / "BAR" / "DEST").exists()
+
+
+def test_copytree_default_op_clones_once_across_filesystems(tmp_path, monkeypatch):
+    # A cross-filesystem copy fails copy_file_range once per run, not once
+    # per file: later files go straight to sendfile.
+    import truenas_os_pyutils.truenas_shutil.copy as copy_mod
+
+    # Large enough to bypass the fcopy_small fast path.
+    size = truenas_os.FCOPY_SMALL_MAX
+    src = tmp_path / "src"
+    src.mkdir()
+    for i in range(5):
+        (src / f"f{i}").write_bytes(b"x" * (size + i))
+    calls = []
+
+    def fake_copy_file_range(*a, **kw):
+        calls.append(a)
+        raise OSError(errno.EXDEV, "Invalid cross-device link")
+
+    monkeypatch.setattr(copy_mod, "copy_file_range", fake_copy_file_range)
+    dst = tmp_path / "dst"
+    stats = copytree(str(src), str(dst), CopyTreeConfig())
+    assert stats.files == 5
+    assert stats.bytes == 5 * size + 10
+    assert len(calls) == 1
+    for i in range(5):
+        assert (dst / f"f{i}").read_bytes() == b"x" * (size + i)
+
+
+def _build_linked_tree(root):
+    """Three links to one inode (two directories), plus an unlinked file."""
+    (root / "d1").mkdir()
+    (root / "d2").mkdir()
+    (root / "d1" / "a").write_bytes(b"shared data")
+    os.link(root / "d1" / "a", root / "d1" / "b")
+    os.link(root / "d1" / "a", root / "d2" / "c")
+    (root / "solo").write_bytes(b"solo")
+
+
+def test_copytree_hardlinks_preserved(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_linked_tree(src)
+    dst = tmp_path / "dst"
+    stats = copytree(
+        str(src), str(dst), CopyTreeConfig(flags=DEF_CP_FLAGS | CopyFlags.HARDLINKS)
+    )
+    assert stats.files == 2
+    assert stats.hardlinks == 2
+    assert stats.bytes == len(b"shared data") + len(b"solo")
+
+    a = os.stat(dst / "d1" / "a")
+    assert a.st_nlink == 3
+    assert os.stat(dst / "d1" / "b").st_ino == a.st_ino
+    assert os.stat(dst / "d2" / "c").st_ino == a.st_ino
+    assert (dst / "d2" / "c").read_bytes() == b"shared data"
+    assert os.stat(dst / "solo").st_nlink == 1
+
+
+def test_copytree_hardlinks_off_by_default(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_linked_tree(src)
+    dst = tmp_path / "dst"
+    stats = copytree(str(src), str(dst), CopyTreeConfig())
+    assert stats.files == 4
+    assert stats.hardlinks == 0
+    assert os.stat(dst / "d1" / "a").st_nlink == 1
+
+
+def test_copytree_hardlinks_rerun_and_dry_run(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_linked_tree(src)
+    dst = tmp_path / "dst"
+    config = CopyTreeConfig(flags=DEF_CP_FLAGS | CopyFlags.HARDLINKS)
+    copytree(str(src), str(dst), config)
+
+    # Re-running over the copy keeps the links intact.
+    stats = copytree(str(src), str(dst), config)
+    assert stats.hardlinks == 2
+    assert os.stat(dst / "d1" / "a").st_nlink == 3
+
+    # A destination name that is not the link is replaced by it.
+    os.unlink(dst / "d2" / "c")
+    (dst / "d2" / "c").write_bytes(b"stale")
+    copytree(str(src), str(dst), config)
+    assert os.stat(dst / "d2" / "c").st_ino == os.stat(dst / "d1" / "a").st_ino
+
+    dry = copytree(
+        str(src), str(tmp_path / "nowhere"),
+        CopyTreeConfig(flags=DEF_CP_FLAGS | CopyFlags.HARDLINKS, dry_run=True),
+    )
+    assert (dry.files, dry.hardlinks) == (2, 2)
+
+
+def test_copytree_small_files_take_native_path(tmp_path, monkeypatch):
+    # Files below FCOPY_SMALL_MAX are copied by truenas_os.fcopy_small with
+    # mode and timestamps applied natively; larger ones by copyfile.
+    src = tmp_path / "src"
+    src.mkdir()
+    (src / "small").write_bytes(b"s" * 100)
+    (src / "empty").write_bytes(b"")
+    (src / "large").write_bytes(b"L" * truenas_os.FCOPY_SMALL_MAX)
+    os.chmod(src / "small", 0o640)
+    os.utime(src / "small", ns=(1_000_000_123, 2_000_000_456))
+    os.chmod(src / "large", 0o604)
+
+    native = []
+    real = truenas_os.fcopy_small
+
+    def spy(src_fd, dst_fd, **kw):
+        native.append(kw)
+        return real(src_fd, dst_fd, **kw)
+
+    monkeypatch.setattr(truenas_os, "fcopy_small", spy)
+    dst = tmp_path / "dst"
+    stats = copytree(str(src), str(dst), CopyTreeConfig())
+
+    assert len(native) == 2
+    assert all(kw["ns"] is not None for kw in native)
+    assert stats.bytes == 100 + truenas_os.FCOPY_SMALL_MAX
+    for name in ("small", "empty", "large"):
+        s_st, d_st = os.stat(src / name), os.stat(dst / name)
+        assert (dst / name).read_bytes() == (src / name).read_bytes()
+        assert stat.S_IMODE(d_st.st_mode) == stat.S_IMODE(s_st.st_mode)
+        assert d_st.st_mtime_ns == s_st.st_mtime_ns
+
+
+@pytest.mark.parametrize("raise_error", [True, False])
+def test_copytree_setuid_survives_owner_copy(tmp_path, raise_error):
+    # chown(2) clears S_ISUID / S_ISGID, so the owner has to be set before
+    # the mode on the native small-file path and the Python paths alike.
+    if os.geteuid() != 0:
+        pytest.skip("owner-preservation test needs root to chown")
+    src = tmp_path / "src"
+    src.mkdir()
+    (src / "small").write_bytes(b"s" * 100)
+    (src / "large").write_bytes(b"L" * truenas_os.FCOPY_SMALL_MAX)
+    for name in ("small", "large"):
+        os.chown(src / name, 12345, 12346)
+        os.chmod(src / name, 0o6755)
+    dst = tmp_path / "dst"
+
+    copytree(str(src), str(dst), CopyTreeConfig(raise_error=raise_error))
+
+    for name in ("small", "large"):
+        st = os.stat(dst / name)
+        assert (st.st_uid, st.st_gid) == (12345, 12346)
+        assert stat.S_IMODE(st.st_mode) == 0o6755
+
+
+def test_copytree_update_reconcile_keeps_setuid(tmp_path):
+    if os.geteuid() != 0:
+        pytest.skip("owner-preservation test needs root to chown")
+    src = tmp_path / "src"
+    src.mkdir()
+    (src / "prog").write_bytes(b"s" * 100)
+    os.chmod(src / "prog", 0o4755)
+    dst = tmp_path / "dst"
+    copytree(str(src), str(dst), CopyTreeConfig())
+    os.chown(src / "prog", 12345, 12346)
+    os.chmod(src / "prog", 0o4755)
+
+    stats = copytree(
+        str(src), str(dst), CopyTreeConfig(update=CopyTreeUpdate.SIZE_MTIME)
+    )
+
+    st = os.stat(dst / "prog")
+    assert stats.skipped == 1
+    assert (st.st_uid, st.st_gid) == (12345, 12346)
+    assert stat.S_IMODE(st.st_mode) == 0o4755
+
+
+@pytest.mark.parametrize("raise_error", [True, False])
+def test_copytree_small_file_large_owner_id(tmp_path, raise_error):
+    # Owner ids at or above 2**31 are valid and must reach fcopy_small intact.
+    if os.geteuid() != 0:
+        pytest.skip("owner-preservation test needs root to chown")
+    src = tmp_path / "src"
+    src.mkdir()
+    (src / "small").write_bytes(b"s")
+    os.chown(src / "small", 3_000_000_000, 3_000_000_000)
+    dst = tmp_path / "dst"
+
+    copytree(str(src), str(dst), CopyTreeConfig(raise_error=raise_error))
+
+    st = os.stat(dst / "small")
+    assert (dst / "small").read_bytes() == b"s"
+    assert (st.st_uid, st.st_gid) == (3_000_000_000, 3_000_000_000)
+
+
+def test_copytree_small_files_userspace_op_not_native(tmp_path, monkeypatch):
+    src = tmp_path / "src"
+    src.mkdir()
+    (src / "small").write_bytes(b"s" * 100)
+
+    def fail(*a, **kw):
+        raise AssertionError("fcopy_small must not be used")
+
+    monkeypatch.setattr(truenas_os, "fcopy_small", fail)
+    for op in (CopyTreeOp.USERSPACE, CopyTreeOp.CLONE):
+        dst = tmp_path / f"dst_{op.name}"
+        copytree(str(src), str(dst), CopyTreeConfig(op=op))
+        assert (dst / "small").read_bytes() == b"s" * 100
+
+
+@pytest.mark.parametrize("op,expected", [
+    (CopyTreeOp.DEFAULT, {"chunk_size": 4096, "preallocate": True, "fadvise": True}),
+    (CopyTreeOp.SENDFILE, {"chunk_size": 4096, "preallocate": True, "fadvise": True}),
+    (CopyTreeOp.CLONE, {"chunk_size": 4096, "fadvise": True}),
+    (CopyTreeOp.USERSPACE, {}),
+])
+def test_copytree_io_options_reach_copy_fn(tmp_path, monkeypatch, op, expected):
+    real = _copytree_mod._select_copy_fn(op)
+    seen = []
+
+    def spy(src_fd, dst_fd, **kw):
+        seen.append(kw)
+        return real(src_fd, dst_fd, **kw)
+
+    # Keep the runner's identity checks working on the real function.
+    select_kwargs = _copytree_mod._select_copy_kwargs
+    monkeypatch.setattr(
+        _copytree_mod, "_select_copy_kwargs",
+        lambda config, c_fn: select_kwargs(config, real),
+    )
+    monkeypatch.setattr(_copytree_mod, "_select_copy_fn", lambda op: spy)
+    src = tmp_path / "src"
+    src.mkdir()
+    payload = b"L" * (truenas_os.FCOPY_SMALL_MAX + 1)
+    (src / "large").write_bytes(payload)
+    dst = tmp_path / "dst"
+    config = CopyTreeConfig(op=op, chunk_size=4096, preallocate=True, fadvise=True)
+    try:
+        copytree(str(src), str(dst), config)
+    except OSError as e:
+        # CLONE may be unsupported by the filesystem under tmp_path.
+        assert op is CopyTreeOp.CLONE
+        assert e.errno in (errno.EXDEV, errno.EOPNOTSUPP, errno.EINVAL)
+        return
+    assert seen == [expected]
+    assert (dst / "large").read_bytes() == payload
+
+
+def test_copytree_chunk_size_must_be_positive(tmp_path):
+    src = tmp_path / "src"
+    src.mkdir()
+    with pytest.raises(ValueError):
+        copytree(str(src), str(tmp_path / "dst"), CopyTreeConfig(chunk_size=0))
+
+
+# ── durability ───────────────────────────────────────────────────────────────
+
+
+def _spy_syncs(monkeypatch):
+    calls = []
+    for name in ("fdatasync", "fsync"):
+        real = getattr(_copytree_mod, name)
+        monkeypatch.setattr(
+            _copytree_mod, name,
+            lambda fd, name=name, real=real: (calls.append(name), real(fd))[1],
+        )
+    real_syncfs = truenas_os.syncfs
+    monkeypatch.setattr(
+        truenas_os, "syncfs",
+        lambda fd: (calls.append("syncfs"), real_syncfs(fd))[1],
+    )
+    return calls
+
+
+def test_copytree_durability_none_never_syncs(tmp_path, monkeypatch):
+    calls = _spy_syncs(monkeypatch)
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    copytree(str(src), str(tmp_path / "dst"), CopyTreeConfig())
+    assert calls == []
+
+
+def test_copytree_durability_per_file(tmp_path, monkeypatch):
+    calls = _spy_syncs(monkeypatch)
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    stats = copytree(
+        str(src), str(tmp_path / "dst"),
+        CopyTreeConfig(durability=CopyTreeDurability.PER_FILE),
+    )
+    # a.txt, b.bin, sub/nested.txt; sub/, empty/ and the root.
+    assert calls.count("fdatasync") == stats.files == 3
+    assert calls.count("fsync") == stats.dirs + 1 == 3
+    assert "syncfs" not in calls
+
+
+def test_copytree_durability_end(tmp_path, monkeypatch):
+    calls = _spy_syncs(monkeypatch)
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+    dst = tmp_path / "dst"
+    before = len(os.listdir("/proc/self/fd"))
+    copytree(str(src), str(dst), CopyTreeConfig(durability=CopyTreeDurability.END))
+    assert calls == ["syncfs"]
+    assert len(os.listdir("/proc/self/fd")) == before
+    assert (dst / "sub" / "nested.txt").read_text() == "nest!"
+
+
+def test_copytree_durability_end_closes_on_error(tmp_path, monkeypatch):
+    src = tmp_path / "src"
+    src.mkdir()
+    _build_tree(src)
+
+    def fail(*a, **kw):
+        raise OSError(errno.EIO, "MOCK EIO")
+
+    monkeypatch.setattr(truenas_os, "syncfs", fail)
+    before = len(os.listdir("/proc/self/fd"))
+    with pytest.raises(OSError) as exc:
+        copytree(
+            str(src), str(tmp_path / "dst"),
+            CopyTreeConfig(durability=CopyTreeDurability.END),
+        )
+    assert exc.value.errno == errno.EIO
+    assert len(os.listdir("/proc/self/fd")) == before
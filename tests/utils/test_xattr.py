@@ -0,0 +1,107 @@
+import errno
+import os
+import socket
+import stat
+
+import pytest
+import truenas_os
+from truenas_os_pyutils.xattr import removexattrs_tree
+
+
+@pytest.fixture
+def xattr_tree(tmp_path):
+    """A small tree with user.* xattrs on every entry, plus a FIFO and a
+    symlink that must be left alone.  Yields an O_PATH fd for the root."""
+    root = tmp_path / "root"
+    (root / "a" / "b").mkdir(parents=True)
+    (root / "f1").write_bytes(b"")
+    (root / "a" / "f2").write_bytes(b"")
+    (root / "a" / "b" / "f3").write_bytes(b"")
+    os.mkfifo(root / "a" / "fifo")
+    os.symlink("f1", root / "link")
+
+    paths = [root, root / "a", root / "a" / "b",
+             root / "f1", root / "a" / "f2", root / "a" / "b" / "f3"]
+    for path in paths:
+        try:
+            os.setxattr(path, "user.stale", b"1")
+        except OSError as e:
+            if e.errno in (errno.ENOTSUP, errno.EOPNOTSUPP, errno.EPERM):
+                pytest.skip("filesystem does not support user.* xattrs")
+            raise
+        os.setxattr(path, "user.keep", b"1")
+
+    fd = os.open(root, os.O_PATH | os.O_DIRECTORY)
+    try:
+        yield fd, paths
+    finally:
+        os.close(fd)
+
+
+def test_removexattrs_tree_names(xattr_tree):
+    fd, paths = xattr_tree
+    assert removexattrs_tree(fd, names=["user.stale"]) == len(paths)
+    for path in paths:
+        assert os.listxattr(path) == ["user.keep"]
+
+
+def test_removexattrs_tree_prefix(xattr_tree):
+    fd, paths = xattr_tree
+    assert removexattrs_tree(fd, prefix="user.") == 2 * len(paths)
+    for path in paths:
+        assert os.listxattr(path) == []
+
+
+def test_removexattrs_tree_bounded_fds(xattr_tree):
+    fd, paths = xattr_tree
+    assert removexattrs_tree(fd, names=["user.keep"], max_open_dirs=2) == len(paths)
+    for path in paths:
+        assert os.listxattr(path) == ["user.stale"]
+
+
+def test_removexattrs_tree_nothing_matches(xattr_tree):
+    fd, _ = xattr_tree
+    assert removexattrs_tree(fd, names=["user.absent"]) == 0
+
+
+def test_removexattrs_tree_socket_and_device(tmp_path):
+    # Neither may be opened: a UNIX socket open fails with ENXIO, and major
+    # 240 (local/experimental) has no driver, so a device open would too.
+    # Sockets and devices only take trusted.* / security.* xattrs.
+    if os.geteuid() != 0:
+        pytest.skip("mknod and trusted.* xattrs require root")
+    root = tmp_path / "root"
+    root.mkdir()
+    sock = socket.socket(socket.AF_UNIX)
+    sock.bind(str(root / "sock"))
+    os.mknod(root / "chr", stat.S_IFCHR | 0o600, os.makedev(240, 0))
+    os.mknod(root / "blk", stat.S_IFBLK | 0o600, os.makedev(240, 0))
+    (root / "f1").write_bytes(b"")
+
+    paths = [root / "sock", root / "chr", root / "blk", root / "f1"]
+    for path in paths:
+        os.setxattr(path, "trusted.stale", b"1")
+        os.setxattr(path, "trusted.keep", b"1")
+
+    fd = os.open(root, os.O_PATH | os.O_DIRECTORY)
+    try:
+        assert removexattrs_tree(fd, names=["trusted.stale"]) == len(paths)
+        for path in paths:
+            assert os.listxattr(path) == ["trusted.keep"]
+        assert removexattrs_tree(fd, prefix="trusted.") == len(paths)
+        for path in paths:
+            assert os.listxattr(path) == []
+    finally:
+        os.close(fd)
+        sock.close()
+
+
+def test_removexattrs_tree_not_a_directory(tmp_path):
+    path = tmp_path / "file"
+    path.write_bytes(b"")
+    fd = os.open(path, os.O_PATH)
+    try:
+        with pytest.raises(NotADirectoryError):
+            removexattrs_tree(fd)
+    finally:
+        os.close(fd)